@@ -31,7 +31,12 @@ layout (std140) uniform PointLightArray {
 #endif
 
 // Animation Data
-uniform mat4 bone_transforms[BONE_TRANSFORMS];
+// Every entity's bone transforms for the frame, each a column-major mat4 over 4 texels
+uniform samplerBuffer bone_palette;
+// The index of this mesh's first bone in bone_palette
+uniform int bone_offset;
+// The number of bones this mesh has, weights on bones past it would read another mesh's (or entity's) bones
+uniform int bone_count;
 
 // Global data
 uniform vec3 ws_view_position;
@@ -39,18 +44,34 @@ uniform mat4 projection_view_matrix;
 
 uniform sampler2D specular_map_texture;
 
+mat4 bone_transform(uint bone) {
+    int texel = (bone_offset + int(bone)) * 4;
+    return mat4(
+        texelFetch(bone_palette, texel),
+        texelFetch(bone_palette, texel + 1),
+        texelFetch(bone_palette, texel + 2),
+        texelFetch(bone_palette, texel + 3)
+    );
+}
+
+// Skipped rather than multiplied by zero, since a texel past the end of the palette could hold anything, including NaNs
+mat4 weighted_bone_transform(float weight, uint bone) {
+    return weight != 0.0f ? weight * bone_transform(bone) : mat4(0.0f);
+}
+
 void main() {
-    // Transform vertices
-    float sum = dot(bone_weights, vec4(1.0f));
-
-    mat4 bone_transform =
-        bone_weights[0] * bone_transforms[bone_indices[0]]
-        + bone_weights[1] * bone_transforms[bone_indices[1]]
-        + bone_weights[2] * bone_transforms[bone_indices[2]]
-        + bone_weights[3] * bone_transforms[bone_indices[3]]
+    // Transform vertices, dropping weights on out of range bones the same way the vertex animation bake does
+    vec4 weights = mix(vec4(0.0f), bone_weights, lessThan(bone_indices, uvec4(bone_count)));
+    float sum = dot(weights, vec4(1.0f));
+
+    mat4 skin_transform =
+        weighted_bone_transform(weights[0], bone_indices[0])
+        + weighted_bone_transform(weights[1], bone_indices[1])
+        + weighted_bone_transform(weights[2], bone_indices[2])
+        + weighted_bone_transform(weights[3], bone_indices[3])
         + (1.0f - sum) * mat4(1.0f);
 
-    mat4 animation_matrix = model_matrix * bone_transform;
+    mat4 animation_matrix = model_matrix * skin_transform;
     mat3 normal_matrix = cofactor(animation_matrix);
 
     vec3 ws_position = (animation_matrix * vec4(vertex_position, 1.0f)).xyz;
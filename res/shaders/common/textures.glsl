@@ -0,0 +1,14 @@
+// Sample either a standalone texture, or a layer of a texture array when layer >= 0.
+// The layer is set per draw as a uniform, so only one of the two is ever sampled for a given entity.
+vec4 sample_texture(sampler2D standalone_texture, sampler2DArray texture_array, int layer, vec2 texture_coordinate) {
+    if (layer < 0) {
+        return texture(standalone_texture, texture_coordinate);
+    }
+    return texture(texture_array, vec3(texture_coordinate, float(layer)));
+}
+
+// Textures are stored unflipped, so a vertical flip is applied to the (already scaled) coordinates instead,
+// which lets both flips of a texture share the same storage.
+vec2 flip_texture_coordinate(vec2 texture_coordinate, bool flipped) {
+    return flipped ? vec2(texture_coordinate.x, 1.0 - texture_coordinate.y) : texture_coordinate;
+}
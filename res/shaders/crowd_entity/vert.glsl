@@ -0,0 +1,103 @@
+#version 410 core
+#include "../common/lights.glsl"
+#include "../common/maths.glsl"
+
+// Per vertex data, the position and normal come from the vertex animation instead
+layout(location = 2) in vec2 texture_coordinate;
+
+out VertexOut {
+    LightingResult lighting_result;
+    vec2 texture_coordinate;
+} vertex_out;
+
+// Per instance data
+uniform mat4 model_matrix;
+
+// Material properties
+uniform vec3 diffuse_tint;
+uniform vec3 specular_tint;
+uniform vec3 ambient_tint;
+uniform float shininess;
+
+// Light Data
+#if NUM_PL > 0
+layout (std140) uniform PointLightArray {
+    PointLightData point_lights[NUM_PL];
+};
+#endif
+
+// Vertex animation data
+// [frame * vertex_count + vertex] -> the vertex's position as float bits in xyz, and its normal octahedrally encoded as two snorm16s in w
+uniform usamplerBuffer vertex_animation;
+uniform int vertex_count;
+// Where this mesh's vertices start in each frame, less its base vertex, since gl_VertexID includes that
+uniform int vertex_base;
+
+// [animation_id] -> (first frame, frame count, duration in seconds, unused) of the clip
+uniform samplerBuffer clips;
+
+// Per member data, 5 texels each, the columns of the member's transform relative to the crowd, then (animation_id, time offset, speed, unused)
+uniform samplerBuffer crowd_members;
+// The crowd's time, which each member scales by its speed and offsets to find where it is in its clip
+uniform float crowd_time;
+
+// Global data
+uniform vec3 ws_view_position;
+uniform mat4 projection_view_matrix;
+
+vec3 decode_octahedral(uint bits) {
+    vec2 octahedral = clamp(vec2(bitfieldExtract(int(bits), 0, 16), bitfieldExtract(int(bits), 16, 16)) / 32767.0f, -1.0f, 1.0f);
+    vec3 normal = vec3(octahedral, 1.0f - abs(octahedral.x) - abs(octahedral.y));
+    if (normal.z < 0.0f) {
+        normal.xy = (1.0f - abs(normal.yx)) * vec2(normal.x >= 0.0f ? 1.0f : -1.0f, normal.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return normalize(normal);
+}
+
+void main() {
+    int member = gl_InstanceID * 5;
+    mat4 member_matrix = model_matrix * mat4(
+        texelFetch(crowd_members, member),
+        texelFetch(crowd_members, member + 1),
+        texelFetch(crowd_members, member + 2),
+        texelFetch(crowd_members, member + 3)
+    );
+    vec4 playback = texelFetch(crowd_members, member + 4);
+
+    // Loop the member's clip, and find the baked frames either side of where it is in it
+    vec4 clip = texelFetch(clips, int(playback.x));
+    int first_frame = int(clip.x);
+    int frame_count = int(clip.y);
+    float duration = clip.z;
+    float time = crowd_time * playback.z + playback.y;
+    float frame = duration > 0.0f ? clamp((time - floor(time / duration) * duration) / duration, 0.0f, 1.0f) * float(frame_count - 1) : 0.0f;
+    int whole = min(int(frame), frame_count - 2);
+    int frame_a = first_frame + whole;
+    float t = frame - float(whole);
+
+    // Blend the vertex between the two frames
+    int vertex = vertex_base + gl_VertexID;
+    uvec4 vertex_a = texelFetch(vertex_animation, frame_a * vertex_count + vertex);
+    uvec4 vertex_b = texelFetch(vertex_animation, (frame_a + 1) * vertex_count + vertex);
+    vec3 position = mix(uintBitsToFloat(vertex_a.xyz), uintBitsToFloat(vertex_b.xyz), t);
+    vec3 normal = mix(decode_octahedral(vertex_a.w), decode_octahedral(vertex_b.w), t);
+
+    mat3 normal_matrix = cofactor(member_matrix);
+
+    vec3 ws_position = (member_matrix * vec4(position, 1.0f)).xyz;
+    vec3 ws_normal = normalize(normal_matrix * normal);
+    vertex_out.texture_coordinate = texture_coordinate;
+
+    gl_Position = projection_view_matrix * vec4(ws_position, 1.0f);
+
+    // Per vertex light calcs are below this point
+    vec3 ws_view_dir = normalize(ws_view_position - ws_position);
+    LightCalculatioData light_calculation_data = LightCalculatioData(ws_position, ws_view_dir, ws_normal);
+    Material material = Material(diffuse_tint, specular_tint, ambient_tint, shininess);
+
+    vertex_out.lighting_result = total_light_calculation(light_calculation_data, material
+        #if NUM_PL > 0
+        ,point_lights
+        #endif
+    );
+}
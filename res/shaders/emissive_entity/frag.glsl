@@ -1,4 +1,5 @@
 #version 410 core
+#include "../common/textures.glsl"
 
 in VertexOut {
     vec3 ws_position;
@@ -16,11 +17,17 @@ uniform float inverse_gamma;
 
 uniform sampler2D emissive_texture;
 
+// Used instead of the above when the texture is a layer of a texture array (layer >= 0)
+uniform sampler2DArray emissive_texture_array;
+uniform int emissive_texture_layer;
+// Whether to flip the texture vertically, see flip_texture_coordinate
+uniform bool emissive_texture_flipped;
+
 void main() {
     // Apply texture scaling to coordinates
-    vec2 scaled_texture_coords = frag_in.texture_coordinate * emission_texture_scale;
+    vec2 scaled_texture_coords = flip_texture_coordinate(frag_in.texture_coordinate * emission_texture_scale, emissive_texture_flipped);
     
-    vec3 texture_colour = texture(emissive_texture, scaled_texture_coords).rgb;
+    vec3 texture_colour = sample_texture(emissive_texture, emissive_texture_array, emissive_texture_layer, scaled_texture_coords).rgb;
     vec3 emissive_colour = emissive_tint * texture_colour;
 
     out_colour = vec4(emissive_colour, 1.0f);
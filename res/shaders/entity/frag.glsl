@@ -1,5 +1,6 @@
 #version 410 core
 #include "../common/lights.glsl"
+#include "../common/textures.glsl"
 
 in VertexOut {
     LightingResult lighting_result;
@@ -18,14 +19,28 @@ uniform vec2 specular_texture_scale;
 uniform sampler2D diffuse_texture;
 uniform sampler2D specular_map_texture;
 
+// Used instead of the above when the texture is a layer of a texture array (layer >= 0)
+uniform sampler2DArray diffuse_texture_array;
+uniform sampler2DArray specular_map_texture_array;
+uniform int diffuse_texture_layer;
+uniform int specular_map_texture_layer;
+// Whether to flip each texture vertically, see flip_texture_coordinate
+uniform bool diffuse_texture_flipped;
+uniform bool specular_map_texture_flipped;
+// Set when the specular map is packed into the diffuse texture's alpha, in which case only the diffuse texture is bound
+uniform bool specular_in_diffuse_alpha;
+
 void main() {
     // Apply texture scaling to coordinates
-    vec2 scaled_diffuse_coords = frag_in.texture_coordinate * diffuse_texture_scale;
-    vec2 scaled_specular_coords = frag_in.texture_coordinate * specular_texture_scale;
+    vec2 scaled_diffuse_coords = flip_texture_coordinate(frag_in.texture_coordinate * diffuse_texture_scale, diffuse_texture_flipped);
+    vec2 scaled_specular_coords = flip_texture_coordinate(frag_in.texture_coordinate * specular_texture_scale, specular_map_texture_flipped);
     
     // Use the scaled texture coordinates for sampling
-    vec3 texture_colour = texture(diffuse_texture, scaled_diffuse_coords).rgb;
-    vec3 specular_map_sample = texture(specular_map_texture, scaled_specular_coords).rgb;
+    vec4 diffuse_sample = sample_texture(diffuse_texture, diffuse_texture_array, diffuse_texture_layer, scaled_diffuse_coords);
+    vec3 texture_colour = diffuse_sample.rgb;
+    vec3 specular_map_sample = specular_in_diffuse_alpha
+        ? vec3(diffuse_sample.a)
+        : sample_texture(specular_map_texture, specular_map_texture_array, specular_map_texture_layer, scaled_specular_coords).rgb;
 
     vec3 textured_diffuse = frag_in.lighting_result.total_diffuse * texture_colour;
     vec3 sampled_specular = frag_in.lighting_result.total_specular * specular_map_sample;
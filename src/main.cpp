@@ -2,8 +2,11 @@
 #include "rendering/imgui/ImGuiManager.h"
 #include "utility/OpenGL.h"
 #include "utility/PerformanceCounter.h"
+#include "utility/Benchmarks.h"
 #include "rendering/resources/ModelLoader.h"
 #include "rendering/resources/TextureLoader.h"
+#include "rendering/resources/AssetBudget.h"
+#include "rendering/resources/UploadThread.h"
 #include "rendering/renders/MasterRenderer.h"
 #include "scene/SceneManager.h"
 #include "scene/SceneInterface.h"
@@ -29,6 +32,9 @@ int main() {
     OpenGL::load_functions();
     OpenGL::setup_debug_callback();
 
+    // A hidden window, just for its OpenGL context, which shares objects with the main window's so that uploads can run on another thread
+    auto upload_window = window_manager.create_shared_context_window(window);
+
     // Scope is to ensure that MasterRenderer destructor runs before the OpenGL context is destroyed
     {
         // Initialise ImGui to be used
@@ -40,9 +46,18 @@ int main() {
         // Create an instance of the MasterRenderer which controls all the rendering
         MasterRenderer master_renderer{};
 
+        // Runs the loaders' buffer and texture uploads, needs to outlive them and anything holding their handles
+        UploadThread upload_thread{upload_window};
+
+        // Keeps track of the memory used by loaded assets, and keeps recently released ones around until it is needed
+        AssetBudget asset_budget{};
+
         // Set up the model and texture loads, pointing them to a relative path to look in for files.
-        ModelLoader model_loader{"res/models"};
-        TextureLoader texture_loader{"res/textures"};
+        ModelLoader model_loader{"res/models", asset_budget};
+        TextureLoader texture_loader{"res/textures", asset_budget};
+
+        // On demand benchmarks of the asset pipeline
+        Benchmarks benchmarks{model_loader};
 
         // Create a scene manager and give it two scene constructors, one for the editor scene,
         // and another for an example second scene, this one just being a simple static scene.
@@ -91,13 +106,24 @@ int main() {
                 if (ImGui::Begin("Options & Info", nullptr, ImGuiWindowFlags_NoFocusOnAppearing)) {
                     scene_manager.add_imgui_options_section(scene_context);
                     master_renderer.add_imgui_options_section(window_manager);
+                    model_loader.add_imgui_options_section();
+                    texture_loader.add_imgui_options_section();
+                    asset_budget.add_imgui_options_section();
+                    upload_thread.add_imgui_options_section();
                     performance_counter.add_imgui_options_section((float) window_manager.get_delta_time());
+                    benchmarks.add_imgui_options_section();
                 }
                 ImGui::End();
             }
 
+            // Pick up any changes to asset files, re-importing them in place
+            model_loader.update();
+            texture_loader.update();
+
             // Tick the scene, so it can do per-frame logic
             scene_manager.tick_scene(scene_context);
+            // Now the scene has had a chance to release assets, move them to warm and evict any that are over budget
+            asset_budget.update();
             // Tell the MasterRenderer to use render the current scene to the window
             master_renderer.render_scene(scene_manager.get_current_scene()->get_render_scene(), scene_context);
 
@@ -116,12 +142,15 @@ int main() {
         // Cleanup some resources now that the program is closing
         scene_manager.cleanup(scene_context);
 
+        asset_budget.cleanup();
         texture_loader.cleanup();
         model_loader.cleanup();
 
         ImGuiManager::cleanup();
     }
 
+    // The upload thread has stopped, so its context can go, before the context it shares with
+    window_manager.destroy_window(upload_window);
     // Lastly destroy the window which will also destroy the OpenGL context, which is why it needs to be last
     window_manager.destroy_window(window);
     WindowManager::cleanup();
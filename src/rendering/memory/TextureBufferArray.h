@@ -0,0 +1,88 @@
+#ifndef TEXTURE_BUFFER_ARRAY_H
+#define TEXTURE_BUFFER_ARRAY_H
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <glad/gl.h>
+
+#include "utility/HelperTypes.h"
+
+/// A helper class that abstracts over a buffer texture, a buffer that shaders read a texel at a time with texelFetch on a samplerBuffer,
+/// as a type safe array that grows to fit. For data that is rewritten every frame and too large, or too variable in size, for a uniform array.
+template<typename T>
+class TextureBufferArray : NonCopyable {
+    static constexpr size_t TEXEL_BYTES = 16;
+    static_assert(sizeof(T) % TEXEL_BYTES == 0, "TextureBufferArray elements must be a whole number of 4 component 32 bit texels");
+
+    uint buffer = 0;
+    uint texture = 0;
+    // The number of elements the buffer has room for
+    size_t capacity = 0;
+    // The most texels a buffer texture may hold on this driver
+    size_t max_texels = 0;
+public:
+    /// The CPU side buffer that will be mirrored on the GPU
+    std::vector<T> data{};
+
+    /// internal_format is the format of each texel, a 4 component 32 bit one such as GL_RGBA32F, and T must be a whole number of texels
+    explicit TextureBufferArray(uint internal_format);
+    /// Upload the CPU side to the GPU, growing the buffer if it needs to. The old contents are orphaned rather than overwritten,
+    /// so that this doesn't have to wait for draws still reading them.
+    void upload();
+    /// The id to bind to GL_TEXTURE_BUFFER, such as with TextureBindings
+    [[nodiscard]] uint get_texture_id() const;
+
+    ~TextureBufferArray();
+};
+
+template<typename T>
+TextureBufferArray<T>::TextureBufferArray(uint internal_format) {
+    int max_texture_buffer_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texture_buffer_size);
+    max_texels = (size_t) max_texture_buffer_size;
+
+    // Never empty, since a buffer texture over an empty buffer is incomplete
+    capacity = 1;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, (long) (capacity * sizeof(T)), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, internal_format, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+template<typename T>
+void TextureBufferArray<T>::upload() {
+    if (data.empty()) return;
+
+    size_t max_elements = max_texels * TEXEL_BYTES / sizeof(T);
+    if (data.size() > max_elements) {
+        throw std::runtime_error(Formatter() << "TextureBufferArray of " << data.size() << " elements exceeds GL_MAX_TEXTURE_BUFFER_SIZE, which fits " << max_elements);
+    }
+    if (data.size() > capacity) {
+        // Grown by half again, so a slowly growing scene doesn't reallocate every frame. The texture follows the buffer object, so isn't affected.
+        capacity = std::min(std::max(data.size(), capacity + capacity / 2), max_elements);
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, (long) (capacity * sizeof(T)), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, (long) (data.size() * sizeof(T)), data.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+template<typename T>
+uint TextureBufferArray<T>::get_texture_id() const {
+    return texture;
+}
+
+template<typename T>
+TextureBufferArray<T>::~TextureBufferArray() {
+    glDeleteTextures(1, &texture);
+    glDeleteBuffers(1, &buffer);
+}
+
+#endif //TEXTURE_BUFFER_ARRAY_H
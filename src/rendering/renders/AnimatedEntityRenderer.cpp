@@ -1,31 +1,189 @@
 #include "AnimatedEntityRenderer.h"
 
+#include <chrono>
+#include <algorithm>
+
+#include "rendering/imgui/ImGuiManager.h"
+#include "utility/ThreadPool.h"
+
 AnimatedEntityRenderer::AnimatedEntityShader::AnimatedEntityShader() :
-    BaseLitEntityShader("Animated Entity", "animated_entity/vert.glsl", "animated_entity/frag.glsl", {{"BONE_TRANSFORMS", BONE_TRANSFORMS_STR}}) {
+    BaseLitEntityShader("Animated Entity", "animated_entity/vert.glsl", "animated_entity/frag.glsl") {
 
     get_uniforms_set_bindings();
 }
 
 void AnimatedEntityRenderer::AnimatedEntityShader::get_uniforms_set_bindings() {
     BaseLitEntityShader::get_uniforms_set_bindings(); // Call the base implementation to load all the common uniforms
-    bone_transforms_location = get_uniform_location("bone_transforms");
+    bone_offset_location = get_uniform_location("bone_offset");
+    bone_count_location = get_uniform_location("bone_count");
+    set_binding("bone_palette", BONE_PALETTE_TEXTURE_UNIT);
 }
 
 void AnimatedEntityRenderer::AnimatedEntityShader::set_model_matrix(const glm::mat4& model_matrix) {
     glProgramUniformMatrix4fv(id(), model_matrix_location, 1, GL_FALSE, &model_matrix[0][0]);
 }
 
-void AnimatedEntityRenderer::AnimatedEntityShader::set_bone_transforms(const std::vector<glm::mat4>& bone_transforms) {
-    glProgramUniformMatrix4fv(id(), bone_transforms_location, std::min(BONE_TRANSFORMS, (int) bone_transforms.size()), GL_FALSE, &bone_transforms[0][0][0]);
+void AnimatedEntityRenderer::AnimatedEntityShader::set_bone_offset(uint bone_offset) {
+    glProgramUniform1i(id(), bone_offset_location, (int) bone_offset);
+}
+
+void AnimatedEntityRenderer::AnimatedEntityShader::set_bone_count(uint bone_count) {
+    glProgramUniform1i(id(), bone_count_location, (int) bone_count);
+}
+
+namespace {
+    // The skin reaches past the joints that the pose's bounds are fitted to, so they are padded out to roughly cover the mesh
+    constexpr float POSE_BOUNDS_PADDING = 1.5f;
+
+    struct ScreenBounds {
+        bool visible;
+        // The fraction of the viewport's height covered
+        float size;
+    };
+
+    /// Where the pose's bounds land on screen, placed by the model matrix
+    ScreenBounds screen_bounds(const glm::mat4& projection_view, const glm::mat4& model_matrix, const AnimationPose& pose) {
+        glm::vec4 center = model_matrix * glm::vec4{pose.bounds_center, 1.0f};
+        float scale = std::max({glm::length(glm::vec3{model_matrix[0]}), glm::length(glm::vec3{model_matrix[1]}), glm::length(glm::vec3{model_matrix[2]})});
+        float radius = pose.bounds_radius * POSE_BOUNDS_PADDING * scale;
+
+        glm::vec4 rows[4];
+        for (int r = 0; r < 4; ++r) {
+            rows[r] = glm::vec4{projection_view[0][r], projection_view[1][r], projection_view[2][r], projection_view[3][r]};
+        }
+        // The sphere is off screen if it is entirely outside any of the 6 planes of the view frustum, which are sums of the rows
+        bool visible = true;
+        for (int r = 0; r < 3 && visible; ++r) {
+            for (float sign: {1.0f, -1.0f}) {
+                glm::vec4 plane = rows[3] + sign * rows[r];
+                if (glm::dot(plane, center) < -radius * glm::length(glm::vec3{plane})) {
+                    visible = false;
+                    break;
+                }
+            }
+        }
+
+        // The y row is the projection's vertical scale times the camera's up axis, so its length turns a size at depth w into one on screen
+        float w = glm::dot(rows[3], center);
+        float size = w > radius ? radius * glm::length(glm::vec3{rows[1]}) / w : 1.0f;
+        return {visible, size};
+    }
 }
 
 AnimatedEntityRenderer::AnimatedEntityRenderer::AnimatedEntityRenderer() : shader() {}
 
+void AnimatedEntityRenderer::AnimatedEntityRenderer::evaluate_poses(const RenderScene& render_scene) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Sharing poses has to be settled up front, so the entities left to evaluate are independent of each other
+    pose_cache.begin_frame();
+    pose_frame++;
+    lod_stats = {};
+    // [(entity, animated_node_limit)]
+    std::vector<std::pair<Entity*, uint>> to_evaluate{};
+    for (const auto& entity: render_scene.entities) {
+        const auto& hierarchy = entity->mesh_hierarchy;
+        uint animated_node_limit = UINT_MAX;
+        // A pose for another hierarchy or animation, or the hierarchy from before it was reloaded, can't stand in for a skipped frame
+        bool stale = entity->pose == nullptr || entity->pose_hierarchy.lock() != hierarchy
+                     || entity->pose_animation_id != entity->animation_id || entity->pose_version != hierarchy->version;
+        if (lod_settings.enabled) {
+            auto [visible, size] = stale ? ScreenBounds{true, 1.0f} : screen_bounds(render_scene.global_data.projection_view_matrix, entity->instance_data.model_matrix, *entity->pose);
+            uint64_t interval = 1;
+            if (!visible && lod_settings.skip_offscreen) {
+                lod_stats.offscreen++;
+                interval = 0;
+            } else if (size >= lod_settings.half_rate_size) {
+                lod_stats.full_rate++;
+            } else if (size >= lod_settings.quarter_rate_size) {
+                lod_stats.half_rate++;
+                interval = 2;
+            } else {
+                lod_stats.quarter_rate++;
+                interval = 4;
+            }
+            if (interval != 0 && size < lod_settings.reduced_bones_size) {
+                lod_stats.reduced_bones++;
+                animated_node_limit = hierarchy->get_animated_node_limit(lod_settings.reduced_bone_fraction);
+            }
+
+            // Entities on the same interval are spread over its frames by their address, rather than all updating in the same one
+            auto phase = (uint64_t) reinterpret_cast<uintptr_t>(entity.get()) / sizeof(Entity);
+            if (!stale && (interval == 0 || (pose_frame + phase) % interval != 0)) {
+                lod_stats.skipped++;
+                continue;
+            }
+        }
+
+        entity->pose_hierarchy = hierarchy;
+        entity->pose_animation_id = entity->animation_id;
+        entity->pose_version = hierarchy->version;
+        if (pose_cache.acquire(hierarchy, entity->animation_id, entity->animation_time_seconds, animated_node_limit, entity->pose)) {
+            to_evaluate.emplace_back(entity.get(), animated_node_limit);
+        }
+    }
+
+    auto evaluate = [this, &to_evaluate](size_t i) {
+        auto [entity, animated_node_limit] = to_evaluate[i];
+        entity->mesh_hierarchy->calculate_animation(entity->animation_id, entity->animation_time_seconds, entity->animation_cursors, *entity->pose,
+                                                    bake_settings, animated_node_limit);
+    };
+    if (parallel_poses) {
+        ThreadPool::shared().parallel_for(to_evaluate.size(), evaluate);
+    } else {
+        for (size_t i = 0; i < to_evaluate.size(); ++i) evaluate(i);
+    }
+
+    pose_stage_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Clips baked at a rate no longer in use are freed, and all of them once baking is turned off
+    baked_clip_stats.clear();
+    std::unordered_set<const MeshHierarchy<VertexData>*> hierarchies{};
+    for (const auto& entity: render_scene.entities) {
+        const auto* hierarchy = entity->mesh_hierarchy.get();
+        if (!hierarchies.insert(hierarchy).second) continue;
+        if (!bake_settings.enabled) {
+            hierarchy->clear_baked_clips();
+            continue;
+        }
+        for (const auto& [animation_id, clip]: hierarchy->get_baked_clips()) {
+            if (clip->sample_rate != bake_settings.sample_rate) continue;
+            std::string name = Formatter() << hierarchy->filename.value_or("[Generated]") << " / " << std::get<0>(hierarchy->animations[animation_id]);
+            baked_clip_stats.push_back({std::move(name), clip});
+        }
+    }
+}
+
 void AnimatedEntityRenderer::AnimatedEntityRenderer::render(const RenderScene& render_scene, const LightScene& light_scene) {
     shader.use();
     shader.set_global_data(render_scene.global_data);
 
+    // Draw entities in buckets of matching textures, so that entities whose textures share a texture array don't need a rebind
+    std::vector<const Entity*> sorted_entities{};
+    sorted_entities.reserve(render_scene.entities.size());
     for (const auto& entity: render_scene.entities) {
+        sorted_entities.push_back(entity.get());
+    }
+    std::sort(sorted_entities.begin(), sorted_entities.end(), [](const Entity* a, const Entity* b) {
+        return BaseLitEntityShader::binding_ids(a->render_data, a->instance_data.material) < BaseLitEntityShader::binding_ids(b->render_data, b->instance_data.material);
+    });
+
+    // Gather every pose into the palette, once however many entities share it, and upload them all at once
+    bone_palette.data.clear();
+    std::unordered_map<const AnimationPose*, uint> palette_offsets{};
+    for (const auto& entity: sorted_entities) {
+        auto [offset, inserted] = palette_offsets.try_emplace(entity->pose.get(), (uint) bone_palette.data.size());
+        if (inserted) {
+            bone_palette.data.insert(bone_palette.data.end(), entity->pose->bone_transforms.begin(), entity->pose->bone_transforms.end());
+        }
+    }
+    bone_palette.upload();
+
+    TextureBindings texture_bindings{};
+    texture_bindings.bind(AnimatedEntityShader::BONE_PALETTE_TEXTURE_UNIT, GL_TEXTURE_BUFFER, bone_palette.get_texture_id());
+
+    for (const auto& entity: sorted_entities) {
+        uint palette_offset = palette_offsets[entity->pose.get()];
         shader.set_instance_data(entity->instance_data);
 
         glm::vec3 position = entity->instance_data.model_matrix[3];
@@ -37,23 +195,21 @@ void AnimatedEntityRenderer::AnimatedEntityRenderer::render(const RenderScene& r
         // Just make sure to be careful of this kind of thing.
         shader.set_point_lights(light_scene.get_nearest_point_lights(position, BaseLitEntityShader::MAX_PL, 1));
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, entity->render_data.diffuse_texture->get_texture_id());
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, entity->render_data.specular_map_texture->get_texture_id());
+        shader.bind_textures(texture_bindings, entity->render_data, entity->instance_data.material);
 
-        entity->mesh_hierarchy->calculate_animation(entity->animation_id, entity->animation_time_seconds);
-        entity->mesh_hierarchy->visit_nodes([this, &entity](const MeshHierarchyNode& node, glm::mat4 accumulated_transformation) {
+        for (const auto& node: entity->mesh_hierarchy->nodes) {
             for (const auto& mesh_id: node.meshes) {
                 const auto& mesh = entity->mesh_hierarchy->meshes[mesh_id];
 
-                shader.set_model_matrix(entity->instance_data.model_matrix * accumulated_transformation);
-                if (!mesh.bone_transforms.empty()) shader.set_bone_transforms(mesh.bone_transforms);
+                shader.set_model_matrix(entity->instance_data.model_matrix * node.global_transformation);
+                // Set for meshes without bones too, so that the offset is never left over from the previous draw
+                shader.set_bone_offset(palette_offset + entity->mesh_hierarchy->first_bones[mesh_id]);
+                shader.set_bone_count((uint) mesh.bones.size());
 
                 glBindVertexArray(mesh.model->get_vao());
                 glDrawElementsBaseVertex(GL_TRIANGLES, mesh.model->get_index_count(), GL_UNSIGNED_INT, nullptr, mesh.model->get_vertex_offset());
             }
-        });
+        }
     }
 }
 
@@ -61,6 +217,114 @@ bool AnimatedEntityRenderer::AnimatedEntityRenderer::refresh_shaders() {
     return shader.reload_files();
 }
 
+void AnimatedEntityRenderer::AnimatedEntityRenderer::add_imgui_options_section() {
+    if (ImGui::CollapsingHeader("Animation")) {
+        ImGui::Checkbox("Evaluate Poses In Parallel", &parallel_poses);
+        ImGui::SameLine();
+        ImGui::HelpMarker("Spread the evaluation of every animated entity's pose across all the cores, before any are drawn.");
+
+        bool share_poses = pose_cache.get_enabled();
+        if (ImGui::Checkbox("Share Identical Poses", &share_poses)) {
+            pose_cache.set_enabled(share_poses);
+        }
+        ImGui::SameLine();
+        ImGui::HelpMarker("Entities playing the same animation of the same model at exactly the same time share a single evaluation of the pose, such as a crowd started together. Paused entities also reuse their pose from the last frame.");
+
+        if (ImGui::BeginCombo("Pose Kernels", PoseKernels::level_name(PoseKernels::get_level()))) {
+            for (auto level: {PoseKernels::Level::Scalar, PoseKernels::Level::SSE, PoseKernels::Level::AVX2}) {
+                if (!PoseKernels::is_supported(level)) continue;
+                if (ImGui::Selectable(PoseKernels::level_name(level), level == PoseKernels::get_level())) {
+                    PoseKernels::set_level(level);
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::SameLine();
+        ImGui::HelpMarker("The instruction set used to interpolate and compose node transforms, several nodes at a time, and to apply the bone offsets. Starts at the widest this CPU supports, only the supported ones are listed.");
+
+        ImGui::Separator();
+
+        ImGui::Checkbox("Bake Clips", &bake_settings.enabled);
+        ImGui::SameLine();
+        ImGui::HelpMarker("Evaluate every bone of a clip at a fixed rate the first time it plays, then play it back from that table with no key search or hierarchy walk. Uses more memory the higher the rate, in exchange for less error between frames.");
+        if (bake_settings.enabled) {
+            int sample_rate = (int) bake_settings.sample_rate;
+            if (ImGui::SliderInt("Bake Rate (Hz)", &sample_rate, 5, 120)) {
+                bake_settings.sample_rate = (float) sample_rate;
+            }
+            ImGui::SameLine();
+            ImGui::HelpMarker("Changing the rate bakes each clip again the next time it plays.");
+            ImGui::Checkbox("Blend Baked Frames", &bake_settings.blend);
+            ImGui::SameLine();
+            ImGui::HelpMarker("Blend the two frames either side of the time, rather than snapping to the nearest one. Snapping is cheaper, but steps visibly at low rates.");
+
+            size_t total_bytes = 0;
+            for (const auto& [name, clip]: baked_clip_stats) {
+                total_bytes += clip->get_bytes();
+                ImGui::Text("%s: %u frames, %.1f KiB, error %.4f blended, %.4f nearest", name.c_str(), clip->frame_count, (double) clip->get_bytes() / 1024.0,
+                            clip->blend_error, clip->nearest_error);
+            }
+            ImGui::Text("Baked clips: %zu, %.2f MiB", baked_clip_stats.size(), (double) total_bytes / (1024.0 * 1024.0));
+        }
+
+        ImGui::Separator();
+
+        ImGui::Checkbox("Animation Level Of Detail", &lod_settings.enabled);
+        ImGui::SameLine();
+        ImGui::HelpMarker("Evaluate the poses of entities that are small on screen less often, and with only their most important bones animated, and leave entities that are off screen in their last pose. Their animations carry on playing either way.");
+        if (lod_settings.enabled) {
+            ImGui::SliderFloat("Half Rate Below", &lod_settings.half_rate_size, 0.0f, 1.0f);
+            ImGui::SameLine();
+            ImGui::HelpMarker("The fraction of the screen's height an entity covers below which its pose is evaluated every 2nd frame.");
+            ImGui::SliderFloat("Quarter Rate Below", &lod_settings.quarter_rate_size, 0.0f, 1.0f);
+            ImGui::SameLine();
+            ImGui::HelpMarker("The fraction of the screen's height an entity covers below which its pose is evaluated every 4th frame.");
+            ImGui::SliderFloat("Reduced Bones Below", &lod_settings.reduced_bones_size, 0.0f, 1.0f);
+            ImGui::SameLine();
+            ImGui::HelpMarker("The fraction of the screen's height an entity covers below which only its most important bones are animated, the rest holding their rest pose. Bones are ranked by how many bones they move, so the hips and spine come long before the fingers.");
+            ImGui::SliderFloat("Bones Kept", &lod_settings.reduced_bone_fraction, 0.0f, 1.0f);
+            ImGui::SameLine();
+            ImGui::HelpMarker("The fraction of the bones still animated at reduced detail.");
+            ImGui::Checkbox("Skip Offscreen Entities", &lod_settings.skip_offscreen);
+            ImGui::SameLine();
+            ImGui::HelpMarker("Entities outside the view keep their last pose until they come back into it.");
+
+            ImGui::Text("Full rate: %u, half rate: %u, quarter rate: %u, offscreen: %u", lod_stats.full_rate, lod_stats.half_rate, lod_stats.quarter_rate, lod_stats.offscreen);
+            ImGui::Text("Reduced bones: %u, kept last pose: %u", lod_stats.reduced_bones, lod_stats.skipped);
+        }
+
+        ImGui::Separator();
+
+        ImGui::Text("Poses evaluated: %u, reused: %u", pose_cache.get_last_frame_evaluations(), pose_cache.get_last_frame_reused());
+        ImGui::Text("Bone palette: %zu bones, %.1f KiB", bone_palette.data.size(), (double) (bone_palette.data.size() * sizeof(glm::mat4)) / 1024.0);
+        ImGui::Text("Animation stage: %.3f ms", pose_stage_ms);
+    }
+}
+
+void AnimatedEntityRenderer::AnimatedEntityRenderer::set_parallel_poses(bool enabled) {
+    parallel_poses = enabled;
+}
+
+bool AnimatedEntityRenderer::AnimatedEntityRenderer::get_parallel_poses() const {
+    return parallel_poses;
+}
+
+void AnimatedEntityRenderer::AnimatedEntityRenderer::set_bake_settings(const PoseBakeSettings& settings) {
+    bake_settings = settings;
+}
+
+const PoseBakeSettings& AnimatedEntityRenderer::AnimatedEntityRenderer::get_bake_settings() const {
+    return bake_settings;
+}
+
+void AnimatedEntityRenderer::AnimatedEntityRenderer::set_lod_settings(const AnimationLodSettings& settings) {
+    lod_settings = settings;
+}
+
+const AnimatedEntityRenderer::AnimationLodSettings& AnimatedEntityRenderer::AnimatedEntityRenderer::get_lod_settings() const {
+    return lod_settings;
+}
+
 void AnimatedEntityRenderer::VertexData::from_mesh(const VertexCollection& vertex_collection, std::vector<VertexData>& out_vertices) {
     out_vertices.reserve(out_vertices.size() + vertex_collection.positions.size());
 
@@ -86,6 +350,28 @@ void AnimatedEntityRenderer::VertexData::from_mesh(const VertexCollection& verte
     }
 }
 
+void AnimatedEntityRenderer::VertexData::from_stream(const VertexStream& stream, VertexData* out_vertices) {
+    if (stream.bones.empty()) {
+        throw std::runtime_error("AnimatedEntityRenderer::VertexData requires bones");
+    }
+    if (stream.normals.empty()) {
+        throw std::runtime_error("AnimatedEntityRenderer::VertexData requires normals");
+    }
+
+    for (size_t i = 0; i < stream.count; i++) {
+        auto [bone_weights, bone_indices] = stream.bones[i];
+        glm::vec2 tex_coord = stream.tex_coords.empty() ? glm::vec2{0.0f} : stream.tex_coords[i];
+        if (stream.flip_tex_coords) tex_coord.y = 1.0f - tex_coord.y;
+        out_vertices[i] = VertexData{
+            glm::vec3(stream.transform * glm::vec4(stream.positions[i], 1.0f)),
+            stream.normal_matrix * stream.normals[i],
+            tex_coord,
+            bone_weights,
+            bone_indices
+        };
+    }
+}
+
 
 void AnimatedEntityRenderer::VertexData::setup_attrib_pointers() {
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*) offsetof(VertexData, position));
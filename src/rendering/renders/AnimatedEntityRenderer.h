@@ -12,15 +12,15 @@
 #include "rendering/scene/GlobalData.h"
 #include "rendering/scene/RenderScene.h"
 #include "rendering/scene/RenderedEntity.h"
+#include "rendering/scene/PoseCache.h"
 #include "rendering/resources/ModelLoader.h"
 #include "rendering/resources/TextureHandle.h"
 #include "rendering/memory/UniformBufferArray.h"
+#include "rendering/memory/TextureBufferArray.h"
+#include "rendering/renders/TextureBindings.h"
 
 #include "rendering/renders/shaders/BaseLitEntityShader.h"
 
-#define BONE_TRANSFORMS 64
-#define BONE_TRANSFORMS_STR "64"
-
 namespace AnimatedEntityRenderer {
     struct VertexData {
         glm::vec3 position;
@@ -30,6 +30,8 @@ namespace AnimatedEntityRenderer {
         glm::uvec4 bone_indices;
 
         static void from_mesh(const VertexCollection& vertex_collection, std::vector<VertexData>& out_vertices);
+        /// Write stream.count vertices to out_vertices, applying the stream's transform as it goes
+        static void from_stream(const VertexStream& stream, VertexData* out_vertices);
         static void setup_attrib_pointers();
     };
 
@@ -44,26 +46,95 @@ namespace AnimatedEntityRenderer {
 
     class AnimatedEntityShader : public BaseLitEntityShader {
         // Animation Data
-        int bone_transforms_location{};
+        int bone_offset_location{};
+        int bone_count_location{};
     public:
+        // The bone palette is read from the first unit after BaseLitEntityShader's
+        static const uint BONE_PALETTE_TEXTURE_UNIT = 4;
+
         AnimatedEntityShader();
 
         void set_model_matrix(const glm::mat4& model_matrix);
 
-        void set_bone_transforms(const std::vector<glm::mat4>& bone_transforms);
+        /// Skin the following draws with the bones starting at this index in the bone palette
+        void set_bone_offset(uint bone_offset);
+        /// The number of bones the following draws' mesh has, vertex weights on any bone past it are ignored
+        void set_bone_count(uint bone_count);
     private:
         // Override get_uniforms_set_bindings to get the extra uniform for bone transforms
         void get_uniforms_set_bindings() override;
     };
 
+    /// How the animation stage scales back the poses of entities that are small on screen, or not on it at all.
+    /// Screen sizes are the fraction of the viewport's height that the entity's skeleton covers.
+    struct AnimationLodSettings {
+        bool enabled = false;
+        // Below this size the pose is evaluated every 2nd frame
+        float half_rate_size = 0.2f;
+        // Below this size, every 4th frame
+        float quarter_rate_size = 0.08f;
+        // Below this size only the most important nodes are animated, see MeshHierarchy::node_importance
+        float reduced_bones_size = 0.08f;
+        // The fraction of the nodes that move bones still animated below reduced_bones_size
+        float reduced_bone_fraction = 0.5f;
+        // Entities outside the view keep their last pose, while the Animator carries on advancing their time
+        bool skip_offscreen = true;
+    };
+
     class AnimatedEntityRenderer {
         AnimatedEntityShader shader;
+        // Every drawn entity's bone transforms for the frame, each draw indexing into it from its own offset, so there is no limit on bones
+        TextureBufferArray<glm::mat4> bone_palette{GL_RGBA32F};
+        PoseCache pose_cache{};
+        bool parallel_poses = true;
+        // The time the last evaluate_poses() took, in milliseconds
+        double pose_stage_ms = 0.0;
+        PoseBakeSettings bake_settings{};
+        AnimationLodSettings lod_settings{};
+        // Counts the animation stages, to spread the entities updated at a reduced rate evenly over the frames
+        uint64_t pose_frame = 0;
+
+        // The number of entities at each level of detail in the last frame
+        struct AnimationLodStats {
+            uint full_rate = 0;
+            uint half_rate = 0;
+            uint quarter_rate = 0;
+            uint reduced_bones = 0;
+            uint offscreen = 0;
+            // Entities that kept their pose from an earlier frame
+            uint skipped = 0;
+        };
+        AnimationLodStats lod_stats{};
+
+        struct BakedClipStats {
+            std::string name;
+            std::shared_ptr<const BakedClip> clip;
+        };
+        // Every clip baked by the hierarchies drawn in the last frame, for the memory versus error report
+        std::vector<BakedClipStats> baked_clip_stats{};
 
     public:
         AnimatedEntityRenderer();
 
+        /// The animation stage, which evaluates the pose of every entity for its current animation time ahead of drawing them,
+        /// spread across the shared ThreadPool. The draw loop then only uploads the finished poses.
+        /// With the level-of-detail enabled, entities small on screen or off it are evaluated less often, or in less detail, see AnimationLodSettings.
+        void evaluate_poses(const RenderScene& render_scene);
+
         void render(const RenderScene& render_scene, const LightScene& light_scene);
 
+        /// Adds the ImGUI controls for the animation stage and pose cache
+        void add_imgui_options_section();
+
+        void set_parallel_poses(bool enabled);
+        [[nodiscard]] bool get_parallel_poses() const;
+
+        void set_bake_settings(const PoseBakeSettings& settings);
+        [[nodiscard]] const PoseBakeSettings& get_bake_settings() const;
+
+        void set_lod_settings(const AnimationLodSettings& settings);
+        [[nodiscard]] const AnimationLodSettings& get_lod_settings() const;
+
         bool refresh_shaders();
     };
 }
@@ -0,0 +1,223 @@
+#include "CrowdRenderer.h"
+
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+#include "rendering/imgui/ImGuiManager.h"
+
+CrowdRenderer::CrowdEntity::CrowdEntity(const std::shared_ptr<MeshHierarchy<VertexData>>& mesh_hierarchy, InstanceData instance_data, RenderData render_data) :
+    mesh_hierarchy(mesh_hierarchy), instance_data(std::move(instance_data)), render_data(std::move(render_data)) {}
+
+std::shared_ptr<CrowdRenderer::CrowdEntity> CrowdRenderer::CrowdEntity::create(std::shared_ptr<MeshHierarchy<VertexData>> mesh_hierarchy, InstanceData instance_data, RenderData render_data) {
+    return std::make_shared<CrowdEntity>(mesh_hierarchy, std::move(instance_data), std::move(render_data));
+}
+
+CrowdRenderer::CrowdEntityShader::CrowdEntityShader() :
+    // The vertex shader hands the fragment shader the same inputs as an animated entity's does, so it uses the same fragment shader
+    BaseLitEntityShader("Crowd Entity", "crowd_entity/vert.glsl", "animated_entity/frag.glsl") {
+
+    get_uniforms_set_bindings();
+}
+
+void CrowdRenderer::CrowdEntityShader::get_uniforms_set_bindings() {
+    BaseLitEntityShader::get_uniforms_set_bindings(); // Call the base implementation to load all the common uniforms
+    vertex_count_location = get_uniform_location("vertex_count");
+    vertex_base_location = get_uniform_location("vertex_base");
+    crowd_time_location = get_uniform_location("crowd_time");
+    set_binding("vertex_animation", VERTEX_ANIMATION_TEXTURE_UNIT);
+    set_binding("crowd_members", CROWD_MEMBERS_TEXTURE_UNIT);
+    set_binding("clips", CLIPS_TEXTURE_UNIT);
+}
+
+void CrowdRenderer::CrowdEntityShader::set_vertex_count(uint vertex_count) {
+    glProgramUniform1i(id(), vertex_count_location, (int) vertex_count);
+}
+
+void CrowdRenderer::CrowdEntityShader::set_vertex_base(int vertex_base) {
+    glProgramUniform1i(id(), vertex_base_location, vertex_base);
+}
+
+void CrowdRenderer::CrowdEntityShader::set_crowd_time(float time_seconds) {
+    glProgramUniform1f(id(), crowd_time_location, time_seconds);
+}
+
+CrowdRenderer::CrowdRenderer::CrowdRenderer() : shader() {}
+
+void CrowdRenderer::CrowdRenderer::animate(const RenderScene& render_scene, double dt) {
+    for (const auto& entity: render_scene.entities) {
+        if (!entity->paused) entity->time_seconds += dt;
+    }
+}
+
+void CrowdRenderer::CrowdRenderer::render(const RenderScene& render_scene, const LightScene& light_scene) {
+    crowd_count = 0;
+    member_count = 0;
+    draw_count = 0;
+
+    // Drop the bakes of hierarchies, and the members of crowds, that have been freed
+    for (auto iter = baked_hierarchies.begin(); iter != baked_hierarchies.end();) {
+        iter = iter->second.hierarchy.expired() ? baked_hierarchies.erase(iter) : std::next(iter);
+    }
+    for (auto iter = uploaded_crowds.begin(); iter != uploaded_crowds.end();) {
+        iter = iter->second.entity.expired() ? uploaded_crowds.erase(iter) : std::next(iter);
+    }
+    if (render_scene.entities.empty()) return;
+
+    shader.use();
+    shader.set_global_data(render_scene.global_data);
+
+    TextureBindings texture_bindings{};
+
+    for (const auto& entity: render_scene.entities) {
+        if (entity->members.empty()) continue;
+        const auto* baked = get_baked(entity->mesh_hierarchy);
+        if (baked == nullptr) continue;
+        const auto& uploaded = get_uploaded(entity, *baked);
+
+        shader.set_instance_data(entity->instance_data);
+        // Lit by the lights nearest the crowd as a whole, as every member is drawn at once
+        glm::vec3 position = entity->instance_data.model_matrix[3];
+        shader.set_point_lights(light_scene.get_nearest_point_lights(position, BaseLitEntityShader::MAX_PL, 1));
+        shader.bind_textures(texture_bindings, entity->render_data, entity->instance_data.material);
+
+        texture_bindings.bind(CrowdEntityShader::VERTEX_ANIMATION_TEXTURE_UNIT, GL_TEXTURE_BUFFER, baked->frames->get_texture_id());
+        texture_bindings.bind(CrowdEntityShader::CLIPS_TEXTURE_UNIT, GL_TEXTURE_BUFFER, baked->clips->get_texture_id());
+        texture_bindings.bind(CrowdEntityShader::CROWD_MEMBERS_TEXTURE_UNIT, GL_TEXTURE_BUFFER, uploaded.members->get_texture_id());
+        shader.set_vertex_count(baked->animation.vertex_count);
+        shader.set_crowd_time((float) entity->time_seconds);
+
+        // Each mesh of each node was baked separately, in the same order, so a mesh held by several nodes is drawn with each node's transform
+        uint instance = 0;
+        for (const auto& node: entity->mesh_hierarchy->nodes) {
+            for (const auto& mesh_id: node.meshes) {
+                const auto& mesh = entity->mesh_hierarchy->meshes[mesh_id];
+                shader.set_vertex_base((int) baked->animation.first_vertices[instance++] - mesh.model->get_vertex_offset());
+
+                glBindVertexArray(mesh.model->get_vao());
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh.model->get_index_count(), GL_UNSIGNED_INT, nullptr,
+                                                  (int) entity->members.size(), mesh.model->get_vertex_offset());
+                draw_count++;
+            }
+        }
+
+        crowd_count++;
+        member_count += (uint) entity->members.size();
+    }
+}
+
+const CrowdRenderer::CrowdRenderer::UploadedCrowd& CrowdRenderer::CrowdRenderer::get_uploaded(const std::shared_ptr<Entity>& entity, const BakedHierarchy& baked) {
+    auto& uploaded = uploaded_crowds[entity.get()];
+    bool up_to_date = uploaded.entity.lock() == entity && uploaded.members_version == entity->members_version && uploaded.clip_count == baked.animation.clips.size();
+    if (!up_to_date) {
+        uploaded.entity = entity;
+        uploaded.members_version = entity->members_version;
+        uploaded.clip_count = baked.animation.clips.size();
+        if (uploaded.members == nullptr) uploaded.members = std::make_unique<TextureBufferArray<MemberData>>(GL_RGBA32F);
+
+        auto& data = uploaded.members->data;
+        data.clear();
+        for (const auto& member: entity->members) {
+            // Members of a clip the model no longer has play the first one instead
+            uint animation_id = member.animation_id < uploaded.clip_count ? member.animation_id : 0;
+            data.push_back({member.transform, glm::vec4{(float) animation_id, member.time_offset, member.speed, 0.0f}});
+        }
+        uploaded.members->upload();
+        data = {};
+    }
+    return uploaded;
+}
+
+const CrowdRenderer::CrowdRenderer::BakedHierarchy* CrowdRenderer::CrowdRenderer::get_baked(const std::shared_ptr<MeshHierarchy<VertexData>>& hierarchy) {
+    auto& baked = baked_hierarchies[hierarchy.get()];
+    bool up_to_date = baked.hierarchy.lock() == hierarchy && baked.version == hierarchy->version && baked.sample_rate == sample_rate;
+    if (!up_to_date) {
+        baked = BakedHierarchy{};
+        baked.hierarchy = hierarchy;
+        baked.version = hierarchy->version;
+        baked.sample_rate = sample_rate;
+        baked.name = hierarchy->filename.value_or("[Generated]");
+
+        auto start = std::chrono::steady_clock::now();
+        try {
+            baked.animation = VertexAnimation::bake(*hierarchy, read_vertices(*hierarchy), sample_rate);
+            baked.bytes = baked.animation.get_bytes();
+            baked.frames = std::make_unique<TextureBufferArray<glm::uvec4>>(GL_RGBA32UI);
+            // Moved rather than copied, since the frames are only needed on the GPU
+            baked.frames->data = std::move(baked.animation.frames);
+            baked.frames->upload();
+            baked.frames->data = {};
+
+            baked.clips = std::make_unique<TextureBufferArray<glm::vec4>>(GL_RGBA32F);
+            for (const auto& clip: baked.animation.clips) {
+                baked.clips->data.emplace_back((float) clip.first_frame, (float) clip.frame_count, clip.duration_seconds, 0.0f);
+            }
+            baked.clips->upload();
+        } catch (const std::exception& e) {
+            baked.frames = nullptr;
+            baked.clips = nullptr;
+            baked.error = e.what();
+            std::cerr << "Error while baking the vertex animation of " << baked.name << ":" << std::endl;
+            std::cerr << e.what() << std::endl;
+        }
+        baked.bake_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return baked.error.empty() ? &baked : nullptr;
+}
+
+std::vector<std::vector<CrowdRenderer::VertexData>> CrowdRenderer::CrowdRenderer::read_vertices(const MeshHierarchy<VertexData>& hierarchy) {
+    std::vector<std::vector<VertexData>> mesh_vertices(hierarchy.meshes.size());
+    for (size_t mesh_id = 0; mesh_id < hierarchy.meshes.size(); ++mesh_id) {
+        const auto& model = *hierarchy.meshes[mesh_id].model;
+        // Waits for the upload, and the indices say how many vertices the mesh has, since its vertex buffer may be shared
+        (void) model.get_vao();
+
+        std::vector<uint> indices((size_t) model.get_index_count());
+        glBindBuffer(GL_COPY_READ_BUFFER, model.get_index_vbo());
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (long) (indices.size() * sizeof(uint)), indices.data());
+        size_t vertex_count = indices.empty() ? 0 : (size_t) *std::max_element(indices.begin(), indices.end()) + 1;
+
+        mesh_vertices[mesh_id].resize(vertex_count);
+        glBindBuffer(GL_COPY_READ_BUFFER, model.get_vertex_vbo());
+        glGetBufferSubData(GL_COPY_READ_BUFFER, (long) (model.get_vertex_offset() * sizeof(VertexData)), (long) (vertex_count * sizeof(VertexData)),
+                           mesh_vertices[mesh_id].data());
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    return mesh_vertices;
+}
+
+bool CrowdRenderer::CrowdRenderer::refresh_shaders() {
+    return shader.reload_files();
+}
+
+void CrowdRenderer::CrowdRenderer::add_imgui_options_section() {
+    if (ImGui::CollapsingHeader("Crowds")) {
+        int rate = (int) sample_rate;
+        if (ImGui::SliderInt("Vertex Bake Rate (Hz)", &rate, 5, 60)) {
+            sample_rate = (float) rate;
+        }
+        ImGui::SameLine();
+        ImGui::HelpMarker("The rate every clip of a crowd's model is baked at, as the position and normal of every vertex. Memory grows with the rate, and changing it bakes every model again the next time it is drawn.");
+
+        size_t total_bytes = 0;
+        for (const auto& [_, baked]: baked_hierarchies) {
+            if (!baked.error.empty()) {
+                ImGui::Text("%s: failed, see Console", baked.name.c_str());
+                continue;
+            }
+            total_bytes += baked.bytes;
+            ImGui::Text("%s: %u vertices, %zu clips, %.2f MiB, baked in %.1f ms", baked.name.c_str(), baked.animation.vertex_count, baked.animation.clips.size(),
+                        (double) baked.bytes / (1024.0 * 1024.0), baked.bake_ms);
+        }
+        ImGui::Text("Vertex animations: %.2f MiB", (double) total_bytes / (1024.0 * 1024.0));
+        ImGui::Text("Crowds: %u, members: %u, draws: %u", crowd_count, member_count, draw_count);
+    }
+}
+
+void CrowdRenderer::CrowdRenderer::set_sample_rate(float rate) {
+    sample_rate = rate;
+}
+
+float CrowdRenderer::CrowdRenderer::get_sample_rate() const {
+    return sample_rate;
+}
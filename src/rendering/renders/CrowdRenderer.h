@@ -0,0 +1,163 @@
+#ifndef CROWD_RENDERER_H
+#define CROWD_RENDERER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "rendering/renders/shaders/ShaderInterface.h"
+#include "rendering/scene/Lights.h"
+#include "rendering/scene/GlobalData.h"
+#include "rendering/scene/RenderScene.h"
+#include "rendering/resources/VertexAnimation.h"
+#include "rendering/memory/TextureBufferArray.h"
+#include "rendering/renders/TextureBindings.h"
+#include "rendering/renders/AnimatedEntityRenderer.h"
+
+#include "rendering/renders/shaders/BaseLitEntityShader.h"
+
+/// Draws crowds of an animated model, each member looping one of its clips, from vertex animations baked from the model's clips.
+/// Every member of a crowd is drawn by the same instanced draw, one per mesh, and playing them back is done entirely in the vertex shader.
+/// Suited to background crowds, since members can't blend between clips, and the clips play back at the rate they were baked at.
+namespace CrowdRenderer {
+    // The same models as animated entities use, so the two share loaded hierarchies
+    using VertexData = AnimatedEntityRenderer::VertexData;
+
+    using EntityMaterial = BaseLitEntityMaterial;
+    using InstanceData = BaseLitEntityInstanceData;
+    using GlobalData = BaseLitEntityGlobalData;
+    using RenderData = BaseLitEntityRenderData;
+
+    /// A member of a crowd
+    struct CrowdMember {
+        // Relative to the crowd's model matrix
+        glm::mat4 transform{1.0f};
+        // The clip the member loops
+        uint animation_id = 0;
+        // Where in the clip the member starts, in seconds
+        float time_offset = 0.0f;
+        float speed = 1.0f;
+    };
+
+    /// Many copies of one model, sharing its material and textures
+    struct CrowdEntity {
+        std::shared_ptr<MeshHierarchy<VertexData>> mesh_hierarchy;
+        InstanceData instance_data;
+        RenderData render_data;
+
+        std::vector<CrowdMember> members{};
+        // Incremented whenever members changes, so that the renderer knows to upload them again
+        uint64_t members_version = 0;
+        // Each member is at time_seconds * speed + time_offset into its clip, advanced by CrowdRenderer::animate
+        double time_seconds = 0.0;
+        bool paused = false;
+
+        CrowdEntity(const std::shared_ptr<MeshHierarchy<VertexData>>& mesh_hierarchy, InstanceData instance_data, RenderData render_data);
+
+        static std::shared_ptr<CrowdEntity> create(std::shared_ptr<MeshHierarchy<VertexData>> mesh_hierarchy, InstanceData instance_data, RenderData render_data);
+    };
+
+    using Entity = CrowdEntity;
+
+    using RenderScene = RenderScene<Entity, GlobalData>;
+
+    class CrowdEntityShader : public BaseLitEntityShader {
+        // Vertex animation data
+        int vertex_count_location{};
+        int vertex_base_location{};
+        int crowd_time_location{};
+    public:
+        // The first units after BaseLitEntityShader's
+        static const uint VERTEX_ANIMATION_TEXTURE_UNIT = 4;
+        static const uint CROWD_MEMBERS_TEXTURE_UNIT = 5;
+        static const uint CLIPS_TEXTURE_UNIT = 6;
+
+        CrowdEntityShader();
+
+        /// The number of vertices in each frame of the bound vertex animation
+        void set_vertex_count(uint vertex_count);
+        /// Where the drawn mesh's vertices start in each frame, offset by the mesh's base vertex, since gl_VertexID includes it
+        void set_vertex_base(int vertex_base);
+        /// The crowd's time, which each member offsets and scales to find where it is in its clip
+        void set_crowd_time(float time_seconds);
+    private:
+        // Override get_uniforms_set_bindings to get the extra uniforms for vertex animation
+        void get_uniforms_set_bindings() override;
+    };
+
+    class CrowdRenderer {
+        CrowdEntityShader shader;
+
+        // A member as the vertex shader reads it, 5 texels of the crowd members buffer
+        struct MemberData {
+            // Relative to the crowd's model matrix
+            glm::mat4 transform;
+            // (animation_id, time_offset, speed, unused)
+            glm::vec4 playback;
+        };
+        // A crowd's members on the GPU, only uploaded again when they change, so there is no per member work each frame
+        struct UploadedCrowd {
+            // Guards against a new crowd being allocated at the address of a freed one
+            std::weak_ptr<const Entity> entity;
+            uint64_t members_version = 0;
+            // The clip count of the vertex animation the members' clips were clamped to
+            size_t clip_count = 0;
+            std::unique_ptr<TextureBufferArray<MemberData>> members{};
+        };
+        std::unordered_map<const Entity*, UploadedCrowd> uploaded_crowds{};
+
+        struct BakedHierarchy {
+            // Guards against a new hierarchy being allocated at the address of a freed one
+            std::weak_ptr<const BaseMeshHierarchy> hierarchy;
+            uint64_t version = 0;
+            float sample_rate = 0.0f;
+            // The bake's layout, with its frames moved into the buffer texture
+            VertexAnimation animation{};
+            size_t bytes = 0;
+            std::unique_ptr<TextureBufferArray<glm::uvec4>> frames{};
+            // [animation_id] -> (first_frame, frame_count, duration_seconds, unused) of the clip, for the vertex shader to find its frames with
+            std::unique_ptr<TextureBufferArray<glm::vec4>> clips{};
+            double bake_ms = 0.0;
+            // Set if baking failed, so it isn't retried every frame
+            std::string error{};
+            std::string name{};
+        };
+        std::unordered_map<const MeshHierarchy<VertexData>*, BakedHierarchy> baked_hierarchies{};
+        // The rate clips are baked at, in frames per second
+        float sample_rate = 30.0f;
+
+        // Stats, for the last frame
+        uint crowd_count = 0;
+        uint member_count = 0;
+        uint draw_count = 0;
+    public:
+        CrowdRenderer();
+
+        /// Advance the time of every crowd that isn't paused
+        void animate(const RenderScene& render_scene, double dt);
+
+        /// Bakes the vertex animation of any model drawn for the first time, or changed since, which stalls for the time it takes
+        void render(const RenderScene& render_scene, const LightScene& light_scene);
+
+        /// Adds the ImGUI controls for baking, and what has been baked
+        void add_imgui_options_section();
+
+        /// Changing the rate bakes every model again the next time it is drawn
+        void set_sample_rate(float rate);
+        [[nodiscard]] float get_sample_rate() const;
+
+        bool refresh_shaders();
+    private:
+        /// The baked vertex animation of the hierarchy, baking it if it hasn't been yet or is out of date, or nullptr if baking failed
+        const BakedHierarchy* get_baked(const std::shared_ptr<MeshHierarchy<VertexData>>& hierarchy);
+        /// The crowd's members on the GPU, uploading them if they have changed since they were last uploaded
+        const UploadedCrowd& get_uploaded(const std::shared_ptr<Entity>& entity, const BakedHierarchy& baked);
+        /// Read each mesh's vertices back from its vertex buffer, which waits for them to finish uploading if they haven't
+        static std::vector<std::vector<VertexData>> read_vertices(const MeshHierarchy<VertexData>& hierarchy);
+    };
+}
+
+#endif //CROWD_RENDERER_H
@@ -1,5 +1,7 @@
 #include "EmissiveEntityRenderer.h"
 
+#include <algorithm>
+
 EmissiveEntityRenderer::EmissiveEntityShader::EmissiveEntityShader() :
     BaseEntityShader("Emissive Entity", "emissive_entity/vert.glsl", "emissive_entity/frag.glsl") {
     get_uniforms_set_bindings();
@@ -11,9 +13,12 @@ void EmissiveEntityRenderer::EmissiveEntityShader::get_uniforms_set_bindings() {
     // Material properties
     emission_tint_location = get_uniform_location("emissive_tint");
     emission_texture_scale_location = get_uniform_location("emission_texture_scale");
+    emission_texture_layer_location = get_uniform_location("emissive_texture_layer");
+    emission_texture_flipped_location = get_uniform_location("emissive_texture_flipped");
     
     // Texture sampler bindings
-    set_binding("emissive_texture", 0);
+    set_binding("emissive_texture", EMISSION_TEXTURE_UNIT);
+    set_binding("emissive_texture_array", EMISSION_TEXTURE_ARRAY_UNIT);
 }
 
 void EmissiveEntityRenderer::EmissiveEntityShader::set_instance_data(const InstanceData& instance_data) {
@@ -27,17 +32,38 @@ void EmissiveEntityRenderer::EmissiveEntityShader::set_instance_data(const Insta
     glProgramUniform2fv(id(), emission_texture_scale_location, 1, &entity_material.emission_texture_scale[0]);
 }
 
+void EmissiveEntityRenderer::EmissiveEntityShader::set_texture_layer(int emission_layer) {
+    glProgramUniform1i(id(), emission_texture_layer_location, emission_layer);
+}
+
+void EmissiveEntityRenderer::EmissiveEntityShader::set_texture_flipped(bool emission_flipped) {
+    glProgramUniform1i(id(), emission_texture_flipped_location, emission_flipped);
+}
+
 EmissiveEntityRenderer::EmissiveEntityRenderer::EmissiveEntityRenderer() : shader() {}
 
 void EmissiveEntityRenderer::EmissiveEntityRenderer::render(const RenderScene& render_scene) {
     shader.use();
     shader.set_global_data(render_scene.global_data);
 
+    // Draw entities in buckets of matching textures, so that entities whose textures share a texture array don't need a rebind
+    std::vector<const Entity*> sorted_entities{};
+    sorted_entities.reserve(render_scene.entities.size());
     for (const auto& entity: render_scene.entities) {
+        sorted_entities.push_back(entity.get());
+    }
+    std::sort(sorted_entities.begin(), sorted_entities.end(), [](const Entity* a, const Entity* b) {
+        return TextureBindings::binding_id(*a->render_data.emission_texture) < TextureBindings::binding_id(*b->render_data.emission_texture);
+    });
+
+    TextureBindings texture_bindings{};
+
+    for (const auto& entity: sorted_entities) {
         shader.set_instance_data(entity->instance_data);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, entity->render_data.emission_texture->get_texture_id());
+        int emission_layer = texture_bindings.bind(*entity->render_data.emission_texture, EmissiveEntityShader::EMISSION_TEXTURE_UNIT, EmissiveEntityShader::EMISSION_TEXTURE_ARRAY_UNIT);
+        shader.set_texture_layer(emission_layer);
+        shader.set_texture_flipped(entity->render_data.emission_texture->is_flipped());
 
         glBindVertexArray(entity->model->get_vao());
         glDrawElementsBaseVertex(GL_TRIANGLES, entity->model->get_index_count(), GL_UNSIGNED_INT, nullptr, entity->model->get_vertex_offset());
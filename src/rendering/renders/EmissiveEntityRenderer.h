@@ -14,6 +14,7 @@
 #include "rendering/scene/RenderScene.h"
 #include "rendering/scene/RenderedEntity.h"
 #include "rendering/resources/TextureHandle.h"
+#include "rendering/renders/TextureBindings.h"
 
 #include "EntityRenderer.h"
 
@@ -56,10 +57,22 @@ namespace EmissiveEntityRenderer {
         
         // Texture scale uniform location
         int emission_texture_scale_location{};
+
+        // Texture array layer, where -1 means to sample the standalone texture instead
+        int emission_texture_layer_location{};
+        int emission_texture_flipped_location{};
     public:
+        static const uint EMISSION_TEXTURE_UNIT = 0;
+        static const uint EMISSION_TEXTURE_ARRAY_UNIT = 1;
+
         EmissiveEntityShader();
 
         void set_instance_data(const InstanceData& instance_data);
+
+        /// Set which texture array layer to sample, as returned by TextureBindings::bind
+        void set_texture_layer(int emission_layer);
+        /// Set whether to flip the texture vertically, see TextureHandle::is_flipped()
+        void set_texture_flipped(bool emission_flipped);
     private:
         void get_uniforms_set_bindings() override;
     };
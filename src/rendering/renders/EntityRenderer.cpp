@@ -1,5 +1,7 @@
 #include "EntityRenderer.h"
 
+#include <algorithm>
+
 EntityRenderer::EntityShader::EntityShader() :
     BaseLitEntityShader("Entity", "entity/vert.glsl", "entity/frag.glsl") {
 
@@ -32,7 +34,19 @@ void EntityRenderer::EntityRenderer::render(const RenderScene& render_scene, con
     shader.use();
     shader.set_global_data(render_scene.global_data);
 
+    // Draw entities in buckets of matching textures, so that entities whose textures share a texture array don't need a rebind
+    std::vector<const Entity*> sorted_entities{};
+    sorted_entities.reserve(render_scene.entities.size());
     for (const auto& entity: render_scene.entities) {
+        sorted_entities.push_back(entity.get());
+    }
+    std::sort(sorted_entities.begin(), sorted_entities.end(), [](const Entity* a, const Entity* b) {
+        return BaseLitEntityShader::binding_ids(a->render_data, a->instance_data.material) < BaseLitEntityShader::binding_ids(b->render_data, b->instance_data.material);
+    });
+
+    TextureBindings texture_bindings{};
+
+    for (const auto& entity: sorted_entities) {
         shader.set_instance_data(entity->instance_data);
 
         glm::vec3 position = entity->instance_data.model_matrix[3];
@@ -44,10 +58,7 @@ void EntityRenderer::EntityRenderer::render(const RenderScene& render_scene, con
         // Just make sure to be careful of this kind of thing.
         shader.set_point_lights(light_scene.get_nearest_point_lights(position, BaseLitEntityShader::MAX_PL, 1));
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, entity->render_data.diffuse_texture->get_texture_id());
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, entity->render_data.specular_map_texture->get_texture_id());
+        shader.bind_textures(texture_bindings, entity->render_data, entity->instance_data.material);
 
         glBindVertexArray(entity->model->get_vao());
         glDrawElementsBaseVertex(GL_TRIANGLES, entity->model->get_index_count(), GL_UNSIGNED_INT, nullptr, entity->model->get_vertex_offset());
@@ -78,6 +89,26 @@ void EntityRenderer::VertexData::from_mesh(const VertexCollection& vertex_collec
     }
 }
 
+void EntityRenderer::VertexData::from_stream(const VertexStream& stream, VertexData* out_vertices) {
+    if (stream.normals.empty()) {
+        throw std::runtime_error("EntityRenderer::VertexData requires normals");
+    }
+
+    if (stream.tex_coords.empty()) {
+        throw std::runtime_error("EntityRenderer::VertexData requires texture coordinates");
+    }
+
+    for (size_t i = 0; i < stream.count; i++) {
+        glm::vec2 tex_coord = stream.tex_coords[i];
+        if (stream.flip_tex_coords) tex_coord.y = 1.0f - tex_coord.y;
+        out_vertices[i] = VertexData{
+            glm::vec3(stream.transform * glm::vec4(stream.positions[i], 1.0f)),
+            stream.normal_matrix * stream.normals[i],
+            tex_coord
+        };
+    }
+}
+
 
 void EntityRenderer::VertexData::setup_attrib_pointers() {
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*) offsetof(VertexData, position));
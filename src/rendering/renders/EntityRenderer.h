@@ -15,6 +15,7 @@
 #include "rendering/resources/ModelLoader.h"
 #include "rendering/resources/TextureHandle.h"
 #include "rendering/memory/UniformBufferArray.h"
+#include "rendering/renders/TextureBindings.h"
 
 #include "rendering/renders/shaders/BaseLitEntityShader.h"
 
@@ -25,6 +26,8 @@ namespace EntityRenderer {
         glm::vec2 texture_coordinate;
 
         static void from_mesh(const VertexCollection& vertex_collection, std::vector<VertexData>& out_vertices);
+        /// Write stream.count vertices to out_vertices, applying the stream's transform as it goes
+        static void from_stream(const VertexStream& stream, VertexData* out_vertices);
         static void setup_attrib_pointers();
     };
 
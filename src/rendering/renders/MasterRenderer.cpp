@@ -4,7 +4,36 @@
 #include "rendering/imgui/ImGuiManager.h"
 #include "scene/SceneContext.h"
 
-MasterRenderer::MasterRenderer() : entity_renderer(), animated_entity_renderer(), emissive_entity_renderer(), render_settings() {
+namespace {
+    /// Make or drop each lit entity's packed texture to match the loader's setting, only going to the loader when its textures have changed
+    template<typename Entity>
+    void update_packed_materials(const std::unordered_set<std::shared_ptr<Entity>>& entities, TextureLoader& texture_loader) {
+        bool enabled = texture_loader.get_use_packed_materials();
+        for (const auto& entity: entities) {
+            auto& render_data = entity->render_data;
+            if (!enabled) {
+                render_data.packed_texture = nullptr;
+                render_data.packed_from_diffuse.reset();
+                render_data.packed_from_specular_map.reset();
+                continue;
+            }
+            if (render_data.packed_from_diffuse.lock() == render_data.diffuse_texture && render_data.packed_from_specular_map.lock() == render_data.specular_map_texture) continue;
+
+            // Recorded even on failure, so that textures that can't be packed aren't retried every frame
+            render_data.packed_from_diffuse = render_data.diffuse_texture;
+            render_data.packed_from_specular_map = render_data.specular_map_texture;
+            try {
+                render_data.packed_texture = texture_loader.load_packed_material(render_data.diffuse_texture, render_data.specular_map_texture);
+            } catch (const std::exception& e) {
+                render_data.packed_texture = nullptr;
+                std::cerr << "Error while trying to pack material:" << std::endl;
+                std::cerr << e.what() << std::endl;
+            }
+        }
+    }
+}
+
+MasterRenderer::MasterRenderer() : entity_renderer(), animated_entity_renderer(), emissive_entity_renderer(), crowd_renderer(), shader_watcher("res/shaders"), render_settings() {
     glEnable(GL_DEPTH_TEST);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     glEnable(GL_CULL_FACE);
@@ -16,12 +45,58 @@ MasterRenderer::MasterRenderer() : entity_renderer(), animated_entity_renderer()
 void MasterRenderer::update(const Window& window) {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
     glViewport(0, 0, (int) window.get_framebuffer_width(), (int) window.get_framebuffer_height());
+
+    if (render_settings.auto_reload_shaders) {
+        reload_changed_shaders();
+    } else {
+        // Drop the changes, so turning it back on doesn't immediately reload for old edits
+        shader_watcher.poll_changes();
+    }
+}
+
+void MasterRenderer::reload_changed_shaders() {
+    auto changes = shader_watcher.poll_changes();
+    if (changes.empty()) return;
+
+    bool reload_entity = false;
+    bool reload_animated_entity = false;
+    bool reload_emissive_entity = false;
+    bool reload_crowd_entity = false;
+    for (const auto& change: changes) {
+        std::string directory = change.substr(0, change.find('/'));
+        if (directory == "entity") {
+            reload_entity = true;
+        } else if (directory == "animated_entity") {
+            // Crowds share the animated entity fragment shader
+            reload_animated_entity = reload_crowd_entity = true;
+        } else if (directory == "emissive_entity") {
+            reload_emissive_entity = true;
+        } else if (directory == "crowd_entity") {
+            reload_crowd_entity = true;
+        } else {
+            // Anything else could be included by any of the shaders
+            reload_entity = reload_animated_entity = reload_emissive_entity = reload_crowd_entity = true;
+        }
+    }
+
+    last_shader_reload_time = glfwGetTime();
+    shader_reload_failures = 0;
+    if (reload_entity) shader_reload_failures += entity_renderer.refresh_shaders() ? 0 : 1;
+    if (reload_animated_entity) shader_reload_failures += animated_entity_renderer.refresh_shaders() ? 0 : 1;
+    if (reload_emissive_entity) shader_reload_failures += emissive_entity_renderer.refresh_shaders() ? 0 : 1;
+    if (reload_crowd_entity) shader_reload_failures += crowd_renderer.refresh_shaders() ? 0 : 1;
 }
 
 void MasterRenderer::render_scene(MasterRenderScene& render_scene, const SceneContext& scene_context) {
     render_scene.animator.animate(scene_context.window_manager.get_delta_time());
+    crowd_renderer.animate(render_scene.crowd_scene, scene_context.window_manager.get_delta_time());
+    animated_entity_renderer.evaluate_poses(render_scene.animated_entity_scene);
+    update_packed_materials(render_scene.entity_scene.entities, scene_context.texture_loader);
+    update_packed_materials(render_scene.animated_entity_scene.entities, scene_context.texture_loader);
+    update_packed_materials(render_scene.crowd_scene.entities, scene_context.texture_loader);
     entity_renderer.render(render_scene.entity_scene, render_scene.light_scene);
     animated_entity_renderer.render(render_scene.animated_entity_scene, render_scene.light_scene);
+    crowd_renderer.render(render_scene.crowd_scene, render_scene.light_scene);
     emissive_entity_renderer.render(render_scene.emissive_entity_scene);
 }
 
@@ -67,25 +142,30 @@ void MasterRenderer::add_imgui_options_section(WindowManager& window_manager) {
     }
 
     if (ImGui::CollapsingHeader("Shader Options")) {
-        static int failures = 0;
-        static double last_time = -std::numeric_limits<double>::infinity();
         if (ImGui::Button("Reload Shader Files")) {
-            last_time = glfwGetTime();
-            failures = 0;
-            failures += entity_renderer.refresh_shaders() ? 0 : 1;
-            failures += animated_entity_renderer.refresh_shaders() ? 0 : 1;
-            failures += emissive_entity_renderer.refresh_shaders() ? 0 : 1;
+            last_shader_reload_time = glfwGetTime();
+            shader_reload_failures = 0;
+            shader_reload_failures += entity_renderer.refresh_shaders() ? 0 : 1;
+            shader_reload_failures += animated_entity_renderer.refresh_shaders() ? 0 : 1;
+            shader_reload_failures += emissive_entity_renderer.refresh_shaders() ? 0 : 1;
+            shader_reload_failures += crowd_renderer.refresh_shaders() ? 0 : 1;
         }
-        if (glfwGetTime() - 2.0 <= last_time) {
+        if (glfwGetTime() - 2.0 <= last_shader_reload_time) {
             ImGui::SameLine();
-            if (failures == 0) {
+            if (shader_reload_failures == 0) {
                 ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.0f, 0.8f, 0.0f, 1.0f));
                 ImGui::Text("Success!");
             } else {
                 ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.7f, 0.0, 0.0, 1.0f));
-                ImGui::Text("[%d] Failed, see Console", failures);
+                ImGui::Text("[%d] Failed, see Console", shader_reload_failures);
             }
             ImGui::PopStyleColor();
         }
+        ImGui::Checkbox("Auto Reload Shaders", &render_settings.auto_reload_shaders);
+        ImGui::SameLine();
+        ImGui::HelpMarker("Reload shaders as soon as their files are saved.");
     }
+
+    animated_entity_renderer.add_imgui_options_section();
+    crowd_renderer.add_imgui_options_section();
 }
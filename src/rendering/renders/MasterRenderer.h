@@ -1,9 +1,13 @@
 #ifndef MASTER_RENDERER_H
 #define MASTER_RENDERER_H
 
+#include <limits>
+
 #include "utility/SyncManager.h"
+#include "utility/FileWatcher.h"
 #include "EntityRenderer.h"
 #include "EmissiveEntityRenderer.h"
+#include "CrowdRenderer.h"
 #include "rendering/scene/MasterRenderScene.h"
 #include "system_interfaces/WindowManager.h"
 #include "scene/SceneInterface.h"
@@ -14,7 +18,13 @@ class MasterRenderer {
     EntityRenderer::EntityRenderer entity_renderer;
     AnimatedEntityRenderer::AnimatedEntityRenderer animated_entity_renderer;
     EmissiveEntityRenderer::EmissiveEntityRenderer emissive_entity_renderer;
+    CrowdRenderer::CrowdRenderer crowd_renderer;
     SyncManager sync_manager;
+    FileWatcher shader_watcher;
+
+    // Result of the last shader reload, to show in the UI
+    int shader_reload_failures = 0;
+    double last_shader_reload_time = -std::numeric_limits<double>::infinity();
 
     struct RenderSettings {
         bool show_wireframe = false;
@@ -23,6 +33,7 @@ class MasterRenderer {
         bool v_sync = false;
         bool enable_fps_cap = true;
         float fps_cap = 240.0f;
+        bool auto_reload_shaders = true;
     } render_settings;
 public:
     MasterRenderer();
@@ -36,6 +47,9 @@ public:
 
     /// Adds a control for editing the RenderSettings
     void add_imgui_options_section(WindowManager& window_manager);
+private:
+    /// Reload the shaders of any renderer whose files have changed on disk, all of them if a shared file changed
+    void reload_changed_shaders();
 };
 
 #endif //MASTER_RENDERER_H
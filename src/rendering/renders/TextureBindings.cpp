@@ -0,0 +1,24 @@
+#include "TextureBindings.h"
+
+#include <glad/gl.h>
+
+void TextureBindings::bind(uint unit, uint target, uint texture_id) {
+    if (bound_textures[unit] == texture_id) return;
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(target, texture_id);
+    bound_textures[unit] = texture_id;
+}
+
+int TextureBindings::bind(const TextureHandle& texture, uint unit_2d, uint unit_array) {
+    if (texture.is_array_layer()) {
+        bind(unit_array, GL_TEXTURE_2D_ARRAY, texture.get_array_id());
+    } else {
+        bind(unit_2d, GL_TEXTURE_2D, texture.get_texture_id());
+    }
+    return texture.get_layer();
+}
+
+uint TextureBindings::binding_id(const TextureHandle& texture) {
+    return texture.is_array_layer() ? texture.get_array_id() : texture.get_texture_id();
+}
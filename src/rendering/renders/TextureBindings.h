@@ -0,0 +1,29 @@
+#ifndef TEXTURE_BINDINGS_H
+#define TEXTURE_BINDINGS_H
+
+#include <array>
+
+#include "utility/HelperTypes.h"
+#include "rendering/resources/TextureHandle.h"
+
+/// Tracks what is bound to each texture unit over the course of a single render call,
+/// so that consecutive entities sharing a texture, or a texture array, don't cause a rebind.
+class TextureBindings {
+    static constexpr uint MAX_UNITS = 8;
+
+    std::array<uint, MAX_UNITS> bound_textures{};
+public:
+    TextureBindings() = default;
+
+    /// Bind texture_id to the unit and target, skipping the call if it is already bound there.
+    void bind(uint unit, uint target, uint texture_id);
+
+    /// Bind the texture to unit_2d if it is a standalone texture, or its texture array to unit_array if it is an array layer.
+    /// Returns the layer the shader should sample, where -1 means to use the standalone texture.
+    int bind(const TextureHandle& texture, uint unit_2d, uint unit_array);
+
+    /// The id that binding the texture will bind, used to sort draws so that entities sharing a texture or texture array are drawn consecutively.
+    static uint binding_id(const TextureHandle& texture);
+};
+
+#endif //TEXTURE_BINDINGS_H
@@ -25,9 +25,17 @@ void BaseLitEntityShader::get_uniforms_set_bindings() {
     diffuse_texture_scale_location = get_uniform_location("diffuse_texture_scale");
     specular_texture_scale_location = get_uniform_location("specular_texture_scale");
     
+    diffuse_texture_layer_location = get_uniform_location("diffuse_texture_layer");
+    specular_map_texture_layer_location = get_uniform_location("specular_map_texture_layer");
+    specular_in_diffuse_alpha_location = get_uniform_location("specular_in_diffuse_alpha");
+    diffuse_texture_flipped_location = get_uniform_location("diffuse_texture_flipped");
+    specular_map_texture_flipped_location = get_uniform_location("specular_map_texture_flipped");
+
     // Texture sampler bindings
-    set_binding("diffuse_texture", 0);
-    set_binding("specular_map_texture", 1);
+    set_binding("diffuse_texture", DIFFUSE_TEXTURE_UNIT);
+    set_binding("specular_map_texture", SPECULAR_MAP_TEXTURE_UNIT);
+    set_binding("diffuse_texture_array", DIFFUSE_TEXTURE_ARRAY_UNIT);
+    set_binding("specular_map_texture_array", SPECULAR_MAP_TEXTURE_ARRAY_UNIT);
     // Uniform block bindings
     set_block_binding("PointLightArray", POINT_LIGHT_BINDING);
 }
@@ -67,4 +75,45 @@ void BaseLitEntityShader::set_point_lights(const std::vector<PointLight>& point_
     set_vert_define("NUM_PL", Formatter() << count);
     point_lights_ubo.bind(POINT_LIGHT_BINDING);
     point_lights_ubo.upload();
-}
\ No newline at end of file
+}
+
+void BaseLitEntityShader::set_texture_layers(int diffuse_layer, int specular_map_layer) {
+    glProgramUniform1i(id(), diffuse_texture_layer_location, diffuse_layer);
+    glProgramUniform1i(id(), specular_map_texture_layer_location, specular_map_layer);
+}
+
+void BaseLitEntityShader::set_texture_flips(bool diffuse_flipped, bool specular_map_flipped) {
+    glProgramUniform1i(id(), diffuse_texture_flipped_location, diffuse_flipped);
+    glProgramUniform1i(id(), specular_map_texture_flipped_location, specular_map_flipped);
+}
+
+namespace {
+    /// The packed texture can only stand in for both when they are sampled at the same coordinates
+    const TextureHandle* usable_packed_texture(const BaseLitEntityRenderData& render_data, const BaseLitEntityMaterial& material) {
+        if (render_data.packed_texture == nullptr || material.diffuse_texture_scale != material.specular_texture_scale) return nullptr;
+        return render_data.packed_texture.get();
+    }
+}
+
+void BaseLitEntityShader::bind_textures(TextureBindings& texture_bindings, const BaseLitEntityRenderData& render_data, const BaseLitEntityMaterial& material) {
+    const TextureHandle* packed_texture = usable_packed_texture(render_data, material);
+    if (packed_texture != nullptr) {
+        int layer = texture_bindings.bind(*packed_texture, DIFFUSE_TEXTURE_UNIT, DIFFUSE_TEXTURE_ARRAY_UNIT);
+        set_texture_layers(layer, -1);
+        set_texture_flips(packed_texture->is_flipped(), false);
+    } else {
+        int diffuse_layer = texture_bindings.bind(*render_data.diffuse_texture, DIFFUSE_TEXTURE_UNIT, DIFFUSE_TEXTURE_ARRAY_UNIT);
+        int specular_map_layer = texture_bindings.bind(*render_data.specular_map_texture, SPECULAR_MAP_TEXTURE_UNIT, SPECULAR_MAP_TEXTURE_ARRAY_UNIT);
+        set_texture_layers(diffuse_layer, specular_map_layer);
+        set_texture_flips(render_data.diffuse_texture->is_flipped(), render_data.specular_map_texture->is_flipped());
+    }
+    glProgramUniform1i(id(), specular_in_diffuse_alpha_location, packed_texture != nullptr);
+}
+
+std::pair<uint, uint> BaseLitEntityShader::binding_ids(const BaseLitEntityRenderData& render_data, const BaseLitEntityMaterial& material) {
+    const TextureHandle* packed_texture = usable_packed_texture(render_data, material);
+    if (packed_texture != nullptr) {
+        return {TextureBindings::binding_id(*packed_texture), 0};
+    }
+    return {TextureBindings::binding_id(*render_data.diffuse_texture), TextureBindings::binding_id(*render_data.specular_map_texture)};
+}
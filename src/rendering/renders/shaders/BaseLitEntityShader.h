@@ -17,6 +17,7 @@
 #include "rendering/resources/ModelLoader.h"
 #include "rendering/resources/TextureHandle.h"
 #include "rendering/memory/UniformBufferArray.h"
+#include "rendering/renders/TextureBindings.h"
 
 #include "BaseEntityShader.h"
 
@@ -45,6 +46,12 @@ struct BaseLitEntityRenderData {
 
     std::shared_ptr<TextureHandle> diffuse_texture;
     std::shared_ptr<TextureHandle> specular_map_texture;
+
+    // The diffuse texture with the specular map in its alpha, bound instead of both when set, see TextureLoader::load_packed_material()
+    std::shared_ptr<TextureHandle> packed_texture{};
+    // The textures packed_texture was made from, so it can be remade when either is changed
+    std::weak_ptr<TextureHandle> packed_from_diffuse{};
+    std::weak_ptr<TextureHandle> packed_from_specular_map{};
 };
 
 using BaseLitEntityGlobalData = BaseEntityGlobalData;
@@ -64,10 +71,23 @@ protected:
     int diffuse_texture_scale_location{};
     int specular_texture_scale_location{};
 
+    // Texture array layers, where -1 means to sample the standalone texture instead
+    int diffuse_texture_layer_location{};
+    int specular_map_texture_layer_location{};
+    int specular_in_diffuse_alpha_location{};
+    int diffuse_texture_flipped_location{};
+    int specular_map_texture_flipped_location{};
+
     static const uint POINT_LIGHT_BINDING = 0;
 
     UniformBufferArray<PointLight::Data, MAX_PL> point_lights_ubo;
 public:
+    // Texture units, the array units are used instead when a texture is a layer of a TextureArray
+    static const uint DIFFUSE_TEXTURE_UNIT = 0;
+    static const uint SPECULAR_MAP_TEXTURE_UNIT = 1;
+    static const uint DIFFUSE_TEXTURE_ARRAY_UNIT = 2;
+    static const uint SPECULAR_MAP_TEXTURE_ARRAY_UNIT = 3;
+
     BaseLitEntityShader(std::string name, const std::string& vertex_path, const std::string& fragment_path,
                         std::unordered_map<std::string, std::string> vert_defines = {},
                         std::unordered_map<std::string, std::string> frag_defines = {});
@@ -75,6 +95,16 @@ public:
     void set_instance_data(const BaseLitEntityInstanceData& instance_data);
 
     void set_point_lights(const std::vector<PointLight>& point_lights);
+
+    /// Set which texture array layers to sample, as returned by TextureBindings::bind
+    void set_texture_layers(int diffuse_layer, int specular_map_layer);
+    /// Set whether to flip each texture vertically, see TextureHandle::is_flipped()
+    void set_texture_flips(bool diffuse_flipped, bool specular_map_flipped);
+
+    /// Bind the entity's textures and set the layers to sample, using its packed texture if it has one and the texture scales allow it
+    void bind_textures(TextureBindings& texture_bindings, const BaseLitEntityRenderData& render_data, const BaseLitEntityMaterial& material);
+    /// The ids that bind_textures() will bind, used to sort draws so that entities sharing textures are drawn consecutively
+    static std::pair<uint, uint> binding_ids(const BaseLitEntityRenderData& render_data, const BaseLitEntityMaterial& material);
 protected:
     void get_uniforms_set_bindings() override;
 };
@@ -0,0 +1,171 @@
+#include "AnimationCompression.h"
+
+#include <cmath>
+
+namespace {
+    // Smallest three components are at most 1/sqrt(2) in magnitude, quantised to 15 bits, leaving the top bit of two of them for the largest's index
+    constexpr float SMALLEST_THREE_RANGE = 0.70710678f;
+    constexpr float SMALLEST_THREE_STEPS = 32767.0f;
+
+    uint16_t quantise_unit(float value, float steps) {
+        return (uint16_t) std::lround(std::clamp(value, 0.0f, 1.0f) * steps);
+    }
+
+    uint16_t quantise_time(float time, float start_time, float time_range) {
+        return time_range > 0.0f ? quantise_unit((time - start_time) / time_range, 65535.0f) : 0;
+    }
+
+    // The channel specific parts of compression
+
+    void set_range(CompressedTrack<glm::vec3>& track, const std::vector<glm::vec3>& values) {
+        glm::vec3 maximum = values[0];
+        track.minimum = values[0];
+        for (const auto& value: values) {
+            track.minimum = glm::min(track.minimum, value);
+            maximum = glm::max(maximum, value);
+        }
+        track.extent = maximum - track.minimum;
+    }
+
+    void set_range(CompressedTrack<glm::quat>&, const std::vector<glm::quat>&) {}
+
+    void append_value(CompressedTrack<glm::vec3>& track, const glm::vec3& value) {
+        for (int c = 0; c < 3; ++c) {
+            track.values.push_back(track.extent[c] > 0.0f ? quantise_unit((value[c] - track.minimum[c]) / track.extent[c], 65535.0f) : 0);
+        }
+    }
+
+    void append_value(CompressedTrack<glm::quat>& track, const glm::quat& value) {
+        glm::quat q = glm::normalize(value);
+        float components[4] = {q.x, q.y, q.z, q.w};
+        int largest = 0;
+        for (int c = 1; c < 4; ++c) {
+            if (std::abs(components[c]) > std::abs(components[largest])) largest = c;
+        }
+        // q and -q are the same rotation, so the largest can always be made positive and left implicit
+        float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+        uint16_t quantised[3];
+        for (int c = 0, i = 0; c < 4; ++c) {
+            if (c == largest) continue;
+            quantised[i++] = quantise_unit((sign * components[c] / SMALLEST_THREE_RANGE + 1.0f) * 0.5f, SMALLEST_THREE_STEPS);
+        }
+        track.values.push_back((uint16_t) (quantised[0] | ((largest >> 1) << 15)));
+        track.values.push_back((uint16_t) (quantised[1] | ((largest & 1) << 15)));
+        track.values.push_back(quantised[2]);
+    }
+
+    /// An estimate of the error between two values, in the units of the tolerance
+    float distance(const glm::vec3& a, const glm::vec3& b) {
+        return glm::length(a - b);
+    }
+
+    float distance(const glm::quat& a, const glm::quat& b) {
+        // For unit quaternions |a - b| is 2 sin(angle / 4), so twice it is the angle between the rotations to within a fraction of a percent
+        // at the sizes tolerances are, and unlike acos() of the dot product it keeps its precision near zero
+        float sign = glm::dot(a, b) < 0.0f ? -1.0f : 1.0f;
+        return 2.0f * glm::length(glm::vec4{a.x, a.y, a.z, a.w} - sign * glm::vec4{b.x, b.y, b.z, b.w});
+    }
+
+    /// Interpolates the same way PoseKernels do
+    glm::vec3 interpolate(const glm::vec3& a, const glm::vec3& b, float t) {
+        return glm::mix(a, b, t);
+    }
+
+    glm::quat interpolate(const glm::quat& a, const glm::quat& b, float t) {
+        glm::quat target = glm::dot(a, b) < 0.0f ? -b : b;
+        return glm::normalize(a + (target - a) * t);
+    }
+
+    template<typename T>
+    CompressedTrack<T> compress_track(const std::vector<float>& key_times, const std::vector<T>& key_values, float tolerance, const T& default_value) {
+        CompressedTrack<T> track{};
+        if (key_times.empty()) return track;
+        auto count = (uint) key_times.size();
+
+        bool constant = true;
+        for (uint key = 1; key < count && constant; ++key) {
+            constant = distance(key_values[key], key_values[0]) <= tolerance;
+        }
+        if (constant) {
+            if (distance(key_values[0], default_value) <= tolerance) return track;
+            track.start_time = key_times[0];
+            set_range(track, {key_values[0]});
+            track.times.push_back(0);
+            append_value(track, key_values[0]);
+            return track;
+        }
+
+        track.start_time = key_times.front();
+        track.time_range = key_times.back() - key_times.front();
+        set_range(track, key_values);
+
+        // Every key as it will be decompressed, so the key reduction accounts for the quantisation error too
+        CompressedTrack<T> all_keys = track;
+        for (uint key = 0; key < count; ++key) {
+            all_keys.times.push_back(quantise_time(key_times[key], track.start_time, track.time_range));
+            append_value(all_keys, key_values[key]);
+        }
+
+        // Greedily extend a line from the last kept key for as long as interpolating along it reproduces every key it passes over
+        std::vector<uint> kept{0};
+        uint anchor = 0;
+        for (uint end = 2; end < count; ++end) {
+            float anchor_time = all_keys.key_time(anchor);
+            float span = all_keys.key_time(end) - anchor_time;
+            bool fits = span > 0.0f;
+            T a = all_keys.key_value(anchor);
+            T b = all_keys.key_value(end);
+            for (uint key = anchor + 1; key < end && fits; ++key) {
+                fits = distance(interpolate(a, b, (all_keys.key_time(key) - anchor_time) / span), key_values[key]) <= tolerance;
+            }
+            if (!fits) {
+                anchor = end - 1;
+                kept.push_back(anchor);
+            }
+        }
+        kept.push_back(count - 1);
+
+        for (uint key: kept) {
+            track.times.push_back(all_keys.times[key]);
+            track.values.insert(track.values.end(), all_keys.values.begin() + key * 3, all_keys.values.begin() + key * 3 + 3);
+        }
+        return track;
+    }
+}
+
+template<>
+CompressedTrack<glm::vec3> CompressedTrack<glm::vec3>::compress(const std::vector<float>& key_times, const std::vector<glm::vec3>& key_values, float tolerance, const glm::vec3& default_value) {
+    return compress_track(key_times, key_values, tolerance, default_value);
+}
+
+template<>
+CompressedTrack<glm::quat> CompressedTrack<glm::quat>::compress(const std::vector<float>& key_times, const std::vector<glm::quat>& key_values, float tolerance, const glm::quat& default_value) {
+    return compress_track(key_times, key_values, tolerance, default_value);
+}
+
+template<>
+glm::vec3 CompressedTrack<glm::vec3>::key_value(uint key) const {
+    const uint16_t* quantised = &values[key * 3];
+    return minimum + extent * glm::vec3{quantised[0], quantised[1], quantised[2]} * (1.0f / 65535.0f);
+}
+
+template<>
+glm::quat CompressedTrack<glm::quat>::key_value(uint key) const {
+    const uint16_t* quantised = &values[key * 3];
+    int largest = ((quantised[0] >> 15) << 1) | (quantised[1] >> 15);
+    float smallest[3];
+    float sum_squares = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+        smallest[i] = ((float) (quantised[i] & 0x7FFF) / SMALLEST_THREE_STEPS * 2.0f - 1.0f) * SMALLEST_THREE_RANGE;
+        sum_squares += smallest[i] * smallest[i];
+    }
+    float components[4];
+    for (int c = 0, i = 0; c < 4; ++c) {
+        components[c] = c == largest ? std::sqrt(std::max(0.0f, 1.0f - sum_squares)) : smallest[i++];
+    }
+    return glm::quat{components[3], components[0], components[1], components[2]};
+}
+
+size_t CompressedAnimationTracks::get_bytes() const {
+    return positions.get_bytes() + rotations.get_bytes() + scalings.get_bytes();
+}
@@ -0,0 +1,114 @@
+#ifndef ANIMATION_COMPRESSION_H
+#define ANIMATION_COMPRESSION_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "utility/HelperTypes.h"
+
+/// The index of the last of the sorted times at or before time, or 0 if time is before the first.
+/// cursor is the result of the previous call, so when time has only moved forward by up to a key this is O(1),
+/// and it falls back to a binary search on seeks and loops. cursor is updated to the result. times must not be empty.
+template<typename Time, typename Query>
+uint find_sorted_key(const std::vector<Time>& times, Query time, uint& cursor) {
+    auto count = (uint) times.size();
+    uint key = std::min(cursor, count - 1);
+    if (times[key] <= time) {
+        // Normal playback stays on the same key, or moves onto the next one
+        if (key + 1 == count || time < times[key + 1]) return cursor = key;
+        if (key + 2 == count || time < times[key + 2]) return cursor = key + 1;
+    }
+    auto next = std::upper_bound(times.begin(), times.end(), time);
+    cursor = next == times.begin() ? 0 : (uint) (next - times.begin()) - 1;
+    return cursor;
+}
+
+/// How far a compressed track may stray from the keys it was compressed from
+struct AnimationCompressionSettings {
+    // In model units
+    float position_tolerance = 0.001f;
+    // In radians
+    float rotation_tolerance = 0.001f;
+    float scaling_tolerance = 0.001f;
+};
+
+/// A keyframe track of glm::vec3 or glm::quat, stored in 6 bytes a value and 2 a time, and decompressed a key at a time as it is sampled.
+///
+/// Keys that linear interpolation of their neighbours reproduces within the tolerance are dropped, a track that never strays
+/// from its first value is reduced to that one key, and is dropped entirely if that is the channel's default anyway.
+/// Times are quantised over the track's range, vectors over each component's range, and quaternions are stored as their
+/// three smallest components, the largest being recovered from them being unit length.
+template<typename T>
+struct CompressedTrack {
+    float start_time = 0.0f;
+    float time_range = 0.0f;
+    // [key] -> time, quantised over [start_time, start_time + time_range]
+    std::vector<uint16_t> times{};
+    // For glm::vec3, each component is quantised over [minimum, minimum + extent]
+    glm::vec3 minimum{0.0f};
+    glm::vec3 extent{0.0f};
+    // [key * 3 + i] -> the i'th quantised component
+    std::vector<uint16_t> values{};
+
+    /// Compress sorted keys, where default_value is what the channel takes when it has no track
+    static CompressedTrack compress(const std::vector<float>& key_times, const std::vector<T>& key_values, float tolerance, const T& default_value);
+
+    [[nodiscard]] bool empty() const { return times.empty(); }
+    [[nodiscard]] size_t size() const { return times.size(); }
+    [[nodiscard]] float key_time(uint key) const;
+    [[nodiscard]] T key_value(uint key) const;
+    /// The decompressed keys either side of time and how far between them it is, holding the first and last keys outside the track's range.
+    /// cursor is used as for KeyframeTrack::find_key(). The track must not be empty.
+    void find_keys(float time, uint& cursor, T& a, T& b, float& t) const;
+    [[nodiscard]] size_t get_bytes() const;
+};
+
+/// The compressed form of the three tracks of an AnimationData
+struct CompressedAnimationTracks {
+    CompressedTrack<glm::vec3> positions{};
+    CompressedTrack<glm::quat> rotations{};
+    CompressedTrack<glm::vec3> scalings{};
+
+    [[nodiscard]] size_t get_bytes() const;
+};
+
+// Defined for glm::vec3 and glm::quat in AnimationCompression.cpp
+template<>
+CompressedTrack<glm::vec3> CompressedTrack<glm::vec3>::compress(const std::vector<float>& key_times, const std::vector<glm::vec3>& key_values, float tolerance, const glm::vec3& default_value);
+template<>
+CompressedTrack<glm::quat> CompressedTrack<glm::quat>::compress(const std::vector<float>& key_times, const std::vector<glm::quat>& key_values, float tolerance, const glm::quat& default_value);
+template<>
+glm::vec3 CompressedTrack<glm::vec3>::key_value(uint key) const;
+template<>
+glm::quat CompressedTrack<glm::quat>::key_value(uint key) const;
+
+template<typename T>
+float CompressedTrack<T>::key_time(uint key) const {
+    return start_time + (float) times[key] * (time_range / 65535.0f);
+}
+
+template<typename T>
+void CompressedTrack<T>::find_keys(float time, uint& cursor, T& a, T& b, float& t) const {
+    // Searched in quantised units, so the times never need decompressing
+    float quantised_time = time_range > 0.0f ? (time - start_time) * (65535.0f / time_range) : 0.0f;
+    uint key = find_sorted_key(times, quantised_time, cursor);
+    a = key_value(key);
+    if (key + 1 == times.size() || quantised_time <= (float) times[key]) {
+        b = a;
+        t = 0.0f;
+        return;
+    }
+    b = key_value(key + 1);
+    t = (quantised_time - (float) times[key]) / (float) (times[key + 1] - times[key]);
+}
+
+template<typename T>
+size_t CompressedTrack<T>::get_bytes() const {
+    return sizeof(CompressedTrack<T>) + times.size() * sizeof(uint16_t) + values.size() * sizeof(uint16_t);
+}
+
+#endif //ANIMATION_COMPRESSION_H
@@ -0,0 +1,167 @@
+#include "AssetBudget.h"
+
+#include <cstdio>
+#include <algorithm>
+
+#include "rendering/imgui/ImGuiManager.h"
+
+void AssetBudget::track_erased(std::shared_ptr<void> asset, Kind kind, std::string name, size_t bytes) {
+    auto existing = entry_lookup.find(asset.get());
+    if (existing != entry_lookup.end()) {
+        // Already tracked, just treat it as recently used
+        entries.splice(entries.begin(), entries, existing->second);
+        return;
+    }
+
+    for (auto iter = entries.begin(); iter != entries.end();) {
+        if (iter->kind == kind && iter->name == name && is_warm(*iter)) {
+            entry_lookup.erase(iter->asset.get());
+            iter = entries.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
+    const void* key = asset.get();
+    entries.push_front(Entry{std::move(asset), kind, std::move(name), bytes});
+    entry_lookup[key] = entries.begin();
+}
+
+void AssetBudget::update() {
+    in_use_bytes = 0;
+    warm_bytes = 0;
+    in_use_count = 0;
+    warm_count = 0;
+
+    for (auto iter = entries.begin(); iter != entries.end();) {
+        auto next = std::next(iter);
+        if (is_warm(*iter)) {
+            warm_bytes += iter->bytes;
+            warm_count++;
+        } else {
+            in_use_bytes += iter->bytes;
+            in_use_count++;
+            entries.splice(entries.begin(), entries, iter);
+        }
+        iter = next;
+    }
+
+    // Everything in use is now at the front, so the back holds the warm assets in order of how long ago they were released
+    while (!entries.empty() && is_warm(entries.back()) && (in_use_bytes + warm_bytes > budget_bytes || warm_count > max_warm_assets)) {
+        warm_bytes -= entries.back().bytes;
+        warm_count--;
+        total_evictions++;
+        entry_lookup.erase(entries.back().asset.get());
+        entries.pop_back();
+    }
+}
+
+void AssetBudget::evict_all_warm() {
+    for (auto iter = entries.begin(); iter != entries.end();) {
+        if (is_warm(*iter)) {
+            total_evictions++;
+            entry_lookup.erase(iter->asset.get());
+            iter = entries.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    warm_bytes = 0;
+    warm_count = 0;
+}
+
+void AssetBudget::set_budget_bytes(size_t bytes) {
+    budget_bytes = bytes;
+}
+
+size_t AssetBudget::get_budget_bytes() const {
+    return budget_bytes;
+}
+
+void AssetBudget::set_max_warm_assets(uint count) {
+    max_warm_assets = count;
+}
+
+uint AssetBudget::get_max_warm_assets() const {
+    return max_warm_assets;
+}
+
+size_t AssetBudget::get_in_use_bytes() const {
+    return in_use_bytes;
+}
+
+size_t AssetBudget::get_warm_bytes() const {
+    return warm_bytes;
+}
+
+void AssetBudget::report_shared(Kind kind, uint count, size_t saved_bytes) {
+    shared_stats[kind] = SharedStats{count, saved_bytes};
+}
+
+void AssetBudget::add_imgui_options_section() {
+    if (ImGui::CollapsingHeader("Asset Budget")) {
+        constexpr float MIB = 1024.0f * 1024.0f;
+
+        float used = (float) (in_use_bytes + warm_bytes);
+        char overlay[64];
+        std::snprintf(overlay, sizeof(overlay), "%.1f / %.1f MiB", used / MIB, (float) budget_bytes / MIB);
+        bool over_budget = in_use_bytes + warm_bytes > budget_bytes;
+        if (over_budget) ImGui::PushStyleColor(ImGuiCol_PlotHistogram, ImVec4(0.8f, 0.2f, 0.2f, 1.0f));
+        ImGui::ProgressBar(std::min(used / (float) budget_bytes, 1.0f), ImVec2(-FLT_MIN, 0.0f), overlay);
+        if (over_budget) ImGui::PopStyleColor();
+
+        ImGui::Text("In Use: %u assets, %.1f MiB", in_use_count, (float) in_use_bytes / MIB);
+        ImGui::Text("Warm: %u assets, %.1f MiB", warm_count, (float) warm_bytes / MIB);
+        ImGui::Text("Evictions: %u", total_evictions);
+        for (const auto& [kind, stats]: shared_stats) {
+            ImGui::Text("Shared (%s): %u, saving %.1f MiB", kind_name(kind), stats.count, (float) stats.saved_bytes / MIB);
+        }
+
+        int budget_mib = (int) (budget_bytes / (1024 * 1024));
+        if (ImGui::DragInt("Budget (MiB)", &budget_mib, 4.0f, 16, 16384)) {
+            budget_bytes = (size_t) std::max(budget_mib, 16) * 1024 * 1024;
+        }
+        ImGui::SameLine();
+        ImGui::HelpMarker("Assets still used by the scene are never evicted, so usage can exceed the budget.");
+
+        int max_warm = (int) max_warm_assets;
+        if (ImGui::DragInt("Max Warm Assets", &max_warm, 0.25f, 0, 1024)) {
+            max_warm_assets = (uint) std::max(max_warm, 0);
+        }
+        ImGui::SameLine();
+        ImGui::HelpMarker("How many released assets to keep loaded, so that selecting them again is instant.");
+
+        if (ImGui::Button("Evict Warm Assets")) {
+            evict_all_warm();
+        }
+
+        if (ImGui::TreeNode("Tracked Assets")) {
+            for (const auto& entry: entries) {
+                ImGui::Text("%s %s: %s (%.2f MiB)", is_warm(entry) ? "[Warm]  " : "[In Use]", kind_name(entry.kind), entry.name.c_str(), (float) entry.bytes / MIB);
+            }
+            ImGui::TreePop();
+        }
+    }
+}
+
+void AssetBudget::cleanup() {
+    entry_lookup.clear();
+    entries.clear();
+}
+
+bool AssetBudget::is_warm(const Entry& entry) {
+    // The only reference left is the one held here
+    return entry.asset.use_count() == 1;
+}
+
+const char* AssetBudget::kind_name(Kind kind) {
+    switch (kind) {
+        case Kind::Texture:
+            return "Texture";
+        case Kind::Model:
+            return "Model";
+        case Kind::MeshHierarchy:
+            return "Mesh Hierarchy";
+    }
+    return "Unknown";
+}
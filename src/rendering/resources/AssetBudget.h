@@ -0,0 +1,101 @@
+#ifndef ASSET_BUDGET_H
+#define ASSET_BUDGET_H
+
+#include <list>
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <unordered_map>
+
+#include "utility/HelperTypes.h"
+
+/// Tracks the GPU memory used by the assets handed out by the TextureLoader and ModelLoader.
+///
+/// The loaders only hold weak_ptrs, so an asset is normally freed as soon as the last scene element using it lets go.
+/// This class holds a strong reference to every tracked asset, so that once released an asset stays "warm",
+/// which lets the loader caches hand it straight back out if it is selected again.
+/// Warm assets are kept in least recently used order, and the coldest ones are evicted once the total is over budget
+/// or there are too many of them.
+class AssetBudget : private NonCopyable {
+public:
+    enum class Kind {
+        Texture,
+        Model,
+        MeshHierarchy,
+    };
+
+private:
+    struct Entry {
+        std::shared_ptr<void> asset;
+        Kind kind;
+        std::string name;
+        size_t bytes;
+    };
+
+    // Front is the most recently used, warm entries are only ever evicted from the back
+    std::list<Entry> entries{};
+    // Map asset -> position in entries
+    std::unordered_map<const void*, std::list<Entry>::iterator> entry_lookup{};
+
+    size_t budget_bytes = 512ull * 1024 * 1024;
+    uint max_warm_assets = 32;
+
+    // Stats from the last update
+    size_t in_use_bytes = 0;
+    size_t warm_bytes = 0;
+    uint in_use_count = 0;
+    uint warm_count = 0;
+    uint total_evictions = 0;
+
+    struct SharedStats {
+        uint count;
+        size_t saved_bytes;
+    };
+    // Reported by the loaders, for assets handed out under several names but stored once
+    std::unordered_map<Kind, SharedStats> shared_stats{};
+public:
+    AssetBudget() = default;
+
+    /// Start tracking a newly loaded asset, with the number of bytes of GPU memory it is using.
+    /// Any warm asset with the same name is evicted, since it has been superseded by this one.
+    template<typename T>
+    void track(const std::shared_ptr<T>& asset, Kind kind, std::string name, size_t bytes);
+
+    /// Classify each asset as in use or warm, moving in use assets to the front of the LRU,
+    /// then evict the coldest warm assets until both limits are satisfied. Should be called once per frame.
+    void update();
+
+    /// Drop the reference to every warm asset
+    void evict_all_warm();
+
+    void set_budget_bytes(size_t bytes);
+    [[nodiscard]] size_t get_budget_bytes() const;
+    void set_max_warm_assets(uint count);
+    [[nodiscard]] uint get_max_warm_assets() const;
+
+    [[nodiscard]] size_t get_in_use_bytes() const;
+    [[nodiscard]] size_t get_warm_bytes() const;
+
+    /// Report how many loaded assets of a kind are sharing GPU memory with another, and the bytes that saves over loading each separately.
+    /// Only used for the stats, since tracked assets are already counted once however many handles share them.
+    void report_shared(Kind kind, uint count, size_t saved_bytes);
+
+    /// Adds the ImGUI controls for the budget, and the usage against it
+    void add_imgui_options_section();
+
+    /// Free up any resources, releasing all the tracked assets.
+    void cleanup();
+
+private:
+    void track_erased(std::shared_ptr<void> asset, Kind kind, std::string name, size_t bytes);
+
+    static bool is_warm(const Entry& entry);
+    static const char* kind_name(Kind kind);
+};
+
+template<typename T>
+void AssetBudget::track(const std::shared_ptr<T>& asset, Kind kind, std::string name, size_t bytes) {
+    track_erased(std::static_pointer_cast<void>(asset), kind, std::move(name), bytes);
+}
+
+#endif //ASSET_BUDGET_H
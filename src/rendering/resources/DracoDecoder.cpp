@@ -0,0 +1,139 @@
+#include "DracoDecoder.h"
+
+#include <stdexcept>
+
+#include <glm/gtx/component_wise.hpp>
+#include <draco/compression/decode.h>
+
+
+namespace {
+    /// The attribute with the unique id from attribute_ids if given, otherwise the first attribute of the type
+    const draco::PointAttribute* find_attribute(const draco::Mesh& mesh, const std::optional<DracoAttributeIds>& attribute_ids, std::optional<uint> DracoAttributeIds::* id, draco::GeometryAttribute::Type type) {
+        if (!attribute_ids.has_value()) {
+            return mesh.GetNamedAttribute(type);
+        }
+        auto unique_id = attribute_ids.value().*id;
+        if (!unique_id.has_value()) return nullptr;
+
+        const auto* attribute = mesh.GetAttributeByUniqueId(unique_id.value());
+        if (attribute == nullptr) {
+            throw std::runtime_error(Formatter() << "Missing attribute with id " << unique_id.value());
+        }
+        return attribute;
+    }
+
+    /// Read the attribute of every point, in the layout of T, which is a glm vector of N components.
+    /// Draco dequantizes and normalises the values as they are read.
+    template<typename Component, int N, typename T>
+    void read_attribute(const draco::Mesh& mesh, const draco::PointAttribute& attribute, std::vector<T>& out) {
+        out.resize(mesh.num_points(), T{0});
+        for (draco::PointIndex i(0); i < mesh.num_points(); ++i) {
+            if (!attribute.ConvertValue<Component>(attribute.mapped_index(i), N, &out[i.value()][0])) {
+                throw std::runtime_error(Formatter() << "Failed to read " << draco::GeometryAttribute::TypeToString(attribute.attribute_type()) << " attribute");
+            }
+        }
+    }
+
+    /// Area weighted vertex normals, since larger faces should contribute more to the normal
+    void generate_normals(VertexCollection& vertices, const std::vector<uint>& indices) {
+        vertices.normals.assign(vertices.positions.size(), glm::vec3{0.0f});
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            glm::vec3 a = vertices.positions[indices[i]];
+            glm::vec3 b = vertices.positions[indices[i + 1]];
+            glm::vec3 c = vertices.positions[indices[i + 2]];
+            // The length of the cross product is twice the area of the triangle
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            for (size_t j = 0; j < 3; ++j) {
+                vertices.normals[indices[i + j]] += normal;
+            }
+        }
+        for (auto& normal: vertices.normals) {
+            float length = glm::length(normal);
+            normal = length > 0.0f ? normal / length : glm::vec3{0.0f, 1.0f, 0.0f};
+        }
+    }
+}
+
+void DracoDecoder::decode(const char* data, size_t size, VertexCollection& out_vertices, std::vector<uint>& out_indices, const std::optional<DracoAttributeIds>& attribute_ids) {
+    draco::DecoderBuffer buffer{};
+    buffer.Init(data, size);
+
+    draco::Decoder decoder{};
+    auto result = decoder.DecodeMeshFromBuffer(&buffer);
+    if (!result.ok()) {
+        throw std::runtime_error(Formatter() << "Failed to decode Draco mesh: " << result.status().error_msg_string());
+    }
+    std::unique_ptr<draco::Mesh> mesh = std::move(result).value();
+
+    const auto* positions = find_attribute(*mesh, attribute_ids, &DracoAttributeIds::position, draco::GeometryAttribute::POSITION);
+    if (positions == nullptr) {
+        throw std::runtime_error("Draco mesh has no positions");
+    }
+    read_attribute<float, 3>(*mesh, *positions, out_vertices.positions);
+
+    const auto* normals = find_attribute(*mesh, attribute_ids, &DracoAttributeIds::normal, draco::GeometryAttribute::NORMAL);
+    out_vertices.normals.clear();
+    if (normals != nullptr) {
+        read_attribute<float, 3>(*mesh, *normals, out_vertices.normals);
+    }
+
+    const auto* tex_coords = find_attribute(*mesh, attribute_ids, &DracoAttributeIds::tex_coord, draco::GeometryAttribute::TEX_COORD);
+    out_vertices.tex_coords.clear();
+    if (tex_coords != nullptr) {
+        read_attribute<float, 2>(*mesh, *tex_coords, out_vertices.tex_coords);
+    }
+
+    // Bones only exist in glTF files, as .drc files have no way to mark which generic attribute is which
+    out_vertices.bones.assign(mesh->num_points(), {glm::vec4{0.0f}, glm::uvec4{0u}});
+    if (attribute_ids.has_value()) {
+        const auto* joints = find_attribute(*mesh, attribute_ids, &DracoAttributeIds::joints, draco::GeometryAttribute::GENERIC);
+        const auto* weights = find_attribute(*mesh, attribute_ids, &DracoAttributeIds::weights, draco::GeometryAttribute::GENERIC);
+        if (joints != nullptr && weights != nullptr) {
+            std::vector<glm::uvec4> joint_values{};
+            std::vector<glm::vec4> weight_values{};
+            read_attribute<uint32_t, 4>(*mesh, *joints, joint_values);
+            read_attribute<float, 4>(*mesh, *weights, weight_values);
+
+            for (size_t i = 0; i < out_vertices.bones.size(); ++i) {
+                auto& [bone_weights, bone_indices] = out_vertices.bones[i];
+                for (int j = 0; j < 4; ++j) {
+                    // Unused slots are left as bone 0 with no weight
+                    if (weight_values[i][j] > 0.0f) {
+                        bone_weights[j] = weight_values[i][j];
+                        bone_indices[j] = joint_values[i][j];
+                    }
+                }
+                float weight_sum = glm::compAdd(bone_weights);
+                if (weight_sum != 0.0f) {
+                    // Normalise the sum of the weights
+                    bone_weights /= weight_sum;
+                }
+            }
+        }
+    }
+
+    out_indices.resize((size_t) mesh->num_faces() * 3);
+    for (draco::FaceIndex f(0); f < mesh->num_faces(); ++f) {
+        const auto& face = mesh->face(f);
+        for (int j = 0; j < 3; ++j) {
+            out_indices[(size_t) f.value() * 3 + j] = face[j].value();
+        }
+    }
+}
+
+void DracoDecoder::decode_file(const std::string& path, VertexCollection& out_vertices, std::vector<uint>& out_indices) {
+    FileContents contents = FileContents::map(path);
+    decode_file(contents, path, out_vertices, out_indices);
+}
+
+void DracoDecoder::decode_file(const FileContents& contents, const std::string& path, VertexCollection& out_vertices, std::vector<uint>& out_indices) {
+    try {
+        decode(contents.get_data(), contents.get_size(), out_vertices, out_indices);
+    } catch (const std::exception& e) {
+        throw std::runtime_error(Formatter() << "Failed to load Draco file (" << path << "): \n\t" << e.what());
+    }
+
+    if (out_vertices.normals.empty()) {
+        generate_normals(out_vertices, out_indices);
+    }
+}
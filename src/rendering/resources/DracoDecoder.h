@@ -0,0 +1,37 @@
+#ifndef DRACO_DECODER_H
+#define DRACO_DECODER_H
+
+#include <string>
+#include <vector>
+#include <optional>
+
+#include "VertexCollection.h"
+#include "utility/FileContents.h"
+#include "utility/HelperTypes.h"
+
+/// The unique ids of the attributes within a Draco compressed mesh, as given by glTF's KHR_draco_mesh_compression extension
+struct DracoAttributeIds {
+    std::optional<uint> position{};
+    std::optional<uint> normal{};
+    std::optional<uint> tex_coord{};
+    std::optional<uint> joints{};
+    std::optional<uint> weights{};
+};
+
+/// Decoding of Draco compressed meshes, from either standalone .drc files, or glTF primitives using KHR_draco_mesh_compression.
+///
+/// Each mesh decodes independently, so callers with several meshes decode them in parallel on the ThreadPool.
+/// Draco trades CPU time for much smaller files, which makes loading from slow storage faster overall.
+namespace DracoDecoder {
+    /// Decode the compressed mesh into out_vertices and out_indices.
+    /// Attributes are found by their unique id if attribute_ids is given, otherwise by their type, as standalone .drc files have no other way to identify them.
+    /// Vertices without bones get bone 0 with no weight, and the weights are normalised. Throws a std::runtime_error if the data can't be decoded.
+    void decode(const char* data, size_t size, VertexCollection& out_vertices, std::vector<uint>& out_indices, const std::optional<DracoAttributeIds>& attribute_ids = std::nullopt);
+
+    /// Decode a standalone .drc file, generating smooth normals if the file doesn't have any
+    void decode_file(const std::string& path, VertexCollection& out_vertices, std::vector<uint>& out_indices);
+    /// Decode the contents of a standalone .drc file that is already in memory, the path is only used in messages
+    void decode_file(const FileContents& contents, const std::string& path, VertexCollection& out_vertices, std::vector<uint>& out_indices);
+}
+
+#endif //DRACO_DECODER_H
@@ -0,0 +1,592 @@
+#include "GlbFile.h"
+
+#include "ModelLoader.h"
+#include "utility/ThreadPool.h"
+
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtx/component_wise.hpp>
+#include <nlohmann/json.hpp>
+
+namespace {
+    using json = nlohmann::json;
+
+    constexpr uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+    constexpr uint32_t GLB_VERSION = 2;
+    constexpr uint32_t CHUNK_JSON = 0x4E4F534A; // "JSON"
+    constexpr uint32_t CHUNK_BIN = 0x004E4942; // "BIN\0"
+
+    constexpr uint COMPONENT_BYTE = 5120;
+    constexpr uint COMPONENT_UNSIGNED_BYTE = 5121;
+    constexpr uint COMPONENT_SHORT = 5122;
+    constexpr uint COMPONENT_UNSIGNED_SHORT = 5123;
+    constexpr uint COMPONENT_UNSIGNED_INT = 5125;
+    constexpr uint COMPONENT_FLOAT = 5126;
+
+    constexpr uint MODE_TRIANGLES = 4;
+
+    constexpr const char* DRACO_EXTENSION = "KHR_draco_mesh_compression";
+
+    /// Thrown for valid files that use something the loader doesn't support, so Assimp should load them instead
+    struct UnsupportedFeature : public std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    uint32_t read_u32(const char* data) {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    size_t component_size(uint component_type) {
+        switch (component_type) {
+            case COMPONENT_BYTE:
+            case COMPONENT_UNSIGNED_BYTE:
+                return 1;
+            case COMPONENT_SHORT:
+            case COMPONENT_UNSIGNED_SHORT:
+                return 2;
+            case COMPONENT_UNSIGNED_INT:
+            case COMPONENT_FLOAT:
+                return 4;
+            default:
+                throw std::runtime_error(Formatter() << "Invalid accessor component type: " << component_type);
+        }
+    }
+
+    uint type_components(const std::string& type) {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        if (type == "MAT2") return 4;
+        if (type == "MAT3") return 9;
+        if (type == "MAT4") return 16;
+        throw std::runtime_error(Formatter() << "Invalid accessor type: " << type);
+    }
+
+    /// Read a single component as a float, applying the normalisation rules of the glTF spec if the accessor is normalized
+    float read_component(const unsigned char* data, uint component_type, bool normalized) {
+        switch (component_type) {
+            case COMPONENT_FLOAT: {
+                float value;
+                std::memcpy(&value, data, sizeof(value));
+                return value;
+            }
+            case COMPONENT_UNSIGNED_BYTE:
+                return normalized ? (float) data[0] / 255.0f : (float) data[0];
+            case COMPONENT_BYTE: {
+                auto value = (float) (int8_t) data[0];
+                return normalized ? std::max(value / 127.0f, -1.0f) : value;
+            }
+            case COMPONENT_UNSIGNED_SHORT: {
+                uint16_t value;
+                std::memcpy(&value, data, sizeof(value));
+                return normalized ? (float) value / 65535.0f : (float) value;
+            }
+            case COMPONENT_SHORT: {
+                int16_t value;
+                std::memcpy(&value, data, sizeof(value));
+                return normalized ? std::max((float) value / 32767.0f, -1.0f) : (float) value;
+            }
+            case COMPONENT_UNSIGNED_INT: {
+                uint32_t value;
+                std::memcpy(&value, data, sizeof(value));
+                return (float) value;
+            }
+            default:
+                return 0.0f;
+        }
+    }
+
+    uint read_index(const unsigned char* data, uint component_type) {
+        switch (component_type) {
+            case COMPONENT_UNSIGNED_BYTE:
+                return data[0];
+            case COMPONENT_UNSIGNED_SHORT: {
+                uint16_t value;
+                std::memcpy(&value, data, sizeof(value));
+                return value;
+            }
+            default: {
+                uint32_t value;
+                std::memcpy(&value, data, sizeof(value));
+                return value;
+            }
+        }
+    }
+
+    /// Read element i of the accessor into out, which must have space for accessor.components floats
+    void read_element(const GlbAccessor& accessor, size_t i, float* out) {
+        size_t size = component_size(accessor.component_type);
+        const unsigned char* element = accessor.data + i * accessor.stride;
+        for (uint c = 0; c < accessor.components; ++c) {
+            out[c] = read_component(element + c * size, accessor.component_type, accessor.normalized);
+        }
+    }
+
+    /// An accessor over tightly packed, decompressed data
+    GlbAccessor decoded_accessor(const void* data, size_t count, uint component_type, uint components) {
+        GlbAccessor accessor{};
+        accessor.data = static_cast<const unsigned char*>(data);
+        accessor.count = count;
+        accessor.component_type = component_type;
+        accessor.components = components;
+        accessor.stride = component_size(component_type) * components;
+        return accessor;
+    }
+
+    /// Accessors that vertex attributes are read straight from need to be floats, since they are read through a StridedView
+    void require_float(const GlbAccessor& accessor, uint components, const char* attribute) {
+        if (accessor.component_type != COMPONENT_FLOAT || accessor.components != components) {
+            throw UnsupportedFeature(Formatter() << attribute << " attributes that are not " << components << " component floats");
+        }
+    }
+}
+
+VertexStream GlbPrimitive::vertex_stream() const {
+    VertexStream stream{};
+    stream.count = vertex_count;
+    stream.positions = StridedView<glm::vec3>(positions.data, positions.stride);
+    stream.normals = StridedView<glm::vec3>(normals.data, normals.stride);
+    if (!tex_coords.empty()) {
+        stream.tex_coords = StridedView<glm::vec2>(tex_coords.data, tex_coords.stride);
+        // glTF has the origin of texture space at the top left, GL has it at the bottom left
+        stream.flip_tex_coords = true;
+    }
+    return stream;
+}
+
+const uint* GlbPrimitive::get_direct_indices() const {
+    if (indices.empty() || indices.component_type != COMPONENT_UNSIGNED_INT || indices.stride != sizeof(uint)) return nullptr;
+    // The binary chunk is 4 byte aligned within the file, but the accessor might not be
+    if (reinterpret_cast<uintptr_t>(indices.data) % alignof(uint) != 0) return nullptr;
+    return reinterpret_cast<const uint*>(indices.data);
+}
+
+void GlbPrimitive::read_indices(uint* out, uint base_vertex) const {
+    if (indices.empty()) {
+        // Non-indexed, so each vertex is used once, in order
+        for (size_t i = 0; i < index_count; ++i) {
+            out[i] = base_vertex + (uint) i;
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < index_count; ++i) {
+        out[i] = base_vertex + read_index(indices.data + i * indices.stride, indices.component_type);
+    }
+}
+
+std::vector<std::pair<glm::vec4, glm::uvec4>> GlbPrimitive::read_bones(uint joint_count) const {
+    std::vector<std::pair<glm::vec4, glm::uvec4>> bones(vertex_count, {glm::vec4{0.0f}, glm::uvec4{0u}});
+    // Without a skin, the joints don't refer to anything, so the primitive is left unskinned
+    if (joint_count == 0) return bones;
+
+    if (draco_data != nullptr) {
+        // Already read and normalised while decoding
+        bones = draco_data->vertices.bones;
+    } else {
+        if (joints.empty() || weights.empty()) return bones;
+
+        for (size_t i = 0; i < vertex_count; ++i) {
+            glm::vec4 joint{};
+            glm::vec4 weight{};
+            read_element(joints, i, &joint[0]);
+            read_element(weights, i, &weight[0]);
+
+            auto& [bone_weights, bone_indices] = bones[i];
+            for (int j = 0; j < 4; ++j) {
+                // Unused slots are left as bone 0 with no weight
+                if (weight[j] > 0.0f) {
+                    bone_weights[j] = weight[j];
+                    bone_indices[j] = (uint) joint[j];
+                }
+            }
+        }
+    }
+
+    for (auto& [bone_weights, bone_indices]: bones) {
+        for (int j = 0; j < 4; ++j) {
+            // A joint outside of the skin would read another mesh's bones from the bone palette, so it is dropped
+            if (bone_indices[j] >= joint_count) {
+                bone_weights[j] = 0.0f;
+                bone_indices[j] = 0;
+            }
+        }
+        float weight_sum = glm::compAdd(bone_weights);
+        if (weight_sum != 0.0f) {
+            // Normalise the sum of the weights
+            bone_weights /= weight_sum;
+        }
+    }
+    return bones;
+}
+
+GlbFile::GlbFile(FileContents contents) : contents(std::move(contents)) {}
+
+std::unique_ptr<GlbFile> GlbFile::open(const std::string& path, std::string* unsupported_feature) {
+    return open(FileContents::map(path), path, unsupported_feature);
+}
+
+std::unique_ptr<GlbFile> GlbFile::open(FileContents contents, const std::string& path, std::string* unsupported_feature) {
+    std::unique_ptr<GlbFile> glb{new GlbFile(std::move(contents))};
+    try {
+        glb->parse();
+    } catch (const UnsupportedFeature& e) {
+        if (unsupported_feature != nullptr) *unsupported_feature = e.what();
+        return nullptr;
+    } catch (const std::exception& e) {
+        throw std::runtime_error(Formatter() << "Failed to parse glTF binary file (" << path << "): \n\t" << e.what());
+    }
+    return glb;
+}
+
+void GlbFile::parse() {
+    const char* data = contents.get_data();
+    size_t size = contents.get_size();
+
+    // 12 byte header, followed by the JSON chunk and then an optional binary chunk, each with an 8 byte header
+    if (size < 20 || read_u32(data) != GLB_MAGIC) {
+        throw std::runtime_error("Not a glTF binary file");
+    }
+    if (read_u32(data + 4) != GLB_VERSION) {
+        throw UnsupportedFeature(Formatter() << "glTF version " << read_u32(data + 4));
+    }
+    size = std::min(size, (size_t) read_u32(data + 8));
+
+    size_t json_size = read_u32(data + 12);
+    if (read_u32(data + 16) != CHUNK_JSON || 20 + json_size > size) {
+        throw std::runtime_error("Missing JSON chunk");
+    }
+    const char* json_begin = data + 20;
+    size_t chunk_end = (20 + json_size + 3) & ~(size_t) 3;
+    if (chunk_end + 8 <= size && read_u32(data + chunk_end + 4) == CHUNK_BIN) {
+        binary_chunk = reinterpret_cast<const unsigned char*>(data + chunk_end + 8);
+        binary_chunk_size = std::min((size_t) read_u32(data + chunk_end), size - chunk_end - 8);
+    }
+
+    json gltf = json::parse(json_begin, json_begin + json_size);
+
+    if (gltf.contains("extensionsRequired")) {
+        for (const auto& extension: gltf["extensionsRequired"]) {
+            if (extension != DRACO_EXTENSION) {
+                throw UnsupportedFeature(Formatter() << "the required extension " << extension);
+            }
+        }
+    }
+
+    const json empty_array = json::array();
+    const json& buffers = gltf.contains("buffers") ? gltf["buffers"] : empty_array;
+    const json& buffer_views = gltf.contains("bufferViews") ? gltf["bufferViews"] : empty_array;
+    const json& accessors = gltf.contains("accessors") ? gltf["accessors"] : empty_array;
+
+    for (const auto& buffer: buffers) {
+        if (buffer.contains("uri")) {
+            throw UnsupportedFeature("buffers outside of the binary chunk");
+        }
+    }
+
+    // (data, length) of the buffer view
+    auto get_buffer_view = [&](uint index) {
+        const json& buffer_view = buffer_views.at(index);
+        size_t view_offset = buffer_view.value("byteOffset", (size_t) 0);
+        size_t view_length = buffer_view.at("byteLength").get<size_t>();
+        if (view_offset + view_length > binary_chunk_size) {
+            throw std::runtime_error(Formatter() << "Buffer view " << index << " is outside of the binary chunk");
+        }
+        return std::make_pair(binary_chunk + view_offset, view_length);
+    };
+
+    auto get_accessor = [&](uint index) {
+        const json& accessor = accessors.at(index);
+        if (accessor.contains("sparse")) {
+            throw UnsupportedFeature("sparse accessors");
+        }
+        if (!accessor.contains("bufferView")) {
+            throw UnsupportedFeature("accessors without a buffer view");
+        }
+        const json& buffer_view = buffer_views.at(accessor["bufferView"].get<uint>());
+        auto [view_data, view_length] = get_buffer_view(accessor["bufferView"].get<uint>());
+
+        GlbAccessor result{};
+        result.count = accessor.at("count").get<size_t>();
+        result.component_type = accessor.at("componentType").get<uint>();
+        result.components = type_components(accessor.at("type").get<std::string>());
+        result.normalized = accessor.value("normalized", false);
+
+        size_t element_size = component_size(result.component_type) * result.components;
+        result.stride = buffer_view.value("byteStride", element_size);
+
+        size_t accessor_offset = accessor.value("byteOffset", (size_t) 0);
+        if (result.count > 0 && accessor_offset + (result.count - 1) * result.stride + element_size > view_length) {
+            throw std::runtime_error(Formatter() << "Accessor " << index << " is outside of its buffer view");
+        }
+
+        result.data = view_data + accessor_offset;
+        return result;
+    };
+
+    // [(mesh, primitive, compressed_data, attribute_ids)]
+    std::vector<std::tuple<size_t, size_t, std::pair<const unsigned char*, size_t>, DracoAttributeIds>> draco_primitives{};
+
+    if (gltf.contains("meshes")) {
+        for (const auto& mesh: gltf["meshes"]) {
+            auto& primitives = meshes.emplace_back();
+            for (const auto& primitive_json: mesh.at("primitives")) {
+                uint mode = primitive_json.value("mode", MODE_TRIANGLES);
+                if (mode < MODE_TRIANGLES) continue; // Points and lines aren't rendered, the same as when loading through Assimp
+                if (mode != MODE_TRIANGLES) {
+                    throw UnsupportedFeature("triangle strips or fans");
+                }
+
+                const json& attributes = primitive_json.at("attributes");
+                if (!attributes.contains("NORMAL")) {
+                    throw UnsupportedFeature("meshes without normals");
+                }
+                if (attributes.contains("JOINTS_1")) {
+                    throw UnsupportedFeature("more than 4 joints per vertex");
+                }
+
+                GlbPrimitive primitive{};
+
+                if (primitive_json.contains("extensions") && primitive_json["extensions"].contains(DRACO_EXTENSION)) {
+                    // Compressed, so the accessors have no data, and it is decoded into the primitive once all the primitives are known
+                    const json& extension = primitive_json["extensions"][DRACO_EXTENSION];
+                    const json& draco_attributes = extension.at("attributes");
+                    auto attribute_id = [&](const char* name) -> std::optional<uint> {
+                        if (!attributes.contains(name)) return std::nullopt;
+                        if (!draco_attributes.contains(name)) {
+                            throw UnsupportedFeature("Draco compressed meshes with uncompressed attributes");
+                        }
+                        return draco_attributes[name].get<uint>();
+                    };
+
+                    DracoAttributeIds attribute_ids{};
+                    attribute_ids.position = attribute_id("POSITION");
+                    attribute_ids.normal = attribute_id("NORMAL");
+                    attribute_ids.tex_coord = attribute_id("TEXCOORD_0");
+                    attribute_ids.joints = attribute_id("JOINTS_0");
+                    attribute_ids.weights = attribute_id("WEIGHTS_0");
+
+                    draco_primitives.emplace_back(meshes.size() - 1, primitives.size(), get_buffer_view(extension.at("bufferView").get<uint>()), attribute_ids);
+                    primitives.push_back(std::move(primitive));
+                    continue;
+                }
+
+                primitive.positions = get_accessor(attributes.at("POSITION").get<uint>());
+                require_float(primitive.positions, 3, "POSITION");
+                primitive.normals = get_accessor(attributes["NORMAL"].get<uint>());
+                require_float(primitive.normals, 3, "NORMAL");
+                if (attributes.contains("TEXCOORD_0")) {
+                    primitive.tex_coords = get_accessor(attributes["TEXCOORD_0"].get<uint>());
+                    require_float(primitive.tex_coords, 2, "TEXCOORD_0");
+                }
+                primitive.vertex_count = primitive.positions.count;
+                if (primitive.normals.count != primitive.vertex_count || (!primitive.tex_coords.empty() && primitive.tex_coords.count != primitive.vertex_count)) {
+                    throw std::runtime_error("Mismatched attribute counts");
+                }
+
+                if (attributes.contains("JOINTS_0") && attributes.contains("WEIGHTS_0")) {
+                    primitive.joints = get_accessor(attributes["JOINTS_0"].get<uint>());
+                    primitive.weights = get_accessor(attributes["WEIGHTS_0"].get<uint>());
+                    if (primitive.joints.components != 4 || primitive.weights.components != 4 ||
+                        primitive.joints.count != primitive.vertex_count || primitive.weights.count != primitive.vertex_count) {
+                        throw std::runtime_error("Invalid joints or weights");
+                    }
+                }
+
+                if (primitive_json.contains("indices")) {
+                    primitive.indices = get_accessor(primitive_json["indices"].get<uint>());
+                    primitive.index_count = primitive.indices.count;
+                    bool valid_type = primitive.indices.component_type == COMPONENT_UNSIGNED_BYTE || primitive.indices.component_type == COMPONENT_UNSIGNED_SHORT ||
+                                      primitive.indices.component_type == COMPONENT_UNSIGNED_INT;
+                    if (!valid_type || primitive.indices.components != 1) {
+                        throw std::runtime_error("Invalid index accessor");
+                    }
+                    for (size_t i = 0; i < primitive.index_count; ++i) {
+                        if (read_index(primitive.indices.data + i * primitive.indices.stride, primitive.indices.component_type) >= primitive.vertex_count) {
+                            throw std::runtime_error(Formatter() << "Index out of range in mesh " << meshes.size() - 1);
+                        }
+                    }
+                } else {
+                    primitive.index_count = primitive.vertex_count;
+                }
+                primitive.index_count -= primitive.index_count % 3;
+
+                primitives.push_back(std::move(primitive));
+            }
+        }
+    }
+
+    // Each compressed primitive decodes independently, so they are spread over the thread pool
+    ThreadPool::shared().parallel_for(draco_primitives.size(), [&](size_t i) {
+        const auto& [mesh_i, primitive_i, compressed, attribute_ids] = draco_primitives[i];
+        auto& primitive = meshes[mesh_i][primitive_i];
+
+        primitive.draco_data = std::make_unique<GlbPrimitive::DracoData>();
+        auto& [vertices, indices] = *primitive.draco_data;
+        DracoDecoder::decode(reinterpret_cast<const char*>(compressed.first), compressed.second, vertices, indices, attribute_ids);
+
+        primitive.vertex_count = vertices.positions.size();
+        primitive.index_count = indices.size();
+        primitive.positions = decoded_accessor(vertices.positions.data(), primitive.vertex_count, COMPONENT_FLOAT, 3);
+        primitive.normals = decoded_accessor(vertices.normals.data(), primitive.vertex_count, COMPONENT_FLOAT, 3);
+        if (!vertices.tex_coords.empty()) {
+            primitive.tex_coords = decoded_accessor(vertices.tex_coords.data(), primitive.vertex_count, COMPONENT_FLOAT, 2);
+        }
+        primitive.indices = decoded_accessor(indices.data(), primitive.index_count, COMPONENT_UNSIGNED_INT, 1);
+    });
+
+    if (gltf.contains("nodes")) {
+        for (const auto& node_json: gltf["nodes"]) {
+            GlbNode node{};
+            node.name = node_json.value("name", "");
+
+            if (node_json.contains("matrix")) {
+                auto matrix = node_json["matrix"].get<std::vector<float>>();
+                if (matrix.size() != 16) throw std::runtime_error("Invalid node matrix");
+                // Both glTF and glm are column major
+                node.transform = glm::make_mat4(matrix.data());
+            } else {
+                if (node_json.contains("translation")) {
+                    auto t = node_json["translation"].get<std::vector<float>>();
+                    if (t.size() != 3) throw std::runtime_error("Invalid node translation");
+                    node.translation = glm::vec3{t[0], t[1], t[2]};
+                }
+                if (node_json.contains("rotation")) {
+                    auto r = node_json["rotation"].get<std::vector<float>>();
+                    if (r.size() != 4) throw std::runtime_error("Invalid node rotation");
+                    // glTF stores quaternions as (x, y, z, w)
+                    node.rotation = glm::quat{r[3], r[0], r[1], r[2]};
+                }
+                if (node_json.contains("scale")) {
+                    auto s = node_json["scale"].get<std::vector<float>>();
+                    if (s.size() != 3) throw std::runtime_error("Invalid node scale");
+                    node.scale = glm::vec3{s[0], s[1], s[2]};
+                }
+                node.transform = glm::translate(node.translation.value_or(glm::vec3{0.0f})) *
+                                 glm::mat4_cast(node.rotation.value_or(glm::quat{1.0f, 0.0f, 0.0f, 0.0f})) *
+                                 glm::scale(node.scale.value_or(glm::vec3{1.0f}));
+            }
+
+            if (node_json.contains("mesh")) node.mesh = node_json["mesh"].get<uint>();
+            if (node_json.contains("skin")) node.skin = node_json["skin"].get<uint>();
+            if (node_json.contains("children")) node.children = node_json["children"].get<std::vector<uint>>();
+            nodes.push_back(std::move(node));
+        }
+    }
+
+    // Every node having at most one parent, and the roots having none, means the scene can't contain any cycles
+    std::vector<bool> has_parent(nodes.size(), false);
+    for (const auto& node: nodes) {
+        if (node.mesh.has_value() && node.mesh.value() >= meshes.size()) throw std::runtime_error("Node mesh out of range");
+        for (auto child: node.children) {
+            if (child >= nodes.size()) throw std::runtime_error("Node child out of range");
+            if (has_parent[child]) throw std::runtime_error(Formatter() << "Node " << child << " has more than one parent");
+            has_parent[child] = true;
+        }
+    }
+
+    if (gltf.contains("skins")) {
+        for (const auto& skin_json: gltf["skins"]) {
+            GlbSkin skin{};
+            skin.joints = skin_json.at("joints").get<std::vector<uint>>();
+            for (auto joint: skin.joints) {
+                if (joint >= nodes.size()) throw std::runtime_error("Skin joint out of range");
+            }
+
+            skin.inverse_bind_matrices.resize(skin.joints.size(), glm::mat4{1.0f});
+            if (skin_json.contains("inverseBindMatrices")) {
+                auto matrices = get_accessor(skin_json["inverseBindMatrices"].get<uint>());
+                if (matrices.components != 16 || matrices.count < skin.joints.size()) {
+                    throw std::runtime_error("Invalid inverse bind matrices");
+                }
+                for (size_t i = 0; i < skin.joints.size(); ++i) {
+                    read_element(matrices, i, &skin.inverse_bind_matrices[i][0][0]);
+                }
+            }
+            skins.push_back(std::move(skin));
+        }
+    }
+
+    for (const auto& node: nodes) {
+        if (node.skin.has_value() && node.skin.value() >= skins.size()) throw std::runtime_error("Node skin out of range");
+    }
+
+    if (gltf.contains("animations")) {
+        for (const auto& animation_json: gltf["animations"]) {
+            GlbAnimation animation{};
+            animation.name = animation_json.value("name", "");
+            const json& samplers = animation_json.at("samplers");
+
+            // Which parts of each node are animated, so that the rest can be filled in from the node
+            std::unordered_map<uint, std::tuple<bool, bool, bool>> animated_parts{};
+
+            for (const auto& channel: animation_json.at("channels")) {
+                const json& target = channel.at("target");
+                if (!target.contains("node")) continue;
+                auto node = target["node"].get<uint>();
+                if (node >= nodes.size()) throw std::runtime_error("Animation target out of range");
+                auto path = target.at("path").get<std::string>();
+                if (path == "weights") continue; // Morph targets aren't supported by the renderer
+
+                const json& sampler = samplers.at(channel.at("sampler").get<uint>());
+                auto times = get_accessor(sampler.at("input").get<uint>());
+                auto values = get_accessor(sampler.at("output").get<uint>());
+                // Cubic spline keys are stored as (in-tangent, value, out-tangent), only the value is used
+                bool cubic_spline = sampler.value("interpolation", "LINEAR") == "CUBICSPLINE";
+                size_t values_per_key = cubic_spline ? 3 : 1;
+                if (times.components != 1 || values.count < times.count * values_per_key || values.components > 4) {
+                    throw std::runtime_error("Invalid animation sampler");
+                }
+
+                auto& node_animation = animation.nodes[node];
+                auto& [has_position, has_rotation, has_scaling] = animated_parts[node];
+                for (size_t i = 0; i < times.count; ++i) {
+                    float time;
+                    read_element(times, i, &time);
+                    float ticks = time * 1000.0f;
+                    animation.duration_ticks = std::max(animation.duration_ticks, (double) ticks);
+
+                    glm::vec4 value{};
+                    read_element(values, i * values_per_key + (cubic_spline ? 1 : 0), &value[0]);
+                    if (path == "translation") {
+                        node_animation.positions.set_key(ticks, glm::vec3(value));
+                        has_position = true;
+                    } else if (path == "rotation") {
+                        node_animation.rotations.set_key(ticks, glm::quat{value.w, value.x, value.y, value.z});
+                        has_rotation = true;
+                    } else if (path == "scale") {
+                        node_animation.scalings.set_key(ticks, glm::vec3(value));
+                        has_scaling = true;
+                    }
+                }
+            }
+
+            // Sampling an animation ignores the node's own transform, so anything that isn't animated is taken from the node
+            for (auto& [node, node_animation]: animation.nodes) {
+                const auto& [has_position, has_rotation, has_scaling] = animated_parts[node];
+                if (!has_position && nodes[node].translation.has_value()) node_animation.positions.set_key(0.0f, nodes[node].translation.value());
+                if (!has_rotation && nodes[node].rotation.has_value()) node_animation.rotations.set_key(0.0f, nodes[node].rotation.value());
+                if (!has_scaling && nodes[node].scale.has_value()) node_animation.scalings.set_key(0.0f, nodes[node].scale.value());
+            }
+
+            animations.push_back(std::move(animation));
+        }
+    }
+
+    if (!gltf.contains("scenes") || gltf["scenes"].empty()) {
+        throw UnsupportedFeature("files without a scene");
+    }
+    const json& scene = gltf["scenes"].at(gltf.value("scene", 0u));
+    if (scene.contains("nodes")) {
+        root_nodes = scene["nodes"].get<std::vector<uint>>();
+        for (auto root: root_nodes) {
+            if (root >= nodes.size() || has_parent[root]) throw std::runtime_error("Invalid scene root node");
+        }
+    }
+}
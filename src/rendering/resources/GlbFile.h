@@ -0,0 +1,122 @@
+#ifndef GLB_FILE_H
+#define GLB_FILE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "MeshHierarchy.h"
+#include "DracoDecoder.h"
+#include "utility/FileContents.h"
+#include "utility/HelperTypes.h"
+
+struct VertexStream;
+
+/// A glTF accessor resolved to where its elements are in the binary chunk of the file
+struct GlbAccessor {
+    const unsigned char* data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    // The glTF component type, which uses the matching GL enum values (GL_FLOAT, GL_UNSIGNED_SHORT, ...)
+    uint component_type = 0;
+    uint components = 0;
+    bool normalized = false;
+
+    [[nodiscard]] bool empty() const { return data == nullptr; }
+};
+
+struct GlbPrimitive {
+    size_t vertex_count = 0;
+    size_t index_count = 0;
+
+    /// A view over the positions, normals and texture coordinates, pointing straight into the mapped file
+    [[nodiscard]] VertexStream vertex_stream() const;
+    /// The indices, if they are stored in the file as tightly packed 32 bit indices, so can be used without conversion
+    [[nodiscard]] const uint* get_direct_indices() const;
+    /// Write the indices to out, adding base_vertex to each
+    void read_indices(uint* out, uint base_vertex) const;
+    /// The bone weights and indices of each vertex, with the weights normalised, all zero if the primitive isn't skinned.
+    /// joint_count is the number of joints in the skin of the node using the primitive, or 0 if it has none, and any joint
+    /// outside of the skin has its weight dropped, so that every bone index is valid for the mesh.
+    [[nodiscard]] std::vector<std::pair<glm::vec4, glm::uvec4>> read_bones(uint joint_count) const;
+private:
+    friend class GlbFile;
+    GlbAccessor positions{};
+    GlbAccessor normals{};
+    GlbAccessor tex_coords{};
+    GlbAccessor indices{};
+    GlbAccessor joints{};
+    GlbAccessor weights{};
+
+    // The decompressed vertices and indices of primitives using KHR_draco_mesh_compression, which the accessors point into
+    struct DracoData {
+        VertexCollection vertices{};
+        std::vector<uint> indices{};
+    };
+    std::unique_ptr<DracoData> draco_data{};
+};
+
+struct GlbNode {
+    std::string name{};
+    glm::mat4 transform{1.0f};
+    // The parts of the transform, if the node has them, rather than a matrix
+    std::optional<glm::vec3> translation{};
+    std::optional<glm::quat> rotation{};
+    std::optional<glm::vec3> scale{};
+    // Index into meshes and skins
+    std::optional<uint> mesh{};
+    std::optional<uint> skin{};
+    std::vector<uint> children{};
+};
+
+struct GlbSkin {
+    // [bone_id] -> node index
+    std::vector<uint> joints{};
+    // [bone_id] -> offset matrix
+    std::vector<glm::mat4> inverse_bind_matrices{};
+};
+
+struct GlbAnimation {
+    std::string name{};
+    // Key times are in milliseconds (1000 ticks per second), the same as Assimp uses for glTF
+    double duration_ticks = 0.0;
+    // { node index } -> animation of the node
+    std::unordered_map<uint, AnimationData> nodes{};
+};
+
+/// A loader for glTF binary (.glb) files that skips Assimp and its intermediate aiScene.
+///
+/// The file is memory mapped (or read from an AssetPack), and only the JSON chunk is parsed, with vertex attributes read in place from the binary chunk.
+/// Draco compressed primitives are decoded in parallel, with the accessors pointing at the decoded data instead.
+/// Anything it doesn't support, such as other extensions the file requires or external buffers, means open returns nullptr,
+/// so that the caller can fall back to Assimp.
+class GlbFile : private NonCopyable {
+    FileContents contents;
+    const unsigned char* binary_chunk = nullptr;
+    size_t binary_chunk_size = 0;
+public:
+    // [mesh] -> [primitive], only triangle primitives are kept
+    std::vector<std::vector<GlbPrimitive>> meshes{};
+    std::vector<GlbNode> nodes{};
+    std::vector<GlbSkin> skins{};
+    std::vector<GlbAnimation> animations{};
+    // The root nodes of the default scene
+    std::vector<uint> root_nodes{};
+
+    /// Open and parse the file, throws a std::runtime_error if it is malformed, or returns nullptr if it needs Assimp,
+    /// with what it needs written to unsupported_feature if given
+    static std::unique_ptr<GlbFile> open(const std::string& path, std::string* unsupported_feature = nullptr);
+    /// Parse a file that is already in memory, which it keeps hold of since the primitives point into it. The path is only used in messages.
+    static std::unique_ptr<GlbFile> open(FileContents contents, const std::string& path, std::string* unsupported_feature = nullptr);
+private:
+    explicit GlbFile(FileContents contents);
+
+    void parse();
+};
+
+#endif //GLB_FILE_H
@@ -0,0 +1,43 @@
+#include "ImportProfile.h"
+
+#include <stdexcept>
+
+#include <assimp/postprocess.h>
+
+const char* ImportProfiles::name(ImportProfile profile) {
+    switch (profile) {
+        case ImportProfile::Fast:
+            return "Fast";
+        case ImportProfile::Balanced:
+            return "Balanced";
+        case ImportProfile::MaxQuality:
+            return "Max Quality";
+    }
+    return "Unknown";
+}
+
+ImportProfile ImportProfiles::from_name(const std::string& name) {
+    for (auto profile: ALL) {
+        if (name == ImportProfiles::name(profile)) return profile;
+    }
+    throw std::runtime_error(Formatter() << "Unknown import profile: " << name);
+}
+
+uint ImportProfiles::post_process_flags(ImportProfile profile) {
+    switch (profile) {
+        case ImportProfile::Fast:
+            // GenNormals rather than GenSmoothNormals, since it is skipped entirely for meshes that have normals,
+            // whereas smooth normals build a spatial sort of every mesh first
+            return aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_GenNormals | aiProcess_TransformUVCoords;
+        case ImportProfile::Balanced:
+            // Nothing renders with tangents, so they don't need calculating
+            return (aiProcessPreset_TargetRealtime_Quality & ~aiProcess_CalcTangentSpace) | aiProcess_TransformUVCoords | aiProcess_SortByPType;
+        case ImportProfile::MaxQuality:
+            return aiProcessPreset_TargetRealtime_MaxQuality | aiProcess_TransformUVCoords | aiProcess_SortByPType;
+    }
+    return 0;
+}
+
+bool ImportProfiles::supported_by_fast_loaders(ImportProfile profile) {
+    return profile == ImportProfile::Fast;
+}
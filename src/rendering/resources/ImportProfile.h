@@ -0,0 +1,34 @@
+#ifndef IMPORT_PROFILE_H
+#define IMPORT_PROFILE_H
+
+#include <string>
+#include <optional>
+
+#include "utility/HelperTypes.h"
+
+/// How much post-processing Assimp does on a model as it is imported, so assets only pay for the processing they need.
+enum class ImportProfile {
+    /// Only what is needed to render the model, for assets that have been cleaned up already (indexed, with normals)
+    Fast,
+    /// Joins identical vertices and fills in anything missing, but skips the expensive validation and optimisation steps
+    Balanced,
+    /// Everything, including validation and merging of duplicate meshes, for assets straight out of a modelling tool
+    MaxQuality,
+};
+
+namespace ImportProfiles {
+    constexpr ImportProfile ALL[] = {ImportProfile::Fast, ImportProfile::Balanced, ImportProfile::MaxQuality};
+
+    /// The name of the profile, also used to refer to it in scene files
+    const char* name(ImportProfile profile);
+    /// The profile with the given name, throws a std::runtime_error if there isn't one
+    ImportProfile from_name(const std::string& name);
+
+    /// The aiPostProcessSteps flags to import with
+    uint post_process_flags(ImportProfile profile);
+    /// Whether the dedicated OBJ and glTF binary loaders, which only triangulate and keep the file's normals, do everything the profile asks for.
+    /// Other profiles go through Assimp, so that its extra post-processing isn't silently skipped.
+    bool supported_by_fast_loaders(ImportProfile profile);
+}
+
+#endif //IMPORT_PROFILE_H
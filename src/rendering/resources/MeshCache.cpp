@@ -0,0 +1,254 @@
+#include "MeshCache.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include "ModelLoader.h"
+
+namespace {
+    constexpr char CACHE_MAGIC[4] = {'M', 'E', 'S', 'H'};
+    constexpr uint32_t CACHE_VERSION = 1;
+
+    // Vertex cache optimisation parameters, the values from Forsyth's paper
+    constexpr int OPTIMISER_CACHE_SIZE = 32;
+    constexpr float CACHE_DECAY_POWER = 1.5f;
+    constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+    /// Vertices recently used score higher, so their triangles get emitted while they are still in the cache,
+    /// and vertices with few triangles left score higher, so they get finished off rather than left as stragglers
+    float vertex_score(int cache_position, uint remaining_triangles) {
+        if (remaining_triangles == 0) return -1.0f;
+
+        float score = 0.0f;
+        if (cache_position >= 0) {
+            if (cache_position < 3) {
+                // The triangle just emitted, slightly penalised so the next triangle doesn't just use the same edge
+                score = LAST_TRIANGLE_SCORE;
+            } else {
+                float scale = 1.0f / (OPTIMISER_CACHE_SIZE - 3);
+                score = std::pow(1.0f - (float) (cache_position - 3) * scale, CACHE_DECAY_POWER);
+            }
+        }
+        score += VALENCE_BOOST_SCALE * std::pow((float) remaining_triangles, -VALENCE_BOOST_POWER);
+        return score;
+    }
+}
+
+void BakedMesh::Vertex::from_stream(const VertexStream& stream, Vertex* out_vertices) {
+    for (size_t i = 0; i < stream.count; i++) {
+        glm::vec2 tex_coord = stream.tex_coords.empty() ? glm::vec2{0.0f} : stream.tex_coords[i];
+        if (stream.flip_tex_coords) tex_coord.y = 1.0f - tex_coord.y;
+        out_vertices[i] = Vertex{
+            glm::vec3(stream.transform * glm::vec4(stream.positions[i], 1.0f)),
+            stream.normals.empty() ? glm::vec3{0.0f} : stream.normal_matrix * stream.normals[i],
+            tex_coord
+        };
+    }
+}
+
+VertexStream BakedMesh::vertex_stream() const {
+    VertexStream stream{};
+    stream.count = vertices.size();
+    const auto* data = reinterpret_cast<const unsigned char*>(vertices.data());
+    stream.positions = StridedView<glm::vec3>(data + offsetof(Vertex, position), sizeof(Vertex));
+    if (has_normals) stream.normals = StridedView<glm::vec3>(data + offsetof(Vertex, normal), sizeof(Vertex));
+    if (has_tex_coords) stream.tex_coords = StridedView<glm::vec2>(data + offsetof(Vertex, tex_coord), sizeof(Vertex));
+    return stream;
+}
+
+void MeshCache::optimise_vertex_cache(std::vector<uint>& indices, size_t vertex_count) {
+    size_t triangle_count = indices.size() / 3;
+    if (triangle_count < 2 || indices.size() % 3 != 0) return;
+    if (std::any_of(indices.begin(), indices.end(), [vertex_count](uint index) { return index >= vertex_count; })) return;
+
+    // The triangles using each vertex, packed into one array. The first remaining_triangles[v] of each vertex's range are the ones not emitted yet.
+    std::vector<uint> remaining_triangles(vertex_count, 0);
+    for (auto index: indices) remaining_triangles[index]++;
+    std::vector<size_t> adjacency_offsets(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; ++v) {
+        adjacency_offsets[v + 1] = adjacency_offsets[v] + remaining_triangles[v];
+    }
+    std::vector<uint> adjacency(indices.size());
+    {
+        std::vector<size_t> cursors(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            adjacency[cursors[indices[i]]++] = (uint) (i / 3);
+        }
+    }
+
+    std::vector<float> vertex_scores(vertex_count);
+    for (size_t v = 0; v < vertex_count; ++v) {
+        vertex_scores[v] = vertex_score(-1, remaining_triangles[v]);
+    }
+    std::vector<float> triangle_scores(triangle_count);
+    for (size_t t = 0; t < triangle_count; ++t) {
+        triangle_scores[t] = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+    }
+    std::vector<bool> emitted(triangle_count, false);
+
+    // Extra room for the 3 vertices pushed in front of a full cache
+    std::vector<uint> cache{};
+    std::vector<uint> next_cache{};
+    cache.reserve(OPTIMISER_CACHE_SIZE + 3);
+    next_cache.reserve(OPTIMISER_CACHE_SIZE + 3);
+
+    std::vector<uint> output{};
+    output.reserve(indices.size());
+
+    auto best_triangle = (size_t) (std::max_element(triangle_scores.begin(), triangle_scores.end()) - triangle_scores.begin());
+    // Where to continue looking for a triangle when none of the cached vertices have any left
+    size_t scan_position = 0;
+
+    for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count) {
+        emitted[best_triangle] = true;
+        const uint* triangle = &indices[best_triangle * 3];
+        output.insert(output.end(), triangle, triangle + 3);
+
+        // Remove the triangle from the remaining triangles of its vertices
+        for (int j = 0; j < 3; ++j) {
+            uint v = triangle[j];
+            uint* begin = &adjacency[adjacency_offsets[v]];
+            uint* end = begin + remaining_triangles[v];
+            std::iter_swap(std::find(begin, end, (uint) best_triangle), end - 1);
+            remaining_triangles[v]--;
+        }
+
+        // The emitted triangle's vertices move to the front of the cache, in front of everything else in the old order
+        next_cache.assign(triangle, triangle + 3);
+        for (auto v: cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) next_cache.push_back(v);
+        }
+        std::swap(cache, next_cache);
+
+        // Rescore the vertices whose position changed, along with their remaining triangles.
+        // Any past the end have just been pushed out of the cache, so their position no longer adds to their score.
+        for (size_t i = 0; i < cache.size(); ++i) {
+            uint v = cache[i];
+            float score = vertex_score(i < (size_t) OPTIMISER_CACHE_SIZE ? (int) i : -1, remaining_triangles[v]);
+            float delta = score - vertex_scores[v];
+            vertex_scores[v] = score;
+            for (size_t k = 0; k < remaining_triangles[v]; ++k) {
+                triangle_scores[adjacency[adjacency_offsets[v] + k]] += delta;
+            }
+        }
+
+        // Only triangles touching the cache are worth considering, the rest haven't changed since they were passed over
+        float best_score = -1.0f;
+        best_triangle = triangle_count;
+        for (auto v: cache) {
+            for (size_t k = 0; k < remaining_triangles[v]; ++k) {
+                uint t = adjacency[adjacency_offsets[v] + k];
+                if (triangle_scores[t] > best_score) {
+                    best_score = triangle_scores[t];
+                    best_triangle = t;
+                }
+            }
+        }
+        if (cache.size() > (size_t) OPTIMISER_CACHE_SIZE) cache.resize(OPTIMISER_CACHE_SIZE);
+
+        if (best_triangle == triangle_count && emitted_count + 1 < triangle_count) {
+            // Nothing left touching the cache, so start again from the next triangle in the original order
+            while (emitted[scan_position]) scan_position++;
+            best_triangle = scan_position;
+        }
+    }
+
+    indices = std::move(output);
+}
+
+float MeshCache::average_cache_miss_ratio(const std::vector<uint>& indices, size_t vertex_count, uint cache_size) {
+    if (indices.size() < 3) return 0.0f;
+
+    // [vertex] -> the miss count at which it was last added to the cache, so it is still cached if fewer than cache_size misses have happened since
+    std::vector<size_t> added_at(vertex_count, SIZE_MAX);
+    size_t misses = 0;
+    for (auto index: indices) {
+        if (index >= vertex_count) continue;
+        if (added_at[index] == SIZE_MAX || misses - added_at[index] >= cache_size) {
+            added_at[index] = misses;
+            misses++;
+        }
+    }
+    return (float) misses / (float) (indices.size() / 3);
+}
+
+std::optional<BakedMesh> MeshCache::read_cache(const std::filesystem::path& cache_file, int64_t source_time) {
+    std::ifstream file(cache_file, std::ios::binary);
+    if (!file) return std::nullopt;
+
+    char magic[4];
+    uint32_t version;
+    int64_t cached_source_time;
+    uint8_t has_normals, has_tex_coords;
+    uint64_t vertex_count, index_count;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&cached_source_time), sizeof(cached_source_time));
+    file.read(reinterpret_cast<char*>(&has_normals), sizeof(has_normals));
+    file.read(reinterpret_cast<char*>(&has_tex_coords), sizeof(has_tex_coords));
+    file.read(reinterpret_cast<char*>(&vertex_count), sizeof(vertex_count));
+    file.read(reinterpret_cast<char*>(&index_count), sizeof(index_count));
+
+    if (!file || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || version != CACHE_VERSION || cached_source_time != source_time) {
+        return std::nullopt;
+    }
+
+    // Check the counts against the file size before allocating, so a corrupt header can't ask for a huge buffer
+    auto header_end = (uint64_t) file.tellg();
+    file.seekg(0, std::ios::end);
+    auto file_size = (uint64_t) file.tellg();
+    file.seekg((std::streamoff) header_end);
+    if (vertex_count > file_size / sizeof(BakedMesh::Vertex) || index_count > file_size / sizeof(uint) ||
+        header_end + vertex_count * sizeof(BakedMesh::Vertex) + index_count * sizeof(uint) != file_size) {
+        return std::nullopt;
+    }
+
+    BakedMesh mesh{};
+    mesh.has_normals = has_normals != 0;
+    mesh.has_tex_coords = has_tex_coords != 0;
+    mesh.vertices.resize(vertex_count);
+    mesh.indices.resize(index_count);
+    file.read(reinterpret_cast<char*>(mesh.vertices.data()), (std::streamsize) (vertex_count * sizeof(BakedMesh::Vertex)));
+    file.read(reinterpret_cast<char*>(mesh.indices.data()), (std::streamsize) (index_count * sizeof(uint)));
+
+    if (!file) return std::nullopt;
+    return mesh;
+}
+
+void MeshCache::write_cache(const std::filesystem::path& cache_file, int64_t source_time, const BakedMesh& mesh) {
+    try {
+        std::filesystem::create_directories(cache_file.parent_path());
+
+        // Write to a temporary file and then move it into place, so a partially written cache is never read
+        auto temp_file = cache_file;
+        temp_file += ".tmp";
+        {
+            std::ofstream file(temp_file, std::ios::binary | std::ios::trunc);
+            auto has_normals = (uint8_t) mesh.has_normals;
+            auto has_tex_coords = (uint8_t) mesh.has_tex_coords;
+            auto vertex_count = (uint64_t) mesh.vertices.size();
+            auto index_count = (uint64_t) mesh.indices.size();
+            file.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+            file.write(reinterpret_cast<const char*>(&CACHE_VERSION), sizeof(CACHE_VERSION));
+            file.write(reinterpret_cast<const char*>(&source_time), sizeof(source_time));
+            file.write(reinterpret_cast<const char*>(&has_normals), sizeof(has_normals));
+            file.write(reinterpret_cast<const char*>(&has_tex_coords), sizeof(has_tex_coords));
+            file.write(reinterpret_cast<const char*>(&vertex_count), sizeof(vertex_count));
+            file.write(reinterpret_cast<const char*>(&index_count), sizeof(index_count));
+            file.write(reinterpret_cast<const char*>(mesh.vertices.data()), (std::streamsize) (vertex_count * sizeof(BakedMesh::Vertex)));
+            file.write(reinterpret_cast<const char*>(mesh.indices.data()), (std::streamsize) (index_count * sizeof(uint)));
+            if (!file) {
+                throw std::runtime_error("Failed to write file");
+            }
+        }
+        std::filesystem::rename(temp_file, cache_file);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to write mesh cache (" << cache_file.string() << "):\n\t" << e.what() << std::endl;
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+
+#include <glm/glm.hpp>
+
+#include "utility/HelperTypes.h"
+
+struct VertexStream;
+
+/// A model flattened into a single mesh, with every node's transform already applied, as stored in the mesh cache.
+struct BakedMesh {
+    /// Used as the VertexData when converting a scene, so has the same from_stream as the renderers' vertex types
+    struct Vertex {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 tex_coord;
+
+        static void from_stream(const VertexStream& stream, Vertex* out_vertices);
+    };
+
+    std::vector<Vertex> vertices{};
+    std::vector<uint> indices{};
+    // Whether the source had these, since the renderers' vertex types reject meshes without them
+    bool has_normals = false;
+    bool has_tex_coords = false;
+
+    /// A view over the vertices, to convert them into a renderer's vertex type
+    [[nodiscard]] VertexStream vertex_stream() const;
+};
+
+/// An on-disk cache of imported models, so that a model only goes through Assimp and its post-processing once,
+/// after which it loads with a single read. The offline asset baker fills it ahead of time.
+namespace MeshCache {
+    /// Reorder the triangles for the GPU's post-transform vertex cache, using Tom Forsyth's linear-speed vertex cache optimisation.
+    /// Only the order of the triangles changes, the winding of each is kept.
+    void optimise_vertex_cache(std::vector<uint>& indices, size_t vertex_count);
+    /// The average number of vertices transformed per triangle, with a FIFO vertex cache of cache_size entries. 0.5 is the best possible, 3 the worst.
+    float average_cache_miss_ratio(const std::vector<uint>& indices, size_t vertex_count, uint cache_size = 32);
+
+    /// Try to read a cached mesh, returns std::nullopt if the file doesn't exist,
+    /// is corrupt, or was generated from a version of the source file with a different modification time.
+    std::optional<BakedMesh> read_cache(const std::filesystem::path& cache_file, int64_t source_time);
+    /// Write the mesh to the cache, creating any needed directories. Failures are printed and otherwise ignored.
+    void write_cache(const std::filesystem::path& cache_file, int64_t source_time, const BakedMesh& mesh);
+}
+
+#endif //MESH_CACHE_H
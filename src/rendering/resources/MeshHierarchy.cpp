@@ -1,50 +1,140 @@
 #include "MeshHierarchy.h"
 
-glm::mat4 AnimationData::sample(double time) const {
-    glm::vec3 position{0.0f};
-    if (!positions.empty()) {
-        auto next_key = positions.lower_bound(time);
-        if (next_key == positions.end()) {
-            position = positions.rbegin()->second;
-        } else if (next_key->first == time || next_key == positions.begin()) {
-            position = next_key->second;
-        } else {
-            auto next = *next_key;
-            auto prev = *(--next_key);
-
-            position = glm::mix(prev.second, next.second, (float) ((time - prev.first) / (next.first - prev.first)));
-        }
+namespace {
+    /// Sample a track, interpolating with mix between the keys either side of time
+    template<typename T, typename Mix>
+    T sample_track(const KeyframeTrack<T>& track, float time, uint& cursor, T default_value, Mix mix) {
+        if (track.empty()) return default_value;
+
+        const T* a;
+        const T* b;
+        float t;
+        track.find_keys(time, cursor, a, b, t);
+        return a == b ? *a : mix(*a, *b, t);
     }
 
-    glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
-    if (!rotations.empty()) {
-        auto next_key = rotations.lower_bound(time);
-        if (next_key == rotations.end()) {
-            rotation = rotations.rbegin()->second;
-        } else if (next_key->first == time || next_key == rotations.begin()) {
-            rotation = next_key->second;
-        } else {
-            auto next = *next_key;
-            auto prev = *(--next_key);
+    template<typename T, typename Mix>
+    T sample_track(const CompressedTrack<T>& track, float time, uint& cursor, T default_value, Mix mix) {
+        if (track.empty()) return default_value;
 
-            rotation = glm::slerp(prev.second, next.second, (float) ((time - prev.first) / (next.first - prev.first)));
-        }
+        T a, b;
+        float t;
+        track.find_keys(time, cursor, a, b, t);
+        return t == 0.0f ? a : mix(a, b, t);
     }
 
-    glm::vec3 scaling{1.0f};
-    if (!scalings.empty()) {
-        auto next_key = scalings.lower_bound(time);
-        if (next_key == scalings.end()) {
-            scaling = scalings.rbegin()->second;
-        } else if (next_key->first == time || next_key == scalings.begin()) {
-            scaling = next_key->second;
-        } else {
-            auto next = *next_key;
-            auto prev = *(--next_key);
+    template<typename Track>
+    size_t track_bytes(const Track& track) {
+        return sizeof(Track) + track.times.size() * sizeof(track.times[0]) + track.values.size() * sizeof(track.values[0]);
+    }
+}
 
-            scaling = glm::mix(prev.second, next.second, (float) ((time - prev.first) / (next.first - prev.first)));
-        }
+glm::mat4 AnimationData::sample(float time, AnimationCursor& cursor) const {
+    auto lerp = [](const glm::vec3& a, const glm::vec3& b, float t) { return glm::mix(a, b, t); };
+    auto slerp = [](const glm::quat& a, const glm::quat& b, float t) { return glm::slerp(a, b, t); };
+
+    glm::vec3 position, scaling;
+    glm::quat rotation;
+    if (compressed.has_value()) {
+        position = sample_track(compressed->positions, time, cursor.position, glm::vec3{0.0f}, lerp);
+        rotation = sample_track(compressed->rotations, time, cursor.rotation, glm::quat{1.0f, 0.0f, 0.0f, 0.0f}, slerp);
+        scaling = sample_track(compressed->scalings, time, cursor.scaling, glm::vec3{1.0f}, lerp);
+    } else {
+        position = sample_track(positions, time, cursor.position, glm::vec3{0.0f}, lerp);
+        rotation = sample_track(rotations, time, cursor.rotation, glm::quat{1.0f, 0.0f, 0.0f, 0.0f}, slerp);
+        scaling = sample_track(scalings, time, cursor.scaling, glm::vec3{1.0f}, lerp);
     }
 
     return glm::translate(position) * glm::toMat4(rotation) * glm::scale(scaling);
-}
\ No newline at end of file
+}
+
+void AnimationData::find_samples(float time, AnimationCursor& cursor, TrsSamples& samples, size_t node) const {
+    const glm::vec3 zero{0.0f};
+    const glm::quat identity{1.0f, 0.0f, 0.0f, 0.0f};
+    const glm::vec3 one{1.0f};
+
+    if (compressed.has_value()) {
+        glm::vec3 position_a = zero, position_b = zero, scaling_a = one, scaling_b = one;
+        glm::quat rotation_a = identity, rotation_b = identity;
+        float position_t = 0.0f, rotation_t = 0.0f, scaling_t = 0.0f;
+        if (!compressed->positions.empty()) compressed->positions.find_keys(time, cursor.position, position_a, position_b, position_t);
+        if (!compressed->rotations.empty()) compressed->rotations.find_keys(time, cursor.rotation, rotation_a, rotation_b, rotation_t);
+        if (!compressed->scalings.empty()) compressed->scalings.find_keys(time, cursor.scaling, scaling_a, scaling_b, scaling_t);
+        samples.set_position(node, position_a, position_b, position_t);
+        samples.set_rotation(node, rotation_a, rotation_b, rotation_t);
+        samples.set_scaling(node, scaling_a, scaling_b, scaling_t);
+        return;
+    }
+
+    const glm::vec3* position_a = nullptr;
+    const glm::vec3* position_b = nullptr;
+    const glm::quat* rotation_a = nullptr;
+    const glm::quat* rotation_b = nullptr;
+    const glm::vec3* scaling_a = nullptr;
+    const glm::vec3* scaling_b = nullptr;
+    float position_t = 0.0f, rotation_t = 0.0f, scaling_t = 0.0f;
+
+    if (!positions.empty()) positions.find_keys(time, cursor.position, position_a, position_b, position_t);
+    if (!rotations.empty()) rotations.find_keys(time, cursor.rotation, rotation_a, rotation_b, rotation_t);
+    if (!scalings.empty()) scalings.find_keys(time, cursor.scaling, scaling_a, scaling_b, scaling_t);
+
+    // Missing tracks are held at the identity, the same as sample()
+    samples.set_position(node, position_a ? *position_a : zero, position_b ? *position_b : zero, position_t);
+    samples.set_rotation(node, rotation_a ? *rotation_a : identity, rotation_b ? *rotation_b : identity, rotation_t);
+    samples.set_scaling(node, scaling_a ? *scaling_a : one, scaling_b ? *scaling_b : one, scaling_t);
+}
+
+void BakedClip::sample(double time_seconds, bool blend, AnimationPose& pose) const {
+    pose.bone_transforms.resize(bone_count);
+    pose.node_transforms.resize(node_count);
+
+    double position = frame_interval_seconds > 0.0 ? std::clamp(time_seconds / frame_interval_seconds, 0.0, (double) (frame_count - 1)) : 0.0;
+    auto frame = (uint) position;
+    auto t = (float) (position - frame);
+    if (!blend || frame + 1 == frame_count) {
+        if (t >= 0.5f) frame = std::min(frame + 1, frame_count - 1);
+        std::copy_n(bone_transforms.begin() + (size_t) frame * bone_count, bone_count, pose.bone_transforms.begin());
+        std::copy_n(node_transforms.begin() + (size_t) frame * node_count, node_count, pose.node_transforms.begin());
+        return;
+    }
+
+    // A linear blend of the matrices, which is close to blending their rotations when the frames are close together
+    const glm::mat4* bones_a = &bone_transforms[(size_t) frame * bone_count];
+    const glm::mat4* bones_b = bones_a + bone_count;
+    for (uint bone = 0; bone < bone_count; ++bone) {
+        pose.bone_transforms[bone] = bones_a[bone] + (bones_b[bone] - bones_a[bone]) * t;
+    }
+    const AffineTransform* nodes_a = &node_transforms[(size_t) frame * node_count];
+    const AffineTransform* nodes_b = nodes_a + node_count;
+    for (uint node = 0; node < node_count; ++node) {
+        for (int r = 0; r < 3; ++r) {
+            pose.node_transforms[node].rows[r] = glm::mix(nodes_a[node].rows[r], nodes_b[node].rows[r], t);
+        }
+    }
+}
+
+size_t BakedClip::get_bytes() const {
+    return bone_transforms.size() * sizeof(glm::mat4) + node_transforms.size() * sizeof(AffineTransform);
+}
+
+void AnimationData::compress(const AnimationCompressionSettings& settings) {
+    if (compressed.has_value()) return;
+    compressed = CompressedAnimationTracks{
+        CompressedTrack<glm::vec3>::compress(positions.times, positions.values, settings.position_tolerance, glm::vec3{0.0f}),
+        CompressedTrack<glm::quat>::compress(rotations.times, rotations.values, settings.rotation_tolerance, glm::quat{1.0f, 0.0f, 0.0f, 0.0f}),
+        CompressedTrack<glm::vec3>::compress(scalings.times, scalings.values, settings.scaling_tolerance, glm::vec3{1.0f}),
+    };
+    positions = {};
+    rotations = {};
+    scalings = {};
+}
+
+size_t AnimationData::get_bytes() const {
+    if (compressed.has_value()) return compressed->get_bytes();
+    return track_bytes(positions) + track_bytes(rotations) + track_bytes(scalings);
+}
+
+size_t AnimationData::get_key_count() const {
+    if (compressed.has_value()) return compressed->positions.size() + compressed->rotations.size() + compressed->scalings.size();
+    return positions.size() + rotations.size() + scalings.size();
+}
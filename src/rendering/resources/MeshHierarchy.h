@@ -2,9 +2,12 @@
 #define MESH_HIERARCHY_H
 
 #include <vector>
-#include <map>
+#include <algorithm>
+#include <mutex>
+#include <future>
+#include <chrono>
+#include <limits>
 #include <memory>
-#include <functional>
 #include <unordered_map>
 
 #include <glm/glm.hpp>
@@ -12,17 +15,92 @@
 #include <glm/gtx/quaternion.hpp>
 
 #include "ModelHandle.h"
+#include "PoseKernels.h"
+#include "AnimationCompression.h"
 
 #define NONE_ANIMATION UINT_MAX
 
+/// The keyframes of a single channel of a node's animation, with the times and values in separate sorted arrays,
+/// so that finding the keys either side of a time only touches the times.
+template<typename T>
+struct KeyframeTrack {
+    // Sorted, in ticks
+    std::vector<float> times{};
+    // [key] -> value at times[key]
+    std::vector<T> values{};
+
+    /// Add a key, replacing any existing key at the same time. Keys are expected to mostly arrive in order, which just appends.
+    void set_key(float time, const T& value);
+    [[nodiscard]] bool empty() const { return times.empty(); }
+    [[nodiscard]] size_t size() const { return times.size(); }
+
+    /// The index of the last key at or before time, or 0 if time is before the first key.
+    /// cursor is the result of the previous call, so when time has only moved forward by up to a key this is O(1),
+    /// and it falls back to a binary search on seeks and loops. cursor is updated to the result. The track must not be empty.
+    uint find_key(float time, uint& cursor) const;
+    /// The keys either side of time and how far between them it is, as used by find_key(), holding the first and last keys outside the track's range.
+    /// The track must not be empty.
+    void find_keys(float time, uint& cursor, const T*& a, const T*& b, float& t) const;
+};
+
+/// The per-entity state used to sample an AnimationData, which caches the key each of its tracks was last sampled at
+struct AnimationCursor {
+    uint position = 0;
+    uint rotation = 0;
+    uint scaling = 0;
+};
+
 struct AnimationData {
-    std::map<double, glm::vec3> positions{};
-    std::map<double, glm::quat> rotations{};
-    std::map<double, glm::vec3> scalings{};
+    KeyframeTrack<glm::vec3> positions{};
+    KeyframeTrack<glm::quat> rotations{};
+    KeyframeTrack<glm::vec3> scalings{};
+    // Set by compress(), which empties the tracks above, after which the keys are decompressed from here as they are sampled
+    std::optional<CompressedAnimationTracks> compressed{};
 
-    [[nodiscard]] glm::mat4 sample(double time) const;
+    /// Sample the node's transform at a time in ticks, holding the first and last keys outside of the tracks' range
+    [[nodiscard]] glm::mat4 sample(float time, AnimationCursor& cursor) const;
+    /// Find the keys either side of a time in ticks, and write them into samples for the PoseKernels to interpolate and compose
+    void find_samples(float time, AnimationCursor& cursor, TrsSamples& samples, size_t node) const;
+
+    /// Replace the tracks with their compressed form, see CompressedTrack
+    void compress(const AnimationCompressionSettings& settings);
+    /// The memory used by the keys, compressed or not
+    [[nodiscard]] size_t get_bytes() const;
+    /// The number of keys across all three tracks, compressed or not
+    [[nodiscard]] size_t get_key_count() const;
 };
 
+template<typename T>
+void KeyframeTrack<T>::set_key(float time, const T& value) {
+    auto next = std::lower_bound(times.begin(), times.end(), time);
+    auto index = next - times.begin();
+    if (next != times.end() && *next == time) {
+        values[index] = value;
+        return;
+    }
+    times.insert(next, time);
+    values.insert(values.begin() + index, value);
+}
+
+template<typename T>
+uint KeyframeTrack<T>::find_key(float time, uint& cursor) const {
+    return find_sorted_key(times, time, cursor);
+}
+
+template<typename T>
+void KeyframeTrack<T>::find_keys(float time, uint& cursor, const T*& a, const T*& b, float& t) const {
+    uint key = find_key(time, cursor);
+    a = &values[key];
+    if (key + 1 == times.size() || time <= times[key]) {
+        b = a;
+        t = 0.0f;
+        return;
+    }
+    b = &values[key + 1];
+    t = (time - times[key]) / (times[key + 1] - times[key]);
+}
+
+/// A node of the hierarchy as the loaders build it, which MeshHierarchy::set_nodes() flattens
 struct MeshHierarchyNode {
     std::vector<uint> meshes{};
     glm::mat4 transformation{1.0f};
@@ -33,17 +111,75 @@ struct MeshHierarchyNode {
     std::vector<MeshHierarchyNode> children{};
 };
 
+/// A node of the flattened hierarchy, see MeshHierarchy::nodes
+struct FlatHierarchyNode {
+    // Index of the parent in MeshHierarchy::nodes, always before this node, or -1 for the root
+    int parent = -1;
+    // Whether this node or one of its ancestors has bones, in which case the node's own transformation is used when it isn't animated
+    bool is_skeleton = false;
+    glm::mat4 transformation{1.0f};
+    // The transform used when the node isn't animated, transformation if it is part of a skeleton, otherwise the identity
+    AffineTransform rest_transform{};
+    // The product of the transformations from the root down to and including this node
+    glm::mat4 global_transformation{1.0f};
+    std::vector<uint> meshes{};
+    // [(mesh_index, bone_id, offset_matrix)]
+    std::vector<std::tuple<uint, uint, glm::mat4>> bones{};
+    // { animation_id } -> { Animation Data }
+    std::unordered_map<int, AnimationData> animation_data{};
+};
+
 template<typename VertexData>
 struct ModelInfo {
     std::shared_ptr<ModelHandle<VertexData>> model{};
     // { bone_name } -> { bone_id }
     std::unordered_map<std::string, uint> bones{};
-    // Computed based on an input time
+
+    ModelInfo(const std::shared_ptr<ModelHandle<VertexData>>& model, const std::unordered_map<std::string, uint>& bones) : model(model), bones(bones) {}
+};
+
+/// The result of animating a MeshHierarchy at a point in time. Kept separate from the hierarchy, which is shared by every entity using the file,
+/// so that each entity has its own, and they can be evaluated ahead of drawing.
+struct AnimationPose {
+    // [first_bones[mesh] + bone_id] -> transform, every mesh's bones in one array so the offsets can be applied in bulk
     std::vector<glm::mat4> bone_transforms{};
+    // [node] -> the node's animated transform relative to the root
+    std::vector<AffineTransform> node_transforms{};
+    // A sphere around the skeleton's joints, relative to the root, for judging how large the entity is on screen.
+    // The skin reaches somewhat past the joints, so this is smaller than the mesh.
+    glm::vec3 bounds_center{0.0f};
+    float bounds_radius = 0.0f;
+};
 
-    ModelInfo(const std::shared_ptr<ModelHandle<VertexData>>& model, const std::unordered_map<std::string, uint>& bones) : model(model), bones(bones) {
-        bone_transforms.resize(bones.size(), glm::mat4{1.0f});
-    }
+/// Whether MeshHierarchy::calculate_animation plays clips back from a BakedClip rather than from the keys
+struct PoseBakeSettings {
+    bool enabled = false;
+    // The rate clips are baked at, in frames per second
+    float sample_rate = 30.0f;
+    // Blend the two baked frames either side of the time, rather than using the nearest one
+    bool blend = true;
+};
+
+/// Every bone and node transform of a clip, evaluated from the keys at a fixed rate, so that playing it back is a lookup and at most a blend,
+/// with no key search or hierarchy walk. Trades memory, which grows with the rate, for the error between frames, which shrinks with it.
+struct BakedClip {
+    float sample_rate = 0.0f;
+    // The frames cover the clip exactly, so they are slightly closer together than 1 / sample_rate
+    double frame_interval_seconds = 0.0;
+    uint frame_count = 0;
+    uint bone_count = 0;
+    uint node_count = 0;
+    // [frame * bone_count + bone] -> transform
+    std::vector<glm::mat4> bone_transforms{};
+    // [frame * node_count + node] -> transform
+    std::vector<AffineTransform> node_transforms{};
+    // The largest difference of a bone matrix column from evaluating the keys, measured halfway between frames, blending and using the nearest frame
+    float blend_error = 0.0f;
+    float nearest_error = 0.0f;
+
+    /// Fill in the pose at a time, clamped to the clip
+    void sample(double time_seconds, bool blend, AnimationPose& pose) const;
+    [[nodiscard]] size_t get_bytes() const;
 };
 
 class BaseMeshHierarchy : private NonCopyable {
@@ -61,66 +197,353 @@ struct MeshHierarchy : public BaseMeshHierarchy {
     std::vector<std::tuple<std::string, double, double>> animations{};
     // The name of the file the MeshHierarchy was loaded from, if any
     std::optional<std::string> filename{};
-    MeshHierarchyNode root_node{};
+    // The profile the file was imported with, if it was loaded from a file
+    std::optional<ImportProfile> import_profile{};
+    // The nodes in depth first order, so every parent comes before its children and transforms can be accumulated in a single pass
+    std::vector<FlatHierarchyNode> nodes{};
+    // [node] -> nodes[node].parent, packed together for PoseKernels::AccumulateHierarchy
+    std::vector<int> node_parents{};
+    // [mesh] -> index of the mesh's first bone in AnimationPose::bone_transforms
+    std::vector<uint> first_bones{};
+    // Every node's bones, in node order
+    std::vector<BoneBinding> bone_bindings{};
+    // The total number of bones of all the meshes
+    uint bone_count = 0;
+    // [node] -> the node's rank in importance to the pose, 0 being the most important. Ranked by how many bones the node moves,
+    // itself and its descendants, so a parent always ranks before its children, and a hip or spine long before a finger.
+    std::vector<uint> node_importance{};
+    // The number of nodes that move at least one bone, which are ranked before every node that doesn't
+    uint posed_node_count = 0;
+    struct BakedClipSlot {
+        float sample_rate = 0.0f;
+        // Shared by every entity that asks for the clip while it is being baked, which all wait for the one bake.
+        // Invalid until the clip is first played with baking enabled.
+        std::shared_future<std::shared_ptr<const BakedClip>> clip{};
+    };
+    // [animation_id] -> the clip baked at the rate last asked for.
+    // A cache of what the keys evaluate to, so filling it in doesn't change the hierarchy.
+    mutable std::vector<BakedClipSlot> baked_clips{};
+    // Guards baked_clips, since it is filled in while poses are being evaluated in parallel. Only held to find or claim a slot, never while baking.
+    mutable std::mutex baked_clips_mutex{};
+    // Incremented by swap_contents, so that anything computed from the old contents, such as cached poses, can tell it is stale
+    uint64_t version = 0;
 
     explicit MeshHierarchy(const std::optional<std::string>& filename = std::nullopt) : filename(filename) {}
 
-    /// Set the transformation field of each node to the correct state for the given time
-    void calculate_animation(uint animation_id, double time_seconds);
-    /// Recursively iterator over node tree
-    void visit_nodes(std::function<void(const MeshHierarchyNode& node, glm::mat4 accumulated_transformation)> fn);
+    /// Compress the keys of every node's animations, see CompressedTrack
+    void compress_animations(const AnimationCompressionSettings& settings);
+    /// The memory used by the keys of every node's animations
+    [[nodiscard]] size_t get_animation_bytes() const;
+
+    /// Flatten the tree of nodes built by a loader into nodes, along with the bone bindings, so the meshes must already be added
+    void set_nodes(MeshHierarchyNode&& root_node);
+
+    /// Swap the meshes, bones, animations and nodes of the two hierarchies, used to update a hierarchy in place when its file changes
+    void swap_contents(MeshHierarchy& other);
+    /// The total size of the vertex and index buffers of all the meshes
+    [[nodiscard]] size_t get_gpu_bytes() const;
+    /// Compute the pose for the given time, resizing it to fit. Only reads the hierarchy, so any number of poses can be calculated at once.
+    /// cursors holds the entity's AnimationCursor for each node, and is resized to fit.
+    /// With baking enabled the clip is played back from its BakedClip instead, which is baked the first time the clip is played.
+    /// Otherwise only the animated_node_limit most important nodes are animated, see node_importance, the rest holding their rest transform.
+    void calculate_animation(uint animation_id, double time_seconds, std::vector<AnimationCursor>& cursors, AnimationPose& pose,
+                             const PoseBakeSettings& bake_settings = {}, uint animated_node_limit = UINT_MAX) const;
+
+    /// The animated_node_limit that keeps the given fraction of the nodes that move bones animated, at least 1
+    [[nodiscard]] uint get_animated_node_limit(float fraction) const;
+
+    /// The clip baked at sample_rate, baking it if it hasn't been yet or was baked at another rate. Safe to call from several threads at once.
+    std::shared_ptr<const BakedClip> get_baked_clip(uint animation_id, float sample_rate) const;
+    /// [(animation_id, clip)] for every clip baked so far
+    [[nodiscard]] std::vector<std::pair<uint, std::shared_ptr<const BakedClip>>> get_baked_clips() const;
+    /// Free the baked clips, they are baked again the next time they are played with baking enabled
+    void clear_baked_clips() const;
+
+private:
+    /// Evaluate the pose from the keys
+    void evaluate_keys(uint animation_id, double time_seconds, std::vector<AnimationCursor>& cursors, AnimationPose& pose, uint animated_node_limit = UINT_MAX) const;
+    /// Fit the pose's bounds around the joints it was evaluated to
+    void update_bounds(AnimationPose& pose) const;
+    [[nodiscard]] std::shared_ptr<const BakedClip> bake_clip(uint animation_id, float sample_rate) const;
 };
 
 template<typename VertexData>
-void MeshHierarchy<VertexData>::calculate_animation(uint animation_id, double time_seconds) {
-    if (animation_id == NONE_ANIMATION) {
-        for (auto& mesh: meshes) {
-            std::fill(mesh.bone_transforms.begin(), mesh.bone_transforms.end(), glm::mat4{1.0f});
+void MeshHierarchy<VertexData>::swap_contents(MeshHierarchy& other) {
+    std::swap(meshes, other.meshes);
+    std::swap(total_bones, other.total_bones);
+    std::swap(animations, other.animations);
+    std::swap(nodes, other.nodes);
+    std::swap(node_parents, other.node_parents);
+    std::swap(first_bones, other.first_bones);
+    std::swap(bone_bindings, other.bone_bindings);
+    std::swap(bone_count, other.bone_count);
+    std::swap(node_importance, other.node_importance);
+    std::swap(posed_node_count, other.posed_node_count);
+    clear_baked_clips();
+    other.clear_baked_clips();
+    version++;
+}
+
+template<typename VertexData>
+void MeshHierarchy<VertexData>::set_nodes(MeshHierarchyNode&& root_node) {
+    first_bones.clear();
+    bone_count = 0;
+    for (const auto& mesh: meshes) {
+        first_bones.push_back(bone_count);
+        bone_count += (uint) mesh.bones.size();
+    }
+
+    nodes.clear();
+    node_parents.clear();
+    bone_bindings.clear();
+    // [(node, parent index)], popping from the back visits the children in order, so the nodes end up depth first
+    std::vector<std::pair<MeshHierarchyNode*, int>> stack{{&root_node, -1}};
+    while (!stack.empty()) {
+        auto [node, parent] = stack.back();
+        stack.pop_back();
+
+        auto& flat_node = nodes.emplace_back();
+        flat_node.parent = parent;
+        flat_node.is_skeleton = !node->bones.empty() || (parent >= 0 && nodes[parent].is_skeleton);
+        flat_node.transformation = node->transformation;
+        flat_node.rest_transform = flat_node.is_skeleton ? AffineTransform::from_mat4(node->transformation) : AffineTransform{};
+        flat_node.global_transformation = parent >= 0 ? nodes[parent].global_transformation * node->transformation : node->transformation;
+        flat_node.meshes = std::move(node->meshes);
+        flat_node.bones = std::move(node->bones);
+        flat_node.animation_data = std::move(node->animation_data);
+
+        int index = (int) nodes.size() - 1;
+        node_parents.push_back(parent);
+        for (const auto& [mesh_id, bone_id, offset_matrix]: flat_node.bones) {
+            bone_bindings.push_back({(uint) index, first_bones[mesh_id] + bone_id, AffineTransform::from_mat4(offset_matrix)});
+        }
+        for (auto child = node->children.rbegin(); child != node->children.rend(); ++child) {
+            stack.emplace_back(&*child, index);
         }
-        return;
     }
 
-    if (animation_id >= animations.size()) {
-        throw std::runtime_error(Formatter() << "Invalid animation id: " << animation_id);
+    // [node] -> the number of bones of the node and its descendants, summed up from the leaves since children come after their parents
+    std::vector<uint> moved_bones(nodes.size());
+    for (size_t i = nodes.size(); i-- > 0;) {
+        moved_bones[i] += (uint) nodes[i].bones.size();
+        if (nodes[i].parent >= 0) moved_bones[nodes[i].parent] += moved_bones[i];
     }
+    // Stable, so a parent, which moves at least as many bones as its child, stays ahead of it on a tie
+    std::vector<uint> order(nodes.size());
+    for (uint i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&moved_bones](uint a, uint b) { return moved_bones[a] > moved_bones[b]; });
+    node_importance.resize(nodes.size());
+    posed_node_count = 0;
+    for (uint rank = 0; rank < order.size(); ++rank) {
+        node_importance[order[rank]] = rank;
+        if (moved_bones[order[rank]] > 0) posed_node_count++;
+    }
+}
 
-    std::function<void(const MeshHierarchyNode& node, glm::mat4 accumulated_transformation, bool is_skeleton)> animate;
-    double time_ticks = time_seconds * std::get<1>(animations[animation_id]);
+template<typename VertexData>
+void MeshHierarchy<VertexData>::compress_animations(const AnimationCompressionSettings& settings) {
+    for (auto& node: nodes) {
+        for (auto& [_, animation_data]: node.animation_data) {
+            animation_data.compress(settings);
+        }
+    }
+}
 
-    animate = [&animate, this, animation_id, time_ticks](const MeshHierarchyNode& node, glm::mat4 accumulated_transformation, bool is_skeleton) {
-        is_skeleton |= !node.bones.empty();
-        glm::mat4 transform = is_skeleton ? node.transformation : glm::mat4{1.0f};
-        const auto animation = node.animation_data.find(animation_id);
-        if (animation != node.animation_data.end()) {
-            transform = animation->second.sample(time_ticks);
+template<typename VertexData>
+size_t MeshHierarchy<VertexData>::get_animation_bytes() const {
+    size_t total = 0;
+    for (const auto& node: nodes) {
+        for (const auto& [_, animation_data]: node.animation_data) {
+            total += animation_data.get_bytes();
         }
-        accumulated_transformation = accumulated_transformation * transform;
+    }
+    return total;
+}
+
+template<typename VertexData>
+size_t MeshHierarchy<VertexData>::get_gpu_bytes() const {
+    size_t total = 0;
+    for (const auto& mesh: meshes) {
+        total += mesh.model->get_gpu_bytes();
+    }
+    return total;
+}
+
+template<typename VertexData>
+void MeshHierarchy<VertexData>::calculate_animation(uint animation_id, double time_seconds, std::vector<AnimationCursor>& cursors, AnimationPose& pose,
+                                                    const PoseBakeSettings& bake_settings, uint animated_node_limit) const {
+    if (bake_settings.enabled && animation_id != NONE_ANIMATION && animation_id < animations.size()) {
+        // A baked clip costs the same however many nodes are animated, so it always plays back in full
+        get_baked_clip(animation_id, bake_settings.sample_rate)->sample(time_seconds, bake_settings.blend, pose);
+    } else {
+        evaluate_keys(animation_id, time_seconds, cursors, pose, animated_node_limit);
+    }
+    update_bounds(pose);
+}
+
+template<typename VertexData>
+uint MeshHierarchy<VertexData>::get_animated_node_limit(float fraction) const {
+    return std::max(1u, (uint) std::ceil(std::clamp(fraction, 0.0f, 1.0f) * (float) posed_node_count));
+}
+
+template<typename VertexData>
+void MeshHierarchy<VertexData>::update_bounds(AnimationPose& pose) const {
+    glm::vec3 minimum{std::numeric_limits<float>::max()};
+    glm::vec3 maximum{std::numeric_limits<float>::lowest()};
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (!nodes[i].is_skeleton) continue;
+        const auto& rows = pose.node_transforms[i].rows;
+        glm::vec3 joint{rows[0].w, rows[1].w, rows[2].w};
+        minimum = glm::min(minimum, joint);
+        maximum = glm::max(maximum, joint);
+    }
+    if (minimum.x > maximum.x) {
+        pose.bounds_center = glm::vec3{0.0f};
+        pose.bounds_radius = 0.0f;
+        return;
+    }
+    pose.bounds_center = (minimum + maximum) * 0.5f;
+    pose.bounds_radius = glm::length(maximum - minimum) * 0.5f;
+}
 
-        for (const auto& [mesh_id, bone_id, offset_matrix]: node.bones) {
-            meshes[mesh_id].bone_transforms[bone_id] = accumulated_transformation * offset_matrix;
+template<typename VertexData>
+std::shared_ptr<const BakedClip> MeshHierarchy<VertexData>::get_baked_clip(uint animation_id, float sample_rate) const {
+    std::promise<std::shared_ptr<const BakedClip>> promise{};
+    std::shared_future<std::shared_ptr<const BakedClip>> existing{};
+    {
+        std::lock_guard lock(baked_clips_mutex);
+        if (baked_clips.size() < animations.size()) baked_clips.resize(animations.size());
+        auto& slot = baked_clips[animation_id];
+        if (slot.clip.valid() && slot.sample_rate == sample_rate) {
+            existing = slot.clip;
+        } else {
+            // Claim the slot, so other entities starting the same clip wait for this bake rather than baking it again
+            slot = {sample_rate, promise.get_future().share()};
         }
+    }
+    if (existing.valid()) {
+        // Only waits if the clip is still being baked, entities playing other clips aren't held up by it
+        return existing.get();
+    }
 
-        for (const auto& child: node.children) {
-            animate(child, accumulated_transformation, is_skeleton);
+    try {
+        auto clip = bake_clip(animation_id, sample_rate);
+        promise.set_value(clip);
+        return clip;
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+template<typename VertexData>
+std::vector<std::pair<uint, std::shared_ptr<const BakedClip>>> MeshHierarchy<VertexData>::get_baked_clips() const {
+    std::lock_guard lock(baked_clips_mutex);
+    std::vector<std::pair<uint, std::shared_ptr<const BakedClip>>> clips{};
+    for (uint animation_id = 0; animation_id < baked_clips.size(); ++animation_id) {
+        const auto& clip = baked_clips[animation_id].clip;
+        // Clips still being baked are left out, rather than waiting for them
+        if (clip.valid() && clip.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            clips.emplace_back(animation_id, clip.get());
         }
-    };
+    }
+    return clips;
+}
 
-    animate(root_node, glm::mat4{1.0f}, false);
+template<typename VertexData>
+void MeshHierarchy<VertexData>::clear_baked_clips() const {
+    std::lock_guard lock(baked_clips_mutex);
+    baked_clips.clear();
 }
 
 template<typename VertexData>
-void MeshHierarchy<VertexData>::visit_nodes(std::function<void(const MeshHierarchyNode&, glm::mat4)> fn) {
-    std::function<void(const MeshHierarchyNode& node, glm::mat4 accumulated_transformation)> visit;
-
-    visit = [&visit, &fn](const MeshHierarchyNode& node, glm::mat4 accumulated_transformation) {
-        accumulated_transformation = accumulated_transformation * node.transformation;
-        fn(node, accumulated_transformation);
-        for (const auto& child: node.children) {
-            visit(child, accumulated_transformation);
+std::shared_ptr<const BakedClip> MeshHierarchy<VertexData>::bake_clip(uint animation_id, float sample_rate) const {
+    auto clip = std::make_shared<BakedClip>();
+    double duration_seconds = std::get<2>(animations[animation_id]) / std::get<1>(animations[animation_id]);
+    clip->sample_rate = sample_rate;
+    clip->frame_count = std::max(2u, (uint) std::ceil(duration_seconds * sample_rate) + 1);
+    clip->frame_interval_seconds = std::max(duration_seconds, 0.0) / (clip->frame_count - 1);
+    clip->bone_count = bone_count;
+    clip->node_count = (uint) nodes.size();
+    clip->bone_transforms.reserve((size_t) clip->frame_count * bone_count);
+    clip->node_transforms.reserve((size_t) clip->frame_count * nodes.size());
+
+    // Frames are evaluated in order, so the cursors make each key search O(1)
+    std::vector<AnimationCursor> cursors{};
+    AnimationPose pose{};
+    for (uint frame = 0; frame < clip->frame_count; ++frame) {
+        evaluate_keys(animation_id, frame * clip->frame_interval_seconds, cursors, pose);
+        clip->bone_transforms.insert(clip->bone_transforms.end(), pose.bone_transforms.begin(), pose.bone_transforms.end());
+        clip->node_transforms.insert(clip->node_transforms.end(), pose.node_transforms.begin(), pose.node_transforms.end());
+    }
+
+    // Halfway between frames is where both playback modes are furthest from the keys
+    AnimationPose baked_pose{};
+    for (uint frame = 0; frame + 1 < clip->frame_count; ++frame) {
+        double time_seconds = (frame + 0.5) * clip->frame_interval_seconds;
+        evaluate_keys(animation_id, time_seconds, cursors, pose);
+        for (bool blend: {true, false}) {
+            clip->sample(time_seconds, blend, baked_pose);
+            float& error = blend ? clip->blend_error : clip->nearest_error;
+            for (uint bone = 0; bone < bone_count; ++bone) {
+                glm::mat4 difference = baked_pose.bone_transforms[bone] - pose.bone_transforms[bone];
+                for (int c = 0; c < 4; ++c) {
+                    error = std::max(error, glm::length(difference[c]));
+                }
+            }
         }
-    };
+    }
+    return clip;
+}
+
+template<typename VertexData>
+void MeshHierarchy<VertexData>::evaluate_keys(uint animation_id, double time_seconds, std::vector<AnimationCursor>& cursors, AnimationPose& pose, uint animated_node_limit) const {
+    pose.bone_transforms.resize(bone_count);
+    pose.node_transforms.resize(nodes.size());
+
+    if (animation_id == NONE_ANIMATION) {
+        std::fill(pose.bone_transforms.begin(), pose.bone_transforms.end(), glm::mat4{1.0f});
+        std::fill(pose.node_transforms.begin(), pose.node_transforms.end(), AffineTransform{});
+        return;
+    }
+
+    if (animation_id >= animations.size()) {
+        throw std::runtime_error(Formatter() << "Invalid animation id: " << animation_id);
+    }
+
+    auto time_ticks = (float) (time_seconds * std::get<1>(animations[animation_id]));
+    cursors.resize(nodes.size());
+
+    // Scratch space, per thread since poses are evaluated in parallel
+    thread_local TrsSamples samples{};
+    thread_local std::vector<std::pair<uint, const AnimationData*>> animated_nodes{};
+    thread_local std::vector<AffineTransform> animated_transforms{};
+
+    // Gather the keys of the animated nodes, so they can be interpolated and composed in batches
+    animated_nodes.clear();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const auto animation = node_importance[i] < animated_node_limit ? nodes[i].animation_data.find(animation_id) : nodes[i].animation_data.end();
+        if (animation == nodes[i].animation_data.end()) {
+            pose.node_transforms[i] = nodes[i].rest_transform;
+        } else {
+            animated_nodes.emplace_back((uint) i, &animation->second);
+        }
+    }
+    samples.resize(animated_nodes.size());
+    for (size_t j = 0; j < animated_nodes.size(); ++j) {
+        auto [i, animation_data] = animated_nodes[j];
+        animation_data->find_samples(time_ticks, cursors[i], samples, j);
+    }
+
+    const auto& kernels = PoseKernels::active();
+    animated_transforms.resize(samples.padded_count());
+    kernels.compose_trs(samples, animated_transforms.data());
+    for (size_t j = 0; j < animated_nodes.size(); ++j) {
+        pose.node_transforms[animated_nodes[j].first] = animated_transforms[j];
+    }
 
-    visit(root_node, glm::mat4{1.0f});
+    kernels.accumulate_hierarchy(node_parents.data(), pose.node_transforms.data(), nodes.size());
+    kernels.apply_offsets(pose.node_transforms.data(), bone_bindings.data(), bone_bindings.size(), pose.bone_transforms.data());
 }
 
 #endif //MESH_HIERARCHY_H
@@ -0,0 +1,342 @@
+#include "MipChain.h"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include <glm/gtc/constants.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_CHAIN_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+    // Filtering is done on 4 float channels per pixel, which lines up with one SSE register per pixel
+    using Pixel = glm::vec4;
+
+    constexpr char CACHE_MAGIC[4] = {'M', 'I', 'P', 'C'};
+    // Version 2 stores the channels the image actually uses, rather than always RGB, and version 3 the hash and size of the source file
+    constexpr uint32_t CACHE_VERSION = 3;
+
+    // Kaiser filter parameters, for a 2x reduction there are 6 taps centred between input pixels 2x and 2x + 1
+    constexpr int KAISER_TAPS = 6;
+    constexpr int KAISER_FIRST_TAP = -2;
+    constexpr float KAISER_RADIUS = 3.0f;
+    constexpr float KAISER_ALPHA = 4.0f;
+
+    float srgb_to_linear(float value) {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linear_to_srgb(float value) {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    const std::array<float, 256>& srgb_decode_table() {
+        static const std::array<float, 256> table = []() {
+            std::array<float, 256> t{};
+            for (uint i = 0; i < 256; ++i) t[i] = srgb_to_linear((float) i / 255.0f);
+            return t;
+        }();
+        return table;
+    }
+
+    // Indexed by linear value quantised to 16 bits, which keeps full 8 bit precision even in the dark end of the curve
+    const std::vector<unsigned char>& srgb_encode_table() {
+        static const std::vector<unsigned char> table = []() {
+            std::vector<unsigned char> t(65536);
+            for (uint i = 0; i < t.size(); ++i) {
+                t[i] = (unsigned char) std::lround(linear_to_srgb((float) i / 65535.0f) * 255.0f);
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    // Zeroth order modified Bessel function of the first kind, used by the Kaiser window
+    double bessel_i0(double x) {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 32; ++k) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    const std::array<float, KAISER_TAPS>& kaiser_weights() {
+        static const std::array<float, KAISER_TAPS> weights = []() {
+            std::array<float, KAISER_TAPS> w{};
+            float total = 0.0f;
+            for (int tap = 0; tap < KAISER_TAPS; ++tap) {
+                // Distance from the centre of the output pixel, in input pixels
+                double d = (double) (tap + KAISER_FIRST_TAP) - 0.5;
+                // Sinc with the cutoff at half the input frequency, since the output is half the resolution
+                double x = d / 2.0;
+                double sinc = std::abs(x) < 1e-8 ? 1.0 : std::sin(glm::pi<double>() * x) / (glm::pi<double>() * x);
+                double r = d / KAISER_RADIUS;
+                double window = bessel_i0(KAISER_ALPHA * std::sqrt(std::max(0.0, 1.0 - r * r))) / bessel_i0(KAISER_ALPHA);
+                w[tap] = (float) (sinc * window);
+                total += w[tap];
+            }
+            for (auto& weight: w) weight /= total;
+            return w;
+        }();
+        return weights;
+    }
+
+    struct FloatImage {
+        uint width = 0;
+        uint height = 0;
+        std::vector<Pixel> pixels{};
+
+        Pixel* row(uint y) { return &pixels[(size_t) y * width]; }
+        [[nodiscard]] const Pixel* row(uint y) const { return &pixels[(size_t) y * width]; }
+    };
+
+    // Number of channels that hold colour (and so are affected by sRGB), grey counts as colour but alpha doesn't
+    uint colour_channels(uint channels) {
+        return channels >= 3 ? 3 : 1;
+    }
+
+    FloatImage decode(const ImageData& image, bool srgb, ThreadPool& thread_pool) {
+        FloatImage result{image.width, image.height, std::vector<Pixel>((size_t) image.width * image.height)};
+        const auto& table = srgb_decode_table();
+        const uint channels = image.channels;
+        const uint colour = colour_channels(channels);
+
+        thread_pool.parallel_for(image.height, [&](size_t y) {
+            const unsigned char* src = &image.levels[0][y * image.width * channels];
+            Pixel* dst = result.row((uint) y);
+            for (uint x = 0; x < image.width; ++x) {
+                Pixel pixel{0.0f, 0.0f, 0.0f, 1.0f};
+                for (uint c = 0; c < channels; ++c) {
+                    unsigned char value = src[x * channels + c];
+                    pixel[(int) c] = (srgb && c < colour) ? table[value] : (float) value / 255.0f;
+                }
+                dst[x] = pixel;
+            }
+        }, 16);
+
+        return result;
+    }
+
+    std::vector<unsigned char> encode(const FloatImage& image, uint channels, bool srgb, ThreadPool& thread_pool) {
+        std::vector<unsigned char> result((size_t) image.width * image.height * channels);
+        const auto& table = srgb_encode_table();
+        const uint colour = colour_channels(channels);
+
+        thread_pool.parallel_for(image.height, [&](size_t y) {
+            const Pixel* src = image.row((uint) y);
+            unsigned char* dst = &result[y * image.width * channels];
+            for (uint x = 0; x < image.width; ++x) {
+                for (uint c = 0; c < channels; ++c) {
+                    float value = std::clamp(src[x][(int) c], 0.0f, 1.0f);
+                    dst[x * channels + c] = (srgb && c < colour)
+                                            ? table[(size_t) (value * 65535.0f + 0.5f)]
+                                            : (unsigned char) (value * 255.0f + 0.5f);
+                }
+            }
+        }, 16);
+
+        return result;
+    }
+
+    // out = sum(weights[i] * in[i]), done a whole pixel at a time
+    inline void accumulate(Pixel& out, const Pixel& in, float weight) {
+#ifdef MIP_CHAIN_SSE
+        __m128 acc = _mm_loadu_ps(&out[0]);
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&in[0]), _mm_set1_ps(weight)));
+        _mm_storeu_ps(&out[0], acc);
+#else
+        out += in * weight;
+#endif
+    }
+
+    FloatImage downsample_box(const FloatImage& src, ThreadPool& thread_pool) {
+        FloatImage dst{std::max(1u, src.width / 2), std::max(1u, src.height / 2), {}};
+        dst.pixels.resize((size_t) dst.width * dst.height);
+
+        thread_pool.parallel_for(dst.height, [&](size_t y) {
+            // Clamping handles the odd row/column when a dimension is 1 pixel wide
+            const Pixel* row_0 = src.row(std::min((uint) y * 2, src.height - 1));
+            const Pixel* row_1 = src.row(std::min((uint) y * 2 + 1, src.height - 1));
+            Pixel* out = dst.row((uint) y);
+            for (uint x = 0; x < dst.width; ++x) {
+                uint x_0 = std::min(x * 2, src.width - 1);
+                uint x_1 = std::min(x * 2 + 1, src.width - 1);
+#ifdef MIP_CHAIN_SSE
+                __m128 sum = _mm_add_ps(
+                    _mm_add_ps(_mm_loadu_ps(&row_0[x_0][0]), _mm_loadu_ps(&row_0[x_1][0])),
+                    _mm_add_ps(_mm_loadu_ps(&row_1[x_0][0]), _mm_loadu_ps(&row_1[x_1][0]))
+                );
+                _mm_storeu_ps(&out[x][0], _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+                out[x] = (row_0[x_0] + row_0[x_1] + row_1[x_0] + row_1[x_1]) * 0.25f;
+#endif
+            }
+        }, 8);
+
+        return dst;
+    }
+
+    FloatImage downsample_kaiser(const FloatImage& src, ThreadPool& thread_pool) {
+        const auto& weights = kaiser_weights();
+
+        // Separable, so first filter horizontally into a half width image
+        FloatImage horizontal{std::max(1u, src.width / 2), src.height, {}};
+        horizontal.pixels.resize((size_t) horizontal.width * horizontal.height);
+
+        thread_pool.parallel_for(horizontal.height, [&](size_t y) {
+            const Pixel* in = src.row((uint) y);
+            Pixel* out = horizontal.row((uint) y);
+            for (uint x = 0; x < horizontal.width; ++x) {
+                Pixel sum{0.0f};
+                for (int tap = 0; tap < KAISER_TAPS; ++tap) {
+                    int sx = std::clamp((int) x * 2 + KAISER_FIRST_TAP + tap, 0, (int) src.width - 1);
+                    accumulate(sum, in[sx], weights[tap]);
+                }
+                out[x] = sum;
+            }
+        }, 8);
+
+        // Then vertically into the final image
+        FloatImage dst{horizontal.width, std::max(1u, src.height / 2), {}};
+        dst.pixels.resize((size_t) dst.width * dst.height);
+
+        thread_pool.parallel_for(dst.height, [&](size_t y) {
+            Pixel* out = dst.row((uint) y);
+            std::fill(out, out + dst.width, Pixel{0.0f});
+            for (int tap = 0; tap < KAISER_TAPS; ++tap) {
+                int sy = std::clamp((int) y * 2 + KAISER_FIRST_TAP + tap, 0, (int) horizontal.height - 1);
+                const Pixel* in = horizontal.row((uint) sy);
+                for (uint x = 0; x < dst.width; ++x) {
+                    accumulate(out[x], in[x], weights[tap]);
+                }
+            }
+        }, 8);
+
+        return dst;
+    }
+}
+
+glm::uvec2 ImageData::level_size(uint level) const {
+    return {std::max(1u, width >> level), std::max(1u, height >> level)};
+}
+
+size_t ImageData::total_bytes() const {
+    size_t total = 0;
+    for (const auto& level: levels) total += level.size();
+    return total;
+}
+
+const char* MipChain::filter_name(MipFilter filter) {
+    switch (filter) {
+        case MipFilter::Driver:
+            return "Driver (glGenerateMipmap)";
+        case MipFilter::Box:
+            return "Box";
+        case MipFilter::Kaiser:
+            return "Kaiser";
+    }
+    return "Unknown";
+}
+
+uint MipChain::level_count(uint width, uint height) {
+    uint levels = 1;
+    while (width > 1 || height > 1) {
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+        levels++;
+    }
+    return levels;
+}
+
+void MipChain::build(ImageData& image, bool srgb, MipFilter filter, ThreadPool& thread_pool) {
+    image.levels.resize(1);
+    if (filter == MipFilter::Driver) return;
+
+    uint count = level_count(image.width, image.height);
+    image.levels.reserve(count);
+
+    // Keep the working image in linear floating point the whole way down, so that error doesn't accumulate from re-quantising each level
+    FloatImage current = decode(image, srgb, thread_pool);
+    for (uint level = 1; level < count; ++level) {
+        current = filter == MipFilter::Kaiser ? downsample_kaiser(current, thread_pool) : downsample_box(current, thread_pool);
+        image.levels.push_back(encode(current, image.channels, srgb, thread_pool));
+    }
+}
+
+std::optional<ImageData> MipChain::read_cache(const std::filesystem::path& cache_file, int64_t source_time) {
+    std::ifstream file(cache_file, std::ios::binary);
+    if (!file) return std::nullopt;
+
+    char magic[4];
+    uint32_t version;
+    int64_t cached_source_time;
+    uint64_t source_hash, source_size;
+    uint32_t width, height, channels, level_count;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&cached_source_time), sizeof(cached_source_time));
+    file.read(reinterpret_cast<char*>(&source_hash), sizeof(source_hash));
+    file.read(reinterpret_cast<char*>(&source_size), sizeof(source_size));
+    file.read(reinterpret_cast<char*>(&width), sizeof(width));
+    file.read(reinterpret_cast<char*>(&height), sizeof(height));
+    file.read(reinterpret_cast<char*>(&channels), sizeof(channels));
+    file.read(reinterpret_cast<char*>(&level_count), sizeof(level_count));
+
+    if (!file || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || version != CACHE_VERSION || cached_source_time != source_time) {
+        return std::nullopt;
+    }
+    if (channels == 0 || channels > 4 || level_count == 0 || level_count > MipChain::level_count(width, height)) {
+        return std::nullopt;
+    }
+
+    ImageData image{width, height, channels, {}, source_hash, source_size};
+    image.levels.resize(level_count);
+    for (uint level = 0; level < level_count; ++level) {
+        auto size = image.level_size(level);
+        image.levels[level].resize((size_t) size.x * size.y * channels);
+        file.read(reinterpret_cast<char*>(image.levels[level].data()), (std::streamsize) image.levels[level].size());
+    }
+
+    if (!file) return std::nullopt;
+    return image;
+}
+
+void MipChain::write_cache(const std::filesystem::path& cache_file, int64_t source_time, const ImageData& image) {
+    try {
+        std::filesystem::create_directories(cache_file.parent_path());
+
+        // Write to a temporary file and then move it into place, so a partially written cache is never read
+        auto temp_file = cache_file;
+        temp_file += ".tmp";
+        {
+            std::ofstream file(temp_file, std::ios::binary | std::ios::trunc);
+            auto level_count = (uint32_t) image.levels.size();
+            file.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+            file.write(reinterpret_cast<const char*>(&CACHE_VERSION), sizeof(CACHE_VERSION));
+            file.write(reinterpret_cast<const char*>(&source_time), sizeof(source_time));
+            file.write(reinterpret_cast<const char*>(&image.source_hash), sizeof(image.source_hash));
+            file.write(reinterpret_cast<const char*>(&image.source_size), sizeof(image.source_size));
+            file.write(reinterpret_cast<const char*>(&image.width), sizeof(image.width));
+            file.write(reinterpret_cast<const char*>(&image.height), sizeof(image.height));
+            file.write(reinterpret_cast<const char*>(&image.channels), sizeof(image.channels));
+            file.write(reinterpret_cast<const char*>(&level_count), sizeof(level_count));
+            for (const auto& level: image.levels) {
+                file.write(reinterpret_cast<const char*>(level.data()), (std::streamsize) level.size());
+            }
+            if (!file) {
+                throw std::runtime_error("Failed to write file");
+            }
+        }
+        std::filesystem::rename(temp_file, cache_file);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to write mip chain cache (" << cache_file.string() << "):\n\t" << e.what() << std::endl;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef MIP_CHAIN_H
+#define MIP_CHAIN_H
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+
+#include <glm/glm.hpp>
+
+#include "utility/HelperTypes.h"
+#include "utility/ThreadPool.h"
+
+/// The filter used to generate each mip level from the level above it.
+enum class MipFilter {
+    /// Let the driver generate the mipmaps with glGenerateMipmap
+    Driver,
+    /// A 2x2 box filter, cheap and good enough for most textures
+    Box,
+    /// A Kaiser windowed sinc filter, keeps the smaller mips sharper at the cost of a little ringing
+    Kaiser,
+};
+
+/// Decoded image data, along with its mip chain once built.
+/// Each level is tightly packed, with `channels` 8 bit channels per pixel.
+struct ImageData {
+    uint width = 0;
+    uint height = 0;
+    uint channels = 0;
+    // [level] -> pixel data, level 0 is the full size image
+    std::vector<std::vector<unsigned char>> levels{};
+    // The hash and size of the bytes of the file the image was decoded from, kept in the cache so that files with identical
+    // contents can be found without reading the source file again
+    uint64_t source_hash = 0;
+    uint64_t source_size = 0;
+
+    [[nodiscard]] glm::uvec2 level_size(uint level) const;
+    [[nodiscard]] size_t total_bytes() const;
+};
+
+/// CPU side mip chain generation, which does the filtering in linear space so sRGB textures don't darken as they shrink,
+/// and an on-disk cache so that the chain only needs to be generated once per asset.
+namespace MipChain {
+    const char* filter_name(MipFilter filter);
+
+    /// The number of levels in a full mip chain for an image of the given size, including level 0
+    uint level_count(uint width, uint height);
+
+    /// Replaces any levels below level 0 with a full mip chain generated using the given filter.
+    /// If srgb is set, then the colour channels are linearised before filtering and re-encoded after.
+    /// The work for each level is split across rows on the thread pool.
+    void build(ImageData& image, bool srgb, MipFilter filter, ThreadPool& thread_pool = ThreadPool::shared());
+
+    /// Try to read a cached mip chain, along with the source_hash and source_size it was written with. Returns std::nullopt if the file doesn't exist,
+    /// is corrupt, or was generated from a version of the source file with a different modification time.
+    std::optional<ImageData> read_cache(const std::filesystem::path& cache_file, int64_t source_time);
+    /// Write the mip chain to the cache, creating any needed directories. Failures are printed and otherwise ignored.
+    void write_cache(const std::filesystem::path& cache_file, int64_t source_time, const ImageData& image);
+}
+
+#endif //MIP_CHAIN_H
@@ -2,10 +2,14 @@
 #define MODEL_HANDLE_H
 
 #include <string>
+#include <iostream>
+#include <memory>
 #include <optional>
 
 #include <glad/gl.h>
 #include "utility/HelperTypes.h"
+#include "ImportProfile.h"
+#include "UploadThread.h"
 
 /// A type-erased version of ModelHandle for polymorphic usages
 class BaseModelHandle : private NonCopyable {
@@ -18,27 +22,47 @@ template<typename VertexData>
 class ModelHandle : public BaseModelHandle {
     uint vertex_vbo;
     uint index_vbo;
-    uint vao;
+    // Created on first use if the buffers were uploaded on the UploadThread, since VAOs aren't shared between contexts
+    mutable uint vao;
     int index_count;
     int vertex_offset;
+    size_t gpu_bytes;
+    // Set until the render thread has waited for the buffers to finish uploading
+    mutable std::shared_ptr<PendingUpload> pending_upload{};
 
     std::optional<std::string> filename{};
+    // The profile the file was imported with, if it was loaded from a file
+    std::optional<ImportProfile> import_profile{};
 public:
-    ModelHandle(uint vertex_vbo, uint index_vbo, uint vao, int index_count, int vertex_offset, std::optional<std::string> filename = {});
+    ModelHandle(uint vertex_vbo, uint index_vbo, uint vao, int index_count, int vertex_offset, std::optional<std::string> filename = {}, size_t gpu_bytes = 0);
+    /// Construct a handle to buffers that are still being uploaded on the UploadThread, the VAO is created when it is first requested.
+    ModelHandle(uint vertex_vbo, uint index_vbo, std::shared_ptr<PendingUpload> pending_upload, int index_count, std::optional<std::string> filename = {}, size_t gpu_bytes = 0);
 
     [[nodiscard]] uint get_vertex_vbo() const;
     [[nodiscard]] uint get_index_vbo() const;
+    /// Waits for the buffers to finish uploading if they haven't already, so must only be called on the render thread
     [[nodiscard]] uint get_vao() const;
     [[nodiscard]] int get_index_count() const;
     [[nodiscard]] int get_vertex_offset() const;
+    /// The size of the vertex and index buffers
+    [[nodiscard]] size_t get_gpu_bytes() const;
     [[nodiscard]] const std::optional<std::string>& get_filename() const;
+    [[nodiscard]] std::optional<ImportProfile> get_import_profile() const;
+    void set_import_profile(ImportProfile profile);
+
+    /// Swap the GPU resources of the two handles, used to update a model in place when its file changes
+    void swap_contents(ModelHandle& other);
 
     ~ModelHandle() override;
 };
 
 template<typename VertexData>
-ModelHandle<VertexData>::ModelHandle(uint vertex_vbo, uint index_vbo, uint vao, int index_count, int vertex_offset, std::optional<std::string> filename)
-    : BaseModelHandle(), vertex_vbo(vertex_vbo), index_vbo(index_vbo), vao(vao), index_count(index_count), vertex_offset(vertex_offset), filename(std::move(filename)) {}
+ModelHandle<VertexData>::ModelHandle(uint vertex_vbo, uint index_vbo, uint vao, int index_count, int vertex_offset, std::optional<std::string> filename, size_t gpu_bytes)
+    : BaseModelHandle(), vertex_vbo(vertex_vbo), index_vbo(index_vbo), vao(vao), index_count(index_count), vertex_offset(vertex_offset), gpu_bytes(gpu_bytes), filename(std::move(filename)) {}
+
+template<typename VertexData>
+ModelHandle<VertexData>::ModelHandle(uint vertex_vbo, uint index_vbo, std::shared_ptr<PendingUpload> pending_upload, int index_count, std::optional<std::string> filename, size_t gpu_bytes)
+    : BaseModelHandle(), vertex_vbo(vertex_vbo), index_vbo(index_vbo), vao(0), index_count(index_count), vertex_offset(0), gpu_bytes(gpu_bytes), pending_upload(std::move(pending_upload)), filename(std::move(filename)) {}
 
 template<typename VertexData>
 uint ModelHandle<VertexData>::get_vertex_vbo() const {
@@ -52,6 +76,24 @@ uint ModelHandle<VertexData>::get_index_vbo() const {
 
 template<typename VertexData>
 uint ModelHandle<VertexData>::get_vao() const {
+    if (pending_upload != nullptr) {
+        try {
+            pending_upload->wait();
+        } catch (const std::exception& e) {
+            // The buffers are left with whatever made it in, rather than failing the frame that first used them
+            std::cerr << "Error while uploading model (" << filename.value_or("unnamed") << "):" << std::endl;
+            std::cerr << e.what() << std::endl;
+        }
+        pending_upload = nullptr;
+
+        // Binding the buffers here, after the wait, is also what makes the upload visible to this context
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vertex_vbo);
+        VertexData::setup_attrib_pointers();
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_vbo);
+        glBindVertexArray(0);
+    }
     return vao;
 }
 
@@ -65,13 +107,48 @@ int ModelHandle<VertexData>::get_vertex_offset() const {
     return vertex_offset;
 }
 
+template<typename VertexData>
+size_t ModelHandle<VertexData>::get_gpu_bytes() const {
+    return gpu_bytes;
+}
+
 template<typename VertexData>
 const std::optional<std::string>& ModelHandle<VertexData>::get_filename() const {
     return filename;
 }
 
+template<typename VertexData>
+std::optional<ImportProfile> ModelHandle<VertexData>::get_import_profile() const {
+    return import_profile;
+}
+
+template<typename VertexData>
+void ModelHandle<VertexData>::set_import_profile(ImportProfile profile) {
+    import_profile = profile;
+}
+
+template<typename VertexData>
+void ModelHandle<VertexData>::swap_contents(ModelHandle& other) {
+    std::swap(vertex_vbo, other.vertex_vbo);
+    std::swap(index_vbo, other.index_vbo);
+    std::swap(vao, other.vao);
+    std::swap(index_count, other.index_count);
+    std::swap(vertex_offset, other.vertex_offset);
+    std::swap(gpu_bytes, other.gpu_bytes);
+    std::swap(pending_upload, other.pending_upload);
+}
+
 template<typename VertexData>
 ModelHandle<VertexData>::~ModelHandle() {
+    // Otherwise the upload could recreate the buffers after they are deleted
+    if (pending_upload != nullptr) {
+        try {
+            pending_upload->wait();
+        } catch (const std::exception& e) {
+            std::cerr << "Error while uploading model (" << filename.value_or("unnamed") << "):" << std::endl;
+            std::cerr << e.what() << std::endl;
+        }
+    }
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vertex_vbo);
     glDeleteBuffers(1, &index_vbo);
@@ -1,16 +1,526 @@
 #include "ModelLoader.h"
+#include <chrono>
+#include <cctype>
+#include <cstring>
+#include <iterator>
+#include <algorithm>
 #include <filesystem>
 
+#include <assimp/IOStream.hpp>
+#include <assimp/DefaultIOSystem.h>
+
+#include "rendering/imgui/ImGuiManager.h"
+
+namespace {
+    // Assimp's post-processing steps in the order it runs them (see PostStepRegistry.cpp in Assimp), with the flags that enable each
+    constexpr std::pair<const char*, uint> POST_PROCESS_STEPS[] = {
+        {"MakeLeftHanded", aiProcess_MakeLeftHanded},
+        {"FlipUVs", aiProcess_FlipUVs},
+        {"FlipWindingOrder", aiProcess_FlipWindingOrder},
+        {"RemoveComponent", aiProcess_RemoveComponent},
+        {"RemoveRedundantMaterials", aiProcess_RemoveRedundantMaterials},
+        {"EmbedTextures", aiProcess_EmbedTextures},
+        {"FindInstances", aiProcess_FindInstances},
+        {"OptimizeGraph", aiProcess_OptimizeGraph},
+        {"GenUVCoords", aiProcess_GenUVCoords},
+        {"TransformUVCoords", aiProcess_TransformUVCoords},
+        {"GlobalScale", aiProcess_GlobalScale},
+        {"PopulateArmatureData", aiProcess_PopulateArmatureData},
+        {"PreTransformVertices", aiProcess_PreTransformVertices},
+        {"Triangulate", aiProcess_Triangulate},
+        {"FindDegenerates", aiProcess_FindDegenerates},
+        {"SortByPType", aiProcess_SortByPType},
+        {"FindInvalidData", aiProcess_FindInvalidData},
+        {"OptimizeMeshes", aiProcess_OptimizeMeshes},
+        {"FixInfacingNormals", aiProcess_FixInfacingNormals},
+        {"SplitByBoneCount", aiProcess_SplitByBoneCount},
+        {"SplitLargeMeshes (Triangles)", aiProcess_SplitLargeMeshes},
+        {"DropNormals", aiProcess_DropNormals},
+        {"GenNormals", aiProcess_GenNormals},
+        {"ComputeSpatialSort", aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace | aiProcess_JoinIdenticalVertices},
+        {"GenSmoothNormals", aiProcess_GenSmoothNormals},
+        {"CalcTangentSpace", aiProcess_CalcTangentSpace},
+        {"JoinIdenticalVertices", aiProcess_JoinIdenticalVertices},
+        {"DestroySpatialSort", aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace | aiProcess_JoinIdenticalVertices},
+        {"SplitLargeMeshes (Vertices)", aiProcess_SplitLargeMeshes},
+        {"Debone", aiProcess_Debone},
+        {"LimitBoneWeights", aiProcess_LimitBoneWeights},
+        {"ImproveCacheLocality", aiProcess_ImproveCacheLocality},
+        {"GenBoundingBoxes", aiProcess_GenBoundingBoxes},
+    };
+
+    /// Records when each stage of an import starts, from the progress callbacks Assimp makes as it reads the file and between post-processing steps.
+    /// Steps are timed within a single ReadFile call, since applying them separately changes the result of steps that check each other's flags.
+    class ImportStepTimer : public Assimp::ProgressHandler {
+        using Clock = std::chrono::steady_clock;
+
+        Clock::time_point start = Clock::now();
+        Clock::time_point read_end = start;
+        // [step] -> when the step started, with a final entry for when post-processing finished
+        std::vector<Clock::time_point> step_starts{};
+        int step_count = 0;
+    public:
+        bool Update(float /*percentage*/) override { return true; }
+
+        void UpdateFileRead(int /*current_step*/, int /*number_of_steps*/) override {
+            read_end = Clock::now();
+        }
+
+        void UpdatePostProcess(int /*current_step*/, int number_of_steps) override {
+            step_starts.push_back(Clock::now());
+            step_count = number_of_steps;
+        }
+
+        /// [(step_name, milliseconds)] for the file read, and each post-processing step enabled by flags
+        [[nodiscard]] std::vector<std::pair<std::string, double>> get_timings(uint flags) const {
+            auto ms = [](Clock::time_point from, Clock::time_point to) { return std::chrono::duration<double, std::milli>(to - from).count(); };
+
+            std::vector<std::pair<std::string, double>> timings{};
+            timings.emplace_back("Read File", ms(start, read_end));
+            if (step_starts.empty()) return timings;
+
+            // Validation happens before the scene is prepared for post-processing
+            timings.emplace_back((flags & aiProcess_ValidateDataStructure) != 0 ? "ValidateDataStructure & Preprocess" : "Preprocess", ms(read_end, step_starts.front()));
+
+            if (step_count != (int) std::size(POST_PROCESS_STEPS) || step_starts.size() != std::size(POST_PROCESS_STEPS) + 1) {
+                // Assimp was built with a different set of steps, so just report the total
+                timings.emplace_back("Post-processing", ms(step_starts.front(), step_starts.back()));
+                return timings;
+            }
+            for (size_t i = 0; i < std::size(POST_PROCESS_STEPS); ++i) {
+                const auto& [name, step_flags] = POST_PROCESS_STEPS[i];
+                if ((flags & step_flags) == 0) continue;
+                timings.emplace_back(name, ms(step_starts[i], step_starts[i + 1]));
+            }
+            return timings;
+        }
+    };
+
+    /// An Assimp stream over a file's contents that are already in memory
+    class FileContentsIOStream : public Assimp::IOStream {
+        FileContents contents;
+        size_t position = 0;
+    public:
+        explicit FileContentsIOStream(FileContents contents) : contents(std::move(contents)) {}
+
+        size_t Read(void* buffer, size_t size, size_t count) override {
+            if (size == 0) return 0;
+            count = std::min(count, (contents.get_size() - position) / size);
+            std::memcpy(buffer, contents.get_data() + position, size * count);
+            position += size * count;
+            return count;
+        }
+
+        size_t Write(const void*, size_t, size_t) override {
+            return 0;
+        }
+
+        aiReturn Seek(size_t offset, aiOrigin origin) override {
+            size_t base = origin == aiOrigin_CUR ? position : origin == aiOrigin_END ? contents.get_size() : 0;
+            if (origin == aiOrigin_END ? offset > base : offset > contents.get_size() - base) return aiReturn_FAILURE;
+            position = origin == aiOrigin_END ? base - offset : base + offset;
+            return aiReturn_SUCCESS;
+        }
+
+        [[nodiscard]] size_t Tell() const override {
+            return position;
+        }
+
+        [[nodiscard]] size_t FileSize() const override {
+            return contents.get_size();
+        }
+
+        void Flush() override {}
+    };
+
+    /// Serves files out of the asset pack to Assimp, including the ones a model references (like a .gltf's buffers),
+    /// unless the loose file is newer, in which case it is opened from disk as normal
+    class AssetPackIOSystem : public Assimp::DefaultIOSystem {
+        const AssetPack& asset_pack;
+
+        [[nodiscard]] const AssetPack::Entry* find_packed(const std::string& path) const {
+            const auto* entry = asset_pack.find(path);
+            if (entry == nullptr) return nullptr;
+            std::error_code error;
+            auto loose_write_time = std::filesystem::last_write_time(path, error);
+            return !error && loose_write_time > entry->last_write_time ? nullptr : entry;
+        }
+
+        /// Pack paths always use forward slashes, and Assimp joins referenced files with the OS separator
+        static std::string normalise(const char* file) {
+            std::string path = file;
+            std::replace(path.begin(), path.end(), '\\', '/');
+            return path.compare(0, 2, "./") == 0 ? path.substr(2) : path;
+        }
+    public:
+        explicit AssetPackIOSystem(const AssetPack& asset_pack) : asset_pack(asset_pack) {}
+
+        bool Exists(const char* file) const override {
+            return find_packed(normalise(file)) != nullptr || DefaultIOSystem::Exists(file);
+        }
+
+        Assimp::IOStream* Open(const char* file, const char* mode) override {
+            std::string path = normalise(file);
+            bool read_only = std::strpbrk(mode, "wa+") == nullptr;
+            if (read_only && find_packed(path) != nullptr) {
+                return new FileContentsIOStream(asset_pack.read(path));
+            }
+            return DefaultIOSystem::Open(file, mode);
+        }
+    };
+}
+
+ModelLoader::ModelLoader(std::string import_path, AssetBudget& asset_budget, std::string cache_path) : import_path(std::move(import_path)), cache_path(std::move(cache_path)), asset_budget(asset_budget), file_watcher(this->import_path), asset_pack(AssetPack::shared()) {
+    if (asset_pack != nullptr) {
+        // The importer takes ownership of the handler
+        importer.SetIOHandler(new AssetPackIOSystem(*asset_pack));
+    }
+}
+
 const std::vector<std::string>& ModelLoader::get_available_models(bool force_refresh) {
     if (!force_refresh && available_models.has_value()) {
         return available_models.value();
     }
-    available_models = std::vector<std::string>{};
-
-    for (auto const& dir_entry: std::filesystem::recursive_directory_iterator(import_path)) {
-        available_models->push_back(std::filesystem::relative(dir_entry, import_path).string());
+    // The watcher keeps the listing up-to-date, so there is no need to rescan the directory
+    available_models_version = file_watcher.get_listing_version();
+    available_models = file_watcher.list_files();
+    if (asset_pack != nullptr) {
+        auto packed = asset_pack->list(import_path);
+        std::vector<std::string> merged{};
+        std::set_union(available_models->begin(), available_models->end(), packed.begin(), packed.end(), std::back_inserter(merged));
+        available_models = std::move(merged);
     }
-    std::sort(available_models.value().begin(), available_models.value().end());
 
     return available_models.value();
-}
\ No newline at end of file
+}
+
+void ModelLoader::update() {
+    for (const auto& file: file_watcher.poll_changes()) {
+        if (!file_watcher.get_last_write_time(file).has_value()) continue; // Deleted, existing handles just keep the old version
+
+        for (auto* reimporter_map: {&reimporters, &hierarchy_reimporters}) {
+            for (const auto& [key, reimport]: *reimporter_map) {
+                if (std::get<0>(key) != file) continue;
+                try {
+                    reimport();
+                    std::cout << "Reloaded model: [" << file << "]" << std::endl;
+                } catch (const std::exception& e) {
+                    std::cerr << "Error while trying to reload model file:" << std::endl;
+                    std::cerr << e.what() << std::endl;
+                }
+            }
+        }
+    }
+
+    if (file_watcher.get_listing_version() != available_models_version) {
+        available_models.reset();
+    }
+}
+
+std::filesystem::file_time_type ModelLoader::get_last_write_time(const std::string& file) const {
+    auto last_write_time = file_watcher.get_last_write_time(file);
+    const auto* packed = asset_pack != nullptr ? asset_pack->find(import_path + "/" + file) : nullptr;
+    if (packed != nullptr && (!last_write_time.has_value() || packed->last_write_time > last_write_time.value())) {
+        return packed->last_write_time;
+    }
+    if (!last_write_time.has_value()) {
+        throw std::runtime_error(Formatter() << "Failed to load model (" << import_path << "/" << file << "): \n\t File does not exist");
+    }
+    return last_write_time.value();
+}
+
+const AssetPack::Entry* ModelLoader::find_packed(const std::string& file) const {
+    if (asset_pack == nullptr) return nullptr;
+    const auto* packed = asset_pack->find(import_path + "/" + file);
+    if (packed == nullptr) return nullptr;
+    auto loose_write_time = file_watcher.get_last_write_time(file);
+    return loose_write_time.has_value() && loose_write_time.value() > packed->last_write_time ? nullptr : packed;
+}
+
+FileContents ModelLoader::read_file(const std::string& file) const {
+    if (find_packed(file) != nullptr) {
+        return asset_pack->read(import_path + "/" + file);
+    }
+    return FileContents::map(import_path + "/" + file);
+}
+
+bool ModelLoader::has_extension(const std::string& file, const std::string& extension) {
+    auto file_extension = std::filesystem::path(file).extension().string();
+    std::transform(file_extension.begin(), file_extension.end(), file_extension.begin(), [](unsigned char c) { return (char) std::tolower(c); });
+    return file_extension == extension;
+}
+
+glm::mat3 ModelLoader::calculate_normal_matrix(const glm::mat4& transform) {
+    // Calculate a normal matrix so that non-uniform scale transformations properly transform normals
+    // See: https://github.com/graphitemaster/normals_revisited
+    // and: https://gist.github.com/shakesoda/8485880f71010b79bc8fed0f166dabac
+    return glm::mat3(
+        glm::cross(glm::vec3(transform[1]), glm::vec3(transform[2])),
+        glm::cross(glm::vec3(transform[2]), glm::vec3(transform[0])),
+        glm::cross(glm::vec3(transform[0]), glm::vec3(transform[1]))
+    );
+}
+
+void ModelLoader::set_use_fast_obj_parser(bool enabled) {
+    use_fast_obj_parser = enabled;
+}
+
+bool ModelLoader::get_use_fast_obj_parser() const {
+    return use_fast_obj_parser;
+}
+
+void ModelLoader::set_use_fast_glb_loader(bool enabled) {
+    use_fast_glb_loader = enabled;
+}
+
+bool ModelLoader::get_use_fast_glb_loader() const {
+    return use_fast_glb_loader;
+}
+
+void ModelLoader::set_use_mesh_cache(bool enabled) {
+    use_mesh_cache = enabled;
+}
+
+bool ModelLoader::get_use_mesh_cache() const {
+    return use_mesh_cache;
+}
+
+void ModelLoader::set_compress_animations(bool enabled) {
+    compress_animations = enabled;
+}
+
+bool ModelLoader::get_compress_animations() const {
+    return compress_animations;
+}
+
+void ModelLoader::set_animation_compression(const AnimationCompressionSettings& settings) {
+    animation_compression = settings;
+}
+
+const AnimationCompressionSettings& ModelLoader::get_animation_compression() const {
+    return animation_compression;
+}
+
+std::vector<AnimationClip> ModelLoader::read_animations(const std::string& file) {
+    // No post-processing, since the meshes aren't used, and files with only animations are flagged as incomplete, so that is allowed
+    const aiScene* scene = importer.ReadFile(import_path + "/" + file, 0);
+    if (!scene) {
+        throw std::runtime_error(Formatter() << "Failed to read animations (" << file << "): \n\t" << importer.GetErrorString());
+    }
+
+    std::vector<AnimationClip> clips{};
+    for (auto animation_i = 0u; animation_i < scene->mNumAnimations; ++animation_i) {
+        const auto* animation = scene->mAnimations[animation_i];
+        std::string name = animation->mName.C_Str();
+        // The same defaults as for hierarchies
+        auto& clip = clips.emplace_back(AnimationClip{
+            name.empty() ? Formatter() << "[Unnamed] (" << animation_i << ")" : name,
+            animation->mTicksPerSecond == 0.0 ? 1.0 : animation->mTicksPerSecond,
+            animation->mDuration,
+            {}
+        });
+        for (auto channel_i = 0u; channel_i < animation->mNumChannels; ++channel_i) {
+            const auto* node_animation = animation->mChannels[channel_i];
+            read_node_animation(node_animation, clip.channels.emplace_back(node_animation->mNodeName.C_Str(), AnimationData{}).second);
+        }
+    }
+
+    importer.FreeScene();
+    return clips;
+}
+
+void ModelLoader::read_node_animation(const aiNodeAnim* node_animation, AnimationData& animation_data) {
+    for (auto i = 0u; i < node_animation->mNumPositionKeys; ++i) {
+        const auto& key = node_animation->mPositionKeys[i];
+        animation_data.positions.set_key((float) key.mTime, glm::vec3{key.mValue.x, key.mValue.y, key.mValue.z});
+    }
+    for (auto i = 0u; i < node_animation->mNumRotationKeys; ++i) {
+        const auto& key = node_animation->mRotationKeys[i];
+        animation_data.rotations.set_key((float) key.mTime, glm::quat{key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z});
+    }
+    for (auto i = 0u; i < node_animation->mNumScalingKeys; ++i) {
+        const auto& key = node_animation->mScalingKeys[i];
+        animation_data.scalings.set_key((float) key.mTime, glm::vec3{key.mValue.x, key.mValue.y, key.mValue.z});
+    }
+}
+
+void ModelLoader::set_default_import_profile(ImportProfile profile) {
+    default_import_profile = profile;
+}
+
+ImportProfile ModelLoader::get_default_import_profile() const {
+    return default_import_profile;
+}
+
+void ModelLoader::add_imgui_options_section() {
+    if (ImGui::CollapsingHeader("Model Loader")) {
+        ImGui::Checkbox("Fast OBJ Parser", &use_fast_obj_parser);
+        ImGui::SameLine();
+        ImGui::HelpMarker("Load .obj files with a dedicated multi-threaded parser instead of Assimp. Files without normals, and models using an import profile other than Fast, still go through Assimp so that it can do the post-processing. Only applies to models loaded after changing it.");
+        ImGui::Checkbox("Fast glTF Binary Loader", &use_fast_glb_loader);
+        ImGui::SameLine();
+        ImGui::HelpMarker("Load .glb files by reading their vertex data straight from the memory mapped file instead of through Assimp. Draco compressed meshes are decoded in parallel. Files that need something it doesn't support, like other required extensions, and models using an import profile other than Fast, still go through Assimp. Only applies to models loaded after changing it.");
+        ImGui::Checkbox("Mesh Cache", &use_mesh_cache);
+        ImGui::SameLine();
+        ImGui::HelpMarker("Cache imported models on disk, flattened and with their triangles reordered for the GPU's vertex cache, so that they only go through Assimp once. Each import profile has its own cache entry. The asset baker fills the cache ahead of time. Only applies to models loaded after changing it.");
+        ImGui::Checkbox("Compress Animations", &compress_animations);
+        ImGui::SameLine();
+        ImGui::HelpMarker("Store animation keys quantised to 16 bits, with quaternions as their smallest three components, dropping constant tracks and any keys that interpolating their neighbours reproduces within the tolerances. Keys are decompressed as they are sampled. Run cits3003_animation_report to see the ratio per clip. Only applies to models loaded after changing it.");
+        if (compress_animations) {
+            ImGui::DragFloat("Position Tolerance", &animation_compression.position_tolerance, 0.0001f, 0.0f, 1.0f, "%.4f");
+            ImGui::DragFloat("Rotation Tolerance (rad)", &animation_compression.rotation_tolerance, 0.0001f, 0.0f, 0.1f, "%.4f");
+            ImGui::DragFloat("Scaling Tolerance", &animation_compression.scaling_tolerance, 0.0001f, 0.0f, 0.1f, "%.4f");
+        }
+
+        if (ImGui::BeginCombo("Default Import Profile", ImportProfiles::name(default_import_profile))) {
+            for (auto profile: ImportProfiles::ALL) {
+                if (ImGui::Selectable(ImportProfiles::name(profile), profile == default_import_profile)) {
+                    default_import_profile = profile;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::SameLine();
+        ImGui::HelpMarker("The Assimp post-processing used for models that are selected for the first time. Changing model keeps the profile of the previous model, and scene files store the profile of each model. Only the Fast profile can use the fast OBJ and glTF binary loaders, and standalone Draco files are always decoded as is.");
+
+        if (!last_import_timings.empty() && ImGui::TreeNode("Last Import Timings")) {
+            double total_ms = 0.0;
+            for (const auto& [_, ms]: last_import_timings) total_ms += ms;
+            ImGui::Text("%s (%s): %.2f ms", last_import_file.c_str(), ImportProfiles::name(last_import_profile), total_ms);
+            if (!last_import_fallback.empty()) {
+                ImGui::TextWrapped("Loaded with Assimp, as the glTF binary loader does not support %s", last_import_fallback.c_str());
+            }
+            for (const auto& [step, ms]: last_import_timings) {
+                ImGui::Text("%-26s %8.2f ms", step.c_str(), ms);
+            }
+            ImGui::TreePop();
+        }
+    }
+}
+
+std::filesystem::path ModelLoader::mesh_cache_file(const std::string& file, ImportProfile profile) const {
+    std::string profile_name = ImportProfiles::name(profile);
+    profile_name.erase(std::remove(profile_name.begin(), profile_name.end(), ' '), profile_name.end());
+    return (Formatter() << cache_path << "/" << file << "." << profile_name << ".mesh").str();
+}
+
+BakedMesh ModelLoader::bake_scene(const aiScene* scene, const std::string& file) {
+    BakedMesh baked_mesh{};
+    baked_mesh.has_normals = true;
+    baked_mesh.has_tex_coords = true;
+    auto triangle_meshes = 0;
+    for (auto i = 0u; i < scene->mNumMeshes; ++i) {
+        const auto* mesh = scene->mMeshes[i];
+        if ((mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) == 0) continue;
+        triangle_meshes++;
+        baked_mesh.has_normals &= mesh->HasNormals();
+        baked_mesh.has_tex_coords &= mesh->HasTextureCoords(0);
+    }
+    if (triangle_meshes == 0) {
+        throw std::runtime_error(Formatter() << "Failed to load model (" << file << "): \n\t" << "No triangle meshes");
+    }
+
+    convert_scene(scene, baked_mesh.vertices, baked_mesh.indices);
+    MeshCache::optimise_vertex_cache(baked_mesh.indices, baked_mesh.vertices.size());
+    return baked_mesh;
+}
+
+std::optional<BakedMesh> ModelLoader::bake_model(const std::string& file, ImportProfile profile) const {
+    if (has_extension(file, ".drc")) return std::nullopt;
+    auto source_time = (int64_t) get_last_write_time(file).time_since_epoch().count();
+
+    // The loader's importer can only be used by one thread at a time, so each bake gets its own
+    Assimp::Importer baking_importer{};
+    if (asset_pack != nullptr) {
+        baking_importer.SetIOHandler(new AssetPackIOSystem(*asset_pack));
+    }
+    const aiScene* scene = baking_importer.ReadFile(import_path + "/" + file, ImportProfiles::post_process_flags(profile));
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        throw std::runtime_error(Formatter() << "Failed to load model (" << file << "): \n\t" << baking_importer.GetErrorString());
+    }
+
+    auto baked_mesh = bake_scene(scene, file);
+    MeshCache::write_cache(mesh_cache_file(file, profile), source_time, baked_mesh);
+    return baked_mesh;
+}
+
+const aiScene* ModelLoader::read_scene(const std::string& file, ImportProfile profile) {
+    // The importer takes ownership of the timer, replacing the previous one
+    auto* step_timer = new ImportStepTimer();
+    importer.SetProgressHandler(step_timer);
+
+    uint flags = ImportProfiles::post_process_flags(profile);
+    const aiScene* scene = importer.ReadFile(import_path + "/" + file, flags);
+
+    last_import_file = file;
+    last_import_profile = profile;
+    last_import_timings = step_timer->get_timings(flags);
+    last_import_fallback = std::exchange(glb_fallback, {});
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        throw std::runtime_error(Formatter() << "Failed to load model (" << file << "): \n\t" << importer.GetErrorString());
+    }
+
+    return scene;
+}
+
+void ModelLoader::flatten_node(const aiScene* scene, const aiNode* node, glm::mat4 parent_transform, std::vector<MeshInstance>& mesh_instances, size_t& vertex_count, size_t& index_count) {
+    glm::mat4 node_transform;
+    {
+        auto node_transform_ai = node->mTransformation;
+        node_transform = reinterpret_cast<glm::mat4&>(node_transform_ai.Transpose());
+    }
+
+    // Post-multiply by node_transform since it is relative to parent and should be applied before it.
+    glm::mat4 total_transform = parent_transform * node_transform;
+    glm::mat3 normal_matrix = calculate_normal_matrix(total_transform);
+
+    for (auto mesh_i = 0u; mesh_i < node->mNumMeshes; ++mesh_i) {
+        const auto mesh = scene->mMeshes[node->mMeshes[mesh_i]];
+        if ((mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) == 0) continue;
+
+        bool triangles_only = mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE;
+        mesh_instances.push_back(MeshInstance{mesh, total_transform, normal_matrix, vertex_count, index_count, triangles_only});
+
+        vertex_count += mesh->mNumVertices;
+        if (triangles_only) {
+            // Only triangles, so no need to look at each face
+            index_count += (size_t) mesh->mNumFaces * 3;
+        } else {
+            for (auto i = 0u; i < mesh->mNumFaces; ++i) {
+                index_count += mesh->mFaces[i].mNumIndices;
+            }
+        }
+    }
+
+    for (auto i = 0u; i < node->mNumChildren; ++i) {
+        flatten_node(scene, node->mChildren[i], total_transform, mesh_instances, vertex_count, index_count);
+    }
+}
+
+VertexStream ModelLoader::make_vertex_stream(const aiMesh* mesh) {
+    VertexStream vertex_stream{};
+    vertex_stream.count = mesh->mNumVertices;
+    vertex_stream.positions = mesh->mVertices;
+    vertex_stream.normals = mesh->mNormals;
+    // Assimp stores texture coordinates as 3 component vectors
+    if (mesh->mTextureCoords[0] != nullptr) {
+        vertex_stream.tex_coords = StridedView<glm::vec2>(mesh->mTextureCoords[0], sizeof(aiVector3D));
+    }
+    return vertex_stream;
+}
+
+VertexStream VertexStream::subrange(size_t begin, size_t sub_count) const {
+    auto offset = [begin](auto view) {
+        if (!view.empty()) view.data += begin * view.stride;
+        return view;
+    };
+
+    VertexStream stream = *this;
+    stream.count = sub_count;
+    stream.positions = offset(positions);
+    stream.normals = offset(normals);
+    stream.tex_coords = offset(tex_coords);
+    stream.bones = offset(bones);
+    return stream;
+}
@@ -3,12 +3,15 @@
 
 #include <map>
 #include <set>
+#include <cstring>
 #include <utility>
 #include <vector>
 #include <memory>
 #include <iostream>
+#include <tuple>
 #include <string>
 #include <typeindex>
+#include <type_traits>
 #include <filesystem>
 #include <unordered_set>
 
@@ -17,46 +20,160 @@
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <assimp/ProgressHandler.hpp>
 
 #include <imgui/imgui.h>
 
 #include "ModelHandle.h"
 #include "MeshHierarchy.h"
+#include "AssetBudget.h"
+#include "ImportProfile.h"
+#include "utility/FileWatcher.h"
+#include "utility/ThreadPool.h"
+#include "utility/AssetPack.h"
+#include "utility/FileContents.h"
+#include "VertexCollection.h"
+#include "ObjParser.h"
+#include "GlbFile.h"
+#include "DracoDecoder.h"
+#include "MeshCache.h"
+
+/// A non-owning view over an array of T, where consecutive elements are `stride` bytes apart.
+/// Lets vertex attributes be read straight out of the importer's (or a file's) arrays without copying them first.
+template<typename T>
+struct StridedView {
+    const unsigned char* data = nullptr;
+    size_t stride = sizeof(T);
+
+    StridedView() = default;
+    StridedView(const void* data, size_t stride = sizeof(T)) : data(static_cast<const unsigned char*>(data)), stride(stride) {} // NOLINT(google-explicit-constructor)
+
+    [[nodiscard]] bool empty() const { return data == nullptr; }
+
+    T operator[](size_t i) const {
+        const unsigned char* element = data + i * stride;
+        T value;
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            std::memcpy(&value, element, sizeof(T));
+        } else {
+            // A std::pair isn't trivially copyable, so each of its members is read on its own, laid out one after the other
+            static_assert(sizeof(T) == sizeof(value.first) + sizeof(value.second), "StridedView pairs must not have padding between their members");
+            std::memcpy(&value.first, element, sizeof(value.first));
+            std::memcpy(&value.second, element + sizeof(value.first), sizeof(value.second));
+        }
+        return value;
+    }
+};
+
+/// A view over the vertex attributes of a single mesh, along with the transform to apply to them while converting.
+/// Used by VertexData::from_stream to transform and interleave in a single pass, straight into the output buffer.
+struct VertexStream {
+    size_t count = 0;
+    StridedView<glm::vec3> positions{};
+    StridedView<glm::vec3> normals{};
+    StridedView<glm::vec2> tex_coords{};
+    // (bone_weights, bone_indices)
+    StridedView<std::pair<glm::vec4, glm::uvec4>> bones{};
+
+    glm::mat4 transform{1.0f};
+    glm::mat3 normal_matrix{1.0f};
+    // Texture coordinates are stored as (u, 1 - v), for formats with the origin at the top left, like glTF
+    bool flip_tex_coords = false;
+
+    /// A view over `sub_count` vertices starting at `begin`, with the same transform
+    [[nodiscard]] VertexStream subrange(size_t begin, size_t sub_count) const;
+};
 
-struct VertexCollection {
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> tex_coords;
-    // [(bone_weights, bone_indices)]
-    std::vector<std::pair<glm::vec4, glm::uvec4>> bones;
+/// A mesh referenced by a node of the scene, with everything needed to convert it independently of the others.
+struct MeshInstance {
+    const aiMesh* mesh;
+    glm::mat4 transform;
+    glm::mat3 normal_matrix;
+    // Where the mesh's vertices and indices start in the output buffers
+    size_t vertex_offset;
+    size_t index_offset;
+    // If every face is a triangle, then the index offset of any face can be calculated directly
+    bool triangles_only;
+};
+
+/// A clip read on its own by ModelLoader::read_animations()
+struct AnimationClip {
+    std::string name;
+    double ticks_per_second;
+    double duration_ticks;
+    // [(node_name, keys)]
+    std::vector<std::pair<std::string, AnimationData>> channels;
 };
 
 /// A loader class intended for the use of loading models from disk. Includes caching functionality.
 class ModelLoader {
     std::string import_path;
+    std::string cache_path;
+    AssetBudget& asset_budget;
+    FileWatcher file_watcher;
+    // Files in the pack are read from it instead of from disk, unless the loose file is newer
+    const AssetPack* asset_pack;
     Assimp::Importer importer{};
 
     std::optional<std::vector<std::string>> available_models{};
-
-    // Map (relative_path, vertex_type) -> (last_modified, weak_handle)
-    std::unordered_map<std::pair<std::string, std::type_index>, std::pair<std::filesystem::file_time_type, std::weak_ptr<BaseModelHandle>>, PairHash> cache{};
-    std::unordered_map<std::pair<std::string, std::type_index>, std::pair<std::filesystem::file_time_type, std::weak_ptr<BaseMeshHierarchy>>, PairHash> hierarchy_cache{};
+    uint64_t available_models_version = 0;
+
+    bool use_fast_obj_parser = true;
+    bool use_fast_glb_loader = true;
+    bool use_mesh_cache = true;
+    bool compress_animations = false;
+    AnimationCompressionSettings animation_compression{};
+    ImportProfile default_import_profile = ImportProfile::MaxQuality;
+
+    // The time taken by each step of the last import that went through Assimp
+    std::string last_import_file{};
+    ImportProfile last_import_profile = ImportProfile::MaxQuality;
+    // [(step_name, milliseconds)]
+    std::vector<std::pair<std::string, double>> last_import_timings{};
+    // Why the last import went through Assimp rather than the fast glTF binary loader, if it was a .glb file it didn't support
+    std::string last_import_fallback{};
+    // What the fast glTF binary loader didn't support in the file it just passed on to Assimp, until read_scene records it
+    std::string glb_fallback{};
+
+    // Map (relative_path, vertex_type, import_profile) -> (last_modified, weak_handle)
+    std::unordered_map<std::tuple<std::string, std::type_index, ImportProfile>, std::pair<std::filesystem::file_time_type, std::weak_ptr<BaseModelHandle>>, TripleHash> cache{};
+    std::unordered_map<std::tuple<std::string, std::type_index, ImportProfile>, std::pair<std::filesystem::file_time_type, std::weak_ptr<BaseMeshHierarchy>>, TripleHash> hierarchy_cache{};
+    // Map (relative_path, vertex_type, import_profile) -> function to re-import any live handle in place, since the vertex type is erased in the caches
+    std::unordered_map<std::tuple<std::string, std::type_index, ImportProfile>, std::function<void()>, TripleHash> reimporters{};
+    std::unordered_map<std::tuple<std::string, std::type_index, ImportProfile>, std::function<void()>, TripleHash> hierarchy_reimporters{};
 public:
     /// Construct the loader with a import_path which is prepended to any path you try and load.
-    /// It also scans the directory for all files, which is used to populate the list of get_available_models()
-    explicit ModelLoader(std::string import_path) : import_path(std::move(import_path)) {}
+    /// It also scans the directory for all files, which along with any files under import_path in the AssetPack, is used to populate the list of get_available_models()
+    /// Every model loaded from file is tracked by the asset_budget, and models imported through Assimp are cached on disk under cache_path.
+    ModelLoader(std::string import_path, AssetBudget& asset_budget, std::string cache_path = "cache/models");
 
-    /// Loads the provided model data into GPU memory
+    /// Loads the provided model data into GPU memory, on the UploadThread if there is an active one
     template<typename VertexData>
     static std::shared_ptr<ModelHandle<VertexData>> load_from_data(const std::vector<VertexData>& vertices, const std::vector<uint>& indices, std::optional<std::string> filename = {});
+    /// Loads the provided model data into GPU memory, from anywhere in memory, such as a memory mapped file
+    template<typename VertexData>
+    static std::shared_ptr<ModelHandle<VertexData>> load_from_data(const VertexData* vertices, size_t vertex_count, const uint* indices, size_t index_count, std::optional<std::string> filename = {});
+
+    /// Loads the file specified from disk into GPU memory, post-processing it according to the profile,
+    /// or the default import profile if none is given
+    template<typename VertexData>
+    std::shared_ptr<ModelHandle<VertexData>> load_from_file(const std::string& file, std::optional<ImportProfile> profile = std::nullopt);
 
-    /// Loads the file specified from disk into GPU memory
+    /// Convert every triangle mesh in the scene into a single mesh, with the node transforms applied.
     template<typename VertexData>
-    std::shared_ptr<ModelHandle<VertexData>> load_from_file(const std::string& file);
+    static void convert_scene(const aiScene* scene, std::vector<VertexData>& vertices, std::vector<uint>& indices);
+
+    /// Create a view over the attributes of the mesh
+    static VertexStream make_vertex_stream(const aiMesh* mesh);
+
+    /// Convert all the vertices in the stream, in parallel blocks
+    template<typename VertexData>
+    static void convert_stream(const VertexStream& stream, std::vector<VertexData>& vertices);
 
     /// Load the file specified, as a hierarchy of meshes, for use with animated models.
+    /// Post-processed according to the profile, or the default import profile if none is given
     template<typename VertexData>
-    std::shared_ptr<MeshHierarchy<VertexData>> load_hierarchy_from_file(const std::string& file);
+    std::shared_ptr<MeshHierarchy<VertexData>> load_hierarchy_from_file(const std::string& file, std::optional<ImportProfile> profile = std::nullopt);
 
     /// Helper method to provide a selector over all the model files in the import_path directory.
     template<typename VertexData>
@@ -67,19 +184,129 @@ public:
     bool add_imgui_hierarchy_selector(const std::string& caption, std::shared_ptr<MeshHierarchy<VertexData>>& mesh_hierarchy);
 
     /// Helper method to provide a selector over all the model files in the import_path directory.
-    /// if force_refresh is selected, it will rescan the directory, otherwise it just uses a cached list from the last scan.
+    /// The list is kept up-to-date by a file watcher, force_refresh just rebuilds it from the watcher's index.
     const std::vector<std::string>& get_available_models(bool force_refresh = false);
 
+    /// Re-import any loaded models and hierarchies whose files have changed on disk, in place, so existing handles pick up the change.
+    /// Should be called once per frame.
+    void update();
+
+    /// When enabled, .obj files are loaded with the ObjParser rather than Assimp, unless they need Assimp's post-processing.
+    void set_use_fast_obj_parser(bool enabled);
+    [[nodiscard]] bool get_use_fast_obj_parser() const;
+
+    /// When enabled, .glb files are loaded with the GlbFile loader rather than Assimp, unless they use something it doesn't support.
+    void set_use_fast_glb_loader(bool enabled);
+    [[nodiscard]] bool get_use_fast_glb_loader() const;
+
+    /// When enabled, imported models are flattened into the mesh cache, and loaded from there while the file is unchanged.
+    /// Standalone Draco files skip the cache, as decoding them is already quick.
+    void set_use_mesh_cache(bool enabled);
+    [[nodiscard]] bool get_use_mesh_cache() const;
+
+    /// Import the file the same way load_from_file would, but only on the CPU, and write the result to the mesh cache.
+    /// Uses its own importer, so unlike the rest of the loader it is safe to call from many threads at once, which the offline asset baker does.
+    /// Returns the baked mesh, or std::nullopt for files that don't use the mesh cache.
+    std::optional<BakedMesh> bake_model(const std::string& file, ImportProfile profile) const;
+
+    /// When enabled, the keys of loaded hierarchies' animations are compressed, see CompressedTrack
+    void set_compress_animations(bool enabled);
+    [[nodiscard]] bool get_compress_animations() const;
+    void set_animation_compression(const AnimationCompressionSettings& settings);
+    [[nodiscard]] const AnimationCompressionSettings& get_animation_compression() const;
+
+    /// Read just the animations of the file through Assimp, without loading any meshes, so it needs no OpenGL context.
+    /// Used to inspect animation data offline, such as by the animation report tool.
+    std::vector<AnimationClip> read_animations(const std::string& file);
+
+    /// The profile used by loads that don't ask for one, including models selected through ImGUI for the first time
+    void set_default_import_profile(ImportProfile profile);
+    [[nodiscard]] ImportProfile get_default_import_profile() const;
+
+    /// Adds the ImGUI controls for the loader settings
+    void add_imgui_options_section();
+
     /// Free up any resources.
     void cleanup() {}
 
 private:
+    /// The modification time of the file from the watcher's index or the asset pack, whichever is newer, throws if the file does not exist
+    std::filesystem::file_time_type get_last_write_time(const std::string& file) const;
+    /// The asset pack's entry for the file, if it should be read from there, since the loose file is missing or isn't newer than the packed copy
+    const AssetPack::Entry* find_packed(const std::string& file) const;
+    /// The contents of the file, out of the asset pack if it has an up-to-date copy, otherwise memory mapped from disk
+    FileContents read_file(const std::string& file) const;
+    /// Case-insensitive check of the file's extension, which should include the dot
+    static bool has_extension(const std::string& file, const std::string& extension);
+    static glm::mat3 calculate_normal_matrix(const glm::mat4& transform);
+
+    /// Where the flattened model is cached, as each profile gives a different result they are cached separately
+    std::filesystem::path mesh_cache_file(const std::string& file, ImportProfile profile) const;
+    /// Flatten the scene into a BakedMesh, with the triangles reordered for the vertex cache, throws if it has no triangle meshes
+    static BakedMesh bake_scene(const aiScene* scene, const std::string& file);
+    /// Copy the keys of one channel of an Assimp animation
+    static void read_node_animation(const aiNodeAnim* node_animation, AnimationData& animation_data);
+
+    /// Read the file with Assimp, post-processing it according to the profile and recording how long each step takes.
+    /// Throws if the import fails, otherwise the scene stays owned by the importer until it is freed.
+    const aiScene* read_scene(const std::string& file, ImportProfile profile);
+
+    /// Read and upload the file, without touching the cache
+    template<typename VertexData>
+    std::shared_ptr<ModelHandle<VertexData>> import_model(const std::string& file, ImportProfile profile);
+    template<typename VertexData>
+    std::shared_ptr<MeshHierarchy<VertexData>> import_hierarchy(const std::string& file, ImportProfile profile);
+
+    /// Build the model or hierarchy from an already parsed glTF binary file, without going through Assimp
+    template<typename VertexData>
+    static std::shared_ptr<ModelHandle<VertexData>> import_glb_model(const GlbFile& glb, const std::string& file);
+    template<typename VertexData>
+    static std::shared_ptr<MeshHierarchy<VertexData>> import_glb_hierarchy(const GlbFile& glb, const std::string& file);
+
+    /// Import the file again, and swap the result into the cached handle if it is still alive
+    template<typename VertexData>
+    void reimport_model(const std::string& file, ImportProfile profile);
     template<typename VertexData>
-    static void load_node(const aiScene* scene, const aiNode* node, std::vector<VertexData>& vertices, std::vector<uint>& indices, glm::mat4 parent_transform);
+    void reimport_hierarchy(const std::string& file, ImportProfile profile);
+
+    /// Walk the node tree, collecting every triangle mesh with its accumulated transform and where its output goes,
+    /// and totalling the vertices and indices so the output can be allocated once
+    static void flatten_node(const aiScene* scene, const aiNode* node, glm::mat4 parent_transform, std::vector<MeshInstance>& mesh_instances, size_t& vertex_count, size_t& index_count);
+    /// Transform and convert vertices [vertex_begin, vertex_end) and faces [face_begin, face_end) of the mesh into its range of the outputs
+    template<typename VertexData>
+    static void convert_mesh(const MeshInstance& mesh_instance, size_t vertex_begin, size_t vertex_end, size_t face_begin, size_t face_end, VertexData* vertices, uint* indices);
 };
 
 template<typename VertexData>
 std::shared_ptr<ModelHandle<VertexData>> ModelLoader::load_from_data(const std::vector<VertexData>& vertices, const std::vector<uint>& indices, std::optional<std::string> filename) {
+    return load_from_data(vertices.data(), vertices.size(), indices.data(), indices.size(), std::move(filename));
+}
+
+template<typename VertexData>
+std::shared_ptr<ModelHandle<VertexData>> ModelLoader::load_from_data(const VertexData* vertices, size_t vertex_count, const uint* indices, size_t index_count, std::optional<std::string> filename) {
+    size_t gpu_bytes = sizeof(VertexData) * vertex_count + sizeof(uint) * index_count;
+
+    if (auto* upload_thread = UploadThread::active()) {
+        uint buffers[2];
+        glGenBuffers(2, buffers);
+        uint vertex_vbo = buffers[0];
+        uint index_vbo = buffers[1];
+
+        // Copied, since the caller's data only has to live until this returns. The copy is far cheaper than the driver's side of glBufferData.
+        std::vector<VertexData> vertex_data(vertices, vertices + vertex_count);
+        std::vector<uint> index_data(indices, indices + index_count);
+        auto pending_upload = upload_thread->submit([vertex_vbo, index_vbo, vertex_data = std::move(vertex_data), index_data = std::move(index_data)]() {
+            // GL_COPY_WRITE_BUFFER rather than GL_ELEMENT_ARRAY_BUFFER, since that binding needs a VAO, which the upload context doesn't have
+            glBindBuffer(GL_COPY_WRITE_BUFFER, vertex_vbo);
+            glBufferData(GL_COPY_WRITE_BUFFER, (long) (sizeof(VertexData) * vertex_data.size()), vertex_data.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, index_vbo);
+            glBufferData(GL_COPY_WRITE_BUFFER, (long) (sizeof(uint) * index_data.size()), index_data.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }, gpu_bytes);
+
+        return std::make_shared<ModelHandle<VertexData>>(vertex_vbo, index_vbo, std::move(pending_upload), (int) index_count, std::move(filename), gpu_bytes);
+    }
+
     uint vao;
     glGenVertexArrays(1, &vao);
     glBindVertexArray(vao);
@@ -87,29 +314,26 @@ std::shared_ptr<ModelHandle<VertexData>> ModelLoader::load_from_data(const std::
     uint vertex_vbo;
     glGenBuffers(1, &vertex_vbo);
     glBindBuffer(GL_ARRAY_BUFFER, vertex_vbo);
-    glBufferData(GL_ARRAY_BUFFER, (long) (sizeof(VertexData) * vertices.size()), vertices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, (long) (sizeof(VertexData) * vertex_count), vertices, GL_STATIC_DRAW);
     VertexData::setup_attrib_pointers();
 
     uint index_vbo;
     glGenBuffers(1, &index_vbo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_vbo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (long) (sizeof(uint) * indices.size()), indices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (long) (sizeof(uint) * index_count), indices, GL_STATIC_DRAW);
 
     glBindVertexArray(0);
 
-    return std::make_shared<ModelHandle<VertexData>>(vertex_vbo, index_vbo, vao, (int) indices.size(), 0, std::move(filename));
+    return std::make_shared<ModelHandle<VertexData>>(vertex_vbo, index_vbo, vao, (int) index_count, 0, std::move(filename), gpu_bytes);
 }
 
 template<typename VertexData>
-std::shared_ptr<ModelHandle<VertexData>> ModelLoader::load_from_file(const std::string& file) {
-    auto path = import_path + "/" + file;
-    if (!std::filesystem::exists(path)) {
-        throw std::runtime_error(Formatter() << "Failed to load model (" << path << "): \n\t File does not exist");
-    }
+std::shared_ptr<ModelHandle<VertexData>> ModelLoader::load_from_file(const std::string& file, std::optional<ImportProfile> profile) {
+    auto last_write_time = get_last_write_time(file);
+    auto import_profile = profile.value_or(default_import_profile);
+    std::tuple key{file, std::type_index(typeid(VertexData)), import_profile};
 
-    auto last_write_time = std::filesystem::last_write_time(path);
-
-    auto existing = cache.find({file, std::type_index(typeid(VertexData))});
+    auto existing = cache.find(key);
     if (existing != cache.end()) {
         // Cache exist, so try lock
         auto handle = existing->second.second.lock();
@@ -119,10 +343,79 @@ std::shared_ptr<ModelHandle<VertexData>> ModelLoader::load_from_file(const std::
         }
     }
 
-    const aiScene* scene = importer.ReadFile(path, aiProcessPreset_TargetRealtime_MaxQuality | aiProcess_TransformUVCoords | aiProcess_SortByPType);
+    auto model = import_model<VertexData>(file, import_profile);
+
+    cache[key] = {last_write_time, model};
+    reimporters[key] = [this, file, import_profile]() { reimport_model<VertexData>(file, import_profile); };
+    asset_budget.track(model, AssetBudget::Kind::Model, file, model->get_gpu_bytes());
 
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        throw std::runtime_error(Formatter() << "Failed to load model (" << file << "): \n\t" << importer.GetErrorString());
+    return model;
+}
+
+template<typename VertexData>
+std::shared_ptr<ModelHandle<VertexData>> ModelLoader::import_model(const std::string& file, ImportProfile profile) {
+    bool can_use_mesh_cache = use_mesh_cache && !has_extension(file, ".drc");
+    auto source_time = (int64_t) get_last_write_time(file).time_since_epoch().count();
+
+    if (can_use_mesh_cache) {
+        auto baked_mesh = MeshCache::read_cache(mesh_cache_file(file, profile), source_time);
+        if (baked_mesh.has_value()) {
+            std::vector<VertexData> vertices{};
+            convert_stream(baked_mesh->vertex_stream(), vertices);
+            auto model = load_from_data(vertices, baked_mesh->indices, file);
+            model->set_import_profile(profile);
+            return model;
+        }
+    }
+
+    bool use_fast_loaders = ImportProfiles::supported_by_fast_loaders(profile);
+    if (use_fast_loaders && use_fast_glb_loader && has_extension(file, ".glb")) {
+        auto glb = GlbFile::open(read_file(file), import_path + "/" + file, &glb_fallback);
+        if (glb != nullptr) {
+            auto model = import_glb_model<VertexData>(*glb, file);
+            model->set_import_profile(profile);
+            return model;
+        }
+        // Otherwise it uses something the loader doesn't support, like a required extension, so fall back to Assimp
+    }
+
+    if (has_extension(file, ".drc")) {
+        // Assimp can't read standalone Draco files, so they always go through the decoder, whatever the profile
+        VertexCollection vertex_collection{};
+        std::vector<uint> indices{};
+        DracoDecoder::decode_file(read_file(file), import_path + "/" + file, vertex_collection, indices);
+        std::vector<VertexData> vertices{};
+        VertexData::from_mesh(vertex_collection, vertices);
+        auto model = load_from_data(vertices, indices, file);
+        model->set_import_profile(profile);
+        return model;
+    }
+
+    if (use_fast_loaders && use_fast_obj_parser && has_extension(file, ".obj")) {
+        auto obj_data = ObjParser::parse_file(read_file(file), import_path + "/" + file);
+        if (obj_data.has_value()) {
+            std::vector<VertexData> vertices{};
+            convert_stream(obj_data->vertex_stream(), vertices);
+            auto model = load_from_data(vertices, obj_data->indices, file);
+            model->set_import_profile(profile);
+            return model;
+        }
+        // Otherwise it needs something the parser doesn't do, like generating normals, so fall back to Assimp
+    }
+
+    const aiScene* scene = read_scene(file, profile);
+
+    if (can_use_mesh_cache) {
+        // Going through the baked mesh costs an extra copy, but means the next load can skip Assimp entirely
+        auto baked_mesh = bake_scene(scene, file);
+        importer.FreeScene();
+        MeshCache::write_cache(mesh_cache_file(file, profile), source_time, baked_mesh);
+
+        std::vector<VertexData> vertices{};
+        convert_stream(baked_mesh.vertex_stream(), vertices);
+        auto model = load_from_data(vertices, baked_mesh.indices, file);
+        model->set_import_profile(profile);
+        return model;
     }
 
     if (scene->mNumMeshes == 0) {
@@ -143,84 +436,184 @@ std::shared_ptr<ModelHandle<VertexData>> ModelLoader::load_from_file(const std::
     std::vector<VertexData> vertices{};
     std::vector<uint> indices{};
 
-    load_node(scene, scene->mRootNode, vertices, indices, glm::mat4{1.0f});
+    convert_scene(scene, vertices, indices);
 
     auto model = load_from_data(vertices, indices, file);
+    model->set_import_profile(profile);
 
     importer.FreeScene();
 
-    cache[{file, std::type_index(typeid(VertexData))}] = {last_write_time, model};
-
     return model;
 }
 
 template<typename VertexData>
-void ModelLoader::load_node(const aiScene* scene, const aiNode* node, std::vector<VertexData>& vertices, std::vector<uint>& indices, glm::mat4 parent_transform) {
-    glm::mat4 node_transform;
-    {
-        auto node_transform_ai = node->mTransformation;
-        node_transform = reinterpret_cast<glm::mat4&>(node_transform_ai.Transpose());
-    }
-
-    // Post-multiply by node_transform since it is relative to parent and should be applied before it.
-    glm::mat4 total_transform = parent_transform * node_transform;
-    // Calculate a normal matrix so that non-uniform scale transformations properly transform normals
-    // See: https://github.com/graphitemaster/normals_revisited
-    // and: https://gist.github.com/shakesoda/8485880f71010b79bc8fed0f166dabac
-    glm::mat3 normal_matrix = glm::mat3(
-        glm::cross(glm::vec3(total_transform[1]), glm::vec3(total_transform[2])),
-        glm::cross(glm::vec3(total_transform[2]), glm::vec3(total_transform[0])),
-        glm::cross(glm::vec3(total_transform[0]), glm::vec3(total_transform[1]))
-    );
+std::shared_ptr<ModelHandle<VertexData>> ModelLoader::import_glb_model(const GlbFile& glb, const std::string& file) {
+    // A primitive referenced by a node of the scene, like a MeshInstance
+    struct PrimitiveInstance {
+        const GlbPrimitive* primitive;
+        glm::mat4 transform;
+        size_t vertex_offset;
+        size_t index_offset;
+    };
 
-    for (auto mesh_i = 0u; mesh_i < node->mNumMeshes; ++mesh_i) {
-        auto index_offset = (uint) vertices.size();
-        const auto mesh = scene->mMeshes[node->mMeshes[mesh_i]];
-        if ((mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) == 0) continue;
+    // First pass flattens the tree, so that every primitive knows where its output goes
+    std::vector<PrimitiveInstance> primitive_instances{};
+    size_t vertex_count = 0;
+    size_t index_count = 0;
+    std::function<void(uint node_index, glm::mat4 parent_transform)> flatten;
+    flatten = [&](uint node_index, glm::mat4 parent_transform) {
+        const auto& node = glb.nodes[node_index];
+        glm::mat4 total_transform = parent_transform * node.transform;
+        if (node.mesh.has_value()) {
+            for (const auto& primitive: glb.meshes[node.mesh.value()]) {
+                primitive_instances.push_back(PrimitiveInstance{&primitive, total_transform, vertex_count, index_count});
+                vertex_count += primitive.vertex_count;
+                index_count += primitive.index_count;
+            }
+        }
+        for (auto child: node.children) {
+            flatten(child, total_transform);
+        }
+    };
+    for (auto root: glb.root_nodes) {
+        flatten(root, glm::mat4{1.0f});
+    }
 
-        const auto v = reinterpret_cast<glm::vec3*>(mesh->mVertices);
-        const auto n = reinterpret_cast<glm::vec3*>(mesh->mNormals);
-        const auto t = reinterpret_cast<glm::vec3*>(mesh->mTextureCoords[0]);
+    if (primitive_instances.empty()) {
+        throw std::runtime_error(Formatter() << "Failed to load model (" << file << "): \n\t" << "No triangle meshes");
+    }
 
-        VertexCollection vertex_collection{
-            v ? std::vector<glm::vec3>{v, v + mesh->mNumVertices} : std::vector<glm::vec3>{},
-            n ? std::vector<glm::vec3>{n, n + mesh->mNumVertices} : std::vector<glm::vec3>{},
-            t ? std::vector<glm::vec2>{t, t + mesh->mNumVertices} : std::vector<glm::vec2>{},
-            {}
-        };
+    std::vector<VertexData> vertices(vertex_count);
 
-        for (auto& position: vertex_collection.positions) {
-            position = total_transform * glm::vec4(position, 1.0f);
+    // A single untransformed primitive with 32 bit indices can have its indices uploaded straight from the mapped file
+    const uint* direct_indices = nullptr;
+    if (primitive_instances.size() == 1 && primitive_instances[0].transform == glm::mat4{1.0f}) {
+        direct_indices = primitive_instances[0].primitive->get_direct_indices();
+    }
+    std::vector<uint> indices(direct_indices == nullptr ? index_count : 0);
+
+    // Split large primitives into blocks, so that a model made of one huge primitive still uses every core
+    constexpr size_t BLOCK_VERTICES = 64 * 1024;
+    // [(primitive_instance, vertex_begin, vertex_end)], with an empty vertex range meaning the indices of the primitive
+    std::vector<std::tuple<const PrimitiveInstance*, size_t, size_t>> blocks{};
+    for (const auto& primitive_instance: primitive_instances) {
+        size_t num_vertices = primitive_instance.primitive->vertex_count;
+        for (size_t begin = 0; begin < num_vertices; begin += BLOCK_VERTICES) {
+            blocks.emplace_back(&primitive_instance, begin, std::min(num_vertices, begin + BLOCK_VERTICES));
         }
+        if (direct_indices == nullptr) {
+            blocks.emplace_back(&primitive_instance, 0, 0);
+        }
+    }
 
-        for (auto& normal: vertex_collection.normals) {
-            normal = normal_matrix * normal;
+    ThreadPool::shared().parallel_for(blocks.size(), [&](size_t i) {
+        const auto& [primitive_instance, vertex_begin, vertex_end] = blocks[i];
+        const auto* primitive = primitive_instance->primitive;
+        if (vertex_end > vertex_begin) {
+            auto vertex_stream = primitive->vertex_stream().subrange(vertex_begin, vertex_end - vertex_begin);
+            vertex_stream.transform = primitive_instance->transform;
+            vertex_stream.normal_matrix = calculate_normal_matrix(primitive_instance->transform);
+            VertexData::from_stream(vertex_stream, vertices.data() + primitive_instance->vertex_offset + vertex_begin);
+        } else {
+            primitive->read_indices(indices.data() + primitive_instance->index_offset, (uint) primitive_instance->vertex_offset);
         }
+    });
 
-        VertexData::from_mesh(vertex_collection, vertices);
+    if (direct_indices != nullptr) {
+        return load_from_data(vertices.data(), vertices.size(), direct_indices, index_count, file);
+    }
+    return load_from_data(vertices, indices, file);
+}
 
-        for (auto i = 0u; i < mesh->mNumFaces; ++i) {
-            aiFace face = mesh->mFaces[i];
-            for (auto j = 0u; j < face.mNumIndices; j++) {
-                indices.push_back(face.mIndices[j] + index_offset);
-            }
+template<typename VertexData>
+void ModelLoader::reimport_model(const std::string& file, ImportProfile profile) {
+    auto existing = cache.find({file, std::type_index(typeid(VertexData)), profile});
+    if (existing == cache.end()) return;
+    auto handle = std::dynamic_pointer_cast<ModelHandle<VertexData>>(existing->second.second.lock());
+    if (handle == nullptr) return;
+
+    auto replacement = import_model<VertexData>(file, profile);
+    // The old buffers get freed along with the replacement handle
+    handle->swap_contents(*replacement);
+    existing->second.first = get_last_write_time(file);
+}
+
+template<typename VertexData>
+void ModelLoader::convert_scene(const aiScene* scene, std::vector<VertexData>& vertices, std::vector<uint>& indices) {
+    // First pass flattens the tree, so that every mesh knows where its output goes
+    std::vector<MeshInstance> mesh_instances{};
+    size_t vertex_count = 0;
+    size_t index_count = 0;
+    flatten_node(scene, scene->mRootNode, glm::mat4{1.0f}, mesh_instances, vertex_count, index_count);
+
+    vertices.resize(vertex_count);
+    indices.resize(index_count);
+
+    // Split large meshes into blocks, so that a model made of one huge mesh still uses every core
+    constexpr size_t BLOCK_VERTICES = 64 * 1024;
+    constexpr size_t BLOCK_FACES = 64 * 1024;
+    // [(mesh_instance, vertex_begin, vertex_end, face_begin, face_end)]
+    std::vector<std::tuple<const MeshInstance*, size_t, size_t, size_t, size_t>> blocks{};
+    for (const auto& mesh_instance: mesh_instances) {
+        size_t num_vertices = mesh_instance.mesh->mNumVertices;
+        size_t num_faces = mesh_instance.mesh->mNumFaces;
+        for (size_t begin = 0; begin < num_vertices; begin += BLOCK_VERTICES) {
+            blocks.emplace_back(&mesh_instance, begin, std::min(num_vertices, begin + BLOCK_VERTICES), 0, 0);
+        }
+        // The position of a face's indices is only known up front if every face is a triangle
+        size_t face_block = mesh_instance.triangles_only ? BLOCK_FACES : num_faces;
+        for (size_t begin = 0; begin < num_faces; begin += face_block) {
+            blocks.emplace_back(&mesh_instance, 0, 0, begin, std::min(num_faces, begin + face_block));
         }
     }
 
-    for (auto i = 0u; i < node->mNumChildren; ++i) {
-        load_node(scene, node->mChildren[i], vertices, indices, total_transform);
-    }
+    // Second pass converts each block into its own disjoint range of the outputs, so can be done in parallel
+    ThreadPool::shared().parallel_for(blocks.size(), [&](size_t i) {
+        const auto& [mesh_instance, vertex_begin, vertex_end, face_begin, face_end] = blocks[i];
+        convert_mesh(*mesh_instance, vertex_begin, vertex_end, face_begin, face_end, vertices.data(), indices.data());
+    });
 }
 
 template<typename VertexData>
-std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::load_hierarchy_from_file(const std::string& file) {
-    auto path = import_path + "/" + file;
-    if (!std::filesystem::exists(path)) {
-        throw std::runtime_error(Formatter() << "Failed to load model (" << path << "): \n\t File does not exist");
+void ModelLoader::convert_stream(const VertexStream& stream, std::vector<VertexData>& vertices) {
+    constexpr size_t BLOCK_VERTICES = 64 * 1024;
+    vertices.resize(stream.count);
+    size_t block_count = (stream.count + BLOCK_VERTICES - 1) / BLOCK_VERTICES;
+    ThreadPool::shared().parallel_for(block_count, [&](size_t block) {
+        size_t begin = block * BLOCK_VERTICES;
+        size_t count = std::min(stream.count, begin + BLOCK_VERTICES) - begin;
+        VertexData::from_stream(stream.subrange(begin, count), vertices.data() + begin);
+    });
+}
+
+template<typename VertexData>
+void ModelLoader::convert_mesh(const MeshInstance& mesh_instance, size_t vertex_begin, size_t vertex_end, size_t face_begin, size_t face_end, VertexData* vertices, uint* indices) {
+    const auto* mesh = mesh_instance.mesh;
+
+    if (vertex_end > vertex_begin) {
+        auto vertex_stream = make_vertex_stream(mesh).subrange(vertex_begin, vertex_end - vertex_begin);
+        vertex_stream.transform = mesh_instance.transform;
+        vertex_stream.normal_matrix = mesh_instance.normal_matrix;
+        VertexData::from_stream(vertex_stream, vertices + mesh_instance.vertex_offset + vertex_begin);
+    }
+
+    auto base_vertex = (uint) mesh_instance.vertex_offset;
+    size_t index_offset = mesh_instance.index_offset + (mesh_instance.triangles_only ? face_begin * 3 : 0);
+    for (size_t i = face_begin; i < face_end; ++i) {
+        const aiFace& face = mesh->mFaces[i];
+        for (auto j = 0u; j < face.mNumIndices; j++) {
+            indices[index_offset++] = face.mIndices[j] + base_vertex;
+        }
     }
-    auto last_write_time = std::filesystem::last_write_time(path);
+}
+
+template<typename VertexData>
+std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::load_hierarchy_from_file(const std::string& file, std::optional<ImportProfile> profile) {
+    auto last_write_time = get_last_write_time(file);
+    auto import_profile = profile.value_or(default_import_profile);
+    std::tuple key{file, std::type_index(typeid(VertexData)), import_profile};
 
-    auto existing = hierarchy_cache.find({file, std::type_index(typeid(VertexData))});
+    auto existing = hierarchy_cache.find(key);
     if (existing != hierarchy_cache.end()) {
         // Cache exist, so try lock
         auto handle = existing->second.second.lock();
@@ -230,17 +623,52 @@ std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::load_hierarchy_from_file
         }
     }
 
-    const aiScene* scene = importer.ReadFile(path, aiProcessPreset_TargetRealtime_MaxQuality | aiProcess_TransformUVCoords | aiProcess_SortByPType);
+    auto mesh_hierarchy = import_hierarchy<VertexData>(file, import_profile);
+    if (compress_animations) mesh_hierarchy->compress_animations(animation_compression);
 
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        throw std::runtime_error(Formatter() << "Failed to load model (" << file << "): \n\t" << importer.GetErrorString());
+    hierarchy_cache[key] = {last_write_time, mesh_hierarchy};
+    hierarchy_reimporters[key] = [this, file, import_profile]() { reimport_hierarchy<VertexData>(file, import_profile); };
+    asset_budget.track(mesh_hierarchy, AssetBudget::Kind::MeshHierarchy, file, mesh_hierarchy->get_gpu_bytes());
+
+    return mesh_hierarchy;
+}
+
+template<typename VertexData>
+std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::import_hierarchy(const std::string& file, ImportProfile profile) {
+    if (ImportProfiles::supported_by_fast_loaders(profile) && use_fast_glb_loader && has_extension(file, ".glb")) {
+        auto glb = GlbFile::open(read_file(file), import_path + "/" + file, &glb_fallback);
+        if (glb != nullptr) {
+            auto mesh_hierarchy = import_glb_hierarchy<VertexData>(*glb, file);
+            mesh_hierarchy->import_profile = profile;
+            return mesh_hierarchy;
+        }
+    }
+
+    if (has_extension(file, ".drc")) {
+        // A single mesh with no bones, on the root node, decoded as is whatever the profile
+        VertexCollection vertex_collection{};
+        std::vector<uint> indices{};
+        DracoDecoder::decode_file(read_file(file), import_path + "/" + file, vertex_collection, indices);
+        std::vector<VertexData> vertices{};
+        VertexData::from_mesh(vertex_collection, vertices);
+
+        auto mesh_hierarchy = std::make_shared<MeshHierarchy<VertexData>>(file);
+        mesh_hierarchy->import_profile = profile;
+        mesh_hierarchy->meshes.push_back(ModelInfo<VertexData>{load_from_data(vertices, indices), {}});
+        MeshHierarchyNode root_node{};
+        root_node.meshes.push_back(0);
+        mesh_hierarchy->set_nodes(std::move(root_node));
+        return mesh_hierarchy;
     }
 
+    const aiScene* scene = read_scene(file, profile);
+
     if (scene->mNumMeshes == 0) {
         throw std::runtime_error(Formatter() << "Failed to load model (" << file << "): \n\t" << "No meshes");
     }
 
     auto mesh_hierarchy = std::make_shared<MeshHierarchy<VertexData>>(file);
+    mesh_hierarchy->import_profile = profile;
 
     // {index into scene->mMeshes} -> {index into mesh_hierarchy->models}
     std::unordered_map<uint, uint> mesh_index_map{};
@@ -251,10 +679,6 @@ std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::load_hierarchy_from_file
             continue;
         }
 
-        const auto v = reinterpret_cast<glm::vec3*>(mesh->mVertices);
-        const auto n = reinterpret_cast<glm::vec3*>(mesh->mNormals);
-        const auto t = reinterpret_cast<glm::vec3*>(mesh->mTextureCoords[0]);
-
         // { bone_name } -> { bone_id }
         std::unordered_map<std::string, uint> bone_names{};
 
@@ -293,19 +717,20 @@ std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::load_hierarchy_from_file
             }
         }
 
-        VertexCollection vertex_collection{
-            v ? std::vector<glm::vec3>{v, v + mesh->mNumVertices} : std::vector<glm::vec3>{},
-            n ? std::vector<glm::vec3>{n, n + mesh->mNumVertices} : std::vector<glm::vec3>{},
-            t ? std::vector<glm::vec2>{t, t + mesh->mNumVertices} : std::vector<glm::vec2>{},
-            bone_weights
-        };
+        auto vertex_stream = make_vertex_stream(mesh);
+        vertex_stream.bones = bone_weights.data();
 
-        std::vector<VertexData> vertices{};
-        VertexData::from_mesh(vertex_collection, vertices);
+        std::vector<VertexData> vertices(mesh->mNumVertices);
+        VertexData::from_stream(vertex_stream, vertices.data());
 
+        size_t index_count = 0;
+        for (auto face_i = 0u; face_i < mesh->mNumFaces; ++face_i) {
+            index_count += mesh->mFaces[face_i].mNumIndices;
+        }
         std::vector<uint> indices{};
+        indices.reserve(index_count);
         for (auto face_i = 0u; face_i < mesh->mNumFaces; ++face_i) {
-            aiFace face = mesh->mFaces[face_i];
+            const aiFace& face = mesh->mFaces[face_i];
             indices.insert(indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
         }
 
@@ -350,19 +775,7 @@ std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::load_hierarchy_from_file
         const auto animation = animations.find(node->mName.C_Str());
         if (animation != animations.end()) {
             for (const auto& [animation_id, node_animation]: animation->second) {
-                auto& animation_data = hierarchy_node.animation_data[animation_id];
-                for (auto i = 0u; i < node_animation->mNumPositionKeys; ++i) {
-                    const auto& key = node_animation->mPositionKeys[i];
-                    animation_data.positions[key.mTime] = glm::vec3{key.mValue.x, key.mValue.y, key.mValue.z};
-                }
-                for (auto i = 0u; i < node_animation->mNumRotationKeys; ++i) {
-                    const auto& key = node_animation->mRotationKeys[i];
-                    animation_data.rotations[key.mTime] = glm::quat{key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z};
-                }
-                for (auto i = 0u; i < node_animation->mNumScalingKeys; ++i) {
-                    const auto& key = node_animation->mScalingKeys[i];
-                    animation_data.scalings[key.mTime] = glm::vec3{key.mValue.x, key.mValue.y, key.mValue.z};
-                }
+                read_node_animation(node_animation, hierarchy_node.animation_data[animation_id]);
             }
         }
 
@@ -372,15 +785,144 @@ std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::load_hierarchy_from_file
         }
     };
 
-    load_hierarchy_node(scene->mRootNode, mesh_hierarchy->root_node);
+    MeshHierarchyNode root_node{};
+    load_hierarchy_node(scene->mRootNode, root_node);
+    mesh_hierarchy->set_nodes(std::move(root_node));
 
     importer.FreeScene();
 
-    hierarchy_cache[{file, std::type_index(typeid(VertexData))}] = {last_write_time, mesh_hierarchy};
+    return mesh_hierarchy;
+}
+
+template<typename VertexData>
+std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::import_glb_hierarchy(const GlbFile& glb, const std::string& file) {
+    auto mesh_hierarchy = std::make_shared<MeshHierarchy<VertexData>>(file);
+
+    // Bones are looked up by name, so make sure every joint has a unique one, named the same way as Assimp does for unnamed nodes
+    std::vector<std::string> node_names(glb.nodes.size());
+    std::unordered_set<std::string> used_names{};
+    for (auto node_i = 0u; node_i < glb.nodes.size(); ++node_i) {
+        std::string name = glb.nodes[node_i].name.empty() ? Formatter() << "bone_" << node_i : glb.nodes[node_i].name;
+        node_names[node_i] = used_names.insert(name).second ? name : Formatter() << name << "_" << node_i;
+    }
+
+    // A mesh is skinned by the skin of the first node that uses it
+    std::vector<std::optional<uint>> mesh_skins(glb.meshes.size());
+    for (const auto& node: glb.nodes) {
+        if (node.mesh.has_value() && node.skin.has_value() && !mesh_skins[node.mesh.value()].has_value()) {
+            mesh_skins[node.mesh.value()] = node.skin;
+        }
+    }
+
+    // [index into glb.meshes] -> [index into mesh_hierarchy->meshes, for each primitive]
+    std::vector<std::vector<uint>> mesh_index_map(glb.meshes.size());
+    // { node_index } -> [(mesh_index, bone_id, offset_matrix)]
+    std::unordered_map<uint, std::vector<std::tuple<uint, uint, glm::mat4>>> node_bones{};
+
+    for (auto mesh_i = 0u; mesh_i < glb.meshes.size(); ++mesh_i) {
+        // Each primitive becomes its own mesh, the same as Assimp does
+        for (const auto& primitive: glb.meshes[mesh_i]) {
+            auto hierarchy_mesh_i = (uint) mesh_hierarchy->meshes.size();
+
+            // { bone_name } -> { bone_id }
+            std::unordered_map<std::string, uint> bone_names{};
+            uint joint_count = 0;
+            if (mesh_skins[mesh_i].has_value()) {
+                const auto& skin = glb.skins[mesh_skins[mesh_i].value()];
+                for (auto bone_i = 0u; bone_i < skin.joints.size(); ++bone_i) {
+                    auto joint = skin.joints[bone_i];
+                    bone_names[node_names[joint]] = bone_i;
+                    node_bones[joint].emplace_back(hierarchy_mesh_i, bone_i, skin.inverse_bind_matrices[bone_i]);
+                    mesh_hierarchy->total_bones[node_names[joint]].emplace_back(hierarchy_mesh_i, bone_i, skin.inverse_bind_matrices[bone_i]);
+                }
+                joint_count = (uint) skin.joints.size();
+            }
+
+            auto bone_weights = primitive.read_bones(joint_count);
+            auto vertex_stream = primitive.vertex_stream();
+            vertex_stream.bones = bone_weights.data();
+
+            std::vector<VertexData> vertices(primitive.vertex_count);
+            VertexData::from_stream(vertex_stream, vertices.data());
+
+            std::vector<uint> indices(primitive.index_count);
+            primitive.read_indices(indices.data(), 0);
+
+            mesh_index_map[mesh_i].push_back(hierarchy_mesh_i);
+            mesh_hierarchy->meshes.push_back(ModelInfo{
+                load_from_data(vertices, indices),
+                bone_names
+            });
+        }
+    }
+
+    if (mesh_hierarchy->meshes.empty()) {
+        throw std::runtime_error(Formatter() << "Failed to load model (" << file << "): \n\t" << "No triangle meshes");
+    }
+
+    for (auto animation_i = 0u; animation_i < glb.animations.size(); ++animation_i) {
+        const auto& animation = glb.animations[animation_i];
+        // Default to "[Unnamed] ({id})", in case file doesn't specify
+        mesh_hierarchy->animations.emplace_back(animation.name.empty() ? Formatter() << "[Unnamed] (" << animation_i << ")" : animation.name, 1000.0, animation.duration_ticks);
+    }
+
+    std::function<void(uint node_index, MeshHierarchyNode& hierarchy_node)> load_hierarchy_node;
+    load_hierarchy_node = [&](uint node_index, MeshHierarchyNode& hierarchy_node) {
+        const auto& node = glb.nodes[node_index];
+        hierarchy_node.transformation = node.transform;
+        if (node.mesh.has_value()) {
+            const auto& hierarchy_meshes = mesh_index_map[node.mesh.value()];
+            hierarchy_node.meshes.insert(hierarchy_node.meshes.end(), hierarchy_meshes.begin(), hierarchy_meshes.end());
+        }
+        auto bones = node_bones.find(node_index);
+        if (bones != node_bones.end()) {
+            hierarchy_node.bones = bones->second;
+        }
+        for (auto animation_i = 0u; animation_i < glb.animations.size(); ++animation_i) {
+            auto animation = glb.animations[animation_i].nodes.find(node_index);
+            if (animation != glb.animations[animation_i].nodes.end()) {
+                hierarchy_node.animation_data[(int) animation_i] = animation->second;
+            }
+        }
+
+        hierarchy_node.children.resize(node.children.size());
+        for (size_t child_i = 0; child_i < node.children.size(); ++child_i) {
+            load_hierarchy_node(node.children[child_i], hierarchy_node.children[child_i]);
+        }
+    };
+
+    // Like Assimp, a scene with a single root node uses it as the root, otherwise the roots are put under an empty node
+    MeshHierarchyNode root_node{};
+    if (glb.root_nodes.size() == 1) {
+        load_hierarchy_node(glb.root_nodes[0], root_node);
+    } else {
+        root_node.children.resize(glb.root_nodes.size());
+        for (size_t root_i = 0; root_i < glb.root_nodes.size(); ++root_i) {
+            load_hierarchy_node(glb.root_nodes[root_i], root_node.children[root_i]);
+        }
+    }
+    mesh_hierarchy->set_nodes(std::move(root_node));
 
     return mesh_hierarchy;
 }
 
+template<typename VertexData>
+void ModelLoader::reimport_hierarchy(const std::string& file, ImportProfile profile) {
+    auto existing = hierarchy_cache.find({file, std::type_index(typeid(VertexData)), profile});
+    if (existing == hierarchy_cache.end()) return;
+    auto mesh_hierarchy = std::dynamic_pointer_cast<MeshHierarchy<VertexData>>(existing->second.second.lock());
+    if (mesh_hierarchy == nullptr) return;
+
+    auto replacement = import_hierarchy<VertexData>(file, profile);
+    if (compress_animations) replacement->compress_animations(animation_compression);
+    // Entities store the index of the animation they are playing, so can't swap in a version with fewer animations
+    if (replacement->animations.size() < mesh_hierarchy->animations.size()) {
+        throw std::runtime_error(Formatter() << "Failed to reload model (" << file << "): \n\t" << "It has fewer animations than before, select it again to reload it");
+    }
+    mesh_hierarchy->swap_contents(*replacement);
+    existing->second.first = get_last_write_time(file);
+}
+
 template<typename VertexData>
 bool ModelLoader::add_imgui_model_selector(const std::string& caption, std::shared_ptr<ModelHandle<VertexData>>& model_handle) {
     std::string current_selection = model_handle->get_filename().value_or("Generated Model");
@@ -395,7 +937,8 @@ bool ModelLoader::add_imgui_model_selector(const std::string& caption, std::shar
             const bool is_selected = model_handle->get_filename().has_value() && current_selection == model;
             if (ImGui::Selectable(model.c_str(), is_selected)) {
                 try {
-                    model_handle = load_from_file<VertexData>(model);
+                    // Keep the profile of the current model, if it was loaded from a file
+                    model_handle = load_from_file<VertexData>(model, model_handle->get_import_profile());
                     changed = true;
                 } catch (const std::exception& e) {
                     std::cerr << "Error while trying to update model file:" << std::endl;
@@ -429,7 +972,7 @@ bool ModelLoader::add_imgui_hierarchy_selector(const std::string& caption, std::
             const bool is_selected = mesh_hierarchy->filename.has_value() && current_selection == model;
             if (ImGui::Selectable(model.c_str(), is_selected)) {
                 try {
-                    mesh_hierarchy = load_hierarchy_from_file<VertexData>(model);
+                    mesh_hierarchy = load_hierarchy_from_file<VertexData>(model, mesh_hierarchy->import_profile);
                     changed = true;
                 } catch (const std::exception& e) {
                     std::cerr << "Error while trying to update model hierarchy file:" << std::endl;
@@ -0,0 +1,495 @@
+#include "ObjParser.h"
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "ModelLoader.h"
+
+namespace {
+    constexpr uint NONE = UINT32_MAX;
+
+    /// The three indices making up a face corner, 0 based, NONE if missing
+    struct Corner {
+        uint position;
+        uint tex_coord;
+        uint normal;
+
+        bool operator==(const Corner& other) const {
+            return position == other.position && tex_coord == other.tex_coord && normal == other.normal;
+        }
+    };
+
+    struct Chunk {
+        const char* begin;
+        const char* end;
+
+        uint position_count = 0;
+        uint tex_coord_count = 0;
+        uint normal_count = 0;
+        // Offsets of this chunk's attributes within the whole file
+        uint position_base = 0;
+        uint tex_coord_base = 0;
+        uint normal_base = 0;
+
+        // Triangulated corners
+        std::vector<Corner> corners{};
+        bool any_missing_tex_coord = false;
+        bool any_tex_coord = false;
+        bool any_missing_normal = false;
+    };
+
+    inline bool is_digit(char c) {
+        return (unsigned char) (c - '0') < 10;
+    }
+
+    inline bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline void skip_spaces(const char*& p, const char* end) {
+        while (p < end && is_space(*p)) ++p;
+    }
+
+    inline const char* find_line_end(const char* p, const char* end) {
+        const auto* newline = static_cast<const char*>(std::memchr(p, '\n', (size_t) (end - p)));
+        return newline != nullptr ? newline : end;
+    }
+
+    // SWAR digit parsing, from "Fast numeric string to int" by Wojciech Muła and used by fast_float.
+    // Both assume a little-endian byte order.
+    inline bool is_eight_digits(const char* p) {
+        uint64_t value;
+        std::memcpy(&value, p, 8);
+        return (((value & 0xF0F0F0F0F0F0F0F0ull) | (((value + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull);
+    }
+
+    inline uint32_t parse_eight_digits(const char* p) {
+        uint64_t value;
+        std::memcpy(&value, p, 8);
+        value = (value & 0x0F0F0F0F0F0F0F0Full) * 2561 >> 8;
+        value = (value & 0x00FF00FF00FF00FFull) * 6553601 >> 16;
+        return (uint32_t) ((value & 0x0000FFFF0000FFFFull) * 42949672960001ull >> 32);
+    }
+
+    /// Accumulate digits into the mantissa, keeping at most 19 significant digits, returning how many were read
+    inline int parse_digits(const char*& p, const char* end, uint64_t& mantissa, int& significant_digits, int& dropped_digits) {
+        const char* start = p;
+        while (p + 8 <= end && significant_digits + 8 <= 19 && is_eight_digits(p)) {
+            mantissa = mantissa * 100000000ull + parse_eight_digits(p);
+            if (mantissa != 0) significant_digits += 8;
+            p += 8;
+        }
+        while (p < end && is_digit(*p)) {
+            if (significant_digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+                if (mantissa != 0) significant_digits++;
+            } else {
+                dropped_digits++;
+            }
+            ++p;
+        }
+        return (int) (p - start);
+    }
+
+    /// Parse a possibly negative integer, returns false if there is none
+    inline bool parse_int(const char*& p, const char* end, int64_t& out) {
+        bool negative = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+')) ++p;
+        if (p >= end || !is_digit(*p)) return false;
+        int64_t value = 0;
+        while (p < end && is_digit(*p)) {
+            value = value * 10 + (*p - '0');
+            ++p;
+        }
+        out = negative ? -value : value;
+        return true;
+    }
+
+    /// Turn a 1 based (or negative, relative) OBJ index into a 0 based one, given the number of elements defined so far
+    inline uint resolve_index(int64_t index, uint count_so_far) {
+        if (index > 0) return (uint) (index - 1);
+        if (index < 0) return (uint) ((int64_t) count_so_far + index);
+        return NONE; // 0 is never valid, caught by the bounds check
+    }
+
+    [[noreturn]] void fail(const Chunk& chunk, const char* line, const char* reason) {
+        const char* line_end = find_line_end(line, chunk.end);
+        throw std::runtime_error(Formatter() << reason << ": \"" << std::string(line, std::min<size_t>(line_end - line, 80)) << "\"");
+    }
+
+    /// Classify the line by its keyword, returns the start of the arguments
+    enum class LineType { Position, TexCoord, Normal, Face, Other };
+
+    inline LineType classify(const char*& p, const char* line_end) {
+        skip_spaces(p, line_end);
+        if (line_end - p < 2) return LineType::Other;
+        if (p[0] == 'v') {
+            if (is_space(p[1])) { p += 1; return LineType::Position; }
+            if (line_end - p >= 3 && is_space(p[2])) {
+                if (p[1] == 't') { p += 2; return LineType::TexCoord; }
+                if (p[1] == 'n') { p += 2; return LineType::Normal; }
+            }
+        } else if (p[0] == 'f' && is_space(p[1])) {
+            p += 1;
+            return LineType::Face;
+        }
+        return LineType::Other;
+    }
+
+    void count_chunk(Chunk& chunk) {
+        for (const char* line = chunk.begin; line < chunk.end;) {
+            const char* line_end = find_line_end(line, chunk.end);
+            const char* p = line;
+            switch (classify(p, line_end)) {
+                case LineType::Position:
+                    chunk.position_count++;
+                    break;
+                case LineType::TexCoord:
+                    chunk.tex_coord_count++;
+                    break;
+                case LineType::Normal:
+                    chunk.normal_count++;
+                    break;
+                default:
+                    break;
+            }
+            line = line_end + 1;
+        }
+    }
+
+    void parse_chunk(Chunk& chunk, ObjData& out, std::vector<glm::vec2>& tex_coords, uint total_positions, uint total_tex_coords, uint total_normals) {
+        uint position_index = chunk.position_base;
+        uint tex_coord_index = chunk.tex_coord_base;
+        uint normal_index = chunk.normal_base;
+
+        std::vector<Corner> polygon{};
+
+        for (const char* line = chunk.begin; line < chunk.end;) {
+            const char* line_end = find_line_end(line, chunk.end);
+            const char* p = line;
+
+            auto parse_floats = [&](float* values, int count) {
+                for (int i = 0; i < count; ++i) {
+                    skip_spaces(p, line_end);
+                    if (!ObjParser::parse_float(p, line_end, values[i])) fail(chunk, line, "Expected a number");
+                }
+            };
+
+            switch (classify(p, line_end)) {
+                case LineType::Position:
+                    parse_floats(&out.positions[position_index++].x, 3);
+                    break;
+                case LineType::TexCoord: {
+                    // The v coordinate is optional
+                    auto& tex_coord = tex_coords[tex_coord_index++];
+                    parse_floats(&tex_coord.x, 1);
+                    skip_spaces(p, line_end);
+                    if (!ObjParser::parse_float(p, line_end, tex_coord.y)) tex_coord.y = 0.0f;
+                    break;
+                }
+                case LineType::Normal:
+                    parse_floats(&out.normals[normal_index++].x, 3);
+                    break;
+                case LineType::Face: {
+                    polygon.clear();
+                    while (true) {
+                        skip_spaces(p, line_end);
+                        if (p >= line_end || *p == '#') break;
+
+                        Corner corner{NONE, NONE, NONE};
+                        int64_t index;
+                        if (!parse_int(p, line_end, index)) fail(chunk, line, "Expected a face index");
+                        corner.position = resolve_index(index, position_index);
+                        if (p < line_end && *p == '/') {
+                            ++p;
+                            if (parse_int(p, line_end, index)) corner.tex_coord = resolve_index(index, tex_coord_index);
+                            if (p < line_end && *p == '/') {
+                                ++p;
+                                if (!parse_int(p, line_end, index)) fail(chunk, line, "Expected a normal index");
+                                corner.normal = resolve_index(index, normal_index);
+                            }
+                        }
+
+                        if (corner.position >= total_positions ||
+                            (corner.tex_coord != NONE && corner.tex_coord >= total_tex_coords) ||
+                            (corner.normal != NONE && corner.normal >= total_normals)) {
+                            fail(chunk, line, "Face index out of range");
+                        }
+                        chunk.any_tex_coord |= corner.tex_coord != NONE;
+                        chunk.any_missing_tex_coord |= corner.tex_coord == NONE;
+                        chunk.any_missing_normal |= corner.normal == NONE;
+                        polygon.push_back(corner);
+                    }
+
+                    // Triangulate as a fan
+                    for (size_t i = 2; i < polygon.size(); ++i) {
+                        chunk.corners.push_back(polygon[0]);
+                        chunk.corners.push_back(polygon[i - 1]);
+                        chunk.corners.push_back(polygon[i]);
+                    }
+                    break;
+                }
+                case LineType::Other:
+                    break;
+            }
+            line = line_end + 1;
+        }
+    }
+
+    inline uint32_t hash_corner(const Corner& corner) {
+        uint32_t hash = corner.position * 0x9E3779B1u ^ corner.tex_coord * 0x85EBCA77u ^ corner.normal * 0xC2B2AE3Du;
+        // Murmur3 finaliser, to spread the bits before they are used for both the partition and the slot
+        hash ^= hash >> 16;
+        hash *= 0x85EBCA6Bu;
+        hash ^= hash >> 13;
+        hash *= 0xC2B2AE35u;
+        hash ^= hash >> 16;
+        return hash;
+    }
+}
+
+VertexStream ObjData::vertex_stream() const {
+    VertexStream stream{};
+    stream.count = positions.size();
+    stream.positions = positions.data();
+    stream.normals = normals.data();
+    if (!tex_coords.empty()) stream.tex_coords = tex_coords.data();
+    return stream;
+}
+
+std::optional<ObjData> ObjParser::parse_file(const std::string& path, ThreadPool& thread_pool) {
+    FileContents contents = FileContents::map(path);
+    return parse_file(contents, path, thread_pool);
+}
+
+std::optional<ObjData> ObjParser::parse_file(const FileContents& contents, const std::string& path, ThreadPool& thread_pool) {
+    try {
+        return parse(contents.get_data(), contents.get_size(), thread_pool);
+    } catch (const std::exception& e) {
+        throw std::runtime_error(Formatter() << "Failed to parse OBJ file (" << path << "): \n\t" << e.what());
+    }
+}
+
+std::optional<ObjData> ObjParser::parse(const char* data, size_t size, ThreadPool& thread_pool) {
+    // Split into chunks of whole lines, big enough that the per-chunk overhead doesn't matter
+    constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
+    size_t chunk_count = std::clamp<size_t>(size / MIN_CHUNK_SIZE, 1, (size_t) thread_pool.get_concurrency() * 4);
+    std::vector<Chunk> chunks{};
+    chunks.reserve(chunk_count);
+    const char* end = data + size;
+    const char* chunk_begin = data;
+    for (size_t i = 1; i <= chunk_count && chunk_begin < end; ++i) {
+        const char* chunk_end = i == chunk_count ? end : std::max(chunk_begin, data + size * i / chunk_count);
+        if (chunk_end < end) chunk_end = std::min(end, find_line_end(chunk_end, end) + 1);
+        chunks.push_back(Chunk{chunk_begin, chunk_end});
+        chunk_begin = chunk_end;
+    }
+
+    // First pass counts the attributes in each chunk, so every chunk knows where its attributes go
+    thread_pool.parallel_for(chunks.size(), [&](size_t i) { count_chunk(chunks[i]); });
+
+    uint total_positions = 0, total_tex_coords = 0, total_normals = 0;
+    for (auto& chunk: chunks) {
+        chunk.position_base = total_positions;
+        chunk.tex_coord_base = total_tex_coords;
+        chunk.normal_base = total_normals;
+        total_positions += chunk.position_count;
+        total_tex_coords += chunk.tex_coord_count;
+        total_normals += chunk.normal_count;
+    }
+
+    // Second pass parses the attributes into their final position, and collects the triangulated face corners
+    ObjData file_data{};
+    file_data.positions.resize(total_positions);
+    file_data.normals.resize(total_normals);
+    std::vector<glm::vec2> file_tex_coords(total_tex_coords);
+    thread_pool.parallel_for(chunks.size(), [&](size_t i) {
+        parse_chunk(chunks[i], file_data, file_tex_coords, total_positions, total_tex_coords, total_normals);
+    });
+
+    bool any_tex_coord = false, any_missing_tex_coord = false, any_missing_normal = false;
+    std::vector<size_t> corner_offsets(chunks.size() + 1, 0);
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        any_tex_coord |= chunks[i].any_tex_coord;
+        any_missing_tex_coord |= chunks[i].any_missing_tex_coord;
+        any_missing_normal |= chunks[i].any_missing_normal;
+        corner_offsets[i + 1] = corner_offsets[i] + chunks[i].corners.size();
+    }
+    size_t corner_count = corner_offsets.back();
+
+    // Assimp generates smooth normals and handles partial texture coordinates, so leave those files to it
+    if (corner_count == 0 || any_missing_normal || (any_tex_coord && any_missing_tex_coord)) {
+        return std::nullopt;
+    }
+    if (corner_count > UINT32_MAX) {
+        throw std::runtime_error("Too many face corners");
+    }
+
+    std::vector<Corner> corners(corner_count);
+    thread_pool.parallel_for(chunks.size(), [&](size_t i) {
+        std::copy(chunks[i].corners.begin(), chunks[i].corners.end(), corners.begin() + (long) corner_offsets[i]);
+        chunks[i].corners = {};
+    });
+
+    // Merge identical corners into vertices. Each partition owns the corners whose hash maps to it, so partitions
+    // can build their own hash tables in parallel without any locking.
+    std::vector<uint32_t> hashes(corner_count);
+    thread_pool.parallel_for(corner_count, [&](size_t i) { hashes[i] = hash_corner(corners[i]); }, 4096);
+
+    auto partition_count = (uint32_t) std::min<size_t>(thread_pool.get_concurrency() * 2, std::max<size_t>(corner_count / 4096, 1));
+    auto partition_of = [partition_count](uint32_t hash) {
+        // Uses the high bits, the low bits pick the slot within the partition's table
+        return (uint32_t) (((uint64_t) hash * partition_count) >> 32);
+    };
+
+    // Bucket the corners by partition, so that each partition only walks its own corners. The corners are split into blocks
+    // that each count their corners per partition, then scatter them in order, so each bucket keeps the corners' file order.
+    size_t block_count = std::min<size_t>(thread_pool.get_concurrency() * 2, std::max<size_t>(corner_count / 4096, 1));
+    size_t block_size = (corner_count + block_count - 1) / block_count;
+    // [block * partition_count + partition] -> the number of the block's corners in the partition, then where they go in its bucket
+    std::vector<uint32_t> block_offsets(block_count * partition_count, 0);
+    thread_pool.parallel_for(block_count, [&](size_t block) {
+        uint32_t* counts = &block_offsets[block * partition_count];
+        for (size_t i = block * block_size; i < std::min(corner_count, (block + 1) * block_size); ++i) {
+            counts[partition_of(hashes[i])]++;
+        }
+    });
+
+    // [partition] -> index of its first corner in bucketed_corners
+    std::vector<uint32_t> bucket_starts(partition_count + 1, 0);
+    uint32_t offset = 0;
+    for (uint32_t partition = 0; partition < partition_count; ++partition) {
+        bucket_starts[partition] = offset;
+        for (size_t block = 0; block < block_count; ++block) {
+            uint32_t count = block_offsets[block * partition_count + partition];
+            block_offsets[block * partition_count + partition] = offset;
+            offset += count;
+        }
+    }
+    bucket_starts[partition_count] = offset;
+
+    std::vector<uint32_t> bucketed_corners(corner_count);
+    thread_pool.parallel_for(block_count, [&](size_t block) {
+        uint32_t* offsets = &block_offsets[block * partition_count];
+        for (size_t i = block * block_size; i < std::min(corner_count, (block + 1) * block_size); ++i) {
+            bucketed_corners[offsets[partition_of(hashes[i])]++] = (uint32_t) i;
+        }
+    });
+
+    // [partition] -> [first corner of each unique vertex]
+    std::vector<std::vector<uint32_t>> unique_corners(partition_count);
+    // [corner] -> index of its vertex within its partition
+    std::vector<uint32_t> local_ids(corner_count);
+
+    thread_pool.parallel_for(partition_count, [&](size_t partition) {
+        size_t partition_corners = bucket_starts[partition + 1] - bucket_starts[partition];
+
+        size_t table_size = 16;
+        while (table_size < partition_corners * 2) table_size *= 2;
+        size_t mask = table_size - 1;
+        // Slots store the local vertex id + 1, so that 0 means empty
+        std::vector<uint32_t> slots(table_size, 0);
+
+        auto& unique = unique_corners[partition];
+        for (uint32_t b = bucket_starts[partition]; b < bucket_starts[partition + 1]; ++b) {
+            uint32_t i = bucketed_corners[b];
+            for (size_t slot = hashes[i] & mask;; slot = (slot + 1) & mask) {
+                if (slots[slot] == 0) {
+                    unique.push_back(i);
+                    slots[slot] = (uint32_t) unique.size();
+                    local_ids[i] = (uint32_t) unique.size() - 1;
+                    break;
+                }
+                uint32_t local_id = slots[slot] - 1;
+                if (corners[unique[local_id]] == corners[i]) {
+                    local_ids[i] = local_id;
+                    break;
+                }
+            }
+        }
+    });
+
+    std::vector<uint32_t> partition_bases(partition_count + 1, 0);
+    for (uint32_t partition = 0; partition < partition_count; ++partition) {
+        partition_bases[partition + 1] = partition_bases[partition] + (uint32_t) unique_corners[partition].size();
+    }
+    uint32_t vertex_count = partition_bases.back();
+
+    ObjData obj_data{};
+    obj_data.positions.resize(vertex_count);
+    obj_data.normals.resize(vertex_count);
+    if (any_tex_coord) obj_data.tex_coords.resize(vertex_count);
+    obj_data.indices.resize(corner_count);
+
+    thread_pool.parallel_for(partition_count, [&](size_t partition) {
+        const auto& unique = unique_corners[partition];
+        for (size_t j = 0; j < unique.size(); ++j) {
+            const auto& corner = corners[unique[j]];
+            size_t vertex = partition_bases[partition] + j;
+            obj_data.positions[vertex] = file_data.positions[corner.position];
+            obj_data.normals[vertex] = file_data.normals[corner.normal];
+            if (any_tex_coord) obj_data.tex_coords[vertex] = file_tex_coords[corner.tex_coord];
+        }
+    });
+
+    thread_pool.parallel_for(corner_count, [&](size_t i) {
+        obj_data.indices[i] = partition_bases[partition_of(hashes[i])] + local_ids[i];
+    }, 4096);
+
+    return obj_data;
+}
+
+bool ObjParser::parse_float(const char*& p, const char* end, float& out) {
+    static constexpr double POWERS_OF_TEN[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* start = p;
+    bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+')) ++p;
+
+    uint64_t mantissa = 0;
+    int significant_digits = 0;
+    int dropped_digits = 0;
+    int digits = parse_digits(p, end, mantissa, significant_digits, dropped_digits);
+    int exponent = dropped_digits;
+
+    if (p < end && *p == '.') {
+        ++p;
+        int dropped_fraction = 0;
+        int fraction_digits = parse_digits(p, end, mantissa, significant_digits, dropped_fraction);
+        digits += fraction_digits;
+        exponent -= fraction_digits - dropped_fraction;
+    }
+
+    if (digits == 0) {
+        p = start;
+        return false;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* exponent_start = p;
+        ++p;
+        int64_t explicit_exponent;
+        if (parse_int(p, end, explicit_exponent)) {
+            exponent += (int) std::clamp<int64_t>(explicit_exponent, -1000, 1000);
+        } else {
+            p = exponent_start;
+        }
+    }
+
+    double value = (double) mantissa;
+    if (exponent < 0 && exponent >= -22) {
+        value /= POWERS_OF_TEN[-exponent];
+    } else if (exponent > 0 && exponent <= 22) {
+        value *= POWERS_OF_TEN[exponent];
+    } else if (exponent != 0) {
+        value *= std::pow(10.0, exponent);
+    }
+
+    out = (float) (negative ? -value : value);
+    return true;
+}
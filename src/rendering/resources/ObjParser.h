@@ -0,0 +1,49 @@
+#ifndef OBJ_PARSER_H
+#define OBJ_PARSER_H
+
+#include <string>
+#include <vector>
+#include <optional>
+
+#include <glm/glm.hpp>
+
+#include "utility/HelperTypes.h"
+#include "utility/FileContents.h"
+#include "utility/ThreadPool.h"
+
+struct VertexStream;
+
+/// The indexed mesh produced by the ObjParser, each vertex is a unique (position, texture coordinate, normal) combination.
+struct ObjData {
+    std::vector<glm::vec3> positions{};
+    std::vector<glm::vec3> normals{};
+    // Empty if the file doesn't have texture coordinates
+    std::vector<glm::vec2> tex_coords{};
+    std::vector<uint> indices{};
+
+    /// A view over the vertices, for converting into a VertexData type
+    [[nodiscard]] VertexStream vertex_stream() const;
+};
+
+/// A dedicated parser for Wavefront OBJ files, which is much faster than going through Assimp.
+///
+/// The file is memory mapped and split into chunks of whole lines that are parsed in parallel, with the attributes of each
+/// chunk written straight into their final position. Identical face corners are then merged into vertices in parallel,
+/// by splitting the corners between the threads based on their hash.
+///
+/// Only handles what this project needs, triangulating polygons and ignoring materials, groups, lines and points.
+/// Files it can't handle the same way Assimp would, such as ones that are missing normals, return std::nullopt.
+namespace ObjParser {
+    /// Parse the file at path, throws a std::runtime_error if the file is malformed, or returns std::nullopt if it needs Assimp's post-processing
+    std::optional<ObjData> parse_file(const std::string& path, ThreadPool& thread_pool = ThreadPool::shared());
+    /// Parse the contents of an OBJ file that is already in memory, the path is only used in messages
+    std::optional<ObjData> parse_file(const FileContents& contents, const std::string& path, ThreadPool& thread_pool = ThreadPool::shared());
+    /// Parse OBJ text that is already in memory
+    std::optional<ObjData> parse(const char* data, size_t size, ThreadPool& thread_pool = ThreadPool::shared());
+
+    /// Parse a decimal floating point number starting at p, advancing p past it. Returns false if there is no number at p.
+    /// Eight digits at a time are converted with SWAR (SIMD within a register), and the result is exact for up to 15 significant digits.
+    bool parse_float(const char*& p, const char* end, float& out);
+}
+
+#endif //OBJ_PARSER_H
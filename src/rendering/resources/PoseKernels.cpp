@@ -0,0 +1,400 @@
+#include "PoseKernels.h"
+
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define POSE_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC allows any intrinsic in any function, so the kernels need no attributes
+#define TARGET_SSE
+#define TARGET_AVX2
+#else
+// Compile just these functions for the wider instruction sets, the rest of the program stays runnable on any x86 CPU
+#define TARGET_SSE __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+AffineTransform AffineTransform::from_mat4(const glm::mat4& matrix) {
+    AffineTransform transform{};
+    for (int r = 0; r < 3; ++r) {
+        transform.rows[r] = {matrix[0][r], matrix[1][r], matrix[2][r], matrix[3][r]};
+    }
+    return transform;
+}
+
+glm::mat4 AffineTransform::to_mat4() const {
+    return {
+        rows[0].x, rows[1].x, rows[2].x, 0.0f,
+        rows[0].y, rows[1].y, rows[2].y, 0.0f,
+        rows[0].z, rows[1].z, rows[2].z, 0.0f,
+        rows[0].w, rows[1].w, rows[2].w, 1.0f,
+    };
+}
+
+size_t TrsSamples::padded_count() const {
+    return (count + LANES - 1) / LANES * LANES;
+}
+
+void TrsSamples::resize(size_t node_count) {
+    count = node_count;
+    size_t padded = padded_count();
+    for (auto* components: {position_a, position_b, scaling_a, scaling_b}) {
+        for (int c = 0; c < 3; ++c) components[c].resize(padded);
+    }
+    for (auto* components: {rotation_a, rotation_b}) {
+        for (int c = 0; c < 4; ++c) components[c].resize(padded);
+    }
+    position_t.resize(padded);
+    rotation_t.resize(padded);
+    scaling_t.resize(padded);
+
+    for (size_t node = count; node < padded; ++node) {
+        set_position(node, glm::vec3{0.0f}, glm::vec3{0.0f}, 0.0f);
+        set_rotation(node, glm::quat{1.0f, 0.0f, 0.0f, 0.0f}, glm::quat{1.0f, 0.0f, 0.0f, 0.0f}, 0.0f);
+        set_scaling(node, glm::vec3{1.0f}, glm::vec3{1.0f}, 0.0f);
+    }
+}
+
+void TrsSamples::set_position(size_t node, const glm::vec3& a, const glm::vec3& b, float t) {
+    for (int c = 0; c < 3; ++c) {
+        position_a[c][node] = a[c];
+        position_b[c][node] = b[c];
+    }
+    position_t[node] = t;
+}
+
+void TrsSamples::set_rotation(size_t node, const glm::quat& a, const glm::quat& b, float t) {
+    // Spelled out, since the order glm::quat's operator[] uses depends on its configuration
+    const float components_a[4] = {a.x, a.y, a.z, a.w};
+    const float components_b[4] = {b.x, b.y, b.z, b.w};
+    for (int c = 0; c < 4; ++c) {
+        rotation_a[c][node] = components_a[c];
+        rotation_b[c][node] = components_b[c];
+    }
+    rotation_t[node] = t;
+}
+
+void TrsSamples::set_scaling(size_t node, const glm::vec3& a, const glm::vec3& b, float t) {
+    for (int c = 0; c < 3; ++c) {
+        scaling_a[c][node] = a[c];
+        scaling_b[c][node] = b[c];
+    }
+    scaling_t[node] = t;
+}
+
+namespace {
+    // Scalar, the reference the SIMD kernels follow step for step
+
+    void compose_trs_scalar(const TrsSamples& samples, AffineTransform* out) {
+        for (size_t i = 0; i < samples.count; ++i) {
+            float p[3], s[3], q[4];
+            for (int c = 0; c < 3; ++c) {
+                p[c] = samples.position_a[c][i] + (samples.position_b[c][i] - samples.position_a[c][i]) * samples.position_t[i];
+                s[c] = samples.scaling_a[c][i] + (samples.scaling_b[c][i] - samples.scaling_a[c][i]) * samples.scaling_t[i];
+            }
+
+            float dot = 0.0f;
+            for (int c = 0; c < 4; ++c) dot += samples.rotation_a[c][i] * samples.rotation_b[c][i];
+            float sign = dot < 0.0f ? -1.0f : 1.0f;
+            float length_squared = 0.0f;
+            for (int c = 0; c < 4; ++c) {
+                q[c] = samples.rotation_a[c][i] + (sign * samples.rotation_b[c][i] - samples.rotation_a[c][i]) * samples.rotation_t[i];
+                length_squared += q[c] * q[c];
+            }
+            float inverse_length = 1.0f / std::sqrt(length_squared);
+            float x = q[0] * inverse_length, y = q[1] * inverse_length, z = q[2] * inverse_length, w = q[3] * inverse_length;
+
+            // The rotation matrix of the quaternion, with each column scaled, then the translation in the last column
+            out[i].rows[0] = {(1.0f - 2.0f * (y * y + z * z)) * s[0], 2.0f * (x * y - w * z) * s[1], 2.0f * (x * z + w * y) * s[2], p[0]};
+            out[i].rows[1] = {2.0f * (x * y + w * z) * s[0], (1.0f - 2.0f * (x * x + z * z)) * s[1], 2.0f * (y * z - w * x) * s[2], p[1]};
+            out[i].rows[2] = {2.0f * (x * z - w * y) * s[0], 2.0f * (y * z + w * x) * s[1], (1.0f - 2.0f * (x * x + y * y)) * s[2], p[2]};
+        }
+    }
+
+    AffineTransform multiply_scalar(const AffineTransform& a, const AffineTransform& b) {
+        AffineTransform result{};
+        for (int r = 0; r < 3; ++r) {
+            result.rows[r] = a.rows[r].x * b.rows[0] + a.rows[r].y * b.rows[1] + a.rows[r].z * b.rows[2] + glm::vec4{0.0f, 0.0f, 0.0f, a.rows[r].w};
+        }
+        return result;
+    }
+
+    void accumulate_hierarchy_scalar(const int* parents, AffineTransform* transforms, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (parents[i] >= 0) transforms[i] = multiply_scalar(transforms[parents[i]], transforms[i]);
+        }
+    }
+
+    void apply_offsets_scalar(const AffineTransform* transforms, const BoneBinding* bindings, size_t count, glm::mat4* bone_transforms) {
+        for (size_t i = 0; i < count; ++i) {
+            bone_transforms[bindings[i].bone] = multiply_scalar(transforms[bindings[i].node], bindings[i].offset).to_mat4();
+        }
+    }
+
+#ifdef POSE_KERNELS_X86
+    // SSE, 4 nodes at a time for composing, and one matrix at a time in 4 wide rows for the rest
+
+    TARGET_SSE void compose_trs_sse(const TrsSamples& samples, AffineTransform* out) {
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 sign_bit = _mm_set1_ps(-0.0f);
+        for (size_t i = 0; i < samples.count; i += 4) {
+            __m128 p[3], s[3], q[4], qb[4];
+            __m128 tp = _mm_loadu_ps(&samples.position_t[i]);
+            __m128 ts = _mm_loadu_ps(&samples.scaling_t[i]);
+            __m128 tq = _mm_loadu_ps(&samples.rotation_t[i]);
+            for (int c = 0; c < 3; ++c) {
+                __m128 pa = _mm_loadu_ps(&samples.position_a[c][i]);
+                p[c] = _mm_add_ps(pa, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&samples.position_b[c][i]), pa), tp));
+                __m128 sa = _mm_loadu_ps(&samples.scaling_a[c][i]);
+                s[c] = _mm_add_ps(sa, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&samples.scaling_b[c][i]), sa), ts));
+            }
+
+            __m128 dot = _mm_setzero_ps();
+            for (int c = 0; c < 4; ++c) {
+                q[c] = _mm_loadu_ps(&samples.rotation_a[c][i]);
+                qb[c] = _mm_loadu_ps(&samples.rotation_b[c][i]);
+                dot = _mm_add_ps(dot, _mm_mul_ps(q[c], qb[c]));
+            }
+            __m128 flip = _mm_and_ps(_mm_cmplt_ps(dot, _mm_setzero_ps()), sign_bit);
+            __m128 length_squared = _mm_setzero_ps();
+            for (int c = 0; c < 4; ++c) {
+                q[c] = _mm_add_ps(q[c], _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(qb[c], flip), q[c]), tq));
+                length_squared = _mm_add_ps(length_squared, _mm_mul_ps(q[c], q[c]));
+            }
+            __m128 inverse_length = _mm_div_ps(one, _mm_sqrt_ps(length_squared));
+            __m128 x = _mm_mul_ps(q[0], inverse_length), y = _mm_mul_ps(q[1], inverse_length);
+            __m128 z = _mm_mul_ps(q[2], inverse_length), w = _mm_mul_ps(q[3], inverse_length);
+
+            __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+            __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+            __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+            // [row][column] for all 4 nodes, transposed into each node's rows below
+            __m128 m[3][4] = {
+                {
+                    _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), s[0]),
+                    _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), s[1]),
+                    _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), s[2]),
+                    p[0],
+                },
+                {
+                    _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), s[0]),
+                    _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), s[1]),
+                    _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), s[2]),
+                    p[1],
+                },
+                {
+                    _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), s[0]),
+                    _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), s[1]),
+                    _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), s[2]),
+                    p[2],
+                },
+            };
+            // Padding means the last batch can be written whole, but only the real nodes are
+            size_t lanes = std::min<size_t>(4, samples.count - i);
+            for (int r = 0; r < 3; ++r) {
+                _MM_TRANSPOSE4_PS(m[r][0], m[r][1], m[r][2], m[r][3]);
+                for (size_t lane = 0; lane < lanes; ++lane) {
+                    _mm_storeu_ps(&out[i + lane].rows[r][0], m[r][lane]);
+                }
+            }
+        }
+    }
+
+    /// Multiply a by the transform with rows b0, b1 and b2, into the rows of result
+    TARGET_SSE inline void multiply_rows_sse(const AffineTransform& a, __m128 b0, __m128 b1, __m128 b2, __m128 result[3]) {
+        const __m128 w_mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+        for (int r = 0; r < 3; ++r) {
+            __m128 row = _mm_loadu_ps(&a.rows[r][0]);
+            __m128 sum = _mm_and_ps(row, w_mask);
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), b0));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+            result[r] = sum;
+        }
+    }
+
+    TARGET_SSE void accumulate_hierarchy_sse(const int* parents, AffineTransform* transforms, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (parents[i] < 0) continue;
+            __m128 result[3];
+            multiply_rows_sse(transforms[parents[i]], _mm_loadu_ps(&transforms[i].rows[0][0]), _mm_loadu_ps(&transforms[i].rows[1][0]),
+                              _mm_loadu_ps(&transforms[i].rows[2][0]), result);
+            for (int r = 0; r < 3; ++r) _mm_storeu_ps(&transforms[i].rows[r][0], result[r]);
+        }
+    }
+
+    TARGET_SSE void apply_offsets_sse(const AffineTransform* transforms, const BoneBinding* bindings, size_t count, glm::mat4* bone_transforms) {
+        for (size_t i = 0; i < count; ++i) {
+            const auto& offset = bindings[i].offset;
+            __m128 result[3];
+            multiply_rows_sse(transforms[bindings[i].node], _mm_loadu_ps(&offset.rows[0][0]), _mm_loadu_ps(&offset.rows[1][0]),
+                              _mm_loadu_ps(&offset.rows[2][0]), result);
+            // The rows plus the implicit bottom row transpose into the columns of the glm::mat4
+            __m128 bottom = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+            _MM_TRANSPOSE4_PS(result[0], result[1], result[2], bottom);
+            auto& matrix = bone_transforms[bindings[i].bone];
+            _mm_storeu_ps(&matrix[0][0], result[0]);
+            _mm_storeu_ps(&matrix[1][0], result[1]);
+            _mm_storeu_ps(&matrix[2][0], result[2]);
+            _mm_storeu_ps(&matrix[3][0], bottom);
+        }
+    }
+
+    // AVX2, 8 nodes at a time for composing with fused multiply adds. The hierarchy and offsets work one matrix at a time,
+    // where a row is only 4 wide, so they share the SSE kernels.
+
+    TARGET_AVX2 inline __m256 lerp_avx2(__m256 a, __m256 b, __m256 t) {
+        return _mm256_fmadd_ps(_mm256_sub_ps(b, a), t, a);
+    }
+
+    TARGET_AVX2 void compose_trs_avx2(const TrsSamples& samples, AffineTransform* out) {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 two = _mm256_set1_ps(2.0f);
+        const __m256 sign_bit = _mm256_set1_ps(-0.0f);
+        for (size_t i = 0; i < samples.count; i += 8) {
+            __m256 p[3], s[3], q[4], qb[4];
+            __m256 tp = _mm256_loadu_ps(&samples.position_t[i]);
+            __m256 ts = _mm256_loadu_ps(&samples.scaling_t[i]);
+            __m256 tq = _mm256_loadu_ps(&samples.rotation_t[i]);
+            for (int c = 0; c < 3; ++c) {
+                p[c] = lerp_avx2(_mm256_loadu_ps(&samples.position_a[c][i]), _mm256_loadu_ps(&samples.position_b[c][i]), tp);
+                s[c] = lerp_avx2(_mm256_loadu_ps(&samples.scaling_a[c][i]), _mm256_loadu_ps(&samples.scaling_b[c][i]), ts);
+            }
+
+            __m256 dot = _mm256_setzero_ps();
+            for (int c = 0; c < 4; ++c) {
+                q[c] = _mm256_loadu_ps(&samples.rotation_a[c][i]);
+                qb[c] = _mm256_loadu_ps(&samples.rotation_b[c][i]);
+                dot = _mm256_fmadd_ps(q[c], qb[c], dot);
+            }
+            __m256 flip = _mm256_and_ps(_mm256_cmp_ps(dot, _mm256_setzero_ps(), _CMP_LT_OQ), sign_bit);
+            __m256 length_squared = _mm256_setzero_ps();
+            for (int c = 0; c < 4; ++c) {
+                q[c] = lerp_avx2(q[c], _mm256_xor_ps(qb[c], flip), tq);
+                length_squared = _mm256_fmadd_ps(q[c], q[c], length_squared);
+            }
+            __m256 inverse_length = _mm256_div_ps(one, _mm256_sqrt_ps(length_squared));
+            __m256 x = _mm256_mul_ps(q[0], inverse_length), y = _mm256_mul_ps(q[1], inverse_length);
+            __m256 z = _mm256_mul_ps(q[2], inverse_length), w = _mm256_mul_ps(q[3], inverse_length);
+
+            __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+            __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+            __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+            __m256 m[3][4] = {
+                {
+                    _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one), s[0]),
+                    _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), s[1]),
+                    _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), s[2]),
+                    p[0],
+                },
+                {
+                    _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), s[0]),
+                    _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one), s[1]),
+                    _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), s[2]),
+                    p[1],
+                },
+                {
+                    _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), s[0]),
+                    _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), s[1]),
+                    _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one), s[2]),
+                    p[2],
+                },
+            };
+            size_t lanes = std::min<size_t>(8, samples.count - i);
+            for (int r = 0; r < 3; ++r) {
+                // A 4x4 transpose within each 128 bit half, so the low halves hold the rows of nodes 0-3 and the high halves 4-7
+                __m256 t0 = _mm256_unpacklo_ps(m[r][0], m[r][1]);
+                __m256 t1 = _mm256_unpackhi_ps(m[r][0], m[r][1]);
+                __m256 t2 = _mm256_unpacklo_ps(m[r][2], m[r][3]);
+                __m256 t3 = _mm256_unpackhi_ps(m[r][2], m[r][3]);
+                __m256 rows[4] = {
+                    _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)),
+                    _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+                    _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+                    _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)),
+                };
+                for (size_t lane = 0; lane < lanes; ++lane) {
+                    __m128 row = lane < 4 ? _mm256_castps256_ps128(rows[lane]) : _mm256_extractf128_ps(rows[lane - 4], 1);
+                    _mm_storeu_ps(&out[i + lane].rows[r][0], row);
+                }
+            }
+        }
+    }
+#endif
+
+    const PoseKernels::Kernels SCALAR_KERNELS{compose_trs_scalar, accumulate_hierarchy_scalar, apply_offsets_scalar};
+#ifdef POSE_KERNELS_X86
+    const PoseKernels::Kernels SSE_KERNELS{compose_trs_sse, accumulate_hierarchy_sse, apply_offsets_sse};
+    const PoseKernels::Kernels AVX2_KERNELS{compose_trs_avx2, accumulate_hierarchy_sse, apply_offsets_sse};
+#endif
+
+    std::atomic<PoseKernels::Level> current_level{PoseKernels::best_supported()};
+}
+
+PoseKernels::Level PoseKernels::best_supported() {
+#ifdef POSE_KERNELS_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    bool fma = (info[2] & (1 << 12)) != 0;
+    // AVX state also has to be enabled by the OS
+    bool os_avx = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    if (avx2 && fma && os_avx) return Level::AVX2;
+    if (sse2) return Level::SSE;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return Level::AVX2;
+    if (__builtin_cpu_supports("sse2")) return Level::SSE;
+#endif
+#endif
+    return Level::Scalar;
+}
+
+bool PoseKernels::is_supported(Level level) {
+    return (int) level <= (int) best_supported();
+}
+
+const char* PoseKernels::level_name(Level level) {
+    switch (level) {
+        case Level::Scalar:
+            return "Scalar";
+        case Level::SSE:
+            return "SSE";
+        case Level::AVX2:
+            return "AVX2";
+    }
+    return "Unknown";
+}
+
+const PoseKernels::Kernels& PoseKernels::active() {
+#ifdef POSE_KERNELS_X86
+    switch (current_level.load(std::memory_order_relaxed)) {
+        case Level::AVX2:
+            return AVX2_KERNELS;
+        case Level::SSE:
+            return SSE_KERNELS;
+        case Level::Scalar:
+            break;
+    }
+#endif
+    return SCALAR_KERNELS;
+}
+
+void PoseKernels::set_level(Level level) {
+    if (is_supported(level)) current_level = level;
+}
+
+PoseKernels::Level PoseKernels::get_level() {
+    return current_level;
+}
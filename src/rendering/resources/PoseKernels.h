@@ -0,0 +1,91 @@
+#ifndef POSE_KERNELS_H
+#define POSE_KERNELS_H
+
+#include <vector>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "utility/HelperTypes.h"
+
+/// An affine transform stored as the top 3 rows of a row-major 4x4 matrix, the bottom row being implicitly (0, 0, 0, 1),
+/// so each row is 4 floats that load straight into a SIMD register.
+struct AffineTransform {
+    glm::vec4 rows[3]{{1.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f, 0.0f}};
+
+    /// Drops the bottom row of the matrix, which is expected to be (0, 0, 0, 1)
+    static AffineTransform from_mat4(const glm::mat4& matrix);
+    [[nodiscard]] glm::mat4 to_mat4() const;
+};
+
+/// A bone driven by a node of a hierarchy, see PoseKernels::ApplyOffsets
+struct BoneBinding {
+    uint node;
+    // Index into the pose's flat array of bone transforms
+    uint bone;
+    AffineTransform offset;
+};
+
+/// The keys either side of the sample time for a batch of nodes, in SoA layout so the kernels can load 4 or 8 nodes' worth of a component at once.
+/// Nodes whose time is outside a track's range, or that don't have the track, have the same value in a and b.
+struct TrsSamples {
+    // The widest kernel, which count is padded up to a multiple of
+    static constexpr size_t LANES = 8;
+
+    // [component][node], positions and scalings are xyz, rotations are xyzw
+    std::vector<float> position_a[3], position_b[3];
+    std::vector<float> rotation_a[4], rotation_b[4];
+    std::vector<float> scaling_a[3], scaling_b[3];
+    // [node] -> how far between a and b the time is, in [0, 1]
+    std::vector<float> position_t, rotation_t, scaling_t;
+    size_t count = 0;
+
+    /// Resize to hold node_count nodes, filling the padding with identity transforms
+    void resize(size_t node_count);
+    [[nodiscard]] size_t padded_count() const;
+    void set_position(size_t node, const glm::vec3& a, const glm::vec3& b, float t);
+    void set_rotation(size_t node, const glm::quat& a, const glm::quat& b, float t);
+    void set_scaling(size_t node, const glm::vec3& a, const glm::vec3& b, float t);
+};
+
+/// SIMD kernels for the hot loops of pose evaluation, with the widest the CPU supports picked at runtime.
+///
+/// Rotations are interpolated with a normalised lerp along the shorter arc rather than a slerp, which at the key spacing of animations
+/// is visually identical, and lets 4 or 8 be interpolated at once. Every level does the same maths, so they only differ by rounding.
+namespace PoseKernels {
+    enum class Level {
+        Scalar,
+        SSE,
+        AVX2,
+    };
+
+    /// Interpolate each node's samples and compose them into out[node] = translate(position) * rotate(rotation) * scale(scaling).
+    /// out must hold samples.padded_count() transforms.
+    using ComposeTrs = void (*)(const TrsSamples& samples, AffineTransform* out);
+    /// Turn local transforms into ones relative to the root in place, transforms[i] = transforms[parents[i]] * transforms[i],
+    /// where every parent comes before its children and the roots are -1
+    using AccumulateHierarchy = void (*)(const int* parents, AffineTransform* transforms, size_t count);
+    /// bone_transforms[binding.bone] = transforms[binding.node] * binding.offset for each binding,
+    /// as column-major matrices ready to upload, with later bindings of the same bone winning
+    using ApplyOffsets = void (*)(const AffineTransform* transforms, const BoneBinding* bindings, size_t count, glm::mat4* bone_transforms);
+
+    struct Kernels {
+        ComposeTrs compose_trs;
+        AccumulateHierarchy accumulate_hierarchy;
+        ApplyOffsets apply_offsets;
+    };
+
+    /// The widest level this CPU supports, always Scalar on anything but x86
+    Level best_supported();
+    bool is_supported(Level level);
+    const char* level_name(Level level);
+
+    /// The kernels at the current level, which starts at best_supported()
+    const Kernels& active();
+    /// Switch level, such as to compare them, ignored if the CPU doesn't support it
+    void set_level(Level level);
+    Level get_level();
+}
+
+#endif //POSE_KERNELS_H
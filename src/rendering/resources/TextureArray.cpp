@@ -0,0 +1,89 @@
+#include "TextureArray.h"
+
+#include <algorithm>
+
+#include <glad/gl.h>
+
+#include "TextureHandle.h"
+
+TextureArray::TextureArray(uint width, uint height, uint channels, bool srgb, uint capacity, float max_anisotropy) : width(width), height(height), channels(channels), srgb(srgb), capacity(capacity) {
+    // Hand out the lowest layers first
+    for (uint layer = capacity; layer > 0; --layer) {
+        free_layers.push_back(layer - 1);
+    }
+
+    glGenTextures(1, &texture_id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_id);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY, max_anisotropy);
+    auto texture_format = TextureFormat::from_channels(channels, srgb);
+    texture_format.apply_swizzle(GL_TEXTURE_2D_ARRAY);
+
+    // Allocate every level of the mip chain up front
+    // (glTexStorage3D would be nicer, but it is not available on the OpenGL 4.1 that MacOS provides)
+    uint level_count = MipChain::level_count(width, height);
+    for (uint level = 0; level < level_count; ++level) {
+        int level_width = (int) std::max(1u, width >> level);
+        int level_height = (int) std::max(1u, height >> level);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, (int) level, texture_format.internal_format, level_width, level_height, (int) capacity, 0, texture_format.format, GL_UNSIGNED_BYTE, nullptr);
+    }
+}
+
+std::optional<uint> TextureArray::allocate_layer(const ImageData& image) {
+    if (free_layers.empty()) return std::nullopt;
+
+    uint layer = free_layers.back();
+    free_layers.pop_back();
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_id);
+    uint format = TextureFormat::from_channels(channels, srgb).format;
+    // Rows of 1 to 3 channel data are not necessarily 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint level = 0; level < image.levels.size(); ++level) {
+        auto size = image.level_size(level);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (int) level, 0, 0, (int) layer, (int) size.x, (int) size.y, 1, format, GL_UNSIGNED_BYTE, image.levels[level].data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    return layer;
+}
+
+void TextureArray::release_layer(uint layer) {
+    free_layers.push_back(layer);
+}
+
+uint TextureArray::get_texture_id() const {
+    return texture_id;
+}
+
+glm::uvec2 TextureArray::get_size() const {
+    return {width, height};
+}
+
+uint TextureArray::get_channels() const {
+    return channels;
+}
+
+bool TextureArray::is_srgb() const {
+    return srgb;
+}
+
+uint TextureArray::get_capacity() const {
+    return capacity;
+}
+
+uint TextureArray::get_used_layers() const {
+    return capacity - (uint) free_layers.size();
+}
+
+bool TextureArray::is_full() const {
+    return free_layers.empty();
+}
+
+TextureArray::~TextureArray() {
+    glDeleteTextures(1, &texture_id);
+}
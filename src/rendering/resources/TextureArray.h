@@ -0,0 +1,45 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <vector>
+#include <optional>
+
+#include <glm/glm.hpp>
+#include "utility/HelperTypes.h"
+#include "MipChain.h"
+
+/// A GL_TEXTURE_2D_ARRAY pool holding a fixed number of layers that all share the same size and format,
+/// so that entities using different textures from the same pool can be drawn without rebinding.
+/// Layers are handed out by the TextureLoader, and returned when the owning TextureHandle is destroyed.
+class TextureArray : private NonCopyable {
+    uint texture_id;
+    uint width;
+    uint height;
+    uint channels;
+    bool srgb;
+    uint capacity;
+
+    std::vector<uint> free_layers{};
+public:
+    /// Allocates GPU storage for `capacity` layers of `width` x `height` textures with the format for `channels`, including space for the mipmaps.
+    TextureArray(uint width, uint height, uint channels, bool srgb, uint capacity, float max_anisotropy);
+
+    /// Uploads the image, which must have the array's number of channels and a full mip chain, into a free layer.
+    /// (glGenerateMipmap can't be limited to a single layer, so generating them here would redo every layer on each upload)
+    /// Returns std::nullopt if the pool is full.
+    std::optional<uint> allocate_layer(const ImageData& image);
+    /// Mark a layer as free again, the contents are left as is and will be overwritten by the next allocation.
+    void release_layer(uint layer);
+
+    [[nodiscard]] uint get_texture_id() const;
+    [[nodiscard]] glm::uvec2 get_size() const;
+    [[nodiscard]] uint get_channels() const;
+    [[nodiscard]] bool is_srgb() const;
+    [[nodiscard]] uint get_capacity() const;
+    [[nodiscard]] uint get_used_layers() const;
+    [[nodiscard]] bool is_full() const;
+
+    ~TextureArray();
+};
+
+#endif //TEXTURE_ARRAY_H
@@ -1,23 +1,135 @@
 #include "TextureHandle.h"
 
+#include <iostream>
+
 #include <glad/gl.h>
 
-TextureHandle::TextureHandle(uint texture_id, uint width, uint height, bool srgb, bool flipped, std::optional<std::string> filename) : texture_id(texture_id), width(width), height(height), srgb(srgb), flipped(flipped), filename(std::move(filename)) {}
+#include "TextureArray.h"
+#include "UploadThread.h"
 
-uint TextureHandle::get_texture_id() const {
+TextureFormat TextureFormat::from_channels(uint channels, bool srgb) {
+    switch (channels) {
+        case 1:
+            return {GL_R8, GL_RED, {GL_RED, GL_RED, GL_RED, GL_ONE}};
+        case 2:
+            return {GL_RG8, GL_RG, {GL_RED, GL_RED, GL_RED, GL_GREEN}};
+        case 4:
+            return {srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, GL_RGBA, {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA}};
+        default:
+            return {srgb ? GL_SRGB8 : GL_RGB8, GL_RGB, {GL_RED, GL_GREEN, GL_BLUE, GL_ONE}};
+    }
+}
+
+void TextureFormat::apply_swizzle(uint target) const {
+    glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+}
+
+uint TextureFormat::bytes_per_texel(uint channels) {
+    return channels == 3 ? 4 : channels;
+}
+
+TextureStorage::TextureStorage(uint texture_id, uint width, uint height, uint channels) : texture_id(texture_id), width(width), height(height), channels(channels) {}
+
+TextureStorage::TextureStorage(std::shared_ptr<TextureArray> texture_array, uint layer, uint width, uint height, uint channels)
+    : texture_id(0), width(width), height(height), channels(channels), texture_array(std::move(texture_array)), layer(layer) {}
+
+uint TextureStorage::get_texture_id() const {
+    if (pending_upload != nullptr) {
+        try {
+            pending_upload->wait();
+        } catch (const std::exception& e) {
+            // The texture is left with whatever made it in, rather than failing the frame that first used it
+            std::cerr << "Error while uploading texture:" << std::endl;
+            std::cerr << e.what() << std::endl;
+        }
+        pending_upload = nullptr;
+    }
     return texture_id;
 }
 
-glm::uvec2 TextureHandle::get_size() const {
+uint TextureStorage::get_array_id() const {
+    return texture_array != nullptr ? texture_array->get_texture_id() : 0;
+}
+
+int TextureStorage::get_layer() const {
+    return texture_array != nullptr ? (int) layer : -1;
+}
+
+bool TextureStorage::is_array_layer() const {
+    return texture_array != nullptr;
+}
+
+glm::uvec2 TextureStorage::get_size() const {
     return {width, height};
 }
 
+uint TextureStorage::get_channels() const {
+    return channels;
+}
+
+size_t TextureStorage::get_gpu_bytes() const {
+    // A full mip chain adds roughly a third on top of the base level
+    return (size_t) width * height * TextureFormat::bytes_per_texel(channels) * 4 / 3;
+}
+
+TextureStorage::~TextureStorage() {
+    // Otherwise the upload could recreate the texture after it is deleted
+    if (pending_upload != nullptr) {
+        try {
+            pending_upload->wait();
+        } catch (const std::exception& e) {
+            std::cerr << "Error while uploading texture:" << std::endl;
+            std::cerr << e.what() << std::endl;
+        }
+    }
+    if (texture_array != nullptr) {
+        texture_array->release_layer(layer);
+    } else {
+        glDeleteTextures(1, &texture_id);
+    }
+}
+
+TextureHandle::TextureHandle(std::shared_ptr<TextureStorage> storage, bool srgb, bool flipped, std::optional<std::string> filename)
+    : storage(std::move(storage)), srgb(srgb), flipped(flipped), filename(std::move(filename)) {}
+
+uint TextureHandle::get_texture_id() const {
+    return storage->get_texture_id();
+}
+
+uint TextureHandle::get_array_id() const {
+    return storage->get_array_id();
+}
+
+int TextureHandle::get_layer() const {
+    return storage->get_layer();
+}
+
+bool TextureHandle::is_array_layer() const {
+    return storage->is_array_layer();
+}
+
+glm::uvec2 TextureHandle::get_size() const {
+    return storage->get_size();
+}
+
 uint TextureHandle::get_width() const {
-    return width;
+    return storage->get_size().x;
 }
 
 uint TextureHandle::get_height() const {
-    return height;
+    return storage->get_size().y;
+}
+
+uint TextureHandle::get_channels() const {
+    return storage->get_channels();
+}
+
+size_t TextureHandle::get_gpu_bytes() const {
+    return storage->get_gpu_bytes();
+}
+
+const std::shared_ptr<TextureStorage>& TextureHandle::get_storage() const {
+    return storage;
 }
 
 bool TextureHandle::is_srgb() const {
@@ -31,7 +143,3 @@ bool TextureHandle::is_flipped() const {
 const std::optional<std::string>& TextureHandle::get_filename() const {
     return filename;
 }
-
-TextureHandle::~TextureHandle() {
-    glDeleteTextures(1, &texture_id);
-}
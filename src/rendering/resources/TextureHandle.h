@@ -2,18 +2,74 @@
 #define TEXTURE_HANDLE_H
 
 #include <string>
+#include <memory>
 #include <optional>
 
 #include <glm/glm.hpp>
 #include "utility/HelperTypes.h"
 
 class TextureLoader;
+class TextureArray;
+class PendingUpload;
 
-/// A class representing a handle to a loaded texture, also storing some of its configuration data.
-class TextureHandle : private NonCopyable {
+/// The OpenGL formats used to store an image with a given number of 8 bit channels.
+/// Grey images are stored in a single channel, and swizzled so that they still sample as grey in every colour channel.
+struct TextureFormat {
+    int internal_format;
+    uint format;
+    int swizzle[4];
+
+    /// sRGB only has RGB and RGBA formats, so 1 and 2 channel images must be expanded before uploading them as sRGB
+    static TextureFormat from_channels(uint channels, bool srgb);
+    /// Set the swizzle on the texture currently bound to target
+    void apply_swizzle(uint target) const;
+    /// An estimate of the GPU memory used per texel, assuming the driver pads 3 channels to 4
+    static uint bytes_per_texel(uint channels);
+};
+
+/// The GPU side of a loaded texture, which may be shared by several handles,
+/// such as the same file with and without a vertical flip, or different files with identical contents.
+class TextureStorage : private NonCopyable {
     uint texture_id;
     uint width;
     uint height;
+    uint channels;
+
+    // Set if the texture is stored as a layer of a shared GL_TEXTURE_2D_ARRAY, in which case texture_id is 0
+    std::shared_ptr<TextureArray> texture_array{};
+    uint layer = 0;
+
+    // Set until the render thread has waited for the texture to finish uploading on the UploadThread
+    mutable std::shared_ptr<PendingUpload> pending_upload{};
+
+    friend class TextureLoader;
+
+public:
+    TextureStorage(uint texture_id, uint width, uint height, uint channels);
+    /// Construct storage in a layer of a texture array, the layer is returned to the array when the storage is destroyed.
+    TextureStorage(std::shared_ptr<TextureArray> texture_array, uint layer, uint width, uint height, uint channels);
+
+    /// The id of the GL_TEXTURE_2D, or 0 if the texture is stored in a texture array.
+    /// Waits for the texture to finish uploading if it hasn't already, so must only be called on the render thread.
+    [[nodiscard]] uint get_texture_id() const;
+    /// The id of the GL_TEXTURE_2D_ARRAY the texture is stored in, or 0 if it is a standalone texture
+    [[nodiscard]] uint get_array_id() const;
+    /// The layer to sample within the texture array, or -1 if it is a standalone texture
+    [[nodiscard]] int get_layer() const;
+    [[nodiscard]] bool is_array_layer() const;
+
+    [[nodiscard]] glm::uvec2 get_size() const;
+    /// The number of 8 bit channels the texture is stored with, see TextureFormat
+    [[nodiscard]] uint get_channels() const;
+    /// An estimate of the GPU memory used, including the mip chain
+    [[nodiscard]] size_t get_gpu_bytes() const;
+
+    ~TextureStorage();
+};
+
+/// A class representing a handle to a loaded texture, also storing some of its configuration data.
+class TextureHandle : private NonCopyable {
+    std::shared_ptr<TextureStorage> storage;
 
     bool srgb = true;
     bool flipped = false;
@@ -22,18 +78,33 @@ class TextureHandle : private NonCopyable {
     friend class TextureLoader;
 
 public:
-    TextureHandle(uint texture_id, uint width, uint height, bool srgb = true, bool flipped = false, std::optional<std::string> filename = {});
+    TextureHandle(std::shared_ptr<TextureStorage> storage, bool srgb = true, bool flipped = false, std::optional<std::string> filename = {});
 
+    /// The id of the GL_TEXTURE_2D, or 0 if the texture is stored in a texture array.
+    /// Waits for the texture to finish uploading if it hasn't already, so must only be called on the render thread.
     [[nodiscard]] uint get_texture_id() const;
+    /// The id of the GL_TEXTURE_2D_ARRAY the texture is stored in, or 0 if it is a standalone texture
+    [[nodiscard]] uint get_array_id() const;
+    /// The layer to sample within the texture array, or -1 if it is a standalone texture
+    [[nodiscard]] int get_layer() const;
+    [[nodiscard]] bool is_array_layer() const;
+
     [[nodiscard]] glm::uvec2 get_size() const;
     [[nodiscard]] uint get_width() const;
     [[nodiscard]] uint get_height() const;
+    /// The number of 8 bit channels the texture is stored with, see TextureFormat
+    [[nodiscard]] uint get_channels() const;
+    /// An estimate of the GPU memory used, including the mip chain, which is shared with any other handles to the same storage
+    [[nodiscard]] size_t get_gpu_bytes() const;
+    [[nodiscard]] const std::shared_ptr<TextureStorage>& get_storage() const;
 
+    /// Whether to flip the texture vertically. The stored image is never flipped, instead the renderers flip the texture coordinates,
+    /// so that the flipped and unflipped versions share the same storage.
     [[nodiscard]] bool is_flipped() const;
     [[nodiscard]] bool is_srgb() const;
     [[nodiscard]] const std::optional<std::string>& get_filename() const;
 
-    virtual ~TextureHandle();
+    virtual ~TextureHandle() = default;
 };
 
 
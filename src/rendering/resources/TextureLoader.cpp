@@ -2,8 +2,13 @@
 
 #include <iostream>
 #include <filesystem>
+#include <iterator>
+#include <string_view>
+#include <cstring>
+#include <algorithm>
 
-#include <imgui/imgui.h>
+#include "rendering/imgui/ImGuiManager.h"
+#include "UploadThread.h"
 
 #include <stb/stb_image.h>
 #include <glad/gl.h>
@@ -11,7 +16,49 @@
 #define WHITE_TEXTURE_NAME "[WHITE]"
 #define BLACK_TEXTURE_NAME "[BLACK]"
 
-TextureLoader::TextureLoader(std::string import_path) : import_path(std::move(import_path)), special_names({WHITE_TEXTURE_NAME, BLACK_TEXTURE_NAME}) {
+namespace {
+    /// Reduce a freshly decoded image to the channels it actually uses, dropping an alpha channel that is fully opaque
+    /// and storing grey images in a single channel. sRGB only has RGB and RGBA formats, so sRGB images are kept at 3 or 4 channels.
+    void compact_channels(ImageData& image, bool srgb) {
+        auto& pixels = image.levels[0];
+        size_t pixel_count = (size_t) image.width * image.height;
+        uint channels = image.channels;
+
+        bool has_alpha = channels == 2 || channels == 4;
+        bool opaque = true;
+        for (size_t i = 0; has_alpha && i < pixel_count; ++i) {
+            if (pixels[i * channels + channels - 1] != 0xFF) {
+                opaque = false;
+                break;
+            }
+        }
+        bool grey = !srgb;
+        for (size_t i = 0; grey && channels >= 3 && i < pixel_count; ++i) {
+            const unsigned char* pixel = &pixels[i * channels];
+            grey = pixel[0] == pixel[1] && pixel[0] == pixel[2];
+        }
+
+        uint colour_channels = grey ? 1 : 3;
+        uint out_channels = colour_channels + (has_alpha && !opaque ? 1 : 0);
+        if (out_channels == channels) return;
+
+        std::vector<unsigned char> result(pixel_count * out_channels);
+        for (size_t i = 0; i < pixel_count; ++i) {
+            const unsigned char* src = &pixels[i * channels];
+            unsigned char* dst = &result[i * out_channels];
+            for (uint c = 0; c < colour_channels; ++c) {
+                dst[c] = src[channels >= 3 ? c : 0];
+            }
+            if (out_channels > colour_channels) {
+                dst[colour_channels] = src[channels - 1];
+            }
+        }
+        pixels = std::move(result);
+        image.channels = out_channels;
+    }
+}
+
+TextureLoader::TextureLoader(std::string import_path, AssetBudget& asset_budget, std::string cache_path) : import_path(std::move(import_path)), cache_path(std::move(cache_path)), asset_budget(asset_budget), file_watcher(this->import_path), asset_pack(AssetPack::shared()), special_names({WHITE_TEXTURE_NAME, BLACK_TEXTURE_NAME}) {
     std::fill_n(default_white_texture_data, DEFAULT_TEXTURE_LEN, (unsigned char) 0xFF);
 }
 
@@ -34,55 +81,558 @@ std::shared_ptr<TextureHandle> TextureLoader::load_from_file(const std::string&
         return black;
     };
 
-    std::string full_path = import_path + "/" + file;
+    auto last_write_time = get_last_write_time(file);
 
-    if (!std::filesystem::exists(full_path)) {
-        throw std::runtime_error(Formatter() << "Failed to load texture file: " << full_path << "\n\t Reason: File does not exist");
+    auto existing = find_cached(file, srgb, flip_vertical, last_write_time);
+    if (existing != nullptr) {
+        return existing;
     }
 
-    static float max_ani = get_max_anisotropy();
-    auto last_write_time = std::filesystem::last_write_time(full_path);
+    auto texture = std::make_shared<TextureHandle>(load_storage(file, srgb, last_write_time), srgb, flip_vertical, file);
+    cache[{file, srgb, flip_vertical}] = {last_write_time, texture};
+    return texture;
+}
+
+std::vector<std::shared_ptr<TextureHandle>> TextureLoader::load_from_files(const std::vector<std::tuple<std::string, bool, bool>>& files) {
+    std::vector<std::shared_ptr<TextureHandle>> textures(files.size());
+    std::vector<std::shared_ptr<TextureStorage>> storages(files.size());
+
+    // [index into files] -> last_write_time, for each file whose storage isn't already loaded
+    std::vector<std::pair<size_t, std::filesystem::file_time_type>> missing{};
+    std::vector<std::filesystem::file_time_type> last_write_times(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        const auto& [file, srgb, flip_vertical] = files[i];
+        if (special_names.count(file) != 0) {
+            textures[i] = load_from_file(file, srgb, flip_vertical);
+            continue;
+        }
+
+        last_write_times[i] = get_last_write_time(file);
+        textures[i] = find_cached(file, srgb, flip_vertical, last_write_times[i]);
+        if (textures[i] != nullptr) continue;
+
+        storages[i] = find_cached_storage(file, srgb, last_write_times[i]);
+        if (storages[i] == nullptr) {
+            missing.emplace_back(i, last_write_times[i]);
+        }
+    }
+
+    // Read the missing files' cached mip chains, or hash their bytes, in parallel, to find any that are already loaded under another name
+    std::vector<SourceImage> sources(missing.size());
+    ThreadPool::shared().parallel_for(missing.size(), [&](size_t j) {
+        const auto& [index, last_write_time] = missing[j];
+        sources[j] = open_file(std::get<0>(files[index]), std::get<1>(files[index]), last_write_time);
+    });
+
+    // Only the first of each distinct (contents, srgb) in the batch is decoded, the rest share its storage.
+    // [index into missing] for each image to decode, and [index into to_decode] for each entry in missing that needs it
+    std::vector<size_t> to_decode{};
+    std::vector<std::optional<size_t>> decoded_by(missing.size());
+    std::unordered_map<std::tuple<size_t, size_t, bool>, size_t, TripleHash> batch_contents{};
+    for (size_t j = 0; j < missing.size(); ++j) {
+        size_t i = missing[j].first;
+        const auto& [file, srgb, flip_vertical] = files[i];
+        storages[i] = find_by_content(file, sources[j], srgb);
+        if (storages[i] != nullptr) continue;
+
+        const auto& content = sources[j].content;
+        auto [iter, inserted] = batch_contents.try_emplace({content.first, content.second, srgb}, to_decode.size());
+        if (!inserted && !same_contents(file, sources[j], std::get<0>(files[missing[to_decode[iter->second]].first]))) {
+            // Only the hash matched, so it is decoded on its own
+            decoded_by[j] = to_decode.size();
+            to_decode.push_back(j);
+            continue;
+        }
+        if (inserted) to_decode.push_back(j);
+        decoded_by[j] = iter->second;
+    }
+
+    // Decode and build the mip chains in parallel, the rows of each image are also split across the pool
+    std::vector<ImageData> images(to_decode.size());
+    ThreadPool::shared().parallel_for(to_decode.size(), [&](size_t k) {
+        const auto& [index, last_write_time] = missing[to_decode[k]];
+        images[k] = decode_source(std::get<0>(files[index]), std::move(sources[to_decode[k]]), std::get<1>(files[index]), last_write_time);
+    });
+
+    // Uploading has to happen on the thread with the OpenGL context
+    std::vector<std::shared_ptr<TextureStorage>> uploaded(to_decode.size());
+    for (size_t k = 0; k < to_decode.size(); ++k) {
+        uploaded[k] = upload(std::move(images[k]), std::get<1>(files[missing[to_decode[k]].first]));
+    }
+
+    for (size_t j = 0; j < missing.size(); ++j) {
+        const auto& [index, last_write_time] = missing[j];
+        const auto& [file, srgb, flip_vertical] = files[index];
+        if (decoded_by[j].has_value()) {
+            storages[index] = uploaded[decoded_by[j].value()];
+        }
+        add_storage_to_cache(file, srgb, last_write_time, sources[j].content, storages[index]);
+    }
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (textures[i] != nullptr) continue;
+        const auto& [file, srgb, flip_vertical] = files[i];
+        textures[i] = std::make_shared<TextureHandle>(storages[i], srgb, flip_vertical, file);
+        cache[{file, srgb, flip_vertical}] = {last_write_times[i], textures[i]};
+    }
+
+    return textures;
+}
+
+void TextureLoader::update() {
+    for (const auto& file: file_watcher.poll_changes()) {
+        auto last_write_time = file_watcher.get_last_write_time(file);
+        if (!last_write_time.has_value()) continue; // Deleted, existing handles just keep the old version
+
+        for (bool srgb: {true, false}) {
+            auto existing = storage_cache.find({file, srgb});
+            if (existing == storage_cache.end() || existing->second.second.expired()) continue;
+
+            try {
+                // Point every handle to the file at the new storage, so everything using them sees the change,
+                // and the old storage gets freed once nothing else shares it.
+                auto storage = load_storage(file, srgb, last_write_time.value());
+                for (auto& [key, entry]: cache) {
+                    auto handle = entry.second.lock();
+                    if (handle == nullptr || std::get<0>(key) != file || std::get<1>(key) != srgb) continue;
+                    handle->storage = storage;
+                    entry.first = last_write_time.value();
+                }
+                std::cout << "Reloaded texture: [" << file << "]" << std::endl;
+            } catch (const std::exception& e) {
+                std::cerr << "Error while trying to reload texture file:" << std::endl;
+                std::cerr << e.what() << std::endl;
+            }
+        }
+
+        for (auto& [key, entry]: packed_cache) {
+            const auto& [diffuse_file, specular_file, flags] = key;
+            if (diffuse_file != file && specular_file != file) continue;
+
+            auto handle = entry.second.lock();
+            if (handle == nullptr) continue;
+
+            try {
+                bool srgb = (flags & PACKED_SRGB) != 0;
+                auto packed_write_time = get_packed_write_time(diffuse_file, specular_file);
+                handle->storage = upload(decode_packed_material(diffuse_file, specular_file, srgb), srgb);
+                entry.first = packed_write_time;
+                std::cout << "Reloaded packed material: [" << handle->get_filename().value() << "]" << std::endl;
+            } catch (const std::exception& e) {
+                std::cerr << "Error while trying to reload packed material:" << std::endl;
+                std::cerr << e.what() << std::endl;
+            }
+        }
+    }
+
+    if (file_watcher.get_listing_version() != available_textures_version) {
+        available_textures.reset();
+    }
+
+    report_shared_storage();
+}
+
+void TextureLoader::report_shared_storage() {
+    uint handle_count = 0;
+    size_t handle_bytes = 0;
+    std::unordered_set<const TextureStorage*> distinct{};
+    size_t distinct_bytes = 0;
+    for (const auto& [key, entry]: cache) {
+        auto handle = entry.second.lock();
+        if (handle == nullptr) continue;
+        handle_count++;
+        handle_bytes += handle->get_gpu_bytes();
+        if (distinct.insert(handle->get_storage().get()).second) {
+            distinct_bytes += handle->get_gpu_bytes();
+        }
+    }
+    asset_budget.report_shared(AssetBudget::Kind::Texture, handle_count - (uint) distinct.size(), handle_bytes - distinct_bytes);
+}
 
+std::filesystem::file_time_type TextureLoader::get_last_write_time(const std::string& file) const {
+    auto last_write_time = file_watcher.get_last_write_time(file);
+    const auto* packed = asset_pack != nullptr ? asset_pack->find(import_path + "/" + file) : nullptr;
+    if (packed != nullptr && (!last_write_time.has_value() || packed->last_write_time > last_write_time.value())) {
+        return packed->last_write_time;
+    }
+    if (!last_write_time.has_value()) {
+        throw std::runtime_error(Formatter() << "Failed to load texture file: " << import_path << "/" << file << "\n\t Reason: File does not exist");
+    }
+    return last_write_time.value();
+}
+
+const AssetPack::Entry* TextureLoader::find_packed(const std::string& file) const {
+    if (asset_pack == nullptr) return nullptr;
+    const auto* packed = asset_pack->find(import_path + "/" + file);
+    if (packed == nullptr) return nullptr;
+    auto loose_write_time = file_watcher.get_last_write_time(file);
+    return loose_write_time.has_value() && loose_write_time.value() > packed->last_write_time ? nullptr : packed;
+}
+
+std::shared_ptr<TextureHandle> TextureLoader::find_cached(const std::string& file, bool srgb, bool flip_vertical, std::filesystem::file_time_type last_write_time) const {
     auto existing = cache.find({file, srgb, flip_vertical});
     if (existing != cache.end()) {
         // Cache exist, so try lock
         auto handle = existing->second.second.lock();
-        if (handle != nullptr && existing->second.first >= last_write_time) {
+        if (handle != nullptr && existing->second.first >= last_write_time && handle->is_array_layer() == use_texture_arrays) {
             // Lock was successful and the cache is for an up-to-date version of the file, so can use it
             return handle;
         }
     }
+    return nullptr;
+}
+
+std::shared_ptr<TextureStorage> TextureLoader::find_cached_storage(const std::string& file, bool srgb, std::filesystem::file_time_type last_write_time) const {
+    auto existing = storage_cache.find({file, srgb});
+    if (existing != storage_cache.end()) {
+        auto storage = existing->second.second.lock();
+        if (storage != nullptr && existing->second.first >= last_write_time && storage->is_array_layer() == use_texture_arrays) {
+            return storage;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<TextureStorage> TextureLoader::find_by_content(const std::string& file, SourceImage& source, bool srgb) const {
+    auto existing = content_cache.find({source.content.first, source.content.second, srgb});
+    if (existing != content_cache.end()) {
+        const auto& [existing_file, weak_storage] = existing->second;
+        auto storage = weak_storage.lock();
+        if (storage != nullptr && storage->is_array_layer() == use_texture_arrays && same_contents(file, source, existing_file)) {
+            return storage;
+        }
+    }
+    return nullptr;
+}
+
+bool TextureLoader::same_contents(const std::string& file, SourceImage& source, const std::string& other_file) const {
+    if (file == other_file) return true;
+    try {
+        if (!source.contents.has_value()) source.contents = read_contents(file);
+        auto other_contents = read_contents(other_file);
+        return source.contents->get_size() == other_contents.get_size() &&
+               std::memcmp(source.contents->get_data(), other_contents.get_data(), source.contents->get_size()) == 0;
+    } catch (const std::exception&) {
+        // The other file has since been deleted, so there is nothing to compare against
+        return false;
+    }
+}
+
+FileContents TextureLoader::read_contents(const std::string& file) const {
+    std::string full_path = import_path + "/" + file;
+    return find_packed(file) != nullptr ? asset_pack->read(full_path) : FileContents::map(full_path);
+}
+
+std::shared_ptr<TextureStorage> TextureLoader::load_storage(const std::string& file, bool srgb, std::filesystem::file_time_type last_write_time) {
+    auto storage = find_cached_storage(file, srgb, last_write_time);
+    if (storage != nullptr) {
+        return storage;
+    }
+
+    auto source = open_file(file, srgb, last_write_time);
+    auto content = source.content;
+    storage = find_by_content(file, source, srgb);
+    if (storage == nullptr) {
+        storage = upload(decode_source(file, std::move(source), srgb, last_write_time), srgb);
+    }
+    add_storage_to_cache(file, srgb, last_write_time, content, storage);
+    return storage;
+}
+
+void TextureLoader::add_storage_to_cache(const std::string& file, bool srgb, std::filesystem::file_time_type last_write_time, const std::pair<size_t, size_t>& content, const std::shared_ptr<TextureStorage>& storage) {
+    storage_cache[{file, srgb}] = {last_write_time, storage};
+    content_cache[{content.first, content.second, srgb}] = {file, storage};
+
+    // The budget tracks the storage rather than the handles, so shared storage is only counted once.
+    // Storage shared with another file is already tracked under that file's name.
+    std::string name = Formatter() << file << (srgb ? " (sRGB)" : " (Linear)");
+    asset_budget.track(storage, AssetBudget::Kind::Texture, name, storage->get_gpu_bytes());
+}
+
+ImageData TextureLoader::bake_texture(const std::string& file, bool srgb) const {
+    return decode_file(file, srgb, get_last_write_time(file));
+}
+
+std::filesystem::path TextureLoader::mip_cache_file(const std::string& file, bool srgb) const {
+    // The filter and colour space both affect the generated mips, so they are part of the cache file name
+    return (Formatter() << cache_path << "/" << file << "." << (srgb ? "srgb" : "linear")
+                        << "." << (mip_filter == MipFilter::Kaiser ? "kaiser" : "box") << ".mips").str();
+}
+
+TextureLoader::SourceImage TextureLoader::open_file(const std::string& file, bool srgb, std::filesystem::file_time_type last_write_time) const {
+    SourceImage source{};
+    if (use_disk_cache && mip_filter != MipFilter::Driver) {
+        source.cached = MipChain::read_cache(mip_cache_file(file, srgb), (int64_t) last_write_time.time_since_epoch().count());
+        if (source.cached.has_value()) {
+            // The cache records the source's hash, so the source doesn't have to be read just to hash it
+            source.content = {(size_t) source.cached->source_hash, (size_t) source.cached->source_size};
+            return source;
+        }
+    }
+
+    source.contents = read_contents(file);
+    source.content = {std::hash<std::string_view>()(std::string_view(source.contents->get_data(), source.contents->get_size())), source.contents->get_size()};
+    return source;
+}
 
-    stbi_set_flip_vertically_on_load(flip_vertical);
+ImageData TextureLoader::decode_source(const std::string& file, SourceImage source, bool srgb, std::filesystem::file_time_type last_write_time) const {
+    if (source.cached.has_value()) {
+        return std::move(source.cached.value());
+    }
+    if (!source.contents.has_value()) {
+        source.contents = read_contents(file);
+    }
 
-    int width, height;
-    stbi_uc* data = stbi_load(full_path.c_str(), &width, &height, nullptr, STBI_rgb);
+    int width, height, channels;
+    stbi_uc* data = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(source.contents->get_data()), (int) source.contents->get_size(), &width, &height, &channels, 0);
     if (!data) {
-        throw std::runtime_error(Formatter() << "Failed to load texture file: " << full_path << "\n\t Reason: " << stbi_failure_reason());
+        throw std::runtime_error(Formatter() << "Failed to load texture file: " << import_path << "/" << file << "\n\t Reason: " << stbi_failure_reason());
+    }
+
+    ImageData image{(uint) width, (uint) height, (uint) channels, {}, source.content.first, source.content.second};
+    image.levels.emplace_back(data, data + (size_t) width * height * channels);
+    stbi_image_free(data);
+
+    compact_channels(image, srgb);
+    MipChain::build(image, srgb, mip_filter);
+
+    if (use_disk_cache && mip_filter != MipFilter::Driver) {
+        MipChain::write_cache(mip_cache_file(file, srgb), (int64_t) last_write_time.time_since_epoch().count(), image);
+    }
+
+    return image;
+}
+
+ImageData TextureLoader::decode_file(const std::string& file, bool srgb, std::filesystem::file_time_type last_write_time) const {
+    return decode_source(file, open_file(file, srgb, last_write_time), srgb, last_write_time);
+}
+
+std::shared_ptr<TextureStorage> TextureLoader::upload(ImageData image, bool srgb) {
+    static float max_ani = get_max_anisotropy();
+
+    if (use_texture_arrays) {
+        // The array's storage and layer allocation belong to the render thread, so these are always uploaded here.
+        // glGenerateMipmap would regenerate every layer of the array, so layers always bring their own mip chain.
+        if (image.levels.size() < MipChain::level_count(image.width, image.height)) {
+            MipChain::build(image, srgb, MipFilter::Box);
+        }
+        return load_into_texture_array(image, srgb, max_ani);
     }
 
     uint texture_id;
     glGenTextures(1, &texture_id);
+    uint width = image.width;
+    uint height = image.height;
+
+    if (auto* upload_thread = UploadThread::active()) {
+        size_t bytes = 0;
+        for (const auto& level: image.levels) bytes += level.size();
+        uint channels = image.channels;
+        auto pending_upload = upload_thread->submit([texture_id, srgb, image = std::move(image)]() {
+            upload_levels(texture_id, image, srgb, max_ani);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }, bytes);
+
+        auto storage = std::make_shared<TextureStorage>(texture_id, width, height, channels);
+        storage->pending_upload = std::move(pending_upload);
+        return storage;
+    }
+
+    upload_levels(texture_id, image, srgb, max_ani);
+    return std::make_shared<TextureStorage>(texture_id, width, height, image.channels);
+}
+
+void TextureLoader::upload_levels(uint texture_id, const ImageData& image, bool srgb, float max_anisotropy) {
     glBindTexture(GL_TEXTURE_2D, texture_id);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, max_ani);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, max_anisotropy);
+    auto texture_format = TextureFormat::from_channels(image.channels, srgb);
+    texture_format.apply_swizzle(GL_TEXTURE_2D);
+
+    // Rows of 1 to 3 channel data are not necessarily 4 byte aligned, especially in the smaller mips
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint level = 0; level < image.levels.size(); ++level) {
+        auto size = image.level_size(level);
+        glTexImage2D(GL_TEXTURE_2D, (int) level, texture_format.internal_format, (int) size.x, (int) size.y, 0, texture_format.format, GL_UNSIGNED_BYTE, image.levels[level].data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (image.levels.size() == 1) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+}
 
-    glTexImage2D(GL_TEXTURE_2D, 0, srgb ? GL_SRGB : GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+std::shared_ptr<TextureStorage> TextureLoader::load_into_texture_array(const ImageData& image, bool srgb, float max_anisotropy) {
+    uint width = image.width;
+    uint height = image.height;
+    auto& pools = texture_arrays[{width, height, TextureFormat::from_channels(image.channels, srgb).internal_format}];
+    // Drop any pools that have had all their layers released
+    pools.erase(std::remove_if(pools.begin(), pools.end(), [](const auto& pool) { return pool.expired(); }), pools.end());
+
+    std::shared_ptr<TextureArray> texture_array{};
+    for (const auto& weak_pool: pools) {
+        auto pool = weak_pool.lock();
+        if (!pool->is_full()) {
+            texture_array = pool;
+            break;
+        }
+    }
 
-    stbi_image_free(data);
+    if (texture_array == nullptr) {
+        // Size the pool so that large textures don't reserve huge amounts of memory for layers that might never be used
+        size_t layer_bytes = (size_t) width * height * TextureFormat::bytes_per_texel(image.channels) * 4 / 3; // Including mipmaps
+        uint capacity = (uint) std::clamp<size_t>(TEXTURE_ARRAY_TARGET_BYTES / layer_bytes, 1, TEXTURE_ARRAY_MAX_LAYERS);
+        texture_array = std::make_shared<TextureArray>(width, height, image.channels, srgb, capacity, max_anisotropy);
+        pools.push_back(texture_array);
+    }
 
-    auto texture = std::make_shared<TextureHandle>(texture_id, width, height, srgb, flip_vertical, file);
+    uint layer = texture_array->allocate_layer(image).value(); // Can't fail, since the array was checked to not be full
+    return std::make_shared<TextureStorage>(texture_array, layer, width, height, image.channels);
+}
 
-    cache[{file, srgb, flip_vertical}] = {last_write_time, texture};
+void TextureLoader::set_use_texture_arrays(bool enabled) {
+    use_texture_arrays = enabled;
+}
+
+bool TextureLoader::get_use_texture_arrays() const {
+    return use_texture_arrays;
+}
+
+void TextureLoader::set_mip_filter(MipFilter filter) {
+    mip_filter = filter;
+}
+
+MipFilter TextureLoader::get_mip_filter() const {
+    return mip_filter;
+}
+
+void TextureLoader::set_use_packed_materials(bool enabled) {
+    use_packed_materials = enabled;
+}
+
+bool TextureLoader::get_use_packed_materials() const {
+    return use_packed_materials;
+}
+
+std::shared_ptr<TextureHandle> TextureLoader::load_packed_material(const std::shared_ptr<TextureHandle>& diffuse, const std::shared_ptr<TextureHandle>& specular_map) {
+    if (diffuse == nullptr || specular_map == nullptr || !diffuse->get_filename().has_value() || !specular_map->get_filename().has_value()) return nullptr;
+    const auto& diffuse_file = diffuse->get_filename().value();
+    const auto& specular_file = specular_map->get_filename().value();
+    if (special_names.count(diffuse_file) != 0) return nullptr;
+
+    // The white and black textures just become a constant alpha, otherwise the specular map has to line up texel for texel,
+    // and be grey, since only a single channel fits in the alpha
+    if (special_names.count(specular_file) == 0) {
+        if (specular_map->get_size() != diffuse->get_size() || specular_map->get_channels() != 1) return nullptr;
+        if (specular_map->is_flipped() != diffuse->is_flipped() || specular_map->is_srgb()) return nullptr;
+    }
+
+    bool srgb = diffuse->is_srgb();
+    bool flip_vertical = diffuse->is_flipped();
+    auto last_write_time = get_packed_write_time(diffuse_file, specular_file);
+
+    std::tuple<std::string, std::string, int> key{diffuse_file, specular_file, (srgb ? PACKED_SRGB : 0) | (flip_vertical ? PACKED_FLIPPED : 0)};
+    auto existing = packed_cache.find(key);
+    if (existing != packed_cache.end()) {
+        auto handle = existing->second.second.lock();
+        if (handle != nullptr && existing->second.first >= last_write_time && handle->is_array_layer() == use_texture_arrays) {
+            return handle;
+        }
+    }
 
+    std::string name = Formatter() << diffuse_file << " + " << specular_file;
+    auto texture = std::make_shared<TextureHandle>(upload(decode_packed_material(diffuse_file, specular_file, srgb), srgb), srgb, flip_vertical, name);
+    packed_cache[key] = {last_write_time, texture};
+    asset_budget.track(texture, AssetBudget::Kind::Texture, Formatter() << name << " (Packed)", texture->get_gpu_bytes());
     return texture;
 }
 
+std::filesystem::file_time_type TextureLoader::get_packed_write_time(const std::string& diffuse_file, const std::string& specular_file) const {
+    auto last_write_time = get_last_write_time(diffuse_file);
+    if (special_names.count(specular_file) == 0) {
+        last_write_time = std::max(last_write_time, get_last_write_time(specular_file));
+    }
+    return last_write_time;
+}
+
+ImageData TextureLoader::decode_packed_material(const std::string& diffuse_file, const std::string& specular_file, bool srgb) const {
+    auto diffuse = decode_file(diffuse_file, srgb, get_last_write_time(diffuse_file));
+
+    std::optional<ImageData> specular{};
+    if (special_names.count(specular_file) == 0) {
+        specular = decode_file(specular_file, false, get_last_write_time(specular_file));
+        if (specular->width != diffuse.width || specular->height != diffuse.height || specular->channels != 1 || specular->levels.size() != diffuse.levels.size()) {
+            throw std::runtime_error(Formatter() << "Can't pack specular map " << specular_file << " into " << diffuse_file << ", it must be a single channel image of the same size");
+        }
+    }
+    unsigned char constant_specular = specular_file == BLACK_TEXTURE_NAME ? 0x00 : 0xFF;
+
+    // Each level of the specular map's own chain goes into the matching level's alpha, which GL keeps linear even for sRGB textures
+    ImageData packed{diffuse.width, diffuse.height, 4, {}};
+    packed.levels.resize(diffuse.levels.size());
+    ThreadPool::shared().parallel_for(diffuse.levels.size(), [&](size_t level) {
+        auto size = diffuse.level_size((uint) level);
+        size_t pixel_count = (size_t) size.x * size.y;
+        const auto& colour = diffuse.levels[level];
+        auto& out = packed.levels[level];
+        out.resize(pixel_count * 4);
+        for (size_t i = 0; i < pixel_count; ++i) {
+            for (uint c = 0; c < 3; ++c) {
+                out[i * 4 + c] = colour[i * diffuse.channels + (diffuse.channels >= 3 ? c : 0)];
+            }
+            out[i * 4 + 3] = specular.has_value() ? specular->levels[level][i] : constant_specular;
+        }
+    });
+    return packed;
+}
+
+void TextureLoader::add_imgui_options_section() {
+    if (ImGui::CollapsingHeader("Texture Loader")) {
+        ImGui::Checkbox("Batch Into Texture Arrays", &use_texture_arrays);
+        ImGui::SameLine();
+        ImGui::HelpMarker("Pack textures of the same size and format into shared texture arrays, so entities can be drawn without rebinding textures. Only applies to textures loaded after changing it.");
+
+        uint array_count = 0;
+        uint used_layers = 0;
+        uint total_layers = 0;
+        for (const auto& [key, pools]: texture_arrays) {
+            for (const auto& weak_pool: pools) {
+                auto pool = weak_pool.lock();
+                if (pool == nullptr) continue;
+                array_count++;
+                used_layers += pool->get_used_layers();
+                total_layers += pool->get_capacity();
+            }
+        }
+        ImGui::Text("Texture Arrays: %u (%u/%u layers used)", array_count, used_layers, total_layers);
+
+        ImGui::Separator();
+
+        if (ImGui::BeginCombo("Mipmap Filter", MipChain::filter_name(mip_filter))) {
+            for (auto filter: {MipFilter::Driver, MipFilter::Box, MipFilter::Kaiser}) {
+                if (ImGui::Selectable(MipChain::filter_name(filter), filter == mip_filter)) {
+                    mip_filter = filter;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::SameLine();
+        ImGui::HelpMarker("Box and Kaiser build the mip chain on the CPU, in linear space and in parallel, then upload every level. Only applies to textures loaded after changing it.");
+
+        ImGui::Checkbox("Cache Mip Chains On Disk", &use_disk_cache);
+        ImGui::SameLine();
+        ImGui::HelpMarker("Store generated mip chains, so they are only built once per asset rather than once per run.");
+
+        ImGui::Checkbox("Pack Specular Into Diffuse Alpha", &use_packed_materials);
+        ImGui::SameLine();
+        ImGui::HelpMarker("Lit entities whose specular map is grey and the same size as their diffuse texture (or plain white or black), with matching texture scales, are drawn with a single texture holding the specular map in its alpha, halving the texture binds. The packed textures are kept alongside the originals.");
+    }
+}
+
 std::shared_ptr<TextureHandle> TextureLoader::default_white_texture() {
     if (default_white_texture_cache != nullptr) return default_white_texture_cache;
 
@@ -97,7 +647,8 @@ std::shared_ptr<TextureHandle> TextureLoader::default_white_texture() {
 
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, DEFAULT_TEXTURE_SIZE, DEFAULT_TEXTURE_SIZE, 0, GL_RGB, GL_UNSIGNED_BYTE, &default_white_texture_data[0]);
 
-    default_white_texture_cache = std::make_shared<TextureHandle>(texture_id, DEFAULT_TEXTURE_SIZE, DEFAULT_TEXTURE_SIZE, false, false, WHITE_TEXTURE_NAME);
+    auto storage = std::make_shared<TextureStorage>(texture_id, DEFAULT_TEXTURE_SIZE, DEFAULT_TEXTURE_SIZE, DEFAULT_TEXTURE_BPP);
+    default_white_texture_cache = std::make_shared<TextureHandle>(storage, false, false, WHITE_TEXTURE_NAME);
     return default_white_texture_cache;
 }
 
@@ -115,7 +666,8 @@ std::shared_ptr<TextureHandle> TextureLoader::default_black_texture() {
 
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, DEFAULT_TEXTURE_SIZE, DEFAULT_TEXTURE_SIZE, 0, GL_RGB, GL_UNSIGNED_BYTE, &default_black_texture_data[0]);
 
-    default_black_texture_cache = std::make_shared<TextureHandle>(texture_id, DEFAULT_TEXTURE_SIZE, DEFAULT_TEXTURE_SIZE, false, false, BLACK_TEXTURE_NAME);
+    auto storage = std::make_shared<TextureStorage>(texture_id, DEFAULT_TEXTURE_SIZE, DEFAULT_TEXTURE_SIZE, DEFAULT_TEXTURE_BPP);
+    default_black_texture_cache = std::make_shared<TextureHandle>(storage, false, false, BLACK_TEXTURE_NAME);
     return default_black_texture_cache;
 }
 
@@ -192,14 +744,17 @@ const std::vector<std::string>& TextureLoader::get_available_textures(bool force
     if (!force_refresh && available_textures.has_value()) {
         return available_textures.value();
     }
-    available_textures = std::vector<std::string>{};
-    available_textures->push_back(WHITE_TEXTURE_NAME);
-    available_textures->push_back(BLACK_TEXTURE_NAME);
-
-    for (auto const& dir_entry: std::filesystem::recursive_directory_iterator(import_path)) {
-        available_textures->push_back(std::filesystem::relative(dir_entry, import_path).string());
+    // The watcher keeps the listing up-to-date, so there is no need to rescan the directory
+    available_textures_version = file_watcher.get_listing_version();
+    available_textures = std::vector<std::string>{WHITE_TEXTURE_NAME, BLACK_TEXTURE_NAME};
+    auto files = file_watcher.list_files();
+    if (asset_pack != nullptr) {
+        auto packed = asset_pack->list(import_path);
+        std::vector<std::string> merged{};
+        std::set_union(files.begin(), files.end(), packed.begin(), packed.end(), std::back_inserter(merged));
+        files = std::move(merged);
     }
-    std::sort(available_textures.value().begin() + 2, available_textures.value().end());
+    available_textures->insert(available_textures->end(), files.begin(), files.end());
 
     return available_textures.value();
 }
@@ -11,10 +11,24 @@
 #include <unordered_map>
 
 #include "TextureHandle.h"
+#include "TextureArray.h"
+#include "MipChain.h"
+#include "AssetBudget.h"
+#include "utility/FileWatcher.h"
+#include "utility/AssetPack.h"
 
 /// A loader class intended for the use of loading textures from disk. Includes caching functionality.
 class TextureLoader {
     std::string import_path;
+    std::string cache_path;
+    AssetBudget& asset_budget;
+    FileWatcher file_watcher;
+    // Files in the pack are read from it instead of from disk, unless the loose file is newer
+    const AssetPack* asset_pack;
+
+    MipFilter mip_filter = MipFilter::Box;
+    bool use_disk_cache = true;
+    bool use_packed_materials = false;
 
     static constexpr int DEFAULT_TEXTURE_SIZE = 16;
     static constexpr int DEFAULT_TEXTURE_BPP = 3;
@@ -27,17 +41,59 @@ class TextureLoader {
     std::unordered_set<std::string> special_names;
 
     std::optional<std::vector<std::string>> available_textures{};
+    uint64_t available_textures_version = 0;
 
     // Map (relative_path, srgb, is_flipped) -> (last_modified, weak_handle)
     std::unordered_map<std::tuple<std::string, bool, bool>, std::pair<std::filesystem::file_time_type, std::weak_ptr<TextureHandle>>, TripleHash> cache{};
+    // The flip is applied to the texture coordinates, so both flips of a file share its storage.
+    // Map (relative_path, srgb) -> (last_modified, weak_storage)
+    std::unordered_map<std::pair<std::string, bool>, std::pair<std::filesystem::file_time_type, std::weak_ptr<TextureStorage>>, PairHash> storage_cache{};
+    // Files with byte-identical contents share storage too, whatever their names. A matching hash and size is only a candidate,
+    // the bytes are compared against the file the storage was loaded from before sharing it.
+    // Map (content_hash, content_size, srgb) -> (file, weak_storage)
+    std::unordered_map<std::tuple<size_t, size_t, bool>, std::pair<std::string, std::weak_ptr<TextureStorage>>, TripleHash> content_cache{};
+
+    /// A file about to be decoded, as its mip chain if the disk cache has it, otherwise as its bytes, along with the (hash, size) of its bytes.
+    /// So a file is read once, whether or not it turns out to be identical to one that is already loaded.
+    struct SourceImage {
+        std::optional<ImageData> cached{};
+        std::optional<FileContents> contents{};
+        std::pair<size_t, size_t> content{};
+    };
+
+    // Texture array batching, pools are only kept alive by the handles to their layers
+    static constexpr uint TEXTURE_ARRAY_MAX_LAYERS = 16;
+    static constexpr size_t TEXTURE_ARRAY_TARGET_BYTES = 64 * 1024 * 1024;
+    bool use_texture_arrays = false;
+    // Map (width, height, internal_format) -> [weak_array]
+    std::unordered_map<std::tuple<uint, uint, int>, std::vector<std::weak_ptr<TextureArray>>, TripleHash> texture_arrays{};
+
+    // Flags in the key of packed_cache
+    static constexpr int PACKED_SRGB = 1;
+    static constexpr int PACKED_FLIPPED = 2;
+    // Map (diffuse_path, specular_path, flags) -> (last_modified of either, weak_handle)
+    std::unordered_map<std::tuple<std::string, std::string, int>, std::pair<std::filesystem::file_time_type, std::weak_ptr<TextureHandle>>, TripleHash> packed_cache{};
 public:
     /// Construct the loader with a import_path which is prepended to any path you try and load.
-    /// It also scans the directory for all files, which is used to populate the list of get_available_textures()
-    explicit TextureLoader(std::string import_path);
+    /// It also scans the directory for all files, which along with any files under import_path in the AssetPack, is used to populate the list of get_available_textures()
+    /// Every texture loaded from file is tracked by the asset_budget, and generated mip chains are cached on disk under cache_path.
+    TextureLoader(std::string import_path, AssetBudget& asset_budget, std::string cache_path = "cache/textures");
 
     /// Loads the file at the specified path into GPU memory, with flags for if the texture is sRGB and to flip it vertically.
     std::shared_ptr<TextureHandle> load_from_file(const std::string& file, bool srgb = true, bool flip_vertical = false);
 
+    /// Loads a batch of (file, srgb, flip_vertical) textures, decoding and building the mip chains for all of them in parallel
+    /// before uploading them. Returns the handles in the same order as the input.
+    std::vector<std::shared_ptr<TextureHandle>> load_from_files(const std::vector<std::tuple<std::string, bool, bool>>& files);
+
+    /// Decode the file and build its mip chain, writing it to the disk cache, without touching OpenGL.
+    /// Safe to call from many threads at once, which the offline asset baker does to fill the cache ahead of time.
+    ImageData bake_texture(const std::string& file, bool srgb) const;
+
+    /// Re-import any loaded textures whose files have changed on disk, in place, so existing handles pick up the change.
+    /// Also reports how much memory is being saved by handles sharing storage to the asset budget. Should be called once per frame.
+    void update();
+
     /// Provides a pure white (0xFFFFFF) texture
     std::shared_ptr<TextureHandle> default_white_texture();
     /// Provides a pure black (0x000000) texture
@@ -47,11 +103,71 @@ public:
     /// If the prefer_srgb flag is selected, then when going from no texture to a valid texture it will default to enabling srgb.
     void add_imgui_texture_selector(const std::string& caption, std::shared_ptr<TextureHandle>& texture_handle, bool prefer_srgb = true);
     /// Helper method to provide a selector over all the texture files in the import_path directory.
-    /// if force_refresh is selected, it will rescan the directory, otherwise it just uses a cached list from the last scan.
+    /// The list is kept up-to-date by a file watcher, force_refresh just rebuilds it from the watcher's index.
     const std::vector<std::string>& get_available_textures(bool force_refresh = false);
 
+    /// When enabled, textures loaded from file are packed into GL_TEXTURE_2D_ARRAY pools of matching size and format,
+    /// so that renderers can draw entities with different textures without rebinding. Only affects textures loaded after the change.
+    void set_use_texture_arrays(bool enabled);
+    [[nodiscard]] bool get_use_texture_arrays() const;
+
+    /// The filter used to build the mip chains of textures loaded after the change, which are cached separately for each filter
+    void set_mip_filter(MipFilter filter);
+    [[nodiscard]] MipFilter get_mip_filter() const;
+
+    /// Whether renderers should draw lit entities with the specular map packed into the diffuse texture's alpha, see load_packed_material()
+    void set_use_packed_materials(bool enabled);
+    [[nodiscard]] bool get_use_packed_materials() const;
+    /// A texture with the diffuse texture's colour and the specular map in its alpha, so that both are sampled with a single bind.
+    /// Returns nullptr if they can't be packed, when the specular map isn't a single channel image of the same size, or either isn't from a file.
+    std::shared_ptr<TextureHandle> load_packed_material(const std::shared_ptr<TextureHandle>& diffuse, const std::shared_ptr<TextureHandle>& specular_map);
+
+    /// Adds the ImGUI controls for the loader settings, and some stats about the texture array pools
+    void add_imgui_options_section();
+
     /// Free up any resources.
     void cleanup();
+private:
+    /// The modification time of the file from the watcher's index or the asset pack, whichever is newer, throws if the file does not exist
+    std::filesystem::file_time_type get_last_write_time(const std::string& file) const;
+    /// The asset pack's entry for the file, if it should be read from there, since the loose file is missing or isn't newer than the packed copy
+    const AssetPack::Entry* find_packed(const std::string& file) const;
+    /// Returns the cached handle for the file and settings if there is one, and it is up-to-date, otherwise nullptr
+    std::shared_ptr<TextureHandle> find_cached(const std::string& file, bool srgb, bool flip_vertical, std::filesystem::file_time_type last_write_time) const;
+    /// Returns the cached storage for the file if there is one, and it is up-to-date, otherwise nullptr
+    std::shared_ptr<TextureStorage> find_cached_storage(const std::string& file, bool srgb, std::filesystem::file_time_type last_write_time) const;
+    /// Returns the storage of an already loaded file with byte-identical contents if there is one, otherwise nullptr
+    std::shared_ptr<TextureStorage> find_by_content(const std::string& file, SourceImage& source, bool srgb) const;
+    /// Whether the file's bytes are identical to other_file's, reading the file's bytes into source if it was cached
+    bool same_contents(const std::string& file, SourceImage& source, const std::string& other_file) const;
+    /// The file's bytes, from the asset pack or the memory mapped file
+    FileContents read_contents(const std::string& file) const;
+    /// Find the storage for the file through the caches, otherwise decode and upload it
+    std::shared_ptr<TextureStorage> load_storage(const std::string& file, bool srgb, std::filesystem::file_time_type last_write_time);
+    /// The path of the file's cached mip chain, which depends on the filter and colour space
+    std::filesystem::path mip_cache_file(const std::string& file, bool srgb) const;
+    /// The first half of decoding, reads the file's cached mip chain, or if it isn't cached, its bytes. Safe to call from worker threads.
+    SourceImage open_file(const std::string& file, bool srgb, std::filesystem::file_time_type last_write_time) const;
+    /// The second half of decoding, decodes the image if it wasn't cached, and builds the mip chain.
+    /// Doesn't touch OpenGL, so is safe to call from worker threads.
+    ImageData decode_source(const std::string& file, SourceImage source, bool srgb, std::filesystem::file_time_type last_write_time) const;
+    /// The CPU side of loading, open_file and decode_source in one
+    ImageData decode_file(const std::string& file, bool srgb, std::filesystem::file_time_type last_write_time) const;
+    /// The newer of the two files' modification times, where the specular map may be one of the special textures
+    std::filesystem::file_time_type get_packed_write_time(const std::string& diffuse_file, const std::string& specular_file) const;
+    /// Decode both textures and combine each level of their mip chains into an RGBA image
+    ImageData decode_packed_material(const std::string& diffuse_file, const std::string& specular_file, bool srgb) const;
+    /// Upload every level of the image, as a standalone texture or into a texture array depending on the settings.
+    /// Standalone textures are uploaded on the UploadThread if there is an active one, which takes ownership of the image.
+    std::shared_ptr<TextureStorage> upload(ImageData image, bool srgb);
+    /// Set the parameters of the texture and upload every level of the image into it, on whichever thread's context is current
+    static void upload_levels(uint texture_id, const ImageData& image, bool srgb, float max_anisotropy);
+    /// Upload the image, which must have a full mip chain, into a layer of a matching texture array, creating a new array if all the matching ones are full
+    std::shared_ptr<TextureStorage> load_into_texture_array(const ImageData& image, bool srgb, float max_anisotropy);
+    /// Store newly loaded storage in the caches, and start tracking it in the asset budget
+    void add_storage_to_cache(const std::string& file, bool srgb, std::filesystem::file_time_type last_write_time, const std::pair<size_t, size_t>& content, const std::shared_ptr<TextureStorage>& storage);
+    /// Count the handles sharing storage with another, and report the memory it saves to the asset budget
+    void report_shared_storage();
 };
 
 
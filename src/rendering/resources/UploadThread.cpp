@@ -0,0 +1,164 @@
+#include "UploadThread.h"
+
+#include <chrono>
+#include <utility>
+#include <cassert>
+
+#define GLFW_INCLUDE_NONE
+
+#include <GLFW/glfw3.h>
+
+#include "rendering/imgui/ImGuiManager.h"
+
+std::atomic<uint64_t> PendingUpload::total_wait_ns = 0;
+std::atomic<uint64_t> PendingUpload::wait_count = 0;
+
+UploadThread* UploadThread::instance = nullptr;
+
+void PendingUpload::submit(GLsync upload_fence, std::exception_ptr job_exception) {
+    {
+        std::lock_guard lock(mutex);
+        fence = upload_fence;
+        exception = std::move(job_exception);
+        submitted = true;
+    }
+    submitted_cv.notify_all();
+}
+
+void PendingUpload::wait() {
+    std::unique_lock lock(mutex);
+    if (!submitted) {
+        // The job is still queued, so the render thread has to block until the upload thread gets to it
+        auto start = std::chrono::steady_clock::now();
+        submitted_cv.wait(lock, [this]() { return submitted; });
+        total_wait_ns += (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        wait_count++;
+    }
+
+    if (fence != nullptr) {
+        // Only the GPU waits here, the CPU carries on recording the frame
+        glWaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    if (exception != nullptr) {
+        std::rethrow_exception(std::exchange(exception, nullptr));
+    }
+}
+
+bool PendingUpload::is_submitted() {
+    std::lock_guard lock(mutex);
+    return submitted;
+}
+
+double PendingUpload::get_total_wait_ms() {
+    return (double) total_wait_ns / 1e6;
+}
+
+uint64_t PendingUpload::get_wait_count() {
+    return wait_count;
+}
+
+PendingUpload::~PendingUpload() {
+    if (fence != nullptr) {
+        glDeleteSync(fence);
+    }
+}
+
+UploadThread::UploadThread(Window context_window) : context_window(std::move(context_window)) {
+    assert(instance == nullptr);
+    instance = this;
+    thread = std::thread(&UploadThread::thread_loop, this);
+}
+
+std::shared_ptr<PendingUpload> UploadThread::submit(std::function<void()> job, size_t bytes) {
+    auto pending = std::make_shared<PendingUpload>();
+    {
+        std::lock_guard lock(mutex);
+        jobs.emplace_back(std::move(job), pending);
+    }
+    job_available.notify_one();
+    uploaded_bytes += bytes;
+    return pending;
+}
+
+UploadThread* UploadThread::active() {
+    return instance != nullptr && instance->enabled ? instance : nullptr;
+}
+
+void UploadThread::set_enabled(bool value) {
+    enabled = value;
+}
+
+bool UploadThread::get_enabled() const {
+    return enabled;
+}
+
+void UploadThread::add_imgui_options_section() {
+    if (ImGui::CollapsingHeader("Upload Thread")) {
+        bool use_thread = enabled;
+        if (ImGui::Checkbox("Upload On Loader Thread", &use_thread)) {
+            enabled = use_thread;
+        }
+        ImGui::SameLine();
+        ImGui::HelpMarker("Run buffer and texture uploads on a separate thread with a shared OpenGL context, with the render thread only waiting on a fence before first use. Compare the frame time graph while loading assets with it on and off. Uploads into texture arrays always run on the render thread. Only applies to assets loaded after changing it.");
+
+        size_t queued;
+        {
+            std::lock_guard lock(mutex);
+            queued = jobs.size();
+        }
+        uint64_t completed = completed_uploads;
+        ImGui::Text("Uploads: %llu completed, %zu queued", (unsigned long long) completed, queued);
+        ImGui::Text("Uploaded: %.2f MiB", (double) uploaded_bytes / (1024.0 * 1024.0));
+        ImGui::Text("Upload thread time: %.2f ms (%.3f ms avg)", (double) upload_ns / 1e6, completed > 0 ? (double) upload_ns / 1e6 / (double) completed : 0.0);
+        ImGui::Text("Render thread blocked: %.2f ms over %llu waits", PendingUpload::get_total_wait_ms(), (unsigned long long) PendingUpload::get_wait_count());
+    }
+}
+
+UploadThread::~UploadThread() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    job_available.notify_all();
+    thread.join();
+    instance = nullptr;
+}
+
+void UploadThread::thread_loop() {
+    // The function pointers loaded for the render thread's context are used as is,
+    // since both contexts are from the same driver, and reloading them would race with the render thread.
+    context_window.make_context_current();
+
+    while (true) {
+        std::pair<std::function<void()>, std::shared_ptr<PendingUpload>> job;
+        {
+            std::unique_lock lock(mutex);
+            job_available.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            // Drain the queue before stopping, since the render thread may still be waiting on some of them
+            if (jobs.empty()) break;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        // The fence still goes in if the job throws, otherwise the render thread would wait on it forever
+        std::exception_ptr exception = nullptr;
+        try {
+            job.first();
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // The fence has to reach the GPU before another context can wait on it
+        glFlush();
+        upload_ns += (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        completed_uploads++;
+
+        job.second->submit(fence, std::move(exception));
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
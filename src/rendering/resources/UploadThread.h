@@ -0,0 +1,100 @@
+#ifndef UPLOAD_THREAD_H
+#define UPLOAD_THREAD_H
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+#include <glad/gl.h>
+
+#include "utility/HelperTypes.h"
+#include "system_interfaces/Window.h"
+
+/// The completion of a single job on the UploadThread, which the render thread waits on before it first uses the uploaded objects.
+class PendingUpload : private NonCopyable {
+    std::mutex mutex{};
+    std::condition_variable submitted_cv{};
+    bool submitted = false;
+    // Signalled by the GPU once the upload's commands have completed, owned by the render thread once submitted
+    GLsync fence = nullptr;
+    // What the job threw, if it did, passed on to the render thread by wait()
+    std::exception_ptr exception = nullptr;
+
+    // Time the render thread has spent blocked on uploads that hadn't been run yet, in nanoseconds
+    static std::atomic<uint64_t> total_wait_ns;
+    static std::atomic<uint64_t> wait_count;
+
+    friend class UploadThread;
+    /// Called by the upload thread once it has issued the commands and flushed them, even if the job threw part way through
+    void submit(GLsync upload_fence, std::exception_ptr job_exception);
+public:
+    PendingUpload() = default;
+
+    /// Wait for the upload to be issued, then make the calling context's command stream wait on the GPU for it to complete.
+    /// Must be called on the render thread before it first binds the uploaded objects, and they must be bound again afterwards.
+    /// If the job threw, the exception is rethrown here, once, after which the objects are left however far the job got.
+    void wait();
+    /// Whether the upload has been issued, and wait() will only have to insert a GPU side wait
+    [[nodiscard]] bool is_submitted();
+
+    /// The total time the render thread has spent blocked in wait(), in milliseconds
+    static double get_total_wait_ms();
+    /// The number of times wait() had to block
+    static uint64_t get_wait_count();
+
+    ~PendingUpload();
+};
+
+/// A thread with its own OpenGL context, shared with the render thread's, that runs buffer and texture uploads
+/// so that the driver's copies and allocations don't stall the frame.
+///
+/// Each job is followed by a fence, which the render thread waits on through the job's PendingUpload before first use.
+/// Objects that aren't shared between contexts (VAOs and FBOs) still have to be created on the render thread.
+class UploadThread : private NonCopyable {
+    Window context_window;
+    std::thread thread{};
+
+    std::mutex mutex{};
+    std::condition_variable job_available{};
+    std::deque<std::pair<std::function<void()>, std::shared_ptr<PendingUpload>>> jobs{};
+    bool stopping = false;
+
+    std::atomic<bool> enabled = true;
+
+    std::atomic<uint64_t> completed_uploads = 0;
+    std::atomic<uint64_t> uploaded_bytes = 0;
+    std::atomic<uint64_t> upload_ns = 0;
+
+    static UploadThread* instance;
+public:
+    /// Start the thread on a hidden window whose context shares objects with the render thread's,
+    /// see WindowManager::create_shared_context_window(). The window must outlive this.
+    /// Only one can exist at a time, since the loaders find it through active().
+    explicit UploadThread(Window context_window);
+
+    /// Queue a job to be run with the upload context current. Whatever the job reads must be owned by it,
+    /// since it runs after this returns. bytes is only used for the stats.
+    std::shared_ptr<PendingUpload> submit(std::function<void()> job, size_t bytes);
+
+    /// The running upload thread if there is one and it is enabled, otherwise nullptr, in which case loaders upload on the calling thread
+    static UploadThread* active();
+
+    /// Toggle whether loaders use the thread, to compare frame times with and without it. Only affects uploads after the change.
+    void set_enabled(bool value);
+    [[nodiscard]] bool get_enabled() const;
+
+    /// Adds the ImGUI toggle and stats about the uploads so far
+    void add_imgui_options_section();
+
+    /// Finishes any queued jobs before stopping the thread
+    ~UploadThread();
+private:
+    void thread_loop();
+};
+
+#endif //UPLOAD_THREAD_H
@@ -0,0 +1,36 @@
+#include "VertexAnimation.h"
+
+#include <glm/gtc/packing.hpp>
+
+namespace {
+    /// -1 for negative values, otherwise 1, unlike glm::sign which gives 0 for 0
+    glm::vec2 sign_not_zero(const glm::vec2& v) {
+        return {v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f};
+    }
+}
+
+glm::uvec4 VertexAnimation::pack_vertex(const glm::vec3& position, const glm::vec3& normal) {
+    // Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half out over the corners of the upper
+    float l1_norm = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    glm::vec2 octahedral = l1_norm > 0.0f ? glm::vec2{normal.x, normal.y} / l1_norm : glm::vec2{0.0f};
+    if (l1_norm > 0.0f && normal.z < 0.0f) {
+        octahedral = (1.0f - glm::abs(glm::vec2{octahedral.y, octahedral.x})) * sign_not_zero(octahedral);
+    }
+    return {glm::floatBitsToUint(position.x), glm::floatBitsToUint(position.y), glm::floatBitsToUint(position.z), glm::packSnorm2x16(octahedral)};
+}
+
+void VertexAnimation::unpack_vertex(const glm::uvec4& packed, glm::vec3& position, glm::vec3& normal) {
+    position = glm::uintBitsToFloat(glm::uvec3{packed});
+    glm::vec2 octahedral = glm::unpackSnorm2x16(packed.w);
+    normal = glm::vec3{octahedral, 1.0f - std::abs(octahedral.x) - std::abs(octahedral.y)};
+    if (normal.z < 0.0f) {
+        glm::vec2 folded = (1.0f - glm::abs(glm::vec2{normal.y, normal.x})) * sign_not_zero(glm::vec2{normal});
+        normal.x = folded.x;
+        normal.y = folded.y;
+    }
+    normal = glm::normalize(normal);
+}
+
+size_t VertexAnimation::get_bytes() const {
+    return frames.size() * sizeof(glm::uvec4);
+}
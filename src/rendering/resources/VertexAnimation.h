@@ -0,0 +1,133 @@
+#ifndef VERTEX_ANIMATION_H
+#define VERTEX_ANIMATION_H
+
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+
+#include <glm/glm.hpp>
+
+#include "MeshHierarchy.h"
+#include "utility/ThreadPool.h"
+
+/// Every vertex of a MeshHierarchy, skinned at a fixed rate through each of its clips, so a vertex shader can play the clips back
+/// by fetching its own vertex from the frames either side of the time, with no skeleton or CPU pose work at all.
+/// The vertices are in the hierarchy's space, with the transforms of the nodes holding their meshes already applied,
+/// so a mesh held by several nodes is baked once for each of them.
+struct VertexAnimation {
+    struct Clip {
+        uint first_frame = 0;
+        uint frame_count = 0;
+        float duration_seconds = 0.0f;
+    };
+
+    // The rate clips are baked at, in frames per second. The frames cover each clip exactly, so are slightly closer together than this.
+    float sample_rate = 0.0f;
+    // The number of vertices of every mesh instance, which each frame holds one after another
+    uint vertex_count = 0;
+    // [mesh instance] -> index of the instance's first vertex in a frame. The instances are each mesh of each node,
+    // in the order of MeshHierarchy::nodes and then FlatHierarchyNode::meshes, the order the renderers draw them in.
+    std::vector<uint> first_vertices{};
+    // [animation_id] -> the clip's frames
+    std::vector<Clip> clips{};
+    // [frame * vertex_count + vertex] -> the vertex, see pack_vertex
+    std::vector<glm::uvec4> frames{};
+
+    /// Pack a vertex into one 16 byte texel, the position's float bits in xyz, and the normal octahedrally encoded into two snorm16s in w.
+    /// The normal stays within a thousandth of a radian, in half the space of a texel of its own.
+    static glm::uvec4 pack_vertex(const glm::vec3& position, const glm::vec3& normal);
+    /// The inverse of pack_vertex, as the shader decodes it
+    static void unpack_vertex(const glm::uvec4& packed, glm::vec3& position, glm::vec3& normal);
+
+    /// The memory used by the frames
+    [[nodiscard]] size_t get_bytes() const;
+
+    /// Bake every clip of the hierarchy, or just its rest pose if it has none. mesh_vertices[mesh] holds the mesh's vertices as they are in its vertex buffer.
+    /// The frames are spread across the shared ThreadPool, each evaluating its pose with MeshHierarchy::calculate_animation and skinning
+    /// every vertex the same way the animated entity vertex shader does.
+    template<typename VertexData>
+    static VertexAnimation bake(const MeshHierarchy<VertexData>& hierarchy, const std::vector<std::vector<VertexData>>& mesh_vertices, float sample_rate);
+};
+
+template<typename VertexData>
+VertexAnimation VertexAnimation::bake(const MeshHierarchy<VertexData>& hierarchy, const std::vector<std::vector<VertexData>>& mesh_vertices, float sample_rate) {
+    VertexAnimation animation{};
+    animation.sample_rate = sample_rate;
+
+    // [mesh instance] -> (mesh, the transform of the node holding it, which the renderers apply on top of the skinning)
+    std::vector<std::pair<uint, glm::mat4>> instances{};
+    for (const auto& node: hierarchy.nodes) {
+        for (uint mesh_id: node.meshes) {
+            if (mesh_id >= mesh_vertices.size()) {
+                throw std::runtime_error(Formatter() << "Mesh " << mesh_id << " of a node has no vertices to bake");
+            }
+            instances.emplace_back(mesh_id, node.global_transformation);
+            animation.first_vertices.push_back(animation.vertex_count);
+            animation.vertex_count += (uint) mesh_vertices[mesh_id].size();
+        }
+    }
+
+    uint frame_count = 0;
+    for (const auto& [name, ticks_per_second, duration_ticks]: hierarchy.animations) {
+        auto& clip = animation.clips.emplace_back();
+        clip.duration_seconds = (float) std::max(duration_ticks / ticks_per_second, 0.0);
+        clip.first_frame = frame_count;
+        clip.frame_count = std::max(2u, (uint) std::ceil(clip.duration_seconds * sample_rate) + 1);
+        frame_count += clip.frame_count;
+    }
+    // A hierarchy without animations gets a single still clip of its rest pose, so that it can still be drawn
+    bool rest_pose_only = animation.clips.empty();
+    if (rest_pose_only) {
+        animation.clips.push_back({0, 2, 0.0f});
+        frame_count = 2;
+    }
+    animation.frames.resize((size_t) frame_count * animation.vertex_count);
+
+    // [(animation_id, frame of the clip)] for every frame, so they can be baked in parallel
+    std::vector<std::pair<uint, uint>> frame_clips{};
+    frame_clips.reserve(frame_count);
+    for (uint animation_id = 0; animation_id < animation.clips.size(); ++animation_id) {
+        for (uint frame = 0; frame < animation.clips[animation_id].frame_count; ++frame) {
+            frame_clips.emplace_back(animation_id, frame);
+        }
+    }
+
+    ThreadPool::shared().parallel_for(frame_clips.size(), [&](size_t i) {
+        auto [animation_id, frame] = frame_clips[i];
+        const auto& clip = animation.clips[animation_id];
+        double time_seconds = clip.duration_seconds * (double) frame / (double) (clip.frame_count - 1);
+
+        std::vector<AnimationCursor> cursors{};
+        AnimationPose pose{};
+        hierarchy.calculate_animation(rest_pose_only ? NONE_ANIMATION : animation_id, time_seconds, cursors, pose);
+
+        glm::uvec4* out = &animation.frames[i * animation.vertex_count];
+        for (const auto& [mesh_id, mesh_transform]: instances) {
+            const glm::mat4* bones = pose.bone_transforms.data() + hierarchy.first_bones[mesh_id];
+            auto bone_count = (uint) hierarchy.meshes[mesh_id].bones.size();
+            for (const auto& vertex: mesh_vertices[mesh_id]) {
+                float sum = 0.0f;
+                glm::mat4 skin_transform{0.0f};
+                for (int b = 0; b < 4; ++b) {
+                    if (vertex.bone_weights[b] == 0.0f || vertex.bone_indices[b] >= bone_count) continue;
+                    skin_transform += vertex.bone_weights[b] * bones[vertex.bone_indices[b]];
+                    sum += vertex.bone_weights[b];
+                }
+                skin_transform += (1.0f - sum) * glm::mat4{1.0f};
+
+                glm::mat4 transform = mesh_transform * skin_transform;
+                // The cofactor matrix, as the shaders use for normals, which is the inverse transpose scaled by the determinant
+                glm::mat3 normal_matrix{
+                    glm::cross(glm::vec3{transform[1]}, glm::vec3{transform[2]}),
+                    glm::cross(glm::vec3{transform[2]}, glm::vec3{transform[0]}),
+                    glm::cross(glm::vec3{transform[0]}, glm::vec3{transform[1]})
+                };
+                *out++ = pack_vertex(glm::vec3{transform * glm::vec4{vertex.position, 1.0f}}, normal_matrix * vertex.normal);
+            }
+        }
+    });
+
+    return animation;
+}
+
+#endif //VERTEX_ANIMATION_H
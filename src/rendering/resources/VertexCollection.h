@@ -0,0 +1,17 @@
+#ifndef VERTEX_COLLECTION_H
+#define VERTEX_COLLECTION_H
+
+#include <vector>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+struct VertexCollection {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> tex_coords;
+    // [(bone_weights, bone_indices)]
+    std::vector<std::pair<glm::vec4, glm::uvec4>> bones;
+};
+
+#endif //VERTEX_COLLECTION_H
@@ -4,6 +4,7 @@ void MasterRenderScene::use_camera(const CameraInterface& camera_interface) {
     entity_scene.global_data.use_camera(camera_interface);
     animated_entity_scene.global_data.use_camera(camera_interface);
     emissive_entity_scene.global_data.use_camera(camera_interface);
+    crowd_scene.global_data.use_camera(camera_interface);
 }
 
 void MasterRenderScene::insert_entity(std::shared_ptr<EntityRenderer::Entity> entity) {
@@ -18,6 +19,10 @@ void MasterRenderScene::insert_entity(std::shared_ptr<EmissiveEntityRenderer::En
     emissive_entity_scene.entities.insert(std::move(entity));
 }
 
+void MasterRenderScene::insert_entity(std::shared_ptr<CrowdRenderer::Entity> entity) {
+    crowd_scene.entities.insert(std::move(entity));
+}
+
 bool MasterRenderScene::remove_entity(const std::shared_ptr<EntityRenderer::Entity>& entity) {
     return entity_scene.entities.erase(entity) != 0;
 }
@@ -30,6 +35,10 @@ bool MasterRenderScene::remove_entity(const std::shared_ptr<EmissiveEntityRender
     return emissive_entity_scene.entities.erase(entity) != 0;
 }
 
+bool MasterRenderScene::remove_entity(const std::shared_ptr<CrowdRenderer::Entity>& entity) {
+    return crowd_scene.entities.erase(entity) != 0;
+}
+
 void MasterRenderScene::insert_light(std::shared_ptr<PointLight> point_light) {
     light_scene.point_lights.insert(std::move(point_light));
 }
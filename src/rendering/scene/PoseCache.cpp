@@ -0,0 +1,48 @@
+#include "PoseCache.h"
+
+void PoseCache::begin_frame() {
+    for (auto iter = entries.begin(); iter != entries.end();) {
+        if (iter->second.last_used_frame < frame || iter->second.hierarchy.expired()) {
+            if (iter->second.pose.use_count() == 1) {
+                free_poses.push_back(std::move(iter->second.pose));
+            }
+            iter = entries.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
+    last_frame_evaluations = evaluations;
+    last_frame_reused = reused;
+    evaluations = 0;
+    reused = 0;
+    frame++;
+}
+
+std::shared_ptr<AnimationPose> PoseCache::unshared_pose(std::shared_ptr<AnimationPose> current) {
+    // Writing into a pose that another entity, or a cache entry, is still using would change that too
+    if (current != nullptr && current.use_count() == 1) return current;
+    if (!free_poses.empty()) {
+        auto pose = std::move(free_poses.back());
+        free_poses.pop_back();
+        return pose;
+    }
+    return std::make_shared<AnimationPose>();
+}
+
+void PoseCache::set_enabled(bool value) {
+    enabled = value;
+    if (!enabled) entries.clear();
+}
+
+bool PoseCache::get_enabled() const {
+    return enabled;
+}
+
+uint PoseCache::get_last_frame_evaluations() const {
+    return last_frame_evaluations;
+}
+
+uint PoseCache::get_last_frame_reused() const {
+    return last_frame_reused;
+}
@@ -0,0 +1,105 @@
+#ifndef POSE_CACHE_H
+#define POSE_CACHE_H
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include "rendering/resources/MeshHierarchy.h"
+
+/// Shares the evaluation of a pose between entities playing the same animation of the same MeshHierarchy at exactly the same time,
+/// such as a crowd that was started together, or entities paused at the same point.
+/// Entries that weren't used in the previous frame are dropped at the start of the next, and their poses reused.
+class PoseCache {
+    struct Key {
+        const BaseMeshHierarchy* hierarchy;
+        uint64_t version;
+        uint animation_id;
+        double time_seconds;
+        // Poses evaluated at a reduced level of detail are only shared with others at the same level
+        uint animated_node_limit;
+
+        bool operator==(const Key& other) const {
+            return hierarchy == other.hierarchy && version == other.version && animation_id == other.animation_id && time_seconds == other.time_seconds
+                   && animated_node_limit == other.animated_node_limit;
+        }
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const {
+            return std::hash<const void*>()(key.hierarchy) ^ (std::hash<uint64_t>()(key.version) << 3)
+                   ^ (std::hash<uint>()(key.animation_id) << 7) ^ (std::hash<double>()(key.time_seconds) << 11) ^ (std::hash<uint>()(key.animated_node_limit) << 13);
+        }
+    };
+
+    struct Entry {
+        // Guards against a new hierarchy being allocated at the address of a freed one
+        std::weak_ptr<const BaseMeshHierarchy> hierarchy;
+        std::shared_ptr<AnimationPose> pose;
+        uint64_t last_used_frame;
+    };
+
+    std::unordered_map<Key, Entry, KeyHash> entries{};
+    // Poses from dropped entries, which nothing else was still using, to evaluate into rather than allocating
+    std::vector<std::shared_ptr<AnimationPose>> free_poses{};
+    uint64_t frame = 0;
+    bool enabled = true;
+
+    // Stats, for the current and the last completed frame
+    uint evaluations = 0;
+    uint reused = 0;
+    uint last_frame_evaluations = 0;
+    uint last_frame_reused = 0;
+public:
+    PoseCache() = default;
+
+    /// Drop the entries that weren't used last frame, should be called once per frame before any acquire()
+    void begin_frame();
+
+    /// Point pose at the pose for the animation, time and animated_node_limit, see MeshHierarchy::calculate_animation,
+    /// shared with any other entity that acquired the same one this frame.
+    /// Returns true if the pose is new, in which case the caller must evaluate it with MeshHierarchy::calculate_animation before it is used.
+    /// A new pose reuses the entity's old one when nothing else is sharing it. Not thread safe, so acquire every pose before evaluating them in parallel.
+    template<typename VertexData>
+    bool acquire(const std::shared_ptr<MeshHierarchy<VertexData>>& hierarchy, uint animation_id, double time_seconds, uint animated_node_limit,
+                 std::shared_ptr<AnimationPose>& pose);
+
+    /// When disabled, every entity evaluates its own pose
+    void set_enabled(bool value);
+    [[nodiscard]] bool get_enabled() const;
+
+    /// The number of poses that needed evaluating last frame
+    [[nodiscard]] uint get_last_frame_evaluations() const;
+    /// The number of poses that were shared with another entity, or reused from the frame before, last frame
+    [[nodiscard]] uint get_last_frame_reused() const;
+private:
+    /// A pose that isn't in use by anything else, reusing a freed one if there is one
+    std::shared_ptr<AnimationPose> unshared_pose(std::shared_ptr<AnimationPose> current);
+};
+
+template<typename VertexData>
+bool PoseCache::acquire(const std::shared_ptr<MeshHierarchy<VertexData>>& hierarchy, uint animation_id, double time_seconds, uint animated_node_limit,
+                        std::shared_ptr<AnimationPose>& pose) {
+    if (!enabled) {
+        pose = unshared_pose(std::move(pose));
+        evaluations++;
+        return true;
+    }
+
+    Key key{hierarchy.get(), hierarchy->version, animation_id, time_seconds, animated_node_limit};
+    auto existing = entries.find(key);
+    if (existing != entries.end() && !existing->second.hierarchy.expired()) {
+        existing->second.last_used_frame = frame;
+        pose = existing->second.pose;
+        reused++;
+        return false;
+    }
+
+    pose = unshared_pose(std::move(pose));
+    evaluations++;
+    entries[key] = Entry{hierarchy, pose, frame};
+    return true;
+}
+
+#endif //POSE_CACHE_H
@@ -46,6 +46,14 @@ struct AnimatedRenderedEntity : public AnimatedEntityInterface {
     // Animation Data
     uint animation_id = NONE_ANIMATION; // NONE_ANIMATION means disabled
     double animation_time_seconds = 0.0;
+    // The key each animated node's tracks were last sampled at, see MeshHierarchy::calculate_animation
+    std::vector<AnimationCursor> animation_cursors{};
+    // The bone transforms for the current animation time, possibly shared with other entities, see PoseCache
+    std::shared_ptr<AnimationPose> pose{};
+    // What the pose was last evaluated for, so that an animation level-of-detail skipping frames can tell when it no longer fits the entity
+    std::weak_ptr<MeshHierarchy<VertexData>> pose_hierarchy{};
+    uint pose_animation_id = NONE_ANIMATION;
+    uint64_t pose_version = 0;
 
     AnimatedRenderedEntity(const std::shared_ptr<MeshHierarchy<VertexData>>& mesh_hierarchy, InstanceData instance_data, RenderData render_data);
 
@@ -15,17 +15,26 @@ void BasicStaticScene::open(const SceneContext& scene_context) {
     auto plane = scene_context.model_loader.load_from_file<EntityRenderer::VertexData>("double_plane.obj");
     auto default_black_texture = scene_context.texture_loader.default_black_texture();
 
+    /// The textures are loaded as one batch, so that they are decoded in parallel
+    auto textures = scene_context.texture_loader.load_from_files({
+        {"crate.png", true, false},
+        {"crate_specular.png", false, false},
+        {"cone_diffuse.png", true, true},
+        {"cone_specular.png", false, true},
+        {"cone_retro_map.png", false, true},
+    });
+
     auto model = scene_context.model_loader.load_from_file<EntityRenderer::VertexData>("crate.obj");
-    auto texture = scene_context.texture_loader.load_from_file("crate.png");
-    auto specular_map = scene_context.texture_loader.load_from_file("crate_specular.png", false);
+    auto texture = textures[0];
+    auto specular_map = textures[1];
 
     auto light_sphere = scene_context.model_loader.load_from_file<EntityRenderer::VertexData>("sphere.obj");
     auto default_white_texture = scene_context.texture_loader.default_white_texture();
 
     auto cone = scene_context.model_loader.load_from_file<EntityRenderer::VertexData>("cone.obj");
-    auto cone_diffuse = scene_context.texture_loader.load_from_file("cone_diffuse.png", true, true);
-    auto cone_specular = scene_context.texture_loader.load_from_file("cone_specular.png", false, true);
-    auto cone_retro_map = scene_context.texture_loader.load_from_file("cone_retro_map.png", false, true);
+    auto cone_diffuse = textures[2];
+    auto cone_specular = textures[3];
+    auto cone_retro_map = textures[4];
 
     auto light_pos = glm::vec3(2.0f, 3.0f, 4.0f);
     auto light_col = glm::vec3(1.0f);
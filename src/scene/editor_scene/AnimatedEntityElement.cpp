@@ -39,7 +39,7 @@ std::unique_ptr<EditorScene::AnimatedEntityElement> EditorScene::AnimatedEntityE
     new_entity->update_local_transform_from_json(j);
     new_entity->update_material_from_json(j);
 
-    new_entity->rendered_entity->mesh_hierarchy = scene_context.model_loader.load_hierarchy_from_file<AnimatedEntityRenderer::VertexData>(j["model"]);
+    new_entity->rendered_entity->mesh_hierarchy = scene_context.model_loader.load_hierarchy_from_file<AnimatedEntityRenderer::VertexData>(j["model"], import_profile_from_json(j));
     new_entity->rendered_entity->render_data.diffuse_texture = texture_from_json(scene_context, j["diffuse_texture"]);
     new_entity->rendered_entity->render_data.specular_map_texture = texture_from_json(scene_context, j["specular_map_texture"]);
 
@@ -66,6 +66,7 @@ json EditorScene::AnimatedEntityElement::into_json() const {
         local_transform_into_json(),
         material_into_json(),
         {"model", rendered_entity->mesh_hierarchy->filename.value()},
+        {"import_profile", import_profile_to_json(rendered_entity->mesh_hierarchy->import_profile)},
         {"diffuse_texture", texture_to_json(rendered_entity->render_data.diffuse_texture)},
         {"specular_map_texture", texture_to_json(rendered_entity->render_data.specular_map_texture)},
         {"animation_parameters", {
@@ -0,0 +1,194 @@
+#include "CrowdElement.h"
+
+#include <random>
+
+#include <glm/gtx/transform.hpp>
+
+#include "rendering/imgui/ImGuiManager.h"
+#include "scene/SceneContext.h"
+
+std::unique_ptr<EditorScene::CrowdElement> EditorScene::CrowdElement::new_default(const SceneContext& scene_context, ElementRef parent) {
+    auto rendered_entity = CrowdRenderer::Entity::create(
+        scene_context.model_loader.load_hierarchy_from_file<CrowdRenderer::VertexData>("cube.obj"),
+        CrowdRenderer::InstanceData{glm::mat4{}, CrowdRenderer::EntityMaterial{
+            {1.0f, 1.0f, 1.0f, 1.0f},
+            {1.0f, 1.0f, 1.0f, 1.0f},
+            {1.0f, 1.0f, 1.0f, 1.0f},
+            512.0f,
+        }},
+        CrowdRenderer::RenderData{
+            scene_context.texture_loader.default_white_texture(),
+            scene_context.texture_loader.default_white_texture()
+        }
+    );
+
+    auto new_entity = std::make_unique<CrowdElement>(
+        parent,
+        "New Crowd",
+        glm::vec3{0.0f},
+        glm::vec3{0.0f},
+        glm::vec3{1.0f},
+        rendered_entity
+    );
+
+    new_entity->generate_members();
+    new_entity->update_instance_data();
+    return new_entity;
+}
+
+std::unique_ptr<EditorScene::CrowdElement> EditorScene::CrowdElement::from_json(const SceneContext& scene_context, EditorScene::ElementRef parent, const json& j) {
+    auto new_entity = new_default(scene_context, parent);
+
+    new_entity->update_local_transform_from_json(j);
+    new_entity->update_material_from_json(j);
+
+    new_entity->rendered_entity->mesh_hierarchy = scene_context.model_loader.load_hierarchy_from_file<CrowdRenderer::VertexData>(j["model"], import_profile_from_json(j));
+    new_entity->rendered_entity->render_data.diffuse_texture = texture_from_json(scene_context, j["diffuse_texture"]);
+    new_entity->rendered_entity->render_data.specular_map_texture = texture_from_json(scene_context, j["specular_map_texture"]);
+
+    json crowd_parameters = j["crowd_parameters"];
+    new_entity->crowd_parameters.rows = crowd_parameters["rows"];
+    new_entity->crowd_parameters.columns = crowd_parameters["columns"];
+    new_entity->crowd_parameters.spacing = crowd_parameters["spacing"];
+    new_entity->crowd_parameters.animation_id = crowd_parameters["animation_id"];
+    new_entity->crowd_parameters.speed_variation = crowd_parameters["speed_variation"];
+    new_entity->crowd_parameters.seed = crowd_parameters["seed"];
+    new_entity->rendered_entity->paused = crowd_parameters["paused"];
+
+    new_entity->generate_members();
+    new_entity->update_instance_data();
+    return new_entity;
+}
+
+json EditorScene::CrowdElement::into_json() const {
+    if (!rendered_entity->mesh_hierarchy->filename.has_value()) {
+        return {
+            {"error", Formatter() << "Crowd [" << name << "]'s model does not have a filename so can not be exported, and has been skipped."}
+        };
+    }
+
+    return {
+        local_transform_into_json(),
+        material_into_json(),
+        {"model", rendered_entity->mesh_hierarchy->filename.value()},
+        {"import_profile", import_profile_to_json(rendered_entity->mesh_hierarchy->import_profile)},
+        {"diffuse_texture", texture_to_json(rendered_entity->render_data.diffuse_texture)},
+        {"specular_map_texture", texture_to_json(rendered_entity->render_data.specular_map_texture)},
+        {"crowd_parameters", {
+            {"rows", crowd_parameters.rows},
+            {"columns", crowd_parameters.columns},
+            {"spacing", crowd_parameters.spacing},
+            {"animation_id", crowd_parameters.animation_id},
+            {"speed_variation", crowd_parameters.speed_variation},
+            {"seed", crowd_parameters.seed},
+            {"paused", rendered_entity->paused},
+        }}
+    };
+}
+
+void EditorScene::CrowdElement::add_imgui_edit_section(MasterRenderScene& render_scene, const SceneContext& scene_context) {
+    ImGui::Text("Crowd");
+    SceneElement::add_imgui_edit_section(render_scene, scene_context);
+
+    add_local_transform_imgui_edit_section(render_scene, scene_context);
+    add_material_imgui_edit_section(render_scene, scene_context);
+
+    ImGui::Text("Model & Textures");
+    bool regenerate = false;
+    if (scene_context.model_loader.add_imgui_hierarchy_selector("Model Selection", rendered_entity->mesh_hierarchy)) {
+        crowd_parameters.animation_id = NONE_ANIMATION;
+        regenerate = true;
+    }
+    scene_context.texture_loader.add_imgui_texture_selector("Diffuse Texture", rendered_entity->render_data.diffuse_texture);
+    scene_context.texture_loader.add_imgui_texture_selector("Specular Map", rendered_entity->render_data.specular_map_texture, false);
+    ImGui::Spacing();
+
+    ImGui::Separator();
+    ImGui::Spacing();
+    ImGui::Text("Members");
+
+    int size[2] = {(int) crowd_parameters.rows, (int) crowd_parameters.columns};
+    if (ImGui::DragInt2("Rows, Columns", size, 0.1f, 1, 64)) {
+        crowd_parameters.rows = (uint) std::max(size[0], 1);
+        crowd_parameters.columns = (uint) std::max(size[1], 1);
+        regenerate = true;
+    }
+    regenerate |= ImGui::DragFloat("Spacing", &crowd_parameters.spacing, 0.01f, 0.0f, FLT_MAX);
+
+    const auto& animations = rendered_entity->mesh_hierarchy->animations;
+    const char* selected_animation = crowd_parameters.animation_id < animations.size() ? std::get<0>(animations[crowd_parameters.animation_id]).c_str() : "[RANDOM]";
+    if (ImGui::BeginCombo("Animation Selection", selected_animation, 0)) {
+        for (auto i = 0u; i < animations.size(); ++i) {
+            if (ImGui::Selectable(std::get<0>(animations[i]).c_str(), i == crowd_parameters.animation_id)) {
+                crowd_parameters.animation_id = i;
+                regenerate = true;
+            }
+        }
+        if (ImGui::Selectable("[RANDOM]", crowd_parameters.animation_id == NONE_ANIMATION)) {
+            crowd_parameters.animation_id = NONE_ANIMATION;
+            regenerate = true;
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::SameLine();
+    ImGui::HelpMarker("The clip every member loops, or [RANDOM] for each to pick one of the model's clips.");
+
+    regenerate |= ImGui::SliderFloat("Speed Variation", &crowd_parameters.speed_variation, 0.0f, 1.0f);
+    ImGui::SameLine();
+    ImGui::HelpMarker("How far each member's playback speed may randomly differ from normal speed.");
+
+    int seed = (int) crowd_parameters.seed;
+    if (ImGui::InputInt("Seed", &seed)) {
+        crowd_parameters.seed = (uint) seed;
+        regenerate = true;
+    }
+    ImGui::Checkbox("Paused", &rendered_entity->paused);
+
+    if (regenerate) generate_members();
+    ImGui::Spacing();
+}
+
+void EditorScene::CrowdElement::generate_members() {
+    std::mt19937 rng(crowd_parameters.seed);
+    auto clip_count = (uint) rendered_entity->mesh_hierarchy->animations.size();
+    std::uniform_int_distribution<uint> clip_distribution(0, std::max(clip_count, 1u) - 1);
+    std::uniform_real_distribution<float> unit_distribution(0.0f, 1.0f);
+
+    auto& members = rendered_entity->members;
+    members.clear();
+    // Centred on the crowd's origin, in its xz plane
+    glm::vec2 extent = glm::vec2{(float) crowd_parameters.columns - 1.0f, (float) crowd_parameters.rows - 1.0f} * crowd_parameters.spacing;
+    for (uint row = 0; row < crowd_parameters.rows; ++row) {
+        for (uint column = 0; column < crowd_parameters.columns; ++column) {
+            auto& member = members.emplace_back();
+            glm::vec2 position = glm::vec2{(float) column, (float) row} * crowd_parameters.spacing - 0.5f * extent;
+            member.transform = glm::translate(glm::vec3{position.x, 0.0f, position.y});
+
+            member.animation_id = crowd_parameters.animation_id < clip_count ? crowd_parameters.animation_id : clip_distribution(rng);
+            float duration = 0.0f;
+            if (member.animation_id < clip_count) {
+                const auto& [_, ticks_per_second, duration_ticks] = rendered_entity->mesh_hierarchy->animations[member.animation_id];
+                duration = (float) (duration_ticks / ticks_per_second);
+            }
+            member.time_offset = unit_distribution(rng) * duration;
+            member.speed = 1.0f + (2.0f * unit_distribution(rng) - 1.0f) * crowd_parameters.speed_variation;
+        }
+    }
+    rendered_entity->members_version++;
+}
+
+void EditorScene::CrowdElement::update_instance_data() {
+    transform = calc_model_matrix();
+
+    if (!EditorScene::is_null(parent)) {
+        // Post multiply by transform so that local transformations are applied first
+        transform = (*parent)->transform * transform;
+    }
+
+    rendered_entity->instance_data.model_matrix = transform;
+    rendered_entity->instance_data.material = material;
+}
+
+const char* EditorScene::CrowdElement::element_type_name() const {
+    return ELEMENT_TYPE_NAME;
+}
@@ -0,0 +1,56 @@
+#ifndef CROWD_ELEMENT_H
+#define CROWD_ELEMENT_H
+
+#include "SceneElement.h"
+#include "scene/SceneContext.h"
+
+namespace EditorScene {
+    /// The layout of a crowd, from which its members are generated
+    struct CrowdParameters {
+        uint rows = 4;
+        uint columns = 4;
+        float spacing = 2.0f;
+        // The clip every member plays, or NONE_ANIMATION to pick one at random for each
+        uint animation_id = NONE_ANIMATION;
+        // How far each member's speed may randomly differ from 1
+        float speed_variation = 0.2f;
+        uint seed = 3003;
+    };
+
+    class CrowdElement : virtual public SceneElement, public LocalTransformComponent, public LitMaterialComponent {
+    public:
+        /// NOTE: Must be unique per element type, as it is used to select generators,
+        ///       so if you are creating a new element type make sure to change this to a new unique name.
+        static constexpr const char* ELEMENT_TYPE_NAME = "Crowd";
+
+        std::shared_ptr<CrowdRenderer::Entity> rendered_entity;
+
+        CrowdParameters crowd_parameters{};
+
+        CrowdElement(const ElementRef& parent, std::string name, const glm::vec3& position, const glm::vec3& euler_rotation, const glm::vec3& scale, std::shared_ptr<CrowdRenderer::Entity> rendered_entity) :
+            SceneElement(parent, std::move(name)), LocalTransformComponent(position, euler_rotation, scale), LitMaterialComponent(rendered_entity->instance_data.material), rendered_entity(std::move(rendered_entity)) {}
+
+        static std::unique_ptr<CrowdElement> new_default(const SceneContext& scene_context, ElementRef parent);
+        static std::unique_ptr<CrowdElement> from_json(const SceneContext& scene_context, ElementRef parent, const json& j);
+        [[nodiscard]] json into_json() const override;
+
+        void add_imgui_edit_section(MasterRenderScene& render_scene, const SceneContext& scene_context) override;
+
+        void update_instance_data() override;
+
+        /// Lay the members out in a grid from crowd_parameters, each with a random start time and speed, and a random clip if one isn't chosen
+        void generate_members();
+
+        void add_to_render_scene(MasterRenderScene& target_render_scene) override {
+            target_render_scene.insert_entity(rendered_entity);
+        }
+
+        void remove_from_render_scene(MasterRenderScene& target_render_scene) override {
+            target_render_scene.remove_entity(rendered_entity);
+        }
+
+        [[nodiscard]] const char* element_type_name() const override;
+    };
+}
+
+#endif //CROWD_ELEMENT_H
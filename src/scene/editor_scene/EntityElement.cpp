@@ -40,7 +40,7 @@ std::unique_ptr<EditorScene::EntityElement> EditorScene::EntityElement::from_jso
     new_entity->update_local_transform_from_json(j);
     new_entity->update_material_from_json(j);
 
-    new_entity->rendered_entity->model = scene_context.model_loader.load_from_file<EntityRenderer::VertexData>(j["model"]);
+    new_entity->rendered_entity->model = scene_context.model_loader.load_from_file<EntityRenderer::VertexData>(j["model"], import_profile_from_json(j));
     new_entity->rendered_entity->render_data.diffuse_texture = texture_from_json(scene_context, j["diffuse_texture"]);
     new_entity->rendered_entity->render_data.specular_map_texture = texture_from_json(scene_context, j["specular_map_texture"]);
 
@@ -59,6 +59,7 @@ json EditorScene::EntityElement::into_json() const {
         local_transform_into_json(),
         material_into_json(),
         {"model", rendered_entity->model->get_filename().value()},
+        {"import_profile", import_profile_to_json(rendered_entity->model->get_import_profile())},
         {"diffuse_texture", texture_to_json(rendered_entity->render_data.diffuse_texture)},
         {"specular_map_texture", texture_to_json(rendered_entity->render_data.specular_map_texture)},
     };
@@ -38,6 +38,16 @@ std::shared_ptr<TextureHandle> EditorScene::SceneElement::texture_from_json(cons
     return scene_context.texture_loader.load_from_file(json["filename"], json["is_srgb"], json["is_flipped"]);
 }
 
+json EditorScene::SceneElement::import_profile_to_json(std::optional<ImportProfile> import_profile) {
+    if (!import_profile.has_value()) return nullptr;
+    return ImportProfiles::name(import_profile.value());
+}
+
+std::optional<ImportProfile> EditorScene::SceneElement::import_profile_from_json(const json& j) {
+    if (!j.contains("import_profile") || j["import_profile"].is_null()) return std::nullopt;
+    return ImportProfiles::from_name(j["import_profile"]);
+}
+
 void EditorScene::LocalTransformComponent::add_local_transform_imgui_edit_section(MasterRenderScene& /*render_scene*/, const SceneContext& scene_context) {
     ImGui::Text("Local Transformation");
     bool transformUpdated = false;
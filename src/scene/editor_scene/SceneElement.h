@@ -76,6 +76,9 @@ namespace EditorScene {
 
         static json texture_to_json(const std::shared_ptr<TextureHandle>& texture);
         static std::shared_ptr<TextureHandle> texture_from_json(const SceneContext& scene_context, const json& json);
+        static json import_profile_to_json(std::optional<ImportProfile> import_profile);
+        /// Scene files saved without an import profile give std::nullopt, so that the loader's default is used
+        static std::optional<ImportProfile> import_profile_from_json(const json& j);
 
         virtual ~SceneElement() = default;
     };
@@ -1,6 +1,7 @@
 #include "WindowManager.h"
 
 #include <memory.h>
+#include <stdexcept>
 #include <imgui/imgui.h>
 
 #include "utility/OpenGL.h"
@@ -22,7 +23,9 @@ void WindowManager::init() {
     glfwInit();
 }
 
-Window WindowManager::create_window(const std::string& name, glm::ivec2 size) {
+/// Sets the hints for an OpenGL context of the version the project targets, resetting any others
+static void set_context_hints() {
+    glfwDefaultWindowHints();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, OpenGL::VERSION_MAJOR);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, OpenGL::VERSION_MINOR);
@@ -30,6 +33,10 @@ Window WindowManager::create_window(const std::string& name, glm::ivec2 size) {
 #if __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif // __APPLE__
+}
+
+Window WindowManager::create_window(const std::string& name, glm::ivec2 size) {
+    set_context_hints();
     glfwWindowHint(GLFW_SAMPLES, 8);
     glfwWindowHint(GLFW_DEPTH_BITS, 32);
     auto glfwWindow = glfwCreateWindow(size.x, size.y, name.c_str(), nullptr, nullptr);
@@ -81,6 +88,26 @@ Window WindowManager::create_window(const std::string& name, glm::ivec2 size) {
     return window;
 }
 
+Window WindowManager::create_shared_context_window(const Window& share_with) {
+    set_context_hints();
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    // Never drawn to, so the framebuffer is kept as small as possible
+    auto glfwWindow = glfwCreateWindow(1, 1, "", nullptr, share_with.window);
+    if (glfwWindow == nullptr) {
+        throw std::runtime_error("Failed to create a shared context window");
+    }
+
+    Window window{};
+    window.window = glfwWindow;
+    window.window_data = std::make_shared<Window::WindowData>();
+    window.base_title = share_with.base_title + " (Shared Context)";
+
+    glfwSetWindowUserPointer(glfwWindow, &*window.window_data);
+
+    // Not added to the set of windows, since it has no input to process
+    return window;
+}
+
 void WindowManager::destroy_window(const Window& window) {
     glfwDestroyWindow(window.window);
     windows.erase(window);
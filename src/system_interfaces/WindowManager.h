@@ -28,6 +28,9 @@ public:
 
     /// Creates a window with the given name and size
     Window create_window(const std::string& name, glm::ivec2 size);
+    /// Creates a hidden window whose OpenGL context shares objects (buffers, textures, etc.) with the given window's,
+    /// for loading on another thread. It receives no input, and should be destroyed before the window it shares with.
+    Window create_shared_context_window(const Window& share_with);
     /// Destroys the window passed in, the window MUST not be used after this.
     void destroy_window(const Window& window);
 
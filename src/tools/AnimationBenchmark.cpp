@@ -0,0 +1,290 @@
+#include <map>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <iostream>
+#include <functional>
+
+#include "rendering/resources/MeshHierarchy.h"
+#include "rendering/resources/PoseKernels.h"
+#include "rendering/resources/MeshCache.h"
+#include "utility/ThreadPool.h"
+
+namespace {
+    /// The original std::map based keyframe storage, kept here as the baseline to compare the flat tracks against
+    struct MapAnimationData {
+        std::map<double, glm::vec3> positions{};
+        std::map<double, glm::quat> rotations{};
+        std::map<double, glm::vec3> scalings{};
+
+        template<typename T, typename Mix>
+        static T sample_map(const std::map<double, T>& keys, double time, T default_value, Mix mix) {
+            if (keys.empty()) return default_value;
+            auto next_key = keys.lower_bound(time);
+            if (next_key == keys.end()) return keys.rbegin()->second;
+            if (next_key->first == time || next_key == keys.begin()) return next_key->second;
+            auto next = *next_key;
+            auto prev = *(--next_key);
+            return mix(prev.second, next.second, (float) ((time - prev.first) / (next.first - prev.first)));
+        }
+
+        [[nodiscard]] glm::mat4 sample(double time) const {
+            auto lerp = [](const glm::vec3& a, const glm::vec3& b, float t) { return glm::mix(a, b, t); };
+            auto slerp = [](const glm::quat& a, const glm::quat& b, float t) { return glm::slerp(a, b, t); };
+            glm::vec3 position = sample_map(positions, time, glm::vec3{0.0f}, lerp);
+            glm::quat rotation = sample_map(rotations, time, glm::quat{1.0f, 0.0f, 0.0f, 0.0f}, slerp);
+            glm::vec3 scaling = sample_map(scalings, time, glm::vec3{1.0f}, lerp);
+            return glm::translate(position) * glm::toMat4(rotation) * glm::scale(scaling);
+        }
+    };
+
+    /// Time fn over every (node, time) pair, returning the nanoseconds per sample and adding the results into checksum
+    double time_samples(size_t node_count, const std::vector<float>& times, float& checksum, const std::function<glm::mat4(size_t node, float time)>& fn) {
+        auto start = std::chrono::steady_clock::now();
+        glm::mat4 total{0.0f};
+        for (float time: times) {
+            for (size_t node = 0; node < node_count; ++node) {
+                total += fn(node, time);
+            }
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        checksum += total[3][0] + total[0][0];
+        return ns / (double) (times.size() * node_count);
+    }
+
+    /// The original pose evaluation, sampling each node on its own with glm and multiplying full 4x4 matrices, kept as the baseline for the PoseKernels
+    void reference_pose(const MeshHierarchy<BakedMesh::Vertex>& hierarchy, float time_ticks, std::vector<AnimationCursor>& cursors,
+                        std::vector<glm::mat4>& node_transforms, std::vector<glm::mat4>& bone_transforms) {
+        cursors.resize(hierarchy.nodes.size());
+        node_transforms.resize(hierarchy.nodes.size());
+        bone_transforms.resize(hierarchy.bone_count);
+        for (size_t i = 0; i < hierarchy.nodes.size(); ++i) {
+            const auto& node = hierarchy.nodes[i];
+            glm::mat4 transform = node.is_skeleton ? node.transformation : glm::mat4{1.0f};
+            const auto animation = node.animation_data.find(0);
+            if (animation != node.animation_data.end()) {
+                transform = animation->second.sample(time_ticks, cursors[i]);
+            }
+            node_transforms[i] = node.parent >= 0 ? node_transforms[node.parent] * transform : transform;
+            for (const auto& [mesh_id, bone_id, offset_matrix]: node.bones) {
+                bone_transforms[hierarchy.first_bones[mesh_id] + bone_id] = node_transforms[i] * offset_matrix;
+            }
+        }
+    }
+}
+
+/// Compares sampling node animations from the flat KeyframeTracks, with a cursor per node, against the original std::map storage.
+/// Then times evaluating the poses of a crowd with each level of PoseKernels the CPU supports, against sampling and multiplying each node on its own,
+/// and playing back clips baked at a few rates, and times evaluating the poses of a crowd of entities sharing a skeleton of those nodes, on one thread and across the ThreadPool.
+/// Usage: cits3003_animation_benchmark [--nodes <count>] [--keys <count per track>] [--frames <count>] [--crowd <entities>]
+/// Sequential playback steps through the clip at 60 fps, looping, while seeking samples uniformly random times.
+/// The timings are only meaningful in an optimised build, e.g. with -DCMAKE_BUILD_TYPE=Release.
+int main(int argc, char** argv) {
+    size_t node_count = 64;
+    size_t key_count = 120;
+    size_t frame_count = 2000;
+    size_t crowd_size = 200;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string argument = argv[i];
+            if (argument == "--nodes" && i + 1 < argc) {
+                node_count = std::stoul(argv[++i]);
+            } else if (argument == "--keys" && i + 1 < argc) {
+                key_count = std::stoul(argv[++i]);
+            } else if (argument == "--frames" && i + 1 < argc) {
+                frame_count = std::stoul(argv[++i]);
+            } else if (argument == "--crowd" && i + 1 < argc) {
+                crowd_size = std::stoul(argv[++i]);
+            } else {
+                throw std::runtime_error(Formatter() << "Unknown argument: " << argument);
+            }
+        }
+        if (node_count == 0 || key_count < 2 || frame_count == 0) throw std::runtime_error("Need at least 1 node, 2 keys and 1 frame");
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [--nodes <count>] [--keys <count per track>] [--frames <count>] [--crowd <entities>]" << std::endl;
+        return 1;
+    }
+
+    // A clip in milliseconds (1000 ticks per second), like glTF animations, with keys at slightly uneven times
+    const float duration_ticks = 4000.0f;
+    std::mt19937 rng(3003);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<AnimationData> tracks(node_count);
+    std::vector<MapAnimationData> maps(node_count);
+    for (size_t node = 0; node < node_count; ++node) {
+        // Every channel wanders a little from key to key, as a real clip's do
+        glm::vec3 position{unit(rng), unit(rng), unit(rng)};
+        glm::vec3 scaling{1.0f};
+        glm::quat rotation = glm::normalize(glm::quat{unit(rng), unit(rng), unit(rng), unit(rng)});
+        for (size_t key = 0; key < key_count; ++key) {
+            float time = duration_ticks * ((float) key + (key == 0 || key + 1 == key_count ? 0.0f : 0.3f * unit(rng))) / (float) (key_count - 1);
+            position += 0.05f * glm::vec3{unit(rng), unit(rng), unit(rng)};
+            rotation = glm::normalize(rotation * glm::angleAxis(0.05f * unit(rng), glm::normalize(glm::vec3{unit(rng), unit(rng), unit(rng)})));
+            scaling = glm::clamp(scaling + 0.005f * glm::vec3{unit(rng), unit(rng), unit(rng)}, 0.9f, 1.1f);
+
+            tracks[node].positions.set_key(time, position);
+            tracks[node].rotations.set_key(time, rotation);
+            tracks[node].scalings.set_key(time, scaling);
+            maps[node].positions[time] = position;
+            maps[node].rotations[time] = rotation;
+            maps[node].scalings[time] = scaling;
+        }
+    }
+
+    std::vector<float> sequential_times(frame_count);
+    std::vector<float> seek_times(frame_count);
+    for (size_t frame = 0; frame < frame_count; ++frame) {
+        sequential_times[frame] = std::fmod((float) frame * 1000.0f / 60.0f, duration_ticks);
+        seek_times[frame] = (unit(rng) * 0.5f + 0.5f) * duration_ticks;
+    }
+
+    // Both have to agree before the timings mean anything
+    float max_error = 0.0f;
+    std::vector<AnimationCursor> cursors(node_count);
+    for (const auto& times: {sequential_times, seek_times}) {
+        for (float time: times) {
+            for (size_t node = 0; node < node_count; ++node) {
+                glm::mat4 difference = tracks[node].sample(time, cursors[node]) - maps[node].sample(time);
+                for (int c = 0; c < 4; ++c) {
+                    max_error = std::max(max_error, glm::length(difference[c]));
+                }
+            }
+        }
+    }
+
+    std::cout << "Sampling " << node_count << " nodes, " << key_count << " keys per track, over " << frame_count << " frames" << std::endl;
+    std::cout << "Max difference between the two: " << max_error << std::endl;
+
+    float checksum = 0.0f;
+    for (const auto& [name, times]: {std::make_pair("Sequential", &sequential_times), std::make_pair("Seeking", &seek_times)}) {
+        double map_ns = time_samples(node_count, *times, checksum, [&maps](size_t node, float time) {
+            return maps[node].sample(time);
+        });
+
+        std::fill(cursors.begin(), cursors.end(), AnimationCursor{});
+        double track_ns = time_samples(node_count, *times, checksum, [&tracks, &cursors](size_t node, float time) {
+            return tracks[node].sample(time, cursors[node]);
+        });
+
+        char line[128];
+        std::snprintf(line, sizeof(line), "%-10s std::map: %7.1f ns/sample, flat tracks: %7.1f ns/sample (%.2fx)", name, map_ns, track_ns, map_ns / track_ns);
+        std::cout << line << std::endl;
+    }
+
+    // A skeleton with a bone on every node, each node the child of the one halfway back, animated by the tracks above
+    MeshHierarchy<BakedMesh::Vertex> hierarchy{};
+    hierarchy.meshes.emplace_back(nullptr, std::unordered_map<std::string, uint>{});
+    hierarchy.animations.emplace_back("Benchmark", 1000.0, duration_ticks);
+    std::vector<MeshHierarchyNode> tree(node_count);
+    for (size_t node = 0; node < node_count; ++node) {
+        hierarchy.meshes[0].bones[Formatter() << "bone_" << node] = (uint) node;
+        tree[node].bones.emplace_back(0, (uint) node, glm::mat4{1.0f});
+        tree[node].animation_data[0] = tracks[node];
+    }
+    for (size_t node = node_count - 1; node > 0; --node) {
+        tree[(node - 1) / 2].children.insert(tree[(node - 1) / 2].children.begin(), std::move(tree[node]));
+    }
+    hierarchy.set_nodes(std::move(tree[0]));
+
+    // Offsets that aren't the identity, so that applying them is checked too
+    for (auto& binding: hierarchy.bone_bindings) {
+        glm::mat4 offset_matrix = glm::translate(glm::vec3{unit(rng), unit(rng), unit(rng)}) * glm::toMat4(glm::normalize(glm::quat{unit(rng), unit(rng), unit(rng), unit(rng)}));
+        binding.offset = AffineTransform::from_mat4(offset_matrix);
+        // Every node has exactly one bone
+        std::get<2>(hierarchy.nodes[binding.node].bones[0]) = offset_matrix;
+    }
+
+    std::vector<AnimationPose> poses(crowd_size);
+    std::vector<std::vector<AnimationCursor>> crowd_cursors(crowd_size);
+    std::vector<double> offsets(crowd_size);
+    for (auto& offset: offsets) offset = (unit(rng) * 0.5f + 0.5f) * duration_ticks / 1000.0f;
+
+    size_t crowd_frames = std::max<size_t>(frame_count / 20, 1);
+    auto evaluate_crowd = [&](bool parallel, const PoseBakeSettings& bake_settings = {}, uint animated_node_limit = UINT_MAX) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t frame = 0; frame < crowd_frames; ++frame) {
+            auto evaluate = [&](size_t entity) {
+                double time = std::fmod(offsets[entity] + (double) frame / 60.0, duration_ticks / 1000.0);
+                hierarchy.calculate_animation(0, time, crowd_cursors[entity], poses[entity], bake_settings, animated_node_limit);
+            };
+            if (parallel) {
+                ThreadPool::shared().parallel_for(crowd_size, evaluate);
+            } else {
+                for (size_t entity = 0; entity < crowd_size; ++entity) evaluate(entity);
+            }
+        }
+        checksum += poses[0].bone_transforms.back()[3][0];
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / (double) crowd_frames;
+    };
+
+    if (crowd_size > 0) {
+        std::vector<glm::mat4> reference_nodes{};
+        std::vector<glm::mat4> reference_bones{};
+        auto start = std::chrono::steady_clock::now();
+        for (size_t frame = 0; frame < crowd_frames; ++frame) {
+            for (size_t entity = 0; entity < crowd_size; ++entity) {
+                double time = std::fmod(offsets[entity] + (double) frame / 60.0, duration_ticks / 1000.0);
+                reference_pose(hierarchy, (float) (time * 1000.0), crowd_cursors[entity], reference_nodes, reference_bones);
+            }
+        }
+        double reference_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / (double) crowd_frames;
+        checksum += reference_bones.back()[3][0];
+        char line[256];
+        std::snprintf(line, sizeof(line), "Crowd of %zu, per node glm: %7.3f ms/frame", crowd_size, reference_ms);
+        std::cout << line << std::endl;
+
+        auto best_level = PoseKernels::best_supported();
+        for (auto level: {PoseKernels::Level::Scalar, PoseKernels::Level::SSE, PoseKernels::Level::AVX2}) {
+            if (!PoseKernels::is_supported(level)) continue;
+            PoseKernels::set_level(level);
+            double kernel_ms = evaluate_crowd(false);
+
+            // The kernels use a normalised lerp rather than a slerp, so they only agree closely rather than exactly
+            float max_kernel_error = 0.0f;
+            for (size_t entity = 0; entity < std::min<size_t>(crowd_size, 16); ++entity) {
+                double time = std::fmod(offsets[entity] + (double) (crowd_frames - 1) / 60.0, duration_ticks / 1000.0);
+                reference_pose(hierarchy, (float) (time * 1000.0), crowd_cursors[entity], reference_nodes, reference_bones);
+                for (size_t bone = 0; bone < reference_bones.size(); ++bone) {
+                    glm::mat4 difference = poses[entity].bone_transforms[bone] - reference_bones[bone];
+                    for (int c = 0; c < 4; ++c) {
+                        max_kernel_error = std::max(max_kernel_error, glm::length(difference[c]));
+                    }
+                }
+            }
+            std::snprintf(line, sizeof(line), "%-8s kernels: %7.3f ms/frame (%.2fx), max difference %g", PoseKernels::level_name(level), kernel_ms,
+                          reference_ms / kernel_ms, max_kernel_error);
+            std::cout << line << std::endl;
+        }
+        PoseKernels::set_level(best_level);
+
+        for (float sample_rate: {15.0f, 30.0f, 60.0f}) {
+            auto bake_start = std::chrono::steady_clock::now();
+            auto clip = hierarchy.get_baked_clip(0, sample_rate);
+            double bake_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bake_start).count();
+            double blend_ms = evaluate_crowd(false, {true, sample_rate, true});
+            double nearest_ms = evaluate_crowd(false, {true, sample_rate, false});
+            std::snprintf(line, sizeof(line), "Baked at %2.0f Hz: %7.3f ms/frame blended (error %.4f), %7.3f ms/frame nearest (error %.4f), %.2f MiB, baked in %.1f ms",
+                          sample_rate, blend_ms, clip->blend_error, nearest_ms, clip->nearest_error, (double) clip->get_bytes() / (1024.0 * 1024.0), bake_ms);
+            std::cout << line << std::endl;
+        }
+
+        double serial_ms = evaluate_crowd(false);
+        // The reduced bone sets that the animation level-of-detail evaluates far away entities with
+        for (float fraction: {0.5f, 0.25f}) {
+            double reduced_ms = evaluate_crowd(false, {}, hierarchy.get_animated_node_limit(fraction));
+            std::snprintf(line, sizeof(line), "%3.0f%% of nodes animated: %7.3f ms/frame (%.2fx)", fraction * 100.0f, reduced_ms, serial_ms / reduced_ms);
+            std::cout << line << std::endl;
+        }
+
+        double parallel_ms = evaluate_crowd(true);
+        std::snprintf(line, sizeof(line), "Crowd of %zu: 1 thread: %7.3f ms/frame, %u threads: %7.3f ms/frame (%.2fx)",
+                      crowd_size, serial_ms, ThreadPool::shared().get_concurrency(), parallel_ms, serial_ms / parallel_ms);
+        std::cout << line << std::endl;
+    }
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+    return 0;
+}
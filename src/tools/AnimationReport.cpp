@@ -0,0 +1,118 @@
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <iostream>
+
+#include "rendering/resources/ModelLoader.h"
+#include "rendering/resources/AssetBudget.h"
+
+namespace {
+    /// The largest difference of a column of the sampled transforms, over every key time of the original and halfway between them
+    float max_error(const AnimationData& original, const AnimationData& compressed) {
+        std::vector<float> times{};
+        for (const auto* track_times: {&original.positions.times, &original.rotations.times, &original.scalings.times}) {
+            for (size_t key = 0; key < track_times->size(); ++key) {
+                times.push_back((*track_times)[key]);
+                if (key + 1 < track_times->size()) times.push_back(((*track_times)[key] + (*track_times)[key + 1]) * 0.5f);
+            }
+        }
+        std::sort(times.begin(), times.end());
+
+        float error = 0.0f;
+        AnimationCursor original_cursor{};
+        AnimationCursor compressed_cursor{};
+        for (float time: times) {
+            glm::mat4 difference = original.sample(time, original_cursor) - compressed.sample(time, compressed_cursor);
+            for (int c = 0; c < 4; ++c) {
+                error = std::max(error, glm::length(difference[c]));
+            }
+        }
+        return error;
+    }
+}
+
+/// Reports how well the animations of each model compress with the given tolerances, per clip, without opening a window.
+/// Usage: cits3003_animation_report [--position-tolerance <units>] [--rotation-tolerance <radians>] [--scaling-tolerance <amount>] [model]...
+/// Models are relative to res/models, and default to every model there. Run from the project root, the same as the main executable.
+int main(int argc, char** argv) {
+    AssetBudget asset_budget{};
+    ModelLoader model_loader{"res/models", asset_budget};
+
+    AnimationCompressionSettings settings{};
+    std::vector<std::string> files{};
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string argument = argv[i];
+            if (argument == "--position-tolerance" && i + 1 < argc) {
+                settings.position_tolerance = std::stof(argv[++i]);
+            } else if (argument == "--rotation-tolerance" && i + 1 < argc) {
+                settings.rotation_tolerance = std::stof(argv[++i]);
+            } else if (argument == "--scaling-tolerance" && i + 1 < argc) {
+                settings.scaling_tolerance = std::stof(argv[++i]);
+            } else if (argument.rfind("--", 0) == 0) {
+                throw std::runtime_error(Formatter() << "Unknown argument: " << argument);
+            } else {
+                files.push_back(argument);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [--position-tolerance <units>] [--rotation-tolerance <radians>] [--scaling-tolerance <amount>] [model]..." << std::endl;
+        return 1;
+    }
+    if (files.empty()) {
+        files = model_loader.get_available_models();
+    }
+
+    size_t total_original_bytes = 0;
+    size_t total_compressed_bytes = 0;
+    size_t clip_count = 0;
+    bool failed = false;
+    for (const auto& file: files) {
+        std::vector<AnimationClip> clips;
+        try {
+            clips = model_loader.read_animations(file);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            failed = true;
+            continue;
+        }
+
+        for (const auto& clip: clips) {
+            size_t original_bytes = 0, compressed_bytes = 0;
+            size_t original_keys = 0, compressed_keys = 0;
+            uint dropped_tracks = 0;
+            float error = 0.0f;
+            for (const auto& [node_name, original]: clip.channels) {
+                AnimationData compressed = original;
+                compressed.compress(settings);
+
+                original_bytes += original.get_bytes();
+                compressed_bytes += compressed.get_bytes();
+                original_keys += original.get_key_count();
+                compressed_keys += compressed.get_key_count();
+                dropped_tracks += (uint) (!original.positions.empty() && compressed.compressed->positions.empty())
+                                  + (uint) (!original.rotations.empty() && compressed.compressed->rotations.empty())
+                                  + (uint) (!original.scalings.empty() && compressed.compressed->scalings.empty());
+                error = std::max(error, max_error(original, compressed));
+            }
+
+            char line[256];
+            std::snprintf(line, sizeof(line), "%s / %s: %zu channels, %zu -> %zu keys, %u constant tracks dropped, %.1f -> %.1f KiB (%.1fx), max error %.5f",
+                          file.c_str(), clip.name.c_str(), clip.channels.size(), original_keys, compressed_keys, dropped_tracks,
+                          (double) original_bytes / 1024.0, (double) compressed_bytes / 1024.0,
+                          compressed_bytes > 0 ? (double) original_bytes / (double) compressed_bytes : 0.0, error);
+            std::cout << line << std::endl;
+
+            total_original_bytes += original_bytes;
+            total_compressed_bytes += compressed_bytes;
+            clip_count++;
+        }
+    }
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "%zu clips: %.1f -> %.1f KiB (%.1fx)", clip_count, (double) total_original_bytes / 1024.0, (double) total_compressed_bytes / 1024.0,
+                  total_compressed_bytes > 0 ? (double) total_original_bytes / (double) total_compressed_bytes : 0.0);
+    std::cout << line << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,109 @@
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <functional>
+
+#include "rendering/resources/ModelLoader.h"
+#include "rendering/resources/TextureLoader.h"
+#include "rendering/resources/AssetBudget.h"
+#include "utility/ThreadPool.h"
+
+/// Fills the mesh and mip chain caches for every model and texture, without opening a window,
+/// so that they can be baked once on a build machine rather than on every first load.
+/// Usage: cits3003_asset_baker [--profile <name>]... [--all-profiles] [--filter <Box|Kaiser>]
+/// Run from the project root, the same as the main executable, so it finds res/ and writes to cache/.
+int main(int argc, char** argv) {
+    AssetBudget asset_budget{};
+    ModelLoader model_loader{"res/models", asset_budget};
+    TextureLoader texture_loader{"res/textures", asset_budget};
+
+    std::vector<ImportProfile> profiles{};
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string argument = argv[i];
+            if (argument == "--profile" && i + 1 < argc) {
+                profiles.push_back(ImportProfiles::from_name(argv[++i]));
+            } else if (argument == "--all-profiles") {
+                profiles.assign(std::begin(ImportProfiles::ALL), std::end(ImportProfiles::ALL));
+            } else if (argument == "--filter" && i + 1 < argc) {
+                std::string filter = argv[++i];
+                if (filter != MipChain::filter_name(MipFilter::Box) && filter != MipChain::filter_name(MipFilter::Kaiser)) {
+                    throw std::runtime_error(Formatter() << "Unknown mip filter: " << filter);
+                }
+                texture_loader.set_mip_filter(filter == MipChain::filter_name(MipFilter::Kaiser) ? MipFilter::Kaiser : MipFilter::Box);
+            } else {
+                throw std::runtime_error(Formatter() << "Unknown argument: " << argument);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [--profile <name>]... [--all-profiles] [--filter <Box|Kaiser>]" << std::endl;
+        return 1;
+    }
+    if (profiles.empty()) {
+        profiles.push_back(model_loader.get_default_import_profile());
+    }
+
+    // [(description, bake)], where bake returns a summary of what it produced
+    std::vector<std::pair<std::string, std::function<std::string()>>> jobs{};
+    for (const auto& file: model_loader.get_available_models()) {
+        for (auto profile: profiles) {
+            jobs.emplace_back(Formatter() << "models/" << file << " (" << ImportProfiles::name(profile) << ")", [&model_loader, file, profile]() -> std::string {
+                auto baked_mesh = model_loader.bake_model(file, profile);
+                if (!baked_mesh.has_value()) return "skipped, not cached";
+                char summary[128];
+                std::snprintf(summary, sizeof(summary), "%zu vertices, %zu triangles, ACMR %.3f", baked_mesh->vertices.size(), baked_mesh->indices.size() / 3,
+                              MeshCache::average_cache_miss_ratio(baked_mesh->indices, baked_mesh->vertices.size()));
+                return summary;
+            });
+        }
+    }
+    for (const auto& file: texture_loader.get_available_textures()) {
+        // The special white and black textures are generated, not loaded
+        if (file.front() == '[') continue;
+        // Textures are baked for both colour spaces, since whether one is sRGB depends on how it is used.
+        // Flipped textures share the same mip chain, since the flip is applied to the texture coordinates.
+        for (bool srgb: {true, false}) {
+            jobs.emplace_back(Formatter() << "textures/" << file << " (" << (srgb ? "sRGB" : "linear") << ")", [&texture_loader, file, srgb]() -> std::string {
+                auto image = texture_loader.bake_texture(file, srgb);
+                return Formatter() << image.width << "x" << image.height << ", " << image.channels << " channels, " << image.levels.size() << " levels";
+            });
+        }
+    }
+
+    std::cout << "Baking " << jobs.size() << " assets on " << ThreadPool::shared().get_concurrency() << " threads" << std::endl;
+
+    std::mutex output_mutex{};
+    std::atomic<size_t> completed = 0;
+    std::atomic<size_t> failed = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    // Each bake also splits its own work across the pool, so the jobs are just handed out one at a time
+    ThreadPool::shared().parallel_for(jobs.size(), [&](size_t i) {
+        const auto& [description, bake] = jobs[i];
+        auto job_start = std::chrono::steady_clock::now();
+        std::string summary;
+        bool success = true;
+        try {
+            summary = bake();
+        } catch (const std::exception& e) {
+            summary = e.what();
+            success = false;
+            failed++;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job_start).count();
+
+        std::lock_guard lock(output_mutex);
+        char progress[64];
+        std::snprintf(progress, sizeof(progress), "[%3zu/%3zu] %8.1f ms ", ++completed, jobs.size(), ms);
+        (success ? std::cout : std::cerr) << progress << description << ": " << summary << std::endl;
+    });
+
+    double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Baked " << jobs.size() - failed << " of " << jobs.size() << " assets in " << total_ms << " ms" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,38 @@
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "utility/AssetPack.h"
+
+/// Packs asset directories into a single AssetPack file, which the loaders read from instead of the loose files.
+/// Usage: cits3003_asset_packer [--store] <output> <directory>...
+/// Run from the project root so the stored paths match how the loaders open files, e.g. `cits3003_asset_packer res.pack res/models res/textures`
+int main(int argc, char** argv) {
+    bool compress = true;
+    std::vector<std::string> arguments{};
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--store") {
+            compress = false;
+        } else {
+            arguments.push_back(argument);
+        }
+    }
+
+    if (arguments.size() < 2) {
+        std::cerr << "Usage: " << argv[0] << " [--store] <output> <directory>..." << std::endl;
+        return 1;
+    }
+
+    std::string output_path = arguments[0];
+    std::vector<std::string> directories{arguments.begin() + 1, arguments.end()};
+    try {
+        AssetPack::write(directories, output_path, compress);
+        AssetPack pack(output_path);
+        std::cout << "Packed " << directories.size() << " directories into [" << output_path << "]" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,262 @@
+#include "AssetPack.h"
+
+#include <limits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
+#include <zlib.h>
+
+namespace {
+    constexpr char MAGIC[8] = {'A', 'S', 'S', 'E', 'T', 'P', 'A', 'K'};
+    constexpr uint32_t VERSION = 1;
+    // magic, version, entry count, size of the index
+    constexpr size_t HEADER_SIZE = sizeof(MAGIC) + sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint64_t);
+    // The data of each entry starts on this alignment, so that binary formats can be read in place
+    constexpr uint64_t DATA_ALIGNMENT = 16;
+    // Compressed entries have to be at least this much smaller to be worth inflating on every load
+    constexpr double MIN_COMPRESSION_RATIO = 0.9;
+
+    // Values are little-endian, which is every platform this project builds for, so they are copied as is
+    template<typename T>
+    void write_value(std::vector<char>& out, T value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    struct Reader {
+        const char* data;
+        size_t size;
+        size_t position = 0;
+
+        void read_bytes(void* out, size_t count) {
+            if (count > size - position) {
+                throw std::runtime_error("Unexpected end of the index");
+            }
+            std::memcpy(out, data + position, count);
+            position += count;
+        }
+
+        template<typename T>
+        T read_value() {
+            T value;
+            read_bytes(&value, sizeof(T));
+            return value;
+        }
+    };
+
+    std::vector<char> read_whole_file(const std::filesystem::path& path) {
+        std::ifstream stream(path, std::ios::binary | std::ios::ate);
+        if (!stream) {
+            throw std::runtime_error(Formatter() << "Failed to open file: " << path.generic_string());
+        }
+        std::vector<char> bytes((size_t) stream.tellg());
+        stream.seekg(0);
+        stream.read(bytes.data(), (std::streamsize) bytes.size());
+        if (!stream) {
+            throw std::runtime_error(Formatter() << "Failed to read file: " << path.generic_string());
+        }
+        return bytes;
+    }
+}
+
+AssetPack::AssetPack(const std::string& path) : file(std::make_shared<const MappedFile>(path)) {
+    try {
+        Reader reader{file->get_data(), file->get_size()};
+
+        char magic[sizeof(MAGIC)];
+        reader.read_bytes(magic, sizeof(magic));
+        if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+            throw std::runtime_error("Not an asset pack");
+        }
+        auto version = reader.read_value<uint32_t>();
+        if (version != VERSION) {
+            throw std::runtime_error(Formatter() << "Unsupported version " << version);
+        }
+        auto entry_count = reader.read_value<uint32_t>();
+        auto index_size = reader.read_value<uint64_t>();
+        if (index_size > reader.size - reader.position) {
+            throw std::runtime_error("Index is larger than the file");
+        }
+        reader.size = HEADER_SIZE + index_size;
+
+        entries.reserve(entry_count);
+        for (uint32_t i = 0; i < entry_count; ++i) {
+            std::string entry_path(reader.read_value<uint32_t>(), '\0');
+            reader.read_bytes(entry_path.data(), entry_path.size());
+
+            Entry entry{};
+            entry.compression = (Compression) reader.read_value<uint8_t>();
+            entry.offset = reader.read_value<uint64_t>();
+            entry.stored_size = reader.read_value<uint64_t>();
+            entry.size = reader.read_value<uint64_t>();
+            entry.last_write_time = std::filesystem::file_time_type(std::filesystem::file_time_type::duration(reader.read_value<int64_t>()));
+
+            if (entry.compression != Compression::Stored && entry.compression != Compression::Zlib) {
+                throw std::runtime_error(Formatter() << "Unknown compression for entry " << entry_path);
+            }
+            if (entry.offset > file->get_size() || entry.stored_size > file->get_size() - entry.offset) {
+                throw std::runtime_error(Formatter() << "Entry " << entry_path << " is out of bounds");
+            }
+            entries[std::move(entry_path)] = entry;
+        }
+    } catch (const std::exception& e) {
+        throw std::runtime_error(Formatter() << "Failed to open asset pack (" << path << "): \n\t" << e.what());
+    }
+}
+
+const AssetPack* AssetPack::shared() {
+    static std::unique_ptr<AssetPack> pack = []() -> std::unique_ptr<AssetPack> {
+        std::error_code error;
+        if (!std::filesystem::is_regular_file(DEFAULT_PATH, error)) return nullptr;
+        try {
+            auto opened = std::make_unique<AssetPack>(DEFAULT_PATH);
+            std::cout << "Using asset pack [" << DEFAULT_PATH << "] with " << opened->entries.size() << " files" << std::endl;
+            return opened;
+        } catch (const std::exception& e) {
+            // Loose files still work, so carry on without it
+            std::cerr << e.what() << std::endl;
+            return nullptr;
+        }
+    }();
+    return pack.get();
+}
+
+const AssetPack::Entry* AssetPack::find(const std::string& path) const {
+    auto iter = entries.find(path);
+    return iter != entries.end() ? &iter->second : nullptr;
+}
+
+std::vector<std::string> AssetPack::list(const std::string& directory) const {
+    std::string prefix = directory + "/";
+    std::vector<std::string> files{};
+    for (const auto& [path, _]: entries) {
+        if (path.compare(0, prefix.size(), prefix) == 0) {
+            files.push_back(path.substr(prefix.size()));
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+FileContents AssetPack::read(const std::string& path) const {
+    const Entry* entry = find(path);
+    if (entry == nullptr) {
+        throw std::runtime_error(Formatter() << "File is not in the asset pack: " << path);
+    }
+    const char* stored = file->get_data() + entry->offset;
+
+    if (entry->compression == Compression::Stored) {
+        return FileContents::view(file, stored, entry->stored_size);
+    }
+
+    if (entry->size > std::numeric_limits<uLongf>::max() || entry->stored_size > std::numeric_limits<uLong>::max()) {
+        throw std::runtime_error(Formatter() << "Asset pack entry is too large to decompress: " << path);
+    }
+    std::vector<char> inflated(entry->size);
+    auto inflated_size = (uLongf) entry->size;
+    int result = uncompress(reinterpret_cast<Bytef*>(inflated.data()), &inflated_size, reinterpret_cast<const Bytef*>(stored), (uLong) entry->stored_size);
+    if (result != Z_OK || inflated_size != entry->size) {
+        throw std::runtime_error(Formatter() << "Failed to decompress asset pack entry: " << path << " (zlib error " << result << ")");
+    }
+    return FileContents::own(std::move(inflated));
+}
+
+void AssetPack::write(const std::vector<std::string>& directories, const std::string& output_path, bool compress) {
+    // (path, full_path), sorted so that the output is deterministic
+    std::vector<std::pair<std::string, std::filesystem::path>> files{};
+    for (auto directory: directories) {
+        while (directory.size() > 1 && directory.back() == '/') directory.pop_back();
+        if (!std::filesystem::is_directory(directory)) {
+            throw std::runtime_error(Formatter() << "Not a directory: " << directory);
+        }
+        for (const auto& file: std::filesystem::recursive_directory_iterator(directory)) {
+            if (!file.is_regular_file()) continue;
+            files.emplace_back(directory + "/" + std::filesystem::relative(file.path(), directory).generic_string(), file.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end(), [](const auto& a, const auto& b) { return a.first == b.first; }), files.end());
+    if (files.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Too many files for an asset pack");
+    }
+
+    std::vector<Entry> pack_entries(files.size());
+    std::vector<std::vector<char>> stored_data(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        const auto& full_path = files[i].second;
+        Entry& entry = pack_entries[i];
+        entry.last_write_time = std::filesystem::last_write_time(full_path);
+
+        auto bytes = read_whole_file(full_path);
+        entry.size = bytes.size();
+        entry.compression = Compression::Stored;
+
+        if (compress && !bytes.empty()) {
+            auto compressed_size = compressBound((uLong) bytes.size());
+            std::vector<char> compressed(compressed_size);
+            int result = compress2(reinterpret_cast<Bytef*>(compressed.data()), &compressed_size, reinterpret_cast<const Bytef*>(bytes.data()), (uLong) bytes.size(), Z_BEST_COMPRESSION);
+            if (result != Z_OK) {
+                throw std::runtime_error(Formatter() << "Failed to compress " << files[i].first << " (zlib error " << result << ")");
+            }
+            if ((double) compressed_size < (double) bytes.size() * MIN_COMPRESSION_RATIO) {
+                compressed.resize(compressed_size);
+                bytes = std::move(compressed);
+                entry.compression = Compression::Zlib;
+            }
+        }
+        entry.stored_size = bytes.size();
+        stored_data[i] = std::move(bytes);
+    }
+
+    // The size of the index is needed to know where the data starts, and so the offsets
+    uint64_t index_size = 0;
+    for (const auto& [path, _]: files) {
+        index_size += sizeof(uint32_t) + path.size() + sizeof(uint8_t) + 3 * sizeof(uint64_t) + sizeof(int64_t);
+    }
+    uint64_t offset = HEADER_SIZE + index_size;
+    for (auto& entry: pack_entries) {
+        offset = (offset + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+        entry.offset = offset;
+        offset += entry.stored_size;
+    }
+
+    std::vector<char> header{MAGIC, MAGIC + sizeof(MAGIC)};
+    write_value<uint32_t>(header, VERSION);
+    write_value<uint32_t>(header, (uint32_t) files.size());
+    write_value<uint64_t>(header, index_size);
+    for (size_t i = 0; i < files.size(); ++i) {
+        const auto& path = files[i].first;
+        const Entry& entry = pack_entries[i];
+        write_value<uint32_t>(header, (uint32_t) path.size());
+        header.insert(header.end(), path.begin(), path.end());
+        write_value<uint8_t>(header, (uint8_t) entry.compression);
+        write_value<uint64_t>(header, entry.offset);
+        write_value<uint64_t>(header, entry.stored_size);
+        write_value<uint64_t>(header, entry.size);
+        write_value<int64_t>(header, (int64_t) entry.last_write_time.time_since_epoch().count());
+    }
+
+    // Written next to the output then renamed over it, so a running program that has the old pack mapped is unaffected
+    std::string temp_path = output_path + ".tmp";
+    {
+        std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+        if (!stream) {
+            throw std::runtime_error(Formatter() << "Failed to open asset pack for writing: " << temp_path);
+        }
+        stream.write(header.data(), (std::streamsize) header.size());
+        uint64_t position = header.size();
+        for (size_t i = 0; i < files.size(); ++i) {
+            static constexpr char PADDING[DATA_ALIGNMENT] = {};
+            stream.write(PADDING, (std::streamsize) (pack_entries[i].offset - position));
+            stream.write(stored_data[i].data(), (std::streamsize) stored_data[i].size());
+            position = pack_entries[i].offset + stored_data[i].size();
+        }
+        if (!stream) {
+            throw std::runtime_error(Formatter() << "Failed to write asset pack: " << temp_path);
+        }
+    }
+    std::filesystem::rename(temp_path, output_path);
+}
@@ -0,0 +1,64 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+
+#include "utility/FileContents.h"
+#include "utility/MappedFile.h"
+#include "utility/HelperTypes.h"
+
+/// A single file archive of many small asset files, so that loading them doesn't need an open and stat for each one.
+///
+/// The archive starts with an index of every entry's (path, offset, size, modification time, compression),
+/// followed by the data of each entry. The whole archive is memory mapped, and stored entries are read straight out of the mapping,
+/// while zlib compressed entries are inflated into memory when read.
+///
+/// Paths are stored the same way the loaders open them, relative to the working directory (e.g. "res/models/cube.obj").
+class AssetPack : private NonCopyable {
+public:
+    enum class Compression : uint8_t {
+        Stored = 0,
+        Zlib = 1,
+    };
+
+    struct Entry {
+        uint64_t offset = 0;
+        // The number of bytes in the archive, and once decompressed
+        uint64_t stored_size = 0;
+        uint64_t size = 0;
+        // The modification time of the file when it was packed
+        std::filesystem::file_time_type last_write_time{};
+        Compression compression = Compression::Stored;
+    };
+
+    /// Where the loaders look for the pack, relative to the working directory
+    static constexpr const char* DEFAULT_PATH = "res.pack";
+private:
+    std::shared_ptr<const MappedFile> file;
+    // Map path -> entry
+    std::unordered_map<std::string, Entry> entries{};
+public:
+    /// Map and read the index of the pack at path, throws a std::runtime_error if it can't be opened or is malformed
+    explicit AssetPack(const std::string& path);
+
+    /// The pack at DEFAULT_PATH, opened the first time this is called, or nullptr if there isn't one
+    static const AssetPack* shared();
+
+    /// The entry for the file at path, or nullptr if it isn't in the pack
+    [[nodiscard]] const Entry* find(const std::string& path) const;
+    /// Every file within directory (and its subdirectories), relative to directory, sorted by path
+    [[nodiscard]] std::vector<std::string> list(const std::string& directory) const;
+    /// The contents of the file at path, throws a std::runtime_error if it isn't in the pack, or fails to decompress
+    [[nodiscard]] FileContents read(const std::string& path) const;
+
+    /// Pack every file under each of the directories into a new archive at output_path.
+    /// If compress is set, entries are zlib compressed, unless that doesn't make them meaningfully smaller (such as for PNGs).
+    static void write(const std::vector<std::string>& directories, const std::string& output_path, bool compress);
+};
+
+#endif //ASSET_PACK_H
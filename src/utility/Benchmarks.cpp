@@ -0,0 +1,244 @@
+#include "Benchmarks.h"
+
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <filesystem>
+
+#include "rendering/imgui/ImGuiManager.h"
+#include "rendering/resources/ModelLoader.h"
+#include "rendering/renders/EntityRenderer.h"
+
+namespace {
+    /// The conversion ModelLoader used before streaming straight from the aiMesh arrays, kept here as the baseline.
+    /// Copies each attribute into a VertexCollection, transforms it in place, then copies it again into the output.
+    template<typename VertexData>
+    void legacy_load_node(const aiScene* scene, const aiNode* node, std::vector<VertexData>& vertices, std::vector<uint>& indices, glm::mat4 parent_transform) {
+        glm::mat4 node_transform;
+        {
+            auto node_transform_ai = node->mTransformation;
+            node_transform = reinterpret_cast<glm::mat4&>(node_transform_ai.Transpose());
+        }
+
+        glm::mat4 total_transform = parent_transform * node_transform;
+        glm::mat3 normal_matrix = glm::mat3(
+            glm::cross(glm::vec3(total_transform[1]), glm::vec3(total_transform[2])),
+            glm::cross(glm::vec3(total_transform[2]), glm::vec3(total_transform[0])),
+            glm::cross(glm::vec3(total_transform[0]), glm::vec3(total_transform[1]))
+        );
+
+        for (auto mesh_i = 0u; mesh_i < node->mNumMeshes; ++mesh_i) {
+            auto index_offset = (uint) vertices.size();
+            const auto mesh = scene->mMeshes[node->mMeshes[mesh_i]];
+            if ((mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) == 0) continue;
+
+            const auto v = reinterpret_cast<glm::vec3*>(mesh->mVertices);
+            const auto n = reinterpret_cast<glm::vec3*>(mesh->mNormals);
+            const auto t = reinterpret_cast<glm::vec3*>(mesh->mTextureCoords[0]);
+
+            VertexCollection vertex_collection{
+                v ? std::vector<glm::vec3>{v, v + mesh->mNumVertices} : std::vector<glm::vec3>{},
+                n ? std::vector<glm::vec3>{n, n + mesh->mNumVertices} : std::vector<glm::vec3>{},
+                t ? std::vector<glm::vec2>{t, t + mesh->mNumVertices} : std::vector<glm::vec2>{},
+                {}
+            };
+
+            for (auto& position: vertex_collection.positions) {
+                position = total_transform * glm::vec4(position, 1.0f);
+            }
+
+            for (auto& normal: vertex_collection.normals) {
+                normal = normal_matrix * normal;
+            }
+
+            VertexData::from_mesh(vertex_collection, vertices);
+
+            for (auto i = 0u; i < mesh->mNumFaces; ++i) {
+                aiFace face = mesh->mFaces[i];
+                for (auto j = 0u; j < face.mNumIndices; j++) {
+                    indices.push_back(face.mIndices[j] + index_offset);
+                }
+            }
+        }
+
+        for (auto i = 0u; i < node->mNumChildren; ++i) {
+            legacy_load_node(scene, node->mChildren[i], vertices, indices, total_transform);
+        }
+    }
+}
+
+Benchmarks::Benchmarks(ModelLoader& model_loader) : model_loader(model_loader) {}
+
+void Benchmarks::add_imgui_options_section() {
+    if (ImGui::CollapsingHeader("Benchmarks")) {
+        if (ImGui::BeginCombo("Model", model_file.c_str())) {
+            for (const auto& model: model_loader.get_available_models()) {
+                if (ImGui::Selectable(model.c_str(), model == model_file)) {
+                    model_file = model;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::SliderInt("Iterations", &iterations, 1, 50);
+
+        if (ImGui::Button("Run Import Benchmark")) {
+            run_import_benchmark();
+        }
+        ImGui::SameLine();
+        ImGui::HelpMarker("Compares converting the imported scene into vertex and index buffers, the file is only read once and nothing is uploaded.");
+
+        ImGui::Separator();
+        ImGui::Checkbox("Use Generated Grid", &use_generated_grid);
+        if (use_generated_grid) {
+            ImGui::SliderInt("Grid Size", &grid_size, 10, 2000);
+        }
+        if (ImGui::Button("Run OBJ Benchmark")) {
+            run_obj_benchmark();
+        }
+        ImGui::SameLine();
+        ImGui::HelpMarker("Compares loading an OBJ file with Assimp against the fast OBJ parser, from reading the file up to the vertex and index buffers.");
+
+        for (const auto& result: results) {
+            ImGui::TextUnformatted(result.c_str());
+        }
+    }
+}
+
+void Benchmarks::run_import_benchmark() {
+    results.clear();
+
+    Assimp::Importer importer{};
+    const aiScene* scene = importer.ReadFile("res/models/" + model_file, ImportProfiles::post_process_flags(model_loader.get_default_import_profile()));
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        results.push_back(Formatter() << "Failed to import " << model_file << ": " << importer.GetErrorString());
+        return;
+    }
+
+    using VertexData = EntityRenderer::VertexData;
+    size_t vertex_count = 0;
+
+    try {
+        double legacy_ms = time_best_of([&]() {
+            std::vector<VertexData> vertices{};
+            std::vector<uint> indices{};
+            legacy_load_node(scene, scene->mRootNode, vertices, indices, glm::mat4{1.0f});
+            vertex_count = vertices.size();
+        });
+        double streaming_ms = time_best_of([&]() {
+            std::vector<VertexData> vertices{};
+            std::vector<uint> indices{};
+            ModelLoader::convert_scene(scene, vertices, indices);
+        });
+
+        auto throughput = [&](double ms) { return (double) vertex_count / (ms * 1.0e3); };
+        char line[128];
+        std::snprintf(line, sizeof(line), "%s: %zu vertices", model_file.c_str(), vertex_count);
+        results.emplace_back(line);
+        std::snprintf(line, sizeof(line), "Copying (old): %.3f ms, %.2f M vertices/s", legacy_ms, throughput(legacy_ms));
+        results.emplace_back(line);
+        std::snprintf(line, sizeof(line), "Streaming (parallel): %.3f ms, %.2f M vertices/s (%.2fx)", streaming_ms, throughput(streaming_ms), legacy_ms / streaming_ms);
+        results.emplace_back(line);
+    } catch (const std::exception& e) {
+        results.push_back(Formatter() << "Failed to convert " << model_file << ": " << e.what());
+    }
+}
+
+void Benchmarks::run_obj_benchmark() {
+    results.clear();
+
+    std::string path;
+    try {
+        path = use_generated_grid ? generate_grid_obj() : "res/models/" + model_file;
+    } catch (const std::exception& e) {
+        results.push_back(Formatter() << "Failed to generate grid: " << e.what());
+        return;
+    }
+
+    using VertexData = EntityRenderer::VertexData;
+    size_t assimp_vertex_count = 0;
+    size_t parser_vertex_count = 0;
+    size_t triangle_count = 0;
+
+    try {
+        if (!ObjParser::parse_file(path).has_value()) {
+            results.push_back(Formatter() << path << " needs Assimp's post-processing, so the fast parser falls back to it");
+            return;
+        }
+
+        double assimp_ms = time_best_of([&]() {
+            Assimp::Importer importer{};
+            const aiScene* scene = importer.ReadFile(path, ImportProfiles::post_process_flags(model_loader.get_default_import_profile()));
+            if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+                throw std::runtime_error(importer.GetErrorString());
+            }
+            std::vector<VertexData> vertices{};
+            std::vector<uint> indices{};
+            ModelLoader::convert_scene(scene, vertices, indices);
+            assimp_vertex_count = vertices.size();
+        });
+        double parser_ms = time_best_of([&]() {
+            auto obj_data = ObjParser::parse_file(path);
+            std::vector<VertexData> vertices{};
+            ModelLoader::convert_stream(obj_data->vertex_stream(), vertices);
+            parser_vertex_count = vertices.size();
+            triangle_count = obj_data->indices.size() / 3;
+        });
+
+        char line[160];
+        std::snprintf(line, sizeof(line), "%s: %zu triangles", path.c_str(), triangle_count);
+        results.emplace_back(line);
+        std::snprintf(line, sizeof(line), "Assimp: %.3f ms, %zu vertices", assimp_ms, assimp_vertex_count);
+        results.emplace_back(line);
+        std::snprintf(line, sizeof(line), "Fast OBJ Parser: %.3f ms, %zu vertices (%.2fx)", parser_ms, parser_vertex_count, assimp_ms / parser_ms);
+        results.emplace_back(line);
+    } catch (const std::exception& e) {
+        results.push_back(Formatter() << "Failed to load " << path << ": " << e.what());
+    }
+}
+
+std::string Benchmarks::generate_grid_obj() const {
+    std::filesystem::create_directories("cache/benchmarks");
+    std::string path = Formatter() << "cache/benchmarks/grid_" << grid_size << ".obj";
+    if (std::filesystem::exists(path)) return path;
+
+    std::ofstream file(path);
+    if (!file) throw std::runtime_error(Formatter() << "Could not open " << path << " for writing");
+
+    auto n = (uint) grid_size;
+    float scale = 1.0f / (float) n;
+    for (uint y = 0; y <= n; ++y) {
+        for (uint x = 0; x <= n; ++x) {
+            file << "v " << (float) x * scale << " 0 " << (float) y * scale << "\n";
+        }
+    }
+    for (uint y = 0; y <= n; ++y) {
+        for (uint x = 0; x <= n; ++x) {
+            file << "vt " << (float) x * scale << " " << (float) y * scale << "\n";
+        }
+    }
+    file << "vn 0 1 0\n";
+    for (uint y = 0; y < n; ++y) {
+        for (uint x = 0; x < n; ++x) {
+            uint a = y * (n + 1) + x + 1;
+            uint b = a + 1;
+            uint c = a + n + 1;
+            uint d = c + 1;
+            file << "f " << a << "/" << a << "/1 " << c << "/" << c << "/1 " << d << "/" << d << "/1 " << b << "/" << b << "/1\n";
+        }
+    }
+    if (!file) throw std::runtime_error(Formatter() << "Failed writing to " << path);
+    return path;
+}
+
+double Benchmarks::time_best_of(const std::function<void()>& fn) const {
+    double best = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
@@ -0,0 +1,40 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <string>
+#include <vector>
+#include <functional>
+
+class ModelLoader;
+
+/// Micro-benchmarks for the asset pipeline, run on demand from ImGUI,
+/// comparing the current code paths against the ones they replaced.
+class Benchmarks {
+    ModelLoader& model_loader;
+
+    std::string model_file = "sphere.obj";
+    int iterations = 5;
+    bool use_generated_grid = false;
+    int grid_size = 500;
+
+    std::vector<std::string> results{};
+public:
+    explicit Benchmarks(ModelLoader& model_loader);
+
+    /// Adds the ImGUI controls for running the benchmarks, and the results of the last run
+    void add_imgui_options_section();
+
+private:
+    /// Times the conversion from an imported aiScene to vertex and index buffers
+    void run_import_benchmark();
+    /// Times parsing an OBJ file with Assimp against the ObjParser, both including the conversion to vertex and index buffers
+    void run_obj_benchmark();
+
+    /// Writes a grid_size x grid_size grid of quads as an OBJ file, to benchmark with something larger than the included models
+    std::string generate_grid_obj() const;
+
+    /// Runs fn the configured number of times, returning the fastest time in milliseconds
+    double time_best_of(const std::function<void()>& fn) const;
+};
+
+#endif //BENCHMARKS_H
@@ -0,0 +1,50 @@
+#ifndef FILE_CONTENTS_H
+#define FILE_CONTENTS_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+#include "utility/MappedFile.h"
+
+/// The bytes of a whole file, either pointing into a memory mapping, or owned in memory such as when decompressed out of an AssetPack.
+/// The data stays at the same address when this is moved, so parsers can keep pointers into it.
+class FileContents {
+    std::shared_ptr<const MappedFile> mapping{};
+    std::vector<char> buffer{};
+    const char* data = nullptr;
+    size_t size = 0;
+
+    FileContents() = default;
+public:
+    /// Memory map the whole file at path, throws a std::runtime_error if it can't be opened
+    static FileContents map(const std::string& path) {
+        auto mapped_file = std::make_shared<const MappedFile>(path);
+        return view(mapped_file, mapped_file->get_data(), mapped_file->get_size());
+    }
+
+    /// A range within an existing mapping, which is kept alive for as long as the contents are
+    static FileContents view(std::shared_ptr<const MappedFile> mapping, const char* data, size_t size) {
+        FileContents contents{};
+        contents.mapping = std::move(mapping);
+        contents.data = data;
+        contents.size = size;
+        return contents;
+    }
+
+    /// Take ownership of bytes that are already in memory
+    static FileContents own(std::vector<char> buffer) {
+        FileContents contents{};
+        contents.buffer = std::move(buffer);
+        contents.data = contents.buffer.data();
+        contents.size = contents.buffer.size();
+        return contents;
+    }
+
+    /// The contents of the file, may be nullptr if the file is empty
+    [[nodiscard]] const char* get_data() const { return data; }
+    [[nodiscard]] size_t get_size() const { return size; }
+};
+
+#endif //FILE_CONTENTS_H
@@ -0,0 +1,243 @@
+#include "FileWatcher.h"
+
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+FileWatcher::FileWatcher(std::string root) : root(std::move(root)) {
+#ifdef __linux__
+    // Watch before scanning, so that a file changed in between is still caught by an event rather than missed by both
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        std::cerr << "Failed to initialise inotify for [" << this->root << "], falling back to polling" << std::endl;
+    } else {
+        add_inotify_watch("");
+    }
+#endif
+
+    scan_directory("", index);
+
+    watch_thread = std::thread([this]() { watch_loop(); });
+}
+
+std::optional<std::filesystem::file_time_type> FileWatcher::get_last_write_time(const std::string& relative_path) const {
+    std::lock_guard lock(mutex);
+    auto iter = index.find(relative_path);
+    if (iter == index.end()) return std::nullopt;
+    return iter->second;
+}
+
+std::vector<std::string> FileWatcher::list_files() const {
+    std::vector<std::string> files{};
+    {
+        std::lock_guard lock(mutex);
+        files.reserve(index.size());
+        for (const auto& [path, _]: index) {
+            files.push_back(path);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+uint64_t FileWatcher::get_listing_version() const {
+    std::lock_guard lock(mutex);
+    return listing_version;
+}
+
+std::vector<std::string> FileWatcher::poll_changes() {
+    std::lock_guard lock(mutex);
+    std::vector<std::string> changes{pending_changes.begin(), pending_changes.end()};
+    pending_changes.clear();
+    return changes;
+}
+
+const std::string& FileWatcher::get_root() const {
+    return root;
+}
+
+FileWatcher::~FileWatcher() {
+    stopping = true;
+    watch_thread.join();
+#ifdef __linux__
+    if (inotify_fd >= 0) close(inotify_fd);
+#endif
+}
+
+void FileWatcher::scan_directory(const std::string& relative_directory, std::unordered_map<std::string, std::filesystem::file_time_type>& out) const {
+    std::filesystem::path directory = std::filesystem::path(root) / relative_directory;
+    std::error_code error;
+    for (auto iter = std::filesystem::recursive_directory_iterator(directory, error); !error && iter != std::filesystem::recursive_directory_iterator(); iter.increment(error)) {
+        if (!iter->is_regular_file(error)) continue;
+        auto last_write_time = iter->last_write_time(error);
+        if (error) continue;
+        out[std::filesystem::relative(iter->path(), root).generic_string()] = last_write_time;
+    }
+}
+
+void FileWatcher::refresh_path(const std::string& relative_path) {
+    std::filesystem::path full_path = std::filesystem::path(root) / relative_path;
+    std::error_code error;
+    bool is_file = std::filesystem::is_regular_file(full_path, error);
+    auto last_write_time = is_file ? std::filesystem::last_write_time(full_path, error) : std::filesystem::file_time_type{};
+
+    std::lock_guard lock(mutex);
+    if (is_file && !error) {
+        auto [iter, inserted] = index.try_emplace(relative_path, last_write_time);
+        if (inserted) {
+            listing_version++;
+            pending_changes.insert(relative_path);
+        } else if (iter->second != last_write_time) {
+            iter->second = last_write_time;
+            pending_changes.insert(relative_path);
+        }
+    } else if (index.erase(relative_path) != 0) {
+        listing_version++;
+        pending_changes.insert(relative_path);
+    }
+}
+
+void FileWatcher::watch_loop() {
+#ifdef __linux__
+    if (inotify_fd < 0) {
+        poll_loop();
+        return;
+    }
+
+    // Large enough for a good number of events, each of which is followed by its (variable length) name
+    alignas(inotify_event) char buffer[16 * 1024];
+    while (!stopping) {
+        // Wake up periodically to check if the watcher is being destroyed
+        pollfd poll_fd{inotify_fd, POLLIN, 0};
+        if (poll(&poll_fd, 1, 250) <= 0) continue;
+
+        ssize_t length;
+        while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+            for (char* ptr = buffer; ptr < buffer + length;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                // The watch is gone (the directory was deleted, moved away or unwatched), so its descriptor may be reused
+                if ((event->mask & IN_IGNORED) != 0) {
+                    watched_directories.erase(event->wd);
+                    continue;
+                }
+
+                auto directory = watched_directories.find(event->wd);
+                if (directory == watched_directories.end() || event->len == 0) continue;
+                std::string relative_path = directory->second.empty() ? std::string(event->name) : directory->second + "/" + event->name;
+
+                if ((event->mask & IN_ISDIR) != 0) {
+                    if ((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0) {
+                        add_inotify_watch(relative_path);
+                        std::unordered_map<std::string, std::filesystem::file_time_type> added{};
+                        scan_directory(relative_path, added);
+                        for (const auto& [path, _]: added) {
+                            refresh_path(path);
+                        }
+                    } else if ((event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0) {
+                        // The kernel removes the watches of a deleted directory itself, but a moved one keeps them under
+                        // its old path, so drop them here and let IN_MOVED_TO watch it again under the new one
+                        if ((event->mask & IN_MOVED_FROM) != 0) {
+                            remove_inotify_watches(relative_path);
+                        }
+
+                        std::lock_guard lock(mutex);
+                        std::string prefix = relative_path + "/";
+                        for (auto iter = index.begin(); iter != index.end();) {
+                            if (iter->first.compare(0, prefix.size(), prefix) == 0) {
+                                pending_changes.insert(iter->first);
+                                iter = index.erase(iter);
+                                listing_version++;
+                            } else {
+                                ++iter;
+                            }
+                        }
+                    }
+                } else if ((event->mask & ~IN_CREATE) != 0) {
+                    // A file that was only just created may still be being written, wait for its IN_CLOSE_WRITE
+                    refresh_path(relative_path);
+                }
+            }
+        }
+    }
+#else
+    poll_loop();
+#endif
+}
+
+#ifdef __linux__
+void FileWatcher::add_inotify_watch(const std::string& relative_directory) {
+    // IN_CREATE is only needed for directories, new files are picked up by IN_CLOSE_WRITE once they are fully written
+    constexpr uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ATTRIB;
+
+    std::filesystem::path directory = std::filesystem::path(root) / relative_directory;
+    int watch_descriptor = inotify_add_watch(inotify_fd, directory.string().c_str(), mask);
+    if (watch_descriptor < 0) {
+        std::cerr << "Failed to watch directory: " << directory << std::endl;
+        return;
+    }
+    watched_directories[watch_descriptor] = relative_directory;
+
+    std::error_code error;
+    for (auto iter = std::filesystem::directory_iterator(directory, error); !error && iter != std::filesystem::directory_iterator(); iter.increment(error)) {
+        if (iter->is_directory(error)) {
+            auto child = std::filesystem::relative(iter->path(), root).generic_string();
+            add_inotify_watch(child);
+        }
+    }
+}
+
+void FileWatcher::remove_inotify_watches(const std::string& relative_directory) {
+    std::string prefix = relative_directory + "/";
+    for (auto iter = watched_directories.begin(); iter != watched_directories.end();) {
+        if (iter->second == relative_directory || iter->second.compare(0, prefix.size(), prefix) == 0) {
+            inotify_rm_watch(inotify_fd, iter->first);
+            iter = watched_directories.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+#endif
+
+void FileWatcher::poll_loop() {
+    using namespace std::chrono_literals;
+    auto next_scan = std::chrono::steady_clock::now() + 1s;
+
+    while (!stopping) {
+        std::this_thread::sleep_for(100ms);
+        if (std::chrono::steady_clock::now() < next_scan) continue;
+        next_scan = std::chrono::steady_clock::now() + 1s;
+
+        std::unordered_map<std::string, std::filesystem::file_time_type> current{};
+        scan_directory("", current);
+
+        std::lock_guard lock(mutex);
+        for (const auto& [path, last_write_time]: current) {
+            auto [iter, inserted] = index.try_emplace(path, last_write_time);
+            if (inserted) {
+                listing_version++;
+                pending_changes.insert(path);
+            } else if (iter->second != last_write_time) {
+                iter->second = last_write_time;
+                pending_changes.insert(path);
+            }
+        }
+        for (auto iter = index.begin(); iter != index.end();) {
+            if (current.count(iter->first) == 0) {
+                pending_changes.insert(iter->first);
+                iter = index.erase(iter);
+                listing_version++;
+            } else {
+                ++iter;
+            }
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <vector>
+#include <optional>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "utility/HelperTypes.h"
+
+/// Watches every file under a root directory from a background thread, keeping an in-memory index of the files and
+/// their modification times, so that loaders don't need to hit the filesystem on every load.
+/// Uses inotify on Linux, and falls back to periodically rescanning the directory elsewhere.
+/// Paths are always relative to the root, and use '/' as the separator.
+class FileWatcher : private NonCopyable {
+    std::string root;
+
+    mutable std::mutex mutex;
+    // Map relative_path -> last_write_time
+    std::unordered_map<std::string, std::filesystem::file_time_type> index{};
+    // Bumped every time a file is added or removed
+    uint64_t listing_version = 0;
+    std::unordered_set<std::string> pending_changes{};
+
+    std::atomic<bool> stopping = false;
+    std::thread watch_thread;
+
+#ifdef __linux__
+    int inotify_fd = -1;
+    // Map watch_descriptor -> relative_directory
+    std::unordered_map<int, std::string> watched_directories{};
+#endif
+public:
+    /// Starts watching the root directory for changes, then scans it to build the initial index.
+    explicit FileWatcher(std::string root);
+
+    /// The modification time of the file, or std::nullopt if it doesn't exist (as far as the watcher knows).
+    [[nodiscard]] std::optional<std::filesystem::file_time_type> get_last_write_time(const std::string& relative_path) const;
+    /// A sorted list of all the files currently under the root
+    [[nodiscard]] std::vector<std::string> list_files() const;
+    /// Changes whenever a file is added or removed, so callers can tell when a listing needs refreshing
+    [[nodiscard]] uint64_t get_listing_version() const;
+
+    /// Take every path that has been created, modified or deleted since the last call
+    std::vector<std::string> poll_changes();
+
+    [[nodiscard]] const std::string& get_root() const;
+
+    ~FileWatcher();
+private:
+    /// Collect every file under the relative directory, along with its modification time
+    void scan_directory(const std::string& relative_directory, std::unordered_map<std::string, std::filesystem::file_time_type>& out) const;
+    /// Re-stat a single path, and update the index and pending changes accordingly
+    void refresh_path(const std::string& relative_path);
+
+    void watch_loop();
+#ifdef __linux__
+    void add_inotify_watch(const std::string& relative_directory);
+    /// Stop watching the relative directory and every directory under it
+    void remove_inotify_watches(const std::string& relative_directory);
+#endif
+    void poll_loop();
+};
+
+#endif //FILE_WATCHER_H
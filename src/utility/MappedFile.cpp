@@ -0,0 +1,77 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+    file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        file_handle = nullptr;
+        throw std::runtime_error(Formatter() << "Failed to open file for mapping: " << path);
+    }
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file_handle, &file_size);
+    size = (size_t) file_size.QuadPart;
+    if (size == 0) return;
+
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle != nullptr) {
+        data = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (data == nullptr) {
+        if (mapping_handle != nullptr) CloseHandle(mapping_handle);
+        CloseHandle(file_handle);
+        throw std::runtime_error(Formatter() << "Failed to map file: " << path);
+    }
+#else
+    file_descriptor = open(path.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        throw std::runtime_error(Formatter() << "Failed to open file for mapping: " << path);
+    }
+
+    struct stat file_stat{};
+    fstat(file_descriptor, &file_stat);
+    size = (size_t) file_stat.st_size;
+    if (size == 0) return;
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    if (mapping == MAP_FAILED) {
+        close(file_descriptor);
+        throw std::runtime_error(Formatter() << "Failed to map file: " << path);
+    }
+    // The whole file is about to be read, so start paging it in now
+    madvise(mapping, size, MADV_WILLNEED);
+    data = static_cast<const char*>(mapping);
+#endif
+}
+
+const char* MappedFile::get_data() const {
+    return data;
+}
+
+size_t MappedFile::get_size() const {
+    return size;
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+    if (data != nullptr) UnmapViewOfFile(data);
+    if (mapping_handle != nullptr) CloseHandle(mapping_handle);
+    if (file_handle != nullptr) CloseHandle(file_handle);
+#else
+    if (data != nullptr) munmap(const_cast<char*>(data), size);
+    if (file_descriptor >= 0) close(file_descriptor);
+#endif
+}
@@ -0,0 +1,32 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+#include "utility/HelperTypes.h"
+
+/// A read-only memory mapping of a whole file, so it can be parsed in place without copying it into memory first.
+/// Uses mmap on POSIX systems and a file mapping object on Windows.
+class MappedFile : private NonCopyable {
+    const char* data = nullptr;
+    size_t size = 0;
+
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#else
+    int file_descriptor = -1;
+#endif
+public:
+    /// Maps the file at path, throws a std::runtime_error if it can't be opened or mapped
+    explicit MappedFile(const std::string& path);
+
+    /// The contents of the file, nullptr if the file is empty
+    [[nodiscard]] const char* get_data() const;
+    [[nodiscard]] size_t get_size() const;
+
+    ~MappedFile();
+};
+
+#endif //MAPPED_FILE_H
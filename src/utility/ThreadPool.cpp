@@ -0,0 +1,125 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint thread_count) {
+    workers.reserve(thread_count);
+    for (uint i = 0; i < thread_count; ++i) {
+        workers.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& fn, size_t grain) {
+    if (count == 0) return;
+
+    // Small batches so that uneven work still balances out, but not so small that claiming them becomes the bottleneck
+    size_t concurrency = get_concurrency();
+    size_t batch_size = std::max({grain, (size_t) 1, count / (concurrency * 16)});
+    size_t batch_count = (count + batch_size - 1) / batch_size;
+    size_t helper_count = std::min(batch_count, concurrency) - 1;
+
+    if (helper_count == 0) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next = 0;
+    std::atomic<size_t> remaining = helper_count;
+    std::exception_ptr exception = nullptr;
+    std::mutex exception_mutex;
+
+    // Rather than handing each thread a fixed range, every thread keeps claiming the next unclaimed batch,
+    // so threads that finish early (or join late) take over the work the others haven't reached yet
+    auto run_batches = [&]() {
+        try {
+            for (size_t begin = next.fetch_add(batch_size); begin < count; begin = next.fetch_add(batch_size)) {
+                size_t end = std::min(count, begin + batch_size);
+                for (size_t i = begin; i < end; ++i) fn(i);
+            }
+        } catch (...) {
+            std::lock_guard lock(exception_mutex);
+            exception = std::current_exception();
+            next = count;
+        }
+    };
+
+    for (size_t helper = 0; helper < helper_count; ++helper) {
+        enqueue([&]() {
+            run_batches();
+            remaining.fetch_sub(1, std::memory_order_acq_rel);
+        });
+    }
+    run_batches();
+
+    // The helpers reference this stack frame, so wait for all of them to finish, even if they had nothing left to claim.
+    // Help out rather than just blocking, this is also what makes nested calls safe
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        if (!run_pending_task()) {
+            std::this_thread::yield();
+        }
+    }
+
+    if (exception != nullptr) {
+        std::rethrow_exception(exception);
+    }
+}
+
+bool ThreadPool::run_pending_task() {
+    std::function<void()> task;
+    {
+        std::lock_guard lock(mutex);
+        if (tasks.empty()) return false;
+        task = std::move(tasks.front());
+        tasks.pop_front();
+    }
+    task();
+    return true;
+}
+
+uint ThreadPool::get_concurrency() const {
+    return (uint) workers.size() + 1;
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool{};
+    return pool;
+}
+
+uint ThreadPool::default_thread_count() {
+    // hardware_concurrency() is allowed to return 0 if it can't tell
+    uint cores = std::thread::hardware_concurrency();
+    return std::max(cores, 2u) - 1;
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    task_available.notify_all();
+    for (auto& worker: workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    task_available.notify_one();
+}
+
+void ThreadPool::worker_loop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            task_available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
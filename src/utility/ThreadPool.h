@@ -0,0 +1,66 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+#include "utility/HelperTypes.h"
+
+/// A fixed size pool of worker threads, used to spread CPU heavy work (such as asset processing) over all the cores.
+///
+/// Threads that wait on work submitted to the pool (including the pool's own workers) help run queued tasks while they wait,
+/// so it is safe to nest parallel_for calls, e.g. parallel over textures, and then parallel over rows within each texture.
+class ThreadPool : private NonCopyable {
+    std::vector<std::thread> workers{};
+    std::deque<std::function<void()>> tasks{};
+    std::mutex mutex{};
+    std::condition_variable task_available{};
+    bool stopping = false;
+
+public:
+    /// Create a pool with the given number of worker threads, by default one less than the number of cores,
+    /// since the thread that submits work also helps complete it.
+    explicit ThreadPool(uint thread_count = default_thread_count());
+
+    /// Queue a function to be run on the pool, returning a future for its result.
+    template<typename Function>
+    auto submit(Function&& function) -> std::future<decltype(function())>;
+
+    /// Runs fn(i) for every i in [0, count), in batches of at least `grain` items that the calling thread and the pool's threads claim as they go,
+    /// so uneven work balances itself out. Blocks until every call has completed, running tasks on the calling thread in the meantime.
+    void parallel_for(size_t count, const std::function<void(size_t i)>& fn, size_t grain = 1);
+
+    /// Runs a single queued task on the calling thread, if there is one. Returns false if the queue was empty.
+    bool run_pending_task();
+
+    /// The number of threads that can run work concurrently, including the calling thread.
+    [[nodiscard]] uint get_concurrency() const;
+
+    /// A pool shared by the whole program, created on first use.
+    static ThreadPool& shared();
+
+    static uint default_thread_count();
+
+    ~ThreadPool();
+private:
+    void enqueue(std::function<void()> task);
+    void worker_loop();
+};
+
+template<typename Function>
+auto ThreadPool::submit(Function&& function) -> std::future<decltype(function())> {
+    using Result = decltype(function());
+    // packaged_task is move only, but std::function requires copyable, so wrap it in a shared_ptr
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+    auto future = task->get_future();
+    enqueue([task]() { (*task)(); });
+    return future;
+}
+
+#endif //THREAD_POOL_H